@@ -32,6 +32,8 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.*/
 
 #include <media/AudioSystem.h>
 #include <sys/poll.h>
+#include <cutils/properties.h>
+#include <cutils/uevent.h>
 
 #include "AudioDaemon.h"
 
@@ -42,16 +44,53 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.*/
 #define MAX_SLEEP_RETRY 100
 #define AUDIO_INIT_SLEEP_WAIT 100 /* 100 ms */
 
+#define UEVENT_MSG_LEN 2048
+#define STATE_COALESCE_PROPERTY "audio.audiod.coalesce.ms"
+#define STATE_COALESCE_DEFAULT_MS "50"
+
 int bootup_complete = 0;
 bool cpe_bootup_complete = false;
 
 namespace android {
 
-    AudioDaemon::AudioDaemon() : Thread(false) {
+    /* State node contents, matched against the start of the node */
+    static const struct {
+        const char *name;
+        int state;
+    } kStateTable[] = {
+        { "ONLINE",  1 },
+        { "OFFLINE", 0 },
+    };
+
+    static int parseState(const char *buf)
+    {
+        unsigned int i;
+        size_t len;
+
+        for (i = 0; i < sizeof(kStateTable) / sizeof(kStateTable[0]); i++) {
+            len = strlen(kStateTable[i].name);
+            if (!strncmp(buf, kStateTable[i].name, len) &&
+                    (buf[len] == '\0' || buf[len] == '\n' || buf[len] == ' '))
+                return kStateTable[i].state;
+        }
+        return -1;
+    }
+
+    static notify_status toNotifyStatus(notify_status_type type, int state)
+    {
+        if (type == CPE_STATE)
+            return state ? cpe_online : cpe_offline;
+        return state ? snd_card_online : snd_card_offline;
+    }
+
+    AudioDaemon::AudioDaemon() : Thread(false),
+        mUeventSock(-1), mCpeRetry(0), mCpeRetryTime(0), mNumCpe(0), mCoalesceNs(0) {
     }
 
     AudioDaemon::~AudioDaemon() {
         putStateFDs(mSndCardFd);
+        if (mUeventSock >= 0)
+            close(mUeventSock);
     }
 
     void AudioDaemon::onFirstRef() {
@@ -68,9 +107,7 @@ namespace android {
     {
         FILE *fp;
         int fd;
-        char *ptr, *saveptr;
         char buffer[128];
-        int line = 0;
         String8 path;
         int sndcard;
         const char* cards = "/proc/asound/cards";
@@ -83,24 +120,18 @@ namespace android {
         sndcardFdPair.clear();
         memset(buffer, 0x0, sizeof(buffer));
         while ((fgets(buffer, sizeof(buffer), fp) != NULL)) {
-            if (line % 2)
+            /* Each card is " N [id    ]: driver - name" plus a description line */
+            if (sscanf(buffer, " %d [", &sndcard) != 1)
                 continue;
-            ptr = strtok_r(buffer, " [", &saveptr);
-            if (ptr) {
-                path = "/proc/asound/card";
-                path += ptr;
-                path += "/state";
-                ALOGD("Opening sound card state : %s", path.string());
-                fd = open(path.string(), O_RDONLY);
-                if (fd == -1) {
-                    ALOGE("Open %s failed : %s", path.string(), strerror(errno));
-                } else {
-                    /* returns vector of pair<sndcard, fd> */
-                    sndcard = atoi(ptr);
-                    sndcardFdPair.push_back(std::make_pair(sndcard, fd));
-                }
+            path = String8::format("/proc/asound/card%d/state", sndcard);
+            ALOGD("Opening sound card state : %s", path.string());
+            fd = open(path.string(), O_RDONLY);
+            if (fd == -1) {
+                ALOGE("Open %s failed : %s", path.string(), strerror(errno));
+            } else {
+                /* returns vector of pair<sndcard, fd> */
+                sndcardFdPair.push_back(std::make_pair(sndcard, fd));
             }
-            line++;
         }
 
         ALOGV("%s: %d sound cards detected", __func__, sndcardFdPair.size());
@@ -115,189 +146,330 @@ namespace android {
         for (i = 0; i < sndcardFdPair.size(); i++)
             close(sndcardFdPair[i].second);
         sndcardFdPair.clear();
+        mNodes.clear();
     }
 
     status_t AudioDaemon::readyToRun() {
 
         ALOGV("readyToRun: open snd card state node files");
+        /* opened once, threadLoop() runs again when no sound card shows up */
+        mUeventSock = uevent_open_socket(64 * 1024, true);
+        if (mUeventSock < 0)
+            ALOGW("uevent socket unavailable, polling for sound cards");
         return NO_ERROR;
     }
 
+    /* Returns true for a uevent from the sound subsystem */
+    bool AudioDaemon::processUeventMessage()
+    {
+        char msg[UEVENT_MSG_LEN + 2];
+        char *cp;
+        int n;
+
+        n = uevent_kernel_multicast_recv(mUeventSock, msg, UEVENT_MSG_LEN);
+        if (n <= 0 || n >= UEVENT_MSG_LEN)
+            return false;
+        msg[n] = '\0';
+        msg[n + 1] = '\0';
+
+        for (cp = msg; *cp; cp += strlen(cp) + 1) {
+            if (!strcmp(cp, "SUBSYSTEM=sound"))
+                return true;
+        }
+        return false;
+    }
+
+    /*
+     * Waits until /proc/asound/cards lists a card whose state node opens.
+     * Sound uevents trigger a new attempt as soon as the driver registers
+     * a card; the 100 ms retry only remains as a fallback and bounds the
+     * total wait as before.
+     */
+    bool AudioDaemon::waitForSoundCards()
+    {
+        nsecs_t start = systemTime();
+        nsecs_t limit = start + milliseconds_to_nanoseconds(
+                                    MAX_SLEEP_RETRY * AUDIO_INIT_SLEEP_WAIT);
+        struct pollfd pfd;
+
+        while (!getStateFDs(mSndCardFd)) {
+            nsecs_t now = systemTime();
+            if (now >= limit)
+                return false;
+
+            if (mUeventSock < 0) {
+                ALOGE("Sleeping for 100 ms");
+                usleep(AUDIO_INIT_SLEEP_WAIT*1000);
+                continue;
+            }
+            pfd.fd = mUeventSock;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if (poll(&pfd, 1, AUDIO_INIT_SLEEP_WAIT) > 0)
+                processUeventMessage();
+        }
+        ALOGD("%d sound cards ready after %lld ms", mSndCardFd.size(),
+              (long long)nanoseconds_to_milliseconds(systemTime() - start));
+        return true;
+    }
+
+    void AudioDaemon::addStateNode(int id, int fd, notify_status_type type)
+    {
+        state_node node;
+
+        memset(&node, 0, sizeof(node));
+        node.id = id;
+        node.fd = fd;
+        node.type = type;
+        node.state = -1;
+        node.notified = -1;
+        mNodes.push_back(node);
+    }
+
+    /* Opens the cpe0_state nodes that are still pending, without sleeping */
+    void AudioDaemon::openCpeStates()
+    {
+        char path[50];
+        int fd;
+        unsigned int i = 0;
+
+        while (i < mCpePending.size()) {
+            snprintf(path, sizeof(path), "/proc/asound/card%d/cpe0_state", mCpePending[i]);
+            fd = open(path, O_RDONLY);
+            if (fd == -1) {
+                ALOGE("CPE state open %s failed %s, Retrying %d",
+                      path, strerror(errno), mCpeRetry);
+                i++;
+                continue;
+            }
+            ALOGD("cpe state opened: %s", path);
+            mSndCardFd.push_back(std::make_pair(CPE_MAGIC_NUM + mNumCpe, fd));
+            addStateNode(CPE_MAGIC_NUM + mNumCpe, fd, CPE_STATE);
+            mNumCpe++;
+            mCpePending.erase(mCpePending.begin() + i);
+        }
+
+        mCpeRetry++;
+        if (mCpePending.empty() || mCpeRetry >= MAX_CPE_SLEEP_RETRY)
+            mCpePending.clear();
+        else
+            mCpeRetryTime = systemTime() + milliseconds_to_nanoseconds(CPE_SLEEP_WAIT);
+
+        /* nothing left to wait for, stop waking up on every system uevent */
+        if (mCpePending.empty() && mUeventSock >= 0) {
+            close(mUeventSock);
+            mUeventSock = -1;
+        }
+    }
+
+    /*
+     * Reads a state node and arms its coalescing deadline on a change.
+     * Flaps within the window are collapsed, so an SSR that bounces
+     * OFFLINE/ONLINE several times produces a single notification per
+     * direction; see flushStateNodes().
+     */
+    void AudioDaemon::readStateNode(state_node &node, nsecs_t now)
+    {
+        char rd_buf[9];
+        ssize_t n;
+        int state;
+
+        n = read(node.fd, (void *)rd_buf, 8);
+        lseek(node.fd, 0, SEEK_SET);
+        if (n <= 0) {
+            ALOGE("Error receiving sound card %d state event (%s)",
+                  node.id, strerror(errno));
+            return;
+        }
+        rd_buf[n] = '\0';
+
+        state = parseState(rd_buf);
+        if (state < 0) {
+            ALOGE("ERROR %s %d rd_buf %s",
+                  node.type == CPE_STATE ? "CPE" : "sound card", node.id, rd_buf);
+            return;
+        }
+        ALOGV("%s %d state %s", node.type == CPE_STATE ? "CPE" : "sound card",
+              node.id, state ? "ONLINE" : "OFFLINE");
+
+        if (state == node.state)
+            return;
+        if (node.deadline)
+            node.coalesced++;
+        node.state = state;
+
+        if (!state && !node.offline_time) {
+            node.offline_time = now;
+        } else if (state && node.offline_time) {
+            nsecs_t recovery = now - node.offline_time;
+            node.offline_time = 0;
+            node.outages++;
+            node.recovery_last = recovery;
+            node.recovery_total += recovery;
+            if (!node.recovery_min || recovery < node.recovery_min)
+                node.recovery_min = recovery;
+            if (recovery > node.recovery_max)
+                node.recovery_max = recovery;
+            ALOGI("%s %d recovered in %lld ms, recovery stats: outages %u "
+                  "min %lld ms max %lld ms avg %lld ms coalesced %u",
+                  node.type == CPE_STATE ? "CPE" : "sound card", node.id,
+                  (long long)nanoseconds_to_milliseconds(recovery), node.outages,
+                  (long long)nanoseconds_to_milliseconds(node.recovery_min),
+                  (long long)nanoseconds_to_milliseconds(node.recovery_max),
+                  (long long)nanoseconds_to_milliseconds(node.recovery_total / node.outages),
+                  node.coalesced);
+        }
+
+        if (node.type == CPE_STATE) {
+            if (!cpe_bootup_complete) {
+                node.notified = state;
+                if (state) {
+                    cpe_bootup_complete = true;
+                    ALOGD("CPE boot up completed");
+                }
+                return;
+            }
+        } else if (!bootup_complete) {
+            node.notified = state;
+            if (state) {
+                bootup_complete = 1;
+                ALOGD("bootup_complete set to 1");
+            }
+            return;
+        }
+        if (!state)
+            node.went_offline = true;
+        node.deadline = now + mCoalesceNs;
+    }
+
+    /*
+     * Reports the state changes whose coalescing window has passed. A node
+     * that went OFFLINE and came back ONLINE within the window is still
+     * reported as one OFFLINE/ONLINE pair, the HAL has to recover from the
+     * restart however short it was.
+     */
+    void AudioDaemon::flushStateNodes(nsecs_t now)
+    {
+        unsigned int i;
+        bool restarted;
+
+        for (i = 0; i < mNodes.size(); i++) {
+            state_node &node = mNodes[i];
+
+            if (!node.deadline || node.deadline > now)
+                continue;
+            node.deadline = 0;
+            restarted = node.state && node.went_offline && node.notified != 0;
+            node.went_offline = false;
+            if (node.state == node.notified && !restarted) {
+                ALOGD("%d state bounced back to %d, not notifying", node.id, node.state);
+                continue;
+            }
+            if (restarted) {
+                ALOGD("%d restarted within the coalescing window", node.id);
+                notifyAudioSystem(node.id, toNotifyStatus(node.type, 0), node.type);
+            }
+            node.notified = node.state;
+            ALOGD("state of %d is %d, notify AudioSystem", node.id, node.state);
+            notifyAudioSystem(node.id, toNotifyStatus(node.type, node.state), node.type);
+        }
+    }
+
+    /* poll() timeout in ms for the nearest deadline, -1 if there is none */
+    int AudioDaemon::nextTimeout(nsecs_t now)
+    {
+        nsecs_t next = 0;
+        unsigned int i;
+
+        for (i = 0; i < mNodes.size(); i++) {
+            if (mNodes[i].deadline && (!next || mNodes[i].deadline < next))
+                next = mNodes[i].deadline;
+        }
+        if (!mCpePending.empty() && (!next || mCpeRetryTime < next))
+            next = mCpeRetryTime;
+
+        if (!next)
+            return -1;
+        if (next <= now)
+            return 0;
+        return toMillisecondTimeoutDelay(now, next);
+    }
+
     bool AudioDaemon::threadLoop()
     {
-        int max = -1;
         unsigned int i;
         bool ret = true;
-        notify_status cur_state = snd_card_offline;
         struct pollfd *pfd = NULL;
-        char rd_buf[9];
-        unsigned int sleepRetry = 0;
-        bool audioInitDone = false;
-        int fd = 0;
-        char path[50];
-        notify_status cur_cpe_state = cpe_offline;
-        notify_status prev_cpe_state = cpe_offline;
-        unsigned int cpe_cnt = CPE_MAGIC_NUM;
-        unsigned int num_snd_cards = 0;
+        unsigned int num_fds = 0;
+        char value[PROPERTY_VALUE_MAX];
+        nsecs_t now;
 
         ALOGV("Start threadLoop()");
-        while (audioInitDone == false && sleepRetry < MAX_SLEEP_RETRY) {
-            if (mSndCardFd.empty() && !getStateFDs(mSndCardFd)) {
-                ALOGE("Sleeping for 100 ms");
-                usleep(AUDIO_INIT_SLEEP_WAIT*1000);
-                sleepRetry++;
-            } else {
-                audioInitDone = true;
-            }
-        }
+        property_get(STATE_COALESCE_PROPERTY, value, STATE_COALESCE_DEFAULT_MS);
+        mCoalesceNs = milliseconds_to_nanoseconds(atoi(value));
 
-        if (audioInitDone == false) {
+        if (!waitForSoundCards()) {
             ALOGE("Sound Card is empty!!!");
             goto thread_exit;
         }
 
         /* soundcards are opened, now get the cpe state nodes */
-        num_snd_cards = mSndCardFd.size();
-        for (i = 0; i < num_snd_cards; i++) {
-            snprintf(path, sizeof(path), "/proc/asound/card%d/cpe0_state", mSndCardFd[i].first);
-            ALOGD("Opening cpe0_state : %s", path);
-            sleepRetry = 0;
-            do {
-                fd = open(path, O_RDONLY);
-                if (fd == -1)  {
-                    sleepRetry++;
-                    ALOGE("CPE state open %s failed %s, Retrying %d",
-                          path, strerror(errno), sleepRetry);
-                    usleep(CPE_SLEEP_WAIT*1000);
-                } else {
-                    ALOGD("cpe state opened: %s", path);
-                    mSndCardFd.push_back(std::make_pair(cpe_cnt++, fd));
-                }
-            }while ((fd == -1) &&  sleepRetry < MAX_CPE_SLEEP_RETRY);
-        }
-        ALOGD("number of sndcards %d CPEs %d", i, cpe_cnt - CPE_MAGIC_NUM);
-
-        pfd = new pollfd[mSndCardFd.size()];
-        bzero(pfd, sizeof(*pfd) * mSndCardFd.size());
         for (i = 0; i < mSndCardFd.size(); i++) {
-            pfd[i].fd = mSndCardFd[i].second;
-            pfd[i].events = POLLPRI;
+            addStateNode(mSndCardFd[i].first, mSndCardFd[i].second, SND_CARD_STATE);
+            mCpePending.push_back(mSndCardFd[i].first);
         }
+        openCpeStates();
+        ALOGD("number of sndcards %d CPEs %d", mSndCardFd.size() - mNumCpe, mNumCpe);
 
         ALOGD("read for sound card state change before while");
-        for (i = 0; i < mSndCardFd.size(); i++) {
-            if (!read(pfd[i].fd, (void *)rd_buf, 8)) {
-               ALOGE("Error receiving sound card state event (%s)", strerror(errno));
-               ret = false;
-            } else {
-               rd_buf[8] = '\0';
-               lseek(pfd[i].fd, 0, SEEK_SET);
-
-               if(mSndCardFd[i].first >= CPE_MAGIC_NUM) {
-                   ALOGD("CPE %d state file content: %s before while",
-                         mSndCardFd[i].first - CPE_MAGIC_NUM, rd_buf);
-                   if (strstr(rd_buf, "OFFLINE")) {
-                       ALOGD("CPE state offline");
-                       cur_cpe_state = cpe_offline;
-                   } else if (strstr(rd_buf, "ONLINE")){
-                       ALOGD("CPE state online");
-                       cur_cpe_state = cpe_online;
-                   } else {
-                       ALOGE("ERROR CPE rd_buf %s", rd_buf);
-                   }
-                   if (cur_cpe_state == cpe_online && !cpe_bootup_complete) {
-                       cpe_bootup_complete = true;
-                       ALOGD("CPE boot up completed before polling");
-                   }
-                   prev_cpe_state = cur_cpe_state;
-               }
-               else {
-                   ALOGD("sound card state file content: %s before while",rd_buf);
-                   if (strstr(rd_buf, "OFFLINE")) {
-                       ALOGE("put cur_state to offline");
-                       cur_state = snd_card_offline;
-                   } else if (strstr(rd_buf, "ONLINE")){
-                       ALOGE("put cur_state to online");
-                       cur_state = snd_card_online;
-                   } else {
-                       ALOGE("ERROR rd_buf %s", rd_buf);
-                   }
-
-                   ALOGD("cur_state=%d, bootup_complete=%d", cur_state, cur_state );
-                   if (cur_state == snd_card_online && !bootup_complete) {
-                       bootup_complete = 1;
-                       ALOGE("sound card up is deteced before while");
-                       ALOGE("bootup_complete set to 1");
-                   }
-               }
+        now = systemTime();
+        for (i = 0; i < mNodes.size(); i++)
+            readStateNode(mNodes[i], now);
+
+        while (!exitPending()) {
+            if (num_fds != mNodes.size() + 1) {
+                delete [] pfd;
+                num_fds = mNodes.size() + 1;
+                pfd = new pollfd[num_fds];
             }
+            bzero(pfd, sizeof(*pfd) * num_fds);
+            for (i = 0; i < mNodes.size(); i++) {
+                pfd[i].fd = mNodes[i].fd;
+                pfd[i].events = POLLPRI;
+            }
+            /* a negative fd is ignored by poll() */
+            pfd[i].fd = mUeventSock;
+            pfd[i].events = POLLIN;
+
+            if (poll(pfd, num_fds, nextTimeout(systemTime())) < 0) {
+                if (errno == EINTR)
+                    continue;
+                ALOGE("poll() failed (%s)", strerror(errno));
+                ret = false;
+                break;
+            }
+
+            now = systemTime();
+            for (i = 0; i < mNodes.size(); i++) {
+                if (pfd[i].revents & POLLPRI)
+                    readStateNode(mNodes[i], now);
+            }
+            /* a card coming up may bring its cpe0_state node with it */
+            if ((pfd[num_fds - 1].revents & POLLIN) && processUeventMessage() &&
+                    !mCpePending.empty())
+                openCpeStates();
+            else if (!mCpePending.empty() && now >= mCpeRetryTime)
+                openCpeStates();
+
+            flushStateNodes(now);
         }
 
-        while (1) {
-           ALOGD("poll() for sound card state change ");
-           if (poll(pfd, mSndCardFd.size(), -1) < 0) {
-              ALOGE("poll() failed (%s)", strerror(errno));
-              ret = false;
-              break;
-           }
-
-           ALOGD("out of poll() for sound card state change, SNDCARD size=%d", mSndCardFd.size());
-           for (i = 0; i < mSndCardFd.size(); i++) {
-               if (pfd[i].revents & POLLPRI) {
-                   if (!read(pfd[i].fd, (void *)rd_buf, 8)) {
-                       ALOGE("Error receiving sound card %d state event (%s)",
-                             mSndCardFd[i].first, strerror(errno));
-                       ret = false;
-                   } else {
-                       rd_buf[8] = '\0';
-                       lseek(pfd[i].fd, 0, SEEK_SET);
-
-                       if(mSndCardFd[i].first >= CPE_MAGIC_NUM) {
-                           if (strstr(rd_buf, "OFFLINE"))
-                               cur_cpe_state = cpe_offline;
-                           else if (strstr(rd_buf, "ONLINE"))
-                               cur_cpe_state = cpe_online;
-                           else
-                               ALOGE("ERROR CPE rd_buf %s", rd_buf);
-
-                           if (cpe_bootup_complete && (prev_cpe_state != cur_cpe_state)) {
-                               ALOGD("CPE state is %d, nofity AudioSystem", cur_cpe_state);
-                               notifyAudioSystem(mSndCardFd[i].first, cur_cpe_state, CPE_STATE);
-                           }
-                           if (!cpe_bootup_complete && (cur_cpe_state == cpe_online)) {
-                               cpe_bootup_complete = true;
-                               ALOGD("CPE boot up completed");
-                           }
-                           prev_cpe_state = cur_cpe_state;
-                       }
-                       else {
-                           ALOGV("sound card state file content: %s, bootup_complete=%d",rd_buf, bootup_complete);
-                           if (strstr(rd_buf, "OFFLINE")) {
-                               cur_state = snd_card_offline;
-                           } else if (strstr(rd_buf, "ONLINE")){
-                               cur_state = snd_card_online;
-                           }
-
-                           if (bootup_complete) {
-                               ALOGV("bootup_complete, so NofityAudioSystem");
-                               notifyAudioSystem(mSndCardFd[i].first, cur_state, SND_CARD_STATE);
-                           }
-
-                           if (cur_state == snd_card_online && !bootup_complete) {
-                               bootup_complete = 1;
-                           }
-                       }
-                   }
-               }
-           }
-       }
-
-       putStateFDs(mSndCardFd);
-       delete [] pfd;
+        putStateFDs(mSndCardFd);
+        delete [] pfd;
 
     thread_exit:
-       ALOGV("Exiting Poll ThreadLoop");
-       return ret;
+        ALOGV("Exiting Poll ThreadLoop");
+        return ret;
     }
 
     void AudioDaemon::notifyAudioSystem(int snd_card,
@@ -36,6 +36,7 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.*/
 
 #include <utils/threads.h>
 #include <utils/String8.h>
+#include <utils/Timers.h>
 
 
 namespace android {
@@ -52,6 +53,24 @@ enum notify_status_type {
     CPE_STATE
 };
 
+/* A sound card or CPE state node and its coalescing/recovery bookkeeping */
+struct state_node {
+    int id;                 /* sound card number, or CPE_MAGIC_NUM + CPE index */
+    int fd;
+    notify_status_type type;
+    int state;              /* last state read, -1 if unknown */
+    int notified;           /* last state reported to AudioSystem, -1 if none */
+    bool went_offline;      /* went OFFLINE since the last notification */
+    nsecs_t deadline;       /* pending change is reported at this time, 0 if none */
+    nsecs_t offline_time;   /* start of the current outage, 0 if online */
+    unsigned int outages;
+    unsigned int coalesced; /* transitions that never reached AudioSystem */
+    nsecs_t recovery_last;
+    nsecs_t recovery_min;
+    nsecs_t recovery_max;
+    nsecs_t recovery_total;
+};
+
 class AudioDaemon:public Thread, public IBinder :: DeathRecipient
 {
     /*Overrides*/
@@ -68,12 +87,26 @@ class AudioDaemon:public Thread, public IBinder :: DeathRecipient
     bool getStateFDs(std::vector<std::pair<int,int> > &sndcardFdPair);
     void putStateFDs(std::vector<std::pair<int,int> > &sndcardFdPair);
 
+    bool waitForSoundCards();
+    void openCpeStates();
+    void addStateNode(int id, int fd, notify_status_type type);
+    void readStateNode(state_node &node, nsecs_t now);
+    void flushStateNodes(nsecs_t now);
+    int nextTimeout(nsecs_t now);
+
 public:
     AudioDaemon();
     virtual ~AudioDaemon();
 
 private:
     std::vector<std::pair<int,int> > mSndCardFd;
+    std::vector<state_node> mNodes;
+    /* sound cards whose cpe0_state node did not exist yet */
+    std::vector<int> mCpePending;
+    unsigned int mCpeRetry;
+    nsecs_t mCpeRetryTime;
+    unsigned int mNumCpe;
+    nsecs_t mCoalesceNs;
 };
 
 }
@@ -26,6 +26,8 @@ endif
 LOCAL_SRC_FILES := \
 	audio_hw.c \
 	voice.c \
+	mixer_volume.c \
+	audio_config.c \
 	platform_info.c \
 	$(AUDIO_PLATFORM)/platform.c
 
@@ -73,10 +75,15 @@ endif
 
 ifeq ($(strip $(AUDIO_FEATURE_ENABLED_SSR)),true)
     LOCAL_CFLAGS += -DSSR_ENABLED
-    LOCAL_SRC_FILES += audio_extn/ssr.c
+    LOCAL_SRC_FILES += audio_extn/ssr.c audio_extn/ssr_ola.c
     LOCAL_C_INCLUDES += $(TARGET_OUT_HEADERS)/mm-audio/surround_sound/
 endif
 
+ifeq ($(strip $(AUDIO_FEATURE_ENABLED_PCM_TAP)),true)
+    LOCAL_CFLAGS += -DPCM_TAP_ENABLED
+    LOCAL_SRC_FILES += audio_extn/pcm_tap.c
+endif
+
 ifeq ($(strip $(AUDIO_FEATURE_ENABLED_MULTI_VOICE_SESSIONS)),true)
     LOCAL_CFLAGS += -DMULTI_VOICE_SESSION_ENABLED
     LOCAL_SRC_FILES += voice_extn/voice_extn.c
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "audio_config"
+/*#define LOG_NDEBUG 0*/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cutils/atomic.h>
+#include <cutils/log.h>
+#include <cutils/properties.h>
+
+#include "audio_config.h"
+
+/*
+ * Sequence lock around the snapshot: the count is odd while a reload
+ * writes it, so a reader that sees an odd or changed count retries the copy.
+ */
+static struct audio_config_snapshot config;
+static volatile int32_t config_seq;
+static pthread_mutex_t reload_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool property_get_enabled(const char *key)
+{
+    char value[PROPERTY_VALUE_MAX] = {0};
+
+    property_get(key, value, NULL);
+    return atoi(value) || !strncmp("true", value, 4);
+}
+
+static uint32_t property_get_uint(const char *key)
+{
+    char value[PROPERTY_VALUE_MAX] = {0};
+    int val;
+
+    property_get(key, value, "");
+    val = atoi(value);
+    return val > 0 ? (uint32_t)val : 0;
+}
+
+void audio_config_reload(void)
+{
+    struct audio_config_snapshot next;
+    char value[PROPERTY_VALUE_MAX] = {0};
+    int32_t seq;
+
+    next.offload_gapless =
+        property_get_enabled("audio.offload.gapless.enabled");
+    next.offload_passthrough =
+        property_get_enabled("audio.offload.passthrough");
+    property_get("audio.use.hdmi.sink.cap", value, NULL);
+    next.use_hdmi_sink_cap = !strncmp("true", value, 4);
+    next.offload_track =
+        property_get_enabled("audio.offload.track.enabled");
+    next.offload_buffer_kb =
+        property_get_uint("audio.offload.buffer.size.kb");
+    next.pcm_offload_buffer_kb =
+        property_get_uint("audio.offload.pcm.buffer.size");
+    next.track_offload_buffer_kb =
+        property_get_uint("audio.offload.track.buffer.size");
+
+    pthread_mutex_lock(&reload_lock);
+    next.generation = config.generation + 1;
+    seq = config_seq;
+    /* acquire: the snapshot stores below must not pass the odd count */
+    android_atomic_acquire_cas(seq, seq + 1, &config_seq);
+    config = next;
+    android_atomic_release_store(seq + 2, &config_seq);
+    pthread_mutex_unlock(&reload_lock);
+
+    ALOGD("%s: generation %u gapless %d passthrough %d hdmi_sink_cap %d",
+          __func__, next.generation, next.offload_gapless,
+          next.offload_passthrough, next.use_hdmi_sink_cap);
+}
+
+void audio_config_get(struct audio_config_snapshot *out)
+{
+    int32_t seq;
+
+    do {
+        seq = android_atomic_acquire_load(&config_seq);
+        *out = config;
+        /* release: the copy above completes before the count is rechecked */
+    } while ((seq & 1) || android_atomic_release_cas(seq, seq, &config_seq));
+}
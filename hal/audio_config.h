@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef AUDIO_CONFIG_H
+#define AUDIO_CONFIG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define AUDIO_PARAMETER_KEY_CONFIG_RELOAD "audio_config_reload"
+
+/*
+ * Typed snapshot of the system properties read on the stream open path.
+ * It is loaded when the HAL is opened and again when the framework sets
+ * AUDIO_PARAMETER_KEY_CONFIG_RELOAD. Readers take no lock and get a
+ * consistent copy even when reloads run back to back.
+ */
+struct audio_config_snapshot {
+    uint32_t generation;
+    bool offload_gapless;           /* audio.offload.gapless.enabled */
+    bool offload_passthrough;       /* audio.offload.passthrough */
+    bool use_hdmi_sink_cap;         /* audio.use.hdmi.sink.cap */
+    bool offload_track;             /* audio.offload.track.enabled */
+    uint32_t offload_buffer_kb;     /* audio.offload.buffer.size.kb */
+    uint32_t pcm_offload_buffer_kb; /* audio.offload.pcm.buffer.size */
+    uint32_t track_offload_buffer_kb; /* audio.offload.track.buffer.size */
+};
+
+void audio_config_reload(void);
+void audio_config_get(struct audio_config_snapshot *config);
+
+#endif /* AUDIO_CONFIG_H */
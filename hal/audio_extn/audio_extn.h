@@ -127,6 +127,21 @@ int32_t audio_extn_ssr_read(struct audio_stream_in *stream,
                        void *buffer, size_t bytes);
 #endif
 
+#ifndef PCM_TAP_ENABLED
+#define audio_extn_pcm_tap_set_parameters(adev, parms)    (0)
+#define audio_extn_pcm_tap_out(out, buffer, bytes)        (0)
+#define audio_extn_pcm_tap_in(in, buffer, bytes)          (0)
+#define audio_extn_pcm_tap_deinit()                       (0)
+#else
+void audio_extn_pcm_tap_set_parameters(struct audio_device *adev,
+                                       struct str_parms *parms);
+void audio_extn_pcm_tap_out(struct stream_out *out, const void *buffer,
+                            size_t bytes);
+void audio_extn_pcm_tap_in(struct stream_in *in, const void *buffer,
+                           size_t bytes);
+void audio_extn_pcm_tap_deinit();
+#endif
+
 #ifndef HW_VARIANTS_ENABLED
 #define hw_info_init(snd_card_name)                  (0)
 #define hw_info_deinit(hw_info)                      (0)
@@ -167,6 +182,9 @@ void audio_extn_listen_set_parameters(struct audio_device *adev,
 #define audio_extn_sound_trigger_set_parameters(adev, parms)           (0)
 #define audio_extn_sound_trigger_check_and_get_session(in)             (0)
 #define audio_extn_sound_trigger_stop_lab(in)                          (0)
+#define audio_extn_sound_trigger_start_lab(in)                         (0)
+#define audio_extn_sound_trigger_read(in, buffer, bytes)               (-ENOSYS)
+#define audio_extn_sound_trigger_avail(in)                             (0)
 #else
 
 enum st_event_type {
@@ -187,6 +205,10 @@ void audio_extn_sound_trigger_set_parameters(struct audio_device *adev,
                                              struct str_parms *parms);
 void audio_extn_sound_trigger_check_and_get_session(struct stream_in *in);
 void audio_extn_sound_trigger_stop_lab(struct stream_in *in);
+void audio_extn_sound_trigger_start_lab(struct stream_in *in);
+int audio_extn_sound_trigger_read(struct stream_in *in, void *buffer,
+                                  size_t bytes);
+size_t audio_extn_sound_trigger_avail(struct stream_in *in);
 #endif
 
 #ifndef AUXPCM_BT_ENABLED
@@ -223,8 +245,8 @@ bool audio_extn_compr_cap_enabled();
 bool audio_extn_compr_cap_format_supported(audio_format_t format);
 bool audio_extn_compr_cap_usecase_supported(audio_usecase_t usecase);
 size_t audio_extn_compr_cap_get_buffer_size(audio_format_t format);
-size_t audio_extn_compr_cap_read(struct stream_in *in,
-                                        void *buffer, size_t bytes);
+ssize_t audio_extn_compr_cap_read(struct stream_in *in,
+                                  void *buffer, size_t bytes);
 void audio_extn_compr_cap_deinit();
 #endif
 
@@ -41,24 +41,69 @@
 #define COMPRESS_IN_CONFIG_PERIOD_SIZE 2048
 #define COMPRESS_IN_CONFIG_PERIOD_COUNT 16
 
+/*
+ * Every DSP period carries one encoded frame preceded by a
+ * snd_compr_audio_info header. Up to COMPRESS_IN_MAX_FRAMES_PER_READ
+ * periods are fetched with a single pcm_read(); the frames found in them
+ * are indexed and handed out back to back, so a caller sized for several
+ * frames (audio.compress.capture.frames) is served with one syscall.
+ * When the caller's buffer can hold all the periods of a read, they are
+ * read straight into it and the frames are compacted in place; otherwise
+ * they go through in_buf.
+ */
+#define COMPRESS_IN_MAX_FRAMES_PER_READ (COMPRESS_IN_CONFIG_PERIOD_COUNT / 2)
+
+struct compress_in_frame {
+    uint32_t            offset;
+    uint32_t            size;
+};
 
 struct compress_in_module {
     uint8_t             *in_buf;
+    size_t              period_bytes;
+    unsigned int        frames_per_read;
+    /* frames of the last pcm_read() into in_buf not yet returned */
+    struct compress_in_frame frames[COMPRESS_IN_MAX_FRAMES_PER_READ];
+    unsigned int        num_frames;
+    unsigned int        next_frame;
 };
 
 static struct compress_in_module c_in_mod = {
     .in_buf = NULL,
 };
 
+static unsigned int compr_cap_frames_per_read()
+{
+    char prop_value[PROPERTY_VALUE_MAX] = {0};
+    int frames;
+
+    property_get("audio.compress.capture.frames", prop_value, "1");
+    frames = atoi(prop_value);
+    if (frames < 1)
+        frames = 1;
+    else if (frames > COMPRESS_IN_MAX_FRAMES_PER_READ)
+        frames = COMPRESS_IN_MAX_FRAMES_PER_READ;
+    return frames;
+}
 
 void audio_extn_compr_cap_init(struct stream_in *in)
 {
+    unsigned int frames = compr_cap_frames_per_read();
+
     in->usecase = USECASE_AUDIO_RECORD_COMPRESS;
     in->config.channels = COMPRESS_IN_CONFIG_CHANNELS;
     in->config.period_size = COMPRESS_IN_CONFIG_PERIOD_SIZE;
     in->config.period_count= COMPRESS_IN_CONFIG_PERIOD_COUNT;
     in->config.format = AUDIO_FORMAT_AMR_WB;
-    c_in_mod.in_buf = (uint8_t*)calloc(1, in->config.period_size*2);
+
+    c_in_mod.frames_per_read = frames;
+    c_in_mod.period_bytes = in->config.period_size * 2;
+    c_in_mod.num_frames = 0;
+    c_in_mod.next_frame = 0;
+    c_in_mod.in_buf = (uint8_t*)calloc(frames, c_in_mod.period_bytes);
+    if (!c_in_mod.in_buf)
+        ALOGE("%s: failed to allocate %u periods", __func__, frames);
+    ALOGV("%s: %u frames per read", __func__, frames);
 }
 
 void audio_extn_compr_cap_deinit()
@@ -67,6 +112,8 @@ void audio_extn_compr_cap_deinit()
         free(c_in_mod.in_buf);
         c_in_mod.in_buf = NULL;
     }
+    c_in_mod.num_frames = 0;
+    c_in_mod.next_frame = 0;
 }
 
 bool audio_extn_compr_cap_enabled()
@@ -104,52 +151,144 @@ bool audio_extn_compr_cap_usecase_supported(audio_usecase_t usecase)
 
 size_t audio_extn_compr_cap_get_buffer_size(audio_format_t format)
 {
+    /* the size can be queried before the module is set up for a stream */
+    unsigned int frames = c_in_mod.in_buf ? c_in_mod.frames_per_read :
+                                            compr_cap_frames_per_read();
+
     if (format == AUDIO_FORMAT_AMR_WB)
-        /*One AMR WB frame is 61 bytes. Return that to the caller.
+        /*One AMR WB frame is 61 bytes. Return that times the number of
+        frames delivered per read to the caller.
         The buffer size is not altered, that is still period size.*/
-        return AMR_WB_FRAMESIZE;
+        return AMR_WB_FRAMESIZE * frames;
     else
         return 0;
 }
 
-size_t audio_extn_compr_cap_read(struct stream_in * in,
-    void *buffer, size_t bytes)
+/*
+ * Reads frames_per_read periods into buf and indexes the frames they
+ * carry in c_in_mod.frames, as offsets into buf.
+ */
+static int compr_cap_fill(struct stream_in *in, uint8_t *buf)
 {
-    int ret;
     struct snd_compr_audio_info *header;
+    size_t period_bytes = c_in_mod.period_bytes;
     uint32_t c_in_header;
-    uint32_t c_in_buf_size;
-
-    c_in_buf_size = in->config.period_size*2;
-
-    if (in->pcm) {
-        ret = pcm_read(in->pcm, c_in_mod.in_buf, c_in_buf_size);
-        if (ret < 0) {
-            ALOGE("pcm_read() returned failure: %d", ret);
-            return ret;
-        } else {
-            header = (struct snd_compr_audio_info *) c_in_mod.in_buf;
-            c_in_header = sizeof(*header) + header->reserved[0];
-            if (header->frame_size > 0) {
-                if (c_in_header  + header->frame_size > c_in_buf_size) {
-                    ALOGW("AMR WB read buffer overflow.");
-                    header->frame_size =
-                        bytes - sizeof(*header) - header->reserved[0];
-                }
-                ALOGV("c_in_buf: %p, data offset: %p, header size: %zu,"
-                    "reserved[0]: %u frame_size: %d", c_in_mod.in_buf,
-                        c_in_mod.in_buf + c_in_header,
-                        sizeof(*header), header->reserved[0],
-                        header->frame_size);
-                memcpy(buffer, c_in_mod.in_buf + c_in_header, header->frame_size);
-            } else {
-                ALOGE("pcm_read() with zero frame size");
-                ret = -EINVAL;
-            }
+    unsigned int i;
+    int ret;
+
+    ret = pcm_read(in->pcm, buf, period_bytes * c_in_mod.frames_per_read);
+    if (ret < 0) {
+        ret = -errno;
+        ALOGE("pcm_read() returned failure: %d", ret);
+        return ret;
+    }
+
+    c_in_mod.num_frames = 0;
+    c_in_mod.next_frame = 0;
+    for (i = 0; i < c_in_mod.frames_per_read; i++) {
+        header = (struct snd_compr_audio_info *)(buf + i * period_bytes);
+        c_in_header = sizeof(*header) + header->reserved[0];
+        if (header->frame_size == 0 || c_in_header >= period_bytes) {
+            ALOGV("%s: period %u carries no frame", __func__, i);
+            continue;
         }
+        if (c_in_header + header->frame_size > period_bytes) {
+            ALOGW("AMR WB read buffer overflow.");
+            header->frame_size = period_bytes - c_in_header;
+        }
+        ALOGV("period %u, header size: %zu, reserved[0]: %u frame_size: %d",
+              i, sizeof(*header), header->reserved[0], header->frame_size);
+        c_in_mod.frames[c_in_mod.num_frames].offset = i * period_bytes +
+                                                      c_in_header;
+        c_in_mod.frames[c_in_mod.num_frames].size = header->frame_size;
+        c_in_mod.num_frames++;
     }
 
+    if (c_in_mod.num_frames == 0) {
+        ALOGE("pcm_read() with zero frame size");
+        return -EINVAL;
+    }
     return 0;
 }
 
+/*
+ * Reads the periods straight into buf and moves the frames down over
+ * their headers. Every frame lands at or below its source, so walking
+ * them in order never overwrites one not yet moved. Returns the bytes
+ * of frames left at the start of buf.
+ */
+static ssize_t compr_cap_read_direct(struct stream_in *in, uint8_t *buf)
+{
+    struct compress_in_frame *frame;
+    size_t filled = 0;
+    unsigned int i;
+    int ret;
+
+    ret = compr_cap_fill(in, buf);
+    if (ret < 0)
+        return ret;
+
+    for (i = 0; i < c_in_mod.num_frames; i++) {
+        frame = &c_in_mod.frames[i];
+        memmove(buf + filled, buf + frame->offset, frame->size);
+        filled += frame->size;
+    }
+    c_in_mod.num_frames = 0;
+    c_in_mod.next_frame = 0;
+    return filled;
+}
+
+ssize_t audio_extn_compr_cap_read(struct stream_in * in,
+    void *buffer, size_t bytes)
+{
+    size_t read_bytes = c_in_mod.period_bytes * c_in_mod.frames_per_read;
+    struct compress_in_frame *frame;
+    size_t filled = 0;
+    size_t size;
+    ssize_t direct;
+    int ret;
+
+    if (!in->pcm || !c_in_mod.in_buf)
+        return -ENODEV;
+
+    /*
+     * Frames are copied whole and back to back; one that does not fit in
+     * the remaining space is kept for the next call. A frame larger than
+     * the whole caller buffer is truncated. Returns the number of valid
+     * bytes in the buffer.
+     */
+    while (filled < bytes) {
+        if (c_in_mod.next_frame == c_in_mod.num_frames) {
+            if (filled > 0 && bytes - filled < AMR_WB_FRAMESIZE)
+                break;
+            if (bytes - filled >= read_bytes) {
+                direct = compr_cap_read_direct(in, (uint8_t *)buffer + filled);
+                if (direct < 0)
+                    return direct;
+                filled += direct;
+                continue;
+            }
+            ret = compr_cap_fill(in, c_in_mod.in_buf);
+            if (ret < 0)
+                return ret;
+        }
+
+        frame = &c_in_mod.frames[c_in_mod.next_frame];
+        size = frame->size;
+        if (size > bytes - filled) {
+            if (filled > 0)
+                break;
+            ALOGW("%s: frame of %u bytes truncated to %zu", __func__,
+                  frame->size, bytes - filled);
+            size = bytes - filled;
+        }
+        memcpy((uint8_t *)buffer + filled, c_in_mod.in_buf + frame->offset,
+               size);
+        filled += size;
+        c_in_mod.next_frame++;
+    }
+
+    return filled;
+}
+
 #endif /* COMPRESS_CAPTURE_ENABLED end */
@@ -28,6 +28,7 @@
 #include "audio_hw.h"
 #include "platform.h"
 #include "platform_api.h"
+#include "mixer_volume.h"
 #include <stdlib.h>
 #include <cutils/str_parms.h>
 
@@ -51,6 +52,7 @@ struct fm_module {
     struct pcm *fm_pcm_tx;
     bool is_fm_running;
     float fm_volume;
+    struct mixer_volume volume;
 };
 
 static struct fm_module fmmod = {
@@ -60,11 +62,10 @@ static struct fm_module fmmod = {
   .is_fm_running = 0,
 };
 
-static int32_t fm_set_volume(struct audio_device *adev, float value)
+static int32_t fm_set_volume(struct audio_device *adev __unused,
+                             float value)
 {
-    int32_t vol, ret = 0;
-    struct mixer_ctl *ctl;
-    const char *mixer_ctl_name = FM_RX_VOLUME;
+    int vol, ret = 0;
 
     ALOGV("%s: entry", __func__);
     ALOGD("%s: (%f)\n", __func__, value);
@@ -85,13 +86,11 @@ static int32_t fm_set_volume(struct audio_device *adev, float value)
     }
 
     ALOGD("%s: Setting FM volume to %d \n", __func__, vol);
-    ctl = mixer_get_ctl_by_name(adev->mixer, mixer_ctl_name);
-    if (!ctl) {
-        ALOGE("%s: Could not get ctl for mixer cmd - %s",
-              __func__, mixer_ctl_name);
+    if (mixer_volume_set(&fmmod.volume, &vol, 1) < 0) {
+        ALOGE("%s: Could not set ctl for mixer cmd - %s",
+              __func__, FM_RX_VOLUME);
         return -EINVAL;
     }
-    mixer_ctl_set_value(ctl, 0, vol);
     ALOGV("%s: exit", __func__);
     return ret;
 }
@@ -103,6 +102,7 @@ static int32_t fm_stop(struct audio_device *adev)
 
     ALOGD("%s: enter", __func__);
     fmmod.is_fm_running = false;
+    mixer_volume_release(&fmmod.volume);
 
     /* 1. Close the PCM devices */
     if (fmmod.fm_pcm_rx) {
@@ -193,6 +193,7 @@ static int32_t fm_start(struct audio_device *adev)
     pcm_start(fmmod.fm_pcm_tx);
 
     fmmod.is_fm_running = true;
+    mixer_volume_init(&fmmod.volume, adev->mixer, FM_RX_VOLUME);
     fm_set_volume(adev, fmmod.fm_volume);
 
     ALOGD("%s: exit: status(%d)", __func__, ret);
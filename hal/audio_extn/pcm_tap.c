@@ -0,0 +1,437 @@
+/*
+ * Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "audio_hw_pcm_tap"
+/*#define LOG_NDEBUG 0*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <cutils/atomic.h>
+#include <cutils/log.h>
+#include <cutils/sched_policy.h>
+#include <cutils/str_parms.h>
+#include <system/thread_defs.h>
+
+#include "audio_hw.h"
+#include "audio_extn.h"
+
+/*
+ * PCM tap: copies of the data passed through out_write()/in_read() for
+ * selected usecases are queued on a per usecase single producer/single
+ * consumer ring and written to WAV files by a background thread. The
+ * stream thread never blocks on the tap; when a ring is full the buffer
+ * is dropped and accounted for in the index file.
+ *
+ * Enabled with set_parameters("pcm_tap_enable=<usecase>") where usecase
+ * is a use_case_table[] name or "all", disabled with "pcm_tap_disable=".
+ * Each session produces <usecase>_<time>.wav plus a .idx text file with
+ * the usecase/device metadata and a timestamp per tapped buffer.
+ */
+
+#define AUDIO_PARAMETER_KEY_PCM_TAP_ENABLE  "pcm_tap_enable"
+#define AUDIO_PARAMETER_KEY_PCM_TAP_DISABLE "pcm_tap_disable"
+#define PCM_TAP_ALL_USECASES                "all"
+
+#define PCM_TAP_DIR             "/data/misc/audio"
+#define PCM_TAP_RING_SIZE       (512 * 1024)    /* must be a power of two */
+#define PCM_TAP_DRAIN_SLEEP_US  20000
+#define PCM_TAP_WAV_HEADER_SIZE 44
+
+extern const char * const use_case_table[AUDIO_USECASE_MAX];
+
+struct pcm_tap_record {
+    uint32_t size;              /* payload bytes following this header */
+    uint32_t sample_rate;
+    uint32_t channels;
+    uint32_t bits_per_sample;
+    uint32_t devices;
+    uint32_t dropped;           /* bytes dropped just before this record */
+    int64_t  timestamp_ns;      /* CLOCK_MONOTONIC */
+};
+
+struct pcm_tap {
+    /* written by set_parameters, read by producer and drain thread */
+    volatile int32_t enabled;
+
+    /* ring, head is owned by the producer and tail by the drain thread */
+    unsigned char *buf;
+    volatile int32_t head;
+    volatile int32_t tail;
+    uint32_t dropped;           /* producer side, since the last record */
+
+    /* drain thread state */
+    FILE *wav;
+    FILE *idx;
+    struct pcm_tap_record fmt;
+    uint64_t data_bytes;
+};
+
+struct pcm_tap_module {
+    pthread_mutex_t lock;       /* serializes enable/disable and the thread */
+    pthread_t thread;
+    bool thread_started;
+    volatile int32_t thread_exit;
+    struct pcm_tap taps[AUDIO_USECASE_MAX];
+};
+
+static struct pcm_tap_module tapmod = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .thread_started = false,
+};
+
+static void put_le16(unsigned char *p, uint16_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static void put_le32(unsigned char *p, uint32_t v)
+{
+    put_le16(p, v & 0xffff);
+    put_le16(p + 2, v >> 16);
+}
+
+static void pcm_tap_write_wav_header(FILE *fp, const struct pcm_tap_record *fmt,
+                                     uint64_t data_bytes)
+{
+    unsigned char hdr[PCM_TAP_WAV_HEADER_SIZE];
+    uint32_t block_align = fmt->channels * (fmt->bits_per_sample / 8);
+    uint32_t data_size = data_bytes > 0xffffffffULL - 36 ?
+                         (uint32_t)(0xffffffffULL - 36) : (uint32_t)data_bytes;
+
+    memcpy(hdr, "RIFF", 4);
+    put_le32(hdr + 4, 36 + data_size);
+    memcpy(hdr + 8, "WAVEfmt ", 8);
+    put_le32(hdr + 16, 16);
+    put_le16(hdr + 20, 1);                      /* PCM */
+    put_le16(hdr + 22, fmt->channels);
+    put_le32(hdr + 24, fmt->sample_rate);
+    put_le32(hdr + 28, fmt->sample_rate * block_align);
+    put_le16(hdr + 32, block_align);
+    put_le16(hdr + 34, fmt->bits_per_sample);
+    memcpy(hdr + 36, "data", 4);
+    put_le32(hdr + 40, data_size);
+
+    fseek(fp, 0, SEEK_SET);
+    fwrite(hdr, 1, sizeof(hdr), fp);
+    fseek(fp, 0, SEEK_END);
+}
+
+static void pcm_tap_close_files(struct pcm_tap *tap)
+{
+    if (tap->wav) {
+        pcm_tap_write_wav_header(tap->wav, &tap->fmt, tap->data_bytes);
+        fclose(tap->wav);
+        tap->wav = NULL;
+    }
+    if (tap->idx) {
+        fclose(tap->idx);
+        tap->idx = NULL;
+    }
+    tap->data_bytes = 0;
+}
+
+static void pcm_tap_open_files(audio_usecase_t uc_id, struct pcm_tap *tap,
+                               const struct pcm_tap_record *rec)
+{
+    char path[PATH_MAX];
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    snprintf(path, sizeof(path), "%s/%s_%ld.%03ld.wav", PCM_TAP_DIR,
+             use_case_table[uc_id], (long)ts.tv_sec, ts.tv_nsec / 1000000);
+    tap->wav = fopen(path, "wb");
+    if (!tap->wav) {
+        ALOGE("%s: cannot open %s", __func__, path);
+        return;
+    }
+    strlcpy(path + strlen(path) - strlen("wav"), "idx", strlen("idx") + 1);
+    tap->idx = fopen(path, "w");
+
+    tap->fmt = *rec;
+    tap->data_bytes = 0;
+    pcm_tap_write_wav_header(tap->wav, &tap->fmt, 0);
+    if (tap->idx)
+        fprintf(tap->idx, "usecase=%s devices=%#x rate=%u channels=%u bits=%u\n"
+                "# frame_offset timestamp_ns dropped_bytes\n",
+                use_case_table[uc_id], rec->devices, rec->sample_rate,
+                rec->channels, rec->bits_per_sample);
+    ALOGD("%s: tapping %s to %s", __func__, use_case_table[uc_id], path);
+}
+
+static void pcm_tap_ring_read(struct pcm_tap *tap, uint32_t pos, void *dst,
+                              size_t bytes)
+{
+    uint32_t offset = pos & (PCM_TAP_RING_SIZE - 1);
+    size_t chunk = PCM_TAP_RING_SIZE - offset;
+
+    if (chunk > bytes)
+        chunk = bytes;
+    memcpy(dst, tap->buf + offset, chunk);
+    memcpy((unsigned char *)dst + chunk, tap->buf, bytes - chunk);
+}
+
+static void pcm_tap_ring_write(struct pcm_tap *tap, uint32_t pos,
+                               const void *src, size_t bytes)
+{
+    uint32_t offset = pos & (PCM_TAP_RING_SIZE - 1);
+    size_t chunk = PCM_TAP_RING_SIZE - offset;
+
+    if (chunk > bytes)
+        chunk = bytes;
+    memcpy(tap->buf + offset, src, chunk);
+    memcpy(tap->buf, (const unsigned char *)src + chunk, bytes - chunk);
+}
+
+/* Drains all complete records of one tap, returns true if any were found */
+static bool pcm_tap_drain(audio_usecase_t uc_id, struct pcm_tap *tap)
+{
+    uint32_t head = (uint32_t)android_atomic_acquire_load(&tap->head);
+    uint32_t tail = (uint32_t)tap->tail;
+    struct pcm_tap_record rec;
+    bool drained = false;
+
+    while (head != tail) {
+        uint32_t offset, chunk, remaining;
+
+        pcm_tap_ring_read(tap, tail, &rec, sizeof(rec));
+        tail += sizeof(rec);
+
+        if (tap->wav && (rec.sample_rate != tap->fmt.sample_rate ||
+                         rec.channels != tap->fmt.channels ||
+                         rec.bits_per_sample != tap->fmt.bits_per_sample ||
+                         rec.devices != tap->fmt.devices))
+            pcm_tap_close_files(tap);
+        if (!tap->wav)
+            pcm_tap_open_files(uc_id, tap, &rec);
+
+        if (tap->idx)
+            fprintf(tap->idx, "%llu %lld %u\n",
+                    (unsigned long long)(tap->data_bytes /
+                        (rec.channels * (rec.bits_per_sample / 8))),
+                    (long long)rec.timestamp_ns, rec.dropped);
+
+        /* payload may wrap, write it straight from the ring */
+        remaining = rec.size;
+        while (remaining) {
+            offset = tail & (PCM_TAP_RING_SIZE - 1);
+            chunk = PCM_TAP_RING_SIZE - offset;
+            if (chunk > remaining)
+                chunk = remaining;
+            if (tap->wav)
+                fwrite(tap->buf + offset, 1, chunk, tap->wav);
+            tail += chunk;
+            remaining -= chunk;
+        }
+        tap->data_bytes += rec.size;
+        /* rounded up so that records stay aligned in the ring */
+        tail += (4 - (rec.size & 3)) & 3;
+
+        android_atomic_release_store((int32_t)tail, &tap->tail);
+        drained = true;
+    }
+    return drained;
+}
+
+static void *pcm_tap_thread_loop(void *context __unused)
+{
+    int i;
+
+    setpriority(PRIO_PROCESS, 0, ANDROID_PRIORITY_BACKGROUND);
+    set_sched_policy(0, SP_BACKGROUND);
+    prctl(PR_SET_NAME, (unsigned long)"PCM Tap", 0, 0, 0);
+
+    while (!android_atomic_acquire_load(&tapmod.thread_exit)) {
+        bool busy = false;
+
+        for (i = 0; i < AUDIO_USECASE_MAX; i++) {
+            struct pcm_tap *tap = &tapmod.taps[i];
+
+            if (!tap->buf)
+                continue;
+            if (pcm_tap_drain(i, tap))
+                busy = true;
+            else if (!android_atomic_acquire_load(&tap->enabled) && tap->wav)
+                pcm_tap_close_files(tap);
+        }
+        if (!busy)
+            usleep(PCM_TAP_DRAIN_SLEEP_US);
+    }
+
+    for (i = 0; i < AUDIO_USECASE_MAX; i++) {
+        if (tapmod.taps[i].buf) {
+            pcm_tap_drain(i, &tapmod.taps[i]);
+            pcm_tap_close_files(&tapmod.taps[i]);
+        }
+    }
+    return NULL;
+}
+
+/* must be called with tapmod.lock held */
+static void pcm_tap_set_enabled(audio_usecase_t uc_id, bool enable)
+{
+    struct pcm_tap *tap = &tapmod.taps[uc_id];
+
+    if (enable && !tap->buf) {
+        /* ring memory is kept until deinit, producers may still be using it */
+        tap->buf = (unsigned char *)malloc(PCM_TAP_RING_SIZE);
+        if (!tap->buf) {
+            ALOGE("%s: no memory for %s", __func__, use_case_table[uc_id]);
+            return;
+        }
+    }
+    if (!tap->buf)
+        return;
+
+    android_atomic_release_store(enable, &tap->enabled);
+    ALOGD("%s: %s %s", __func__, use_case_table[uc_id],
+          enable ? "enabled" : "disabled");
+
+    if (enable && !tapmod.thread_started) {
+        android_atomic_release_store(0, &tapmod.thread_exit);
+        if (pthread_create(&tapmod.thread, (const pthread_attr_t *) NULL,
+                           pcm_tap_thread_loop, NULL)) {
+            ALOGE("%s: failed to create tap thread", __func__);
+            return;
+        }
+        tapmod.thread_started = true;
+    }
+}
+
+static void pcm_tap_parse(const char *value, bool enable)
+{
+    int i;
+
+    for (i = 0; i < AUDIO_USECASE_MAX; i++) {
+        if (!use_case_table[i])
+            continue;
+        if (!strcmp(value, PCM_TAP_ALL_USECASES) ||
+            !strcmp(value, use_case_table[i]))
+            pcm_tap_set_enabled(i, enable);
+    }
+}
+
+void audio_extn_pcm_tap_set_parameters(struct audio_device *adev __unused,
+                                       struct str_parms *parms)
+{
+    char value[64] = {0};
+
+    pthread_mutex_lock(&tapmod.lock);
+    if (str_parms_get_str(parms, AUDIO_PARAMETER_KEY_PCM_TAP_ENABLE, value,
+                          sizeof(value)) >= 0)
+        pcm_tap_parse(value, true);
+    if (str_parms_get_str(parms, AUDIO_PARAMETER_KEY_PCM_TAP_DISABLE, value,
+                          sizeof(value)) >= 0)
+        pcm_tap_parse(value, false);
+    pthread_mutex_unlock(&tapmod.lock);
+}
+
+/* Called from the stream thread; copies the buffer or drops it, never waits */
+static void pcm_tap_push(audio_usecase_t uc_id, audio_devices_t devices,
+                         uint32_t sample_rate, uint32_t channels,
+                         audio_format_t format, const void *buffer,
+                         size_t bytes)
+{
+    struct pcm_tap *tap;
+    struct pcm_tap_record rec;
+    struct timespec ts;
+    uint32_t head, tail, needed;
+
+    if (uc_id <= USECASE_INVALID || uc_id >= AUDIO_USECASE_MAX)
+        return;
+    tap = &tapmod.taps[uc_id];
+    if (!android_atomic_acquire_load(&tap->enabled) || !buffer || !bytes)
+        return;
+    if (!audio_is_linear_pcm(format) || !channels)
+        return;
+
+    needed = sizeof(rec) + ((bytes + 3) & ~3);
+    head = (uint32_t)tap->head;
+    tail = (uint32_t)android_atomic_acquire_load(&tap->tail);
+    if (needed > PCM_TAP_RING_SIZE - (head - tail)) {
+        tap->dropped += bytes;
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    rec.size = bytes;
+    rec.sample_rate = sample_rate;
+    rec.channels = channels;
+    rec.bits_per_sample = audio_bytes_per_sample(format) * 8;
+    rec.devices = devices;
+    rec.dropped = tap->dropped;
+    rec.timestamp_ns = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    tap->dropped = 0;
+
+    pcm_tap_ring_write(tap, head, &rec, sizeof(rec));
+    pcm_tap_ring_write(tap, head + sizeof(rec), buffer, bytes);
+    android_atomic_release_store((int32_t)(head + needed), &tap->head);
+}
+
+void audio_extn_pcm_tap_out(struct stream_out *out, const void *buffer,
+                            size_t bytes)
+{
+    pcm_tap_push(out->usecase, out->devices, out->sample_rate,
+                 popcount(out->channel_mask), out->format, buffer, bytes);
+}
+
+void audio_extn_pcm_tap_in(struct stream_in *in, const void *buffer,
+                           size_t bytes)
+{
+    pcm_tap_push(in->usecase, in->device, in->config.rate,
+                 audio_channel_count_from_in_mask(in->channel_mask),
+                 in->format, buffer, bytes);
+}
+
+void audio_extn_pcm_tap_deinit()
+{
+    int i;
+
+    pthread_mutex_lock(&tapmod.lock);
+    for (i = 0; i < AUDIO_USECASE_MAX; i++)
+        android_atomic_release_store(0, &tapmod.taps[i].enabled);
+    if (tapmod.thread_started) {
+        android_atomic_release_store(1, &tapmod.thread_exit);
+        pthread_join(tapmod.thread, (void **) NULL);
+        tapmod.thread_started = false;
+    }
+    for (i = 0; i < AUDIO_USECASE_MAX; i++) {
+        if (tapmod.taps[i].dropped)
+            ALOGW("%s: %s dropped %u bytes at close", __func__,
+                  use_case_table[i], tapmod.taps[i].dropped);
+        free(tapmod.taps[i].buf);
+        memset(&tapmod.taps[i], 0, sizeof(tapmod.taps[i]));
+    }
+    pthread_mutex_unlock(&tapmod.lock);
+}
@@ -33,7 +33,15 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <dlfcn.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
 #include <cutils/log.h>
+#include <cutils/properties.h>
+#include <cutils/sched_policy.h>
+#include <system/thread_defs.h>
 #include "audio_hw.h"
 #include "audio_extn.h"
 #include "platform.h"
@@ -43,9 +51,46 @@
 #define XSTR(x) STR(x)
 #define STR(x) #x
 
+#define ST_LAB_RING_PROPERTY        "audio.sound_trigger.lab_ring_ms"
+#define ST_LAB_RING_DEFAULT_MS      "4000"
+#define ST_LAB_RING_MIN_CHUNKS      4
+#define ST_LAB_STOP_RETRY_MS        10
+
+/*
+ * Look ahead buffer (LAB) ring of a sound trigger capture. A drain thread
+ * starts reading the LAB pcm into the ring as soon as the sound trigger
+ * HAL registers the detected session, and keeps up with the driver, so
+ * the keyword and the audio buffered since the detection leave the DSP in
+ * one burst whenever the client opens its stream. The stream takes the
+ * ring over on its first read and in_read() is served from memory at
+ * whatever rate the client reads. pcm_read() writes straight into the
+ * free part of the ring and in_read() copies straight out of the filled
+ * part; that copy is the one pcm_read() would otherwise make into the
+ * client buffer.
+ */
+struct sound_trigger_lab {
+    struct pcm *pcm;
+    char *buf;
+    size_t size;                /* a multiple of chunk */
+    size_t chunk;               /* bytes per pcm_read() */
+    size_t bytes_per_ms;
+    uint64_t written;
+    uint64_t read;
+    uint64_t peak;              /* largest backlog in bytes */
+    int error;
+    bool exit;
+    bool done;                  /* the drain thread has left its loop */
+    int64_t start_ns;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+};
+
 struct sound_trigger_info  {
     struct sound_trigger_session_info st_ses;
     bool lab_stopped;
+    /* draining since detection, until a stream takes it over */
+    struct sound_trigger_lab *lab;
     struct listnode list;
 };
 
@@ -59,12 +104,16 @@ struct sound_trigger_audio_device {
 
 static struct sound_trigger_audio_device *st_dev;
 
+static struct sound_trigger_lab *
+st_lab_start(const struct sound_trigger_session_info *st_ses);
+static void st_lab_stop(struct sound_trigger_lab *lab);
+
 static struct sound_trigger_info *
 get_sound_trigger_info(int capture_handle)
 {
     struct sound_trigger_info  *st_ses_info = NULL;
     struct listnode *node;
-    ALOGD("%s: list %d capture_handle %d", __func__,
+    ALOGV("%s: list %d capture_handle %d", __func__,
            list_empty(&st_dev->st_ses_list), capture_handle);
     list_for_each(node, &st_dev->st_ses_list) {
         st_ses_info = node_to_item(node, struct sound_trigger_info , list);
@@ -100,6 +149,8 @@ int audio_hw_call_back(sound_trigger_event_type_t event,
         memcpy(&st_ses_info->st_ses, &config->st_ses, sizeof (config->st_ses));
         ALOGV("%s: add capture_handle %d pcm %p", __func__,
               st_ses_info->st_ses.capture_handle, st_ses_info->st_ses.pcm);
+        /* the session is registered on detection, drain its LAB now */
+        st_ses_info->lab = st_lab_start(&st_ses_info->st_ses);
         list_add_tail(&st_dev->st_ses_list, &st_ses_info->list);
         break;
 
@@ -118,6 +169,9 @@ int audio_hw_call_back(sound_trigger_event_type_t event,
         ALOGV("%s: remove capture_handle %d pcm %p", __func__,
               st_ses_info->st_ses.capture_handle, st_ses_info->st_ses.pcm);
         list_remove(&st_ses_info->list);
+        /* no stream took the LAB over, the pcm is about to be closed */
+        if (st_ses_info->lab)
+            st_lab_stop(st_ses_info->lab);
         free(st_ses_info);
         break;
     default:
@@ -128,6 +182,236 @@ int audio_hw_call_back(sound_trigger_event_type_t event,
     return status;
 }
 
+static int64_t st_lab_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void *st_lab_thread_loop(void *context)
+{
+    struct sound_trigger_lab *lab = (struct sound_trigger_lab *)context;
+    char *dst;
+    int ret;
+
+    setpriority(PRIO_PROCESS, 0, ANDROID_PRIORITY_AUDIO);
+    set_sched_policy(0, SP_FOREGROUND);
+    prctl(PR_SET_NAME, (unsigned long)"ST LAB Drain", 0, 0, 0);
+
+    pthread_mutex_lock(&lab->lock);
+    while (!lab->exit) {
+        if (lab->written - lab->read + lab->chunk > lab->size) {
+            pthread_cond_wait(&lab->cond, &lab->lock);
+            continue;
+        }
+        /* chunks never straddle the end of the ring */
+        dst = lab->buf + (size_t)(lab->written % lab->size);
+        pthread_mutex_unlock(&lab->lock);
+        ret = pcm_read(lab->pcm, dst, lab->chunk);
+        pthread_mutex_lock(&lab->lock);
+        if (ret != 0 && lab->exit)
+            break;
+        if (ret != 0) {
+            lab->error = errno ? -errno : -EIO;
+            ALOGE("%s: pcm_read failed: %s", __func__, pcm_get_error(lab->pcm));
+            pthread_cond_broadcast(&lab->cond);
+            break;
+        }
+        lab->written += lab->chunk;
+        if (lab->written - lab->read > lab->peak)
+            lab->peak = lab->written - lab->read;
+        pthread_cond_broadcast(&lab->cond);
+    }
+    lab->done = true;
+    pthread_cond_broadcast(&lab->cond);
+    pthread_mutex_unlock(&lab->lock);
+
+    return NULL;
+}
+
+static void st_lab_stop(struct sound_trigger_lab *lab)
+{
+    struct timespec ts;
+
+    pthread_mutex_lock(&lab->lock);
+    lab->exit = true;
+    pthread_cond_broadcast(&lab->cond);
+    /*
+     * A stalled LAB leaves the drain thread blocked in pcm_read(), and
+     * stopping the pcm makes that read return. pcm_read() restarts a
+     * stopped pcm, so keep stopping it until the thread has left.
+     */
+    while (!lab->done) {
+        pthread_mutex_unlock(&lab->lock);
+        pcm_stop(lab->pcm);
+        pthread_mutex_lock(&lab->lock);
+        if (lab->done)
+            break;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += ST_LAB_STOP_RETRY_MS * 1000000LL;
+        ts.tv_sec += ts.tv_nsec / 1000000000LL;
+        ts.tv_nsec %= 1000000000LL;
+        pthread_cond_timedwait(&lab->cond, &lab->lock, &ts);
+    }
+    pthread_mutex_unlock(&lab->lock);
+    pthread_join(lab->thread, (void **) NULL);
+
+    ALOGD("%s: drained %llu ms in %lld ms, delivered %llu ms, peak backlog %llu ms",
+          __func__, (unsigned long long)(lab->written / lab->bytes_per_ms),
+          (long long)((st_lab_now_ns() - lab->start_ns) / 1000000),
+          (unsigned long long)(lab->read / lab->bytes_per_ms),
+          (unsigned long long)(lab->peak / lab->bytes_per_ms));
+
+    munmap(lab->buf, lab->size);
+    pthread_cond_destroy(&lab->cond);
+    pthread_mutex_destroy(&lab->lock);
+    free(lab);
+}
+
+/*
+ * Starts draining the LAB of a detected session. Returns NULL when there
+ * is no ring, in which case in_read() reads the pcm directly.
+ */
+static struct sound_trigger_lab *
+st_lab_start(const struct sound_trigger_session_info *st_ses)
+{
+    struct sound_trigger_lab *lab;
+    char value[PROPERTY_VALUE_MAX];
+    size_t frame_size, chunk, bytes_per_ms, chunks;
+
+    if (!st_ses->pcm)
+        return NULL;
+
+    frame_size = st_ses->config.channels *
+                 (pcm_format_to_bits(st_ses->config.format) >> 3);
+    chunk = st_ses->config.period_size * frame_size;
+    bytes_per_ms = st_ses->config.rate * frame_size / 1000;
+    if (!chunk || !bytes_per_ms) {
+        ALOGE("%s: invalid LAB config, reading the pcm directly", __func__);
+        return NULL;
+    }
+
+    property_get(ST_LAB_RING_PROPERTY, value, ST_LAB_RING_DEFAULT_MS);
+    chunks = (atoi(value) * bytes_per_ms + chunk - 1) / chunk;
+    if (chunks < ST_LAB_RING_MIN_CHUNKS)
+        chunks = ST_LAB_RING_MIN_CHUNKS;
+
+    lab = (struct sound_trigger_lab *)calloc(1, sizeof(*lab));
+    if (!lab) {
+        ALOGE("%s: LAB alloc failed", __func__);
+        return NULL;
+    }
+    lab->pcm = st_ses->pcm;
+    lab->chunk = chunk;
+    lab->size = chunks * chunk;
+    lab->bytes_per_ms = bytes_per_ms;
+    lab->buf = mmap(NULL, lab->size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (lab->buf == MAP_FAILED) {
+        ALOGE("%s: mmap of %zu bytes failed: %s", __func__, lab->size,
+              strerror(errno));
+        free(lab);
+        return NULL;
+    }
+    pthread_mutex_init(&lab->lock, (const pthread_mutexattr_t *) NULL);
+    pthread_cond_init(&lab->cond, (const pthread_condattr_t *) NULL);
+    lab->start_ns = st_lab_now_ns();
+
+    if (pthread_create(&lab->thread, (const pthread_attr_t *) NULL,
+                       st_lab_thread_loop, lab)) {
+        ALOGE("%s: drain thread create failed", __func__);
+        munmap(lab->buf, lab->size);
+        pthread_cond_destroy(&lab->cond);
+        pthread_mutex_destroy(&lab->lock);
+        free(lab);
+        return NULL;
+    }
+    ALOGV("%s: capture_handle %d ring %zu bytes, chunk %zu", __func__,
+          st_ses->capture_handle, lab->size, lab->chunk);
+    return lab;
+}
+
+/*
+ * Hands the ring of the stream's session to the stream when it leaves
+ * standby; stopping the LAB then stops the drain.
+ */
+void audio_extn_sound_trigger_start_lab(struct stream_in *in)
+{
+    struct sound_trigger_info *st_ses_info;
+
+    if (!st_dev || !in || in->st_lab)
+        return;
+
+    pthread_mutex_lock(&st_dev->lock);
+    st_ses_info = get_sound_trigger_info(in->capture_handle);
+    if (st_ses_info) {
+        in->st_lab = st_ses_info->lab;
+        st_ses_info->lab = NULL;
+    }
+    pthread_mutex_unlock(&st_dev->lock);
+}
+
+/* Blocks until bytes are in the ring, like pcm_read() */
+int audio_extn_sound_trigger_read(struct stream_in *in, void *buffer,
+                                  size_t bytes)
+{
+    struct sound_trigger_lab *lab = in->st_lab;
+    char *dst = (char *)buffer;
+    size_t off, n;
+    uint64_t avail;
+    int ret = 0;
+
+    if (!lab)
+        return -ENODEV;
+
+    pthread_mutex_lock(&lab->lock);
+    while (bytes) {
+        avail = lab->written - lab->read;
+        if (!avail) {
+            if (lab->error || lab->exit) {
+                ret = lab->error ? lab->error : -EIO;
+                break;
+            }
+            pthread_cond_wait(&lab->cond, &lab->lock);
+            continue;
+        }
+        off = (size_t)(lab->read % lab->size);
+        n = lab->size - off;
+        if (n > avail)
+            n = (size_t)avail;
+        if (n > bytes)
+            n = bytes;
+        /* the drain thread never writes to the filled part */
+        pthread_mutex_unlock(&lab->lock);
+        memcpy(dst, lab->buf + off, n);
+        pthread_mutex_lock(&lab->lock);
+        lab->read += n;
+        dst += n;
+        bytes -= n;
+        pthread_cond_broadcast(&lab->cond);
+    }
+    pthread_mutex_unlock(&lab->lock);
+
+    return ret;
+}
+
+/* Bytes in_read() can take from the ring without blocking */
+size_t audio_extn_sound_trigger_avail(struct stream_in *in)
+{
+    struct sound_trigger_lab *lab = in->st_lab;
+    size_t avail;
+
+    if (!lab)
+        return 0;
+
+    pthread_mutex_lock(&lab->lock);
+    avail = (size_t)(lab->written - lab->read);
+    pthread_mutex_unlock(&lab->lock);
+    return avail;
+}
+
 void audio_extn_sound_trigger_stop_lab(struct stream_in *in)
 {
     int status = 0;
@@ -137,6 +421,15 @@ void audio_extn_sound_trigger_stop_lab(struct stream_in *in)
     if (!st_dev || !in)
        return;
 
+    /*
+     * The sound trigger HAL may close the pcm once the LAB is stopped, so
+     * the drain thread is stopped and joined first.
+     */
+    if (in->st_lab) {
+        st_lab_stop(in->st_lab);
+        in->st_lab = NULL;
+    }
+
     pthread_mutex_lock(&st_dev->lock);
     st_ses_info = get_sound_trigger_info(in->capture_handle);
     pthread_mutex_unlock(&st_dev->lock);
@@ -22,9 +22,13 @@
 #define LOG_NDDEBUG 0
 
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <cutils/properties.h>
 #include <stdlib.h>
 #include <dlfcn.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <cutils/str_parms.h>
 #include <cutils/log.h>
 
@@ -32,6 +36,7 @@
 #include "platform.h"
 #include "platform_api.h"
 #include "surround_filters_interface.h"
+#include "ssr_ola.h"
 
 #ifdef SSR_ENABLED
 #define COEFF_ARRAY_SIZE            4
@@ -52,6 +57,12 @@
 #define SURROUND_FILE_3I "/system/etc/surround_sound/filter3i.pcm"
 #define SURROUND_FILE_4I "/system/etc/surround_sound/filter4i.pcm"
 
+/* All eight filters above in one file, real 1-4 followed by imaginary 1-4 */
+#define SURROUND_COEFFS_BLOB "/system/etc/surround_sound/filters.bin"
+#define SURROUND_COEFFS_SIZE (2 * COEFF_ARRAY_SIZE * FILT_SIZE * sizeof(Word16))
+
+#define SSR_DUMP_RING_SIZE      (64 * 1024)
+
 #define LIB_SURROUND_PROC       "libsurround_proc.so"
 
 typedef int  (*surround_filters_init_t)(void *, int, int, Word16 **,
@@ -60,11 +71,29 @@ typedef void (*surround_filters_release_t)(void *);
 typedef int  (*surround_filters_set_channel_map_t)(void *, const int *);
 typedef void (*surround_filters_intl_process_t)(void *, Word16 *, Word16 *);
 
+/* Capture dumps are written by a separate thread so that file I/O never
+   stalls audio_extn_ssr_read(); data is dropped when the ring is full */
+struct ssr_dump_ring {
+    FILE                *fp;
+    unsigned char       *buf;
+    size_t               rd;
+    size_t               wr;
+    size_t               dropped;
+};
+
 struct ssr_module {
-    FILE                *fp_4ch;
-    FILE                *fp_6ch;
-    Word16             **real_coeffs;
-    Word16             **imag_coeffs;
+    struct ssr_dump_ring dump_4ch;
+    struct ssr_dump_ring dump_6ch;
+    pthread_t           dump_thread;
+    pthread_mutex_t     dump_lock;
+    pthread_cond_t      dump_cond;
+    bool                dump_thread_started;
+    bool                dump_thread_done;
+
+    Word16              *real_coeffs[COEFF_ARRAY_SIZE];
+    Word16              *imag_coeffs[COEFF_ARRAY_SIZE];
+    void                *coeffs_data;
+    bool                coeffs_mapped;
     void                *surround_obj;
     Word16             *surround_raw_buffer;
     bool                is_ssr_enabled;
@@ -77,10 +106,11 @@ struct ssr_module {
 };
 
 static struct ssr_module ssrmod = {
-    .fp_4ch = NULL,
-    .fp_6ch = NULL,
-    .real_coeffs = NULL,
-    .imag_coeffs = NULL,
+    .dump_thread_started = false,
+    .dump_lock = PTHREAD_MUTEX_INITIALIZER,
+    .dump_cond = PTHREAD_COND_INITIALIZER,
+    .coeffs_data = NULL,
+    .coeffs_mapped = false,
     .surround_obj = NULL,
     .surround_raw_buffer = NULL,
     .is_ssr_enabled = 0,
@@ -95,117 +125,242 @@ static struct ssr_module ssrmod = {
 /* Use AAC/DTS channel mapping as default channel mapping: C,FL,FR,Ls,Rs,LFE */
 static const int chan_map[] = { 1, 2, 4, 3, 0, 5};
 
-/* Rotine to read coeffs from File and updates real and imaginary
-   coeff array member variable */
-static int32_t ssr_read_coeffs_from_file()
+static void ssr_set_coeff_pointers(Word16 *coeffs)
 {
-    FILE    *flt1r;
-    FILE    *flt2r;
-    FILE    *flt3r;
-    FILE    *flt4r;
-    FILE    *flt1i;
-    FILE    *flt2i;
-    FILE    *flt3i;
-    FILE    *flt4i;
     int i;
 
-    if ( (flt1r = fopen(SURROUND_FILE_1R, "rb")) == NULL ) {
-        ALOGE("%s: Cannot open filter co-efficient "
-              "file %s", __func__, SURROUND_FILE_1R);
-        return -EINVAL;
+    for (i = 0; i < COEFF_ARRAY_SIZE; i++) {
+        ssrmod.real_coeffs[i] = coeffs + i * FILT_SIZE;
+        ssrmod.imag_coeffs[i] = coeffs + (COEFF_ARRAY_SIZE + i) * FILT_SIZE;
     }
+}
 
-    if ( (flt2r = fopen(SURROUND_FILE_2R, "rb")) == NULL ) {
-        ALOGE("%s: Cannot open filter "
-              "co-efficient file %s", __func__, SURROUND_FILE_2R);
-        return -EINVAL;
-    }
+/* Map the single coefficient blob if the target ships one */
+static int32_t ssr_map_coeffs_blob()
+{
+    struct stat st;
+    void *data;
+    int fd;
 
-    if ( (flt3r = fopen(SURROUND_FILE_3R, "rb")) == NULL ) {
-        ALOGE("%s: Cannot open filter "
-              "co-efficient file %s", __func__, SURROUND_FILE_3R);
-        return  -EINVAL;
-    }
+    fd = open(SURROUND_COEFFS_BLOB, O_RDONLY);
+    if (fd < 0)
+        return -ENOENT;
 
-    if ( (flt4r = fopen(SURROUND_FILE_4R, "rb")) == NULL ) {
-        ALOGE("%s: Cannot open filter "
-              "co-efficient file %s", __func__, SURROUND_FILE_4R);
-        return  -EINVAL;
-    }
-
-    if ( (flt1i = fopen(SURROUND_FILE_1I, "rb")) == NULL ) {
-        ALOGE("%s: Cannot open filter "
-              "co-efficient file %s", __func__, SURROUND_FILE_1I);
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)SURROUND_COEFFS_SIZE) {
+        ALOGE("%s: %s is too small", __func__, SURROUND_COEFFS_BLOB);
+        close(fd);
         return -EINVAL;
     }
 
-    if ( (flt2i = fopen(SURROUND_FILE_2I, "rb")) == NULL ) {
-        ALOGE("%s: Cannot open filter "
-              "co-efficient file %s", __func__, SURROUND_FILE_2I);
-        return -EINVAL;
+    data = mmap(NULL, SURROUND_COEFFS_SIZE, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        ALOGE("%s: mmap of %s failed", __func__, SURROUND_COEFFS_BLOB);
+        return -errno;
     }
 
-    if ( (flt3i = fopen(SURROUND_FILE_3I, "rb")) == NULL ) {
-        ALOGE("%s: Cannot open filter "
-              "co-efficient file %s", __func__, SURROUND_FILE_3I);
-        return -EINVAL;
+    ssrmod.coeffs_data = data;
+    ssrmod.coeffs_mapped = true;
+    ssr_set_coeff_pointers((Word16 *)data);
+    return 0;
+}
+
+/* Rotine to read coeffs from the per filter files into one buffer */
+static int32_t ssr_read_coeffs_from_file()
+{
+    static const char * const files[2 * COEFF_ARRAY_SIZE] = {
+        SURROUND_FILE_1R, SURROUND_FILE_2R, SURROUND_FILE_3R, SURROUND_FILE_4R,
+        SURROUND_FILE_1I, SURROUND_FILE_2I, SURROUND_FILE_3I, SURROUND_FILE_4I,
+    };
+    Word16 *coeffs;
+    FILE *fp;
+    int i;
+
+    coeffs = (Word16 *)calloc(2 * COEFF_ARRAY_SIZE * FILT_SIZE, sizeof(Word16));
+    if (!coeffs) {
+        ALOGE("%s: Memory allocation failure for coefficients", __func__);
+        return -ENOMEM;
     }
 
-    if ( (flt4i = fopen(SURROUND_FILE_4I, "rb")) == NULL ) {
-        ALOGE("%s: Cannot open filter "
-              "co-efficient file %s", __func__, SURROUND_FILE_4I);
-        return -EINVAL;
+    for (i = 0; i < 2 * COEFF_ARRAY_SIZE; i++) {
+        if ((fp = fopen(files[i], "rb")) == NULL) {
+            ALOGE("%s: Cannot open filter co-efficient "
+                  "file %s", __func__, files[i]);
+            free(coeffs);
+            return -EINVAL;
+        }
+        fread(coeffs + i * FILT_SIZE, sizeof(int16), FILT_SIZE, fp);
+        fclose(fp);
     }
     ALOGV("%s: readCoeffsFromFile all filter "
-          "files opened", __func__);
+          "files read", __func__);
 
-    for (i=0; i<COEFF_ARRAY_SIZE; i++) {
-        ssrmod.real_coeffs[i] = (Word16 *)calloc(FILT_SIZE, sizeof(Word16));
-    }
-    for (i=0; i<COEFF_ARRAY_SIZE; i++) {
-        ssrmod.imag_coeffs[i] = (Word16 *)calloc(FILT_SIZE, sizeof(Word16));
-    }
+    ssrmod.coeffs_data = coeffs;
+    ssrmod.coeffs_mapped = false;
+    ssr_set_coeff_pointers(coeffs);
+    return 0;
+}
 
-    /* Read real co-efficients */
-    if (NULL != ssrmod.real_coeffs[0]) {
-        fread(ssrmod.real_coeffs[0], sizeof(int16), FILT_SIZE, flt1r);
-    }
-    if (NULL != ssrmod.real_coeffs[0]) {
-        fread(ssrmod.real_coeffs[1], sizeof(int16), FILT_SIZE, flt2r);
-    }
-    if (NULL != ssrmod.real_coeffs[0]) {
-        fread(ssrmod.real_coeffs[2], sizeof(int16), FILT_SIZE, flt3r);
-    }
-    if (NULL != ssrmod.real_coeffs[0]) {
-        fread(ssrmod.real_coeffs[3], sizeof(int16), FILT_SIZE, flt4r);
-    }
+/* Coefficients are loaded on first use and kept for the process lifetime */
+static int32_t ssr_load_coeffs()
+{
+    if (ssrmod.coeffs_data)
+        return 0;
 
-    /* read imaginary co-efficients */
-    if (NULL != ssrmod.imag_coeffs[0]) {
-        fread(ssrmod.imag_coeffs[0], sizeof(int16), FILT_SIZE, flt1i);
-    }
-    if (NULL != ssrmod.imag_coeffs[0]) {
-        fread(ssrmod.imag_coeffs[1], sizeof(int16), FILT_SIZE, flt2i);
-    }
-    if (NULL != ssrmod.imag_coeffs[0]) {
-        fread(ssrmod.imag_coeffs[2], sizeof(int16), FILT_SIZE, flt3i);
+    if (ssr_map_coeffs_blob() == 0) {
+        ALOGV("%s: using coefficient blob %s", __func__, SURROUND_COEFFS_BLOB);
+        return 0;
     }
-    if (NULL != ssrmod.imag_coeffs[0]) {
-        fread(ssrmod.imag_coeffs[3], sizeof(int16), FILT_SIZE, flt4i);
+    return ssr_read_coeffs_from_file();
+}
+
+static void ssr_use_builtin_filters()
+{
+    ALOGI("%s: using in-tree surround filters", __func__);
+    ssrmod.surround_filters_init = ssr_ola_init;
+    ssrmod.surround_filters_release = ssr_ola_release;
+    ssrmod.surround_filters_set_channel_map = ssr_ola_set_channel_map;
+    ssrmod.surround_filters_intl_process = ssr_ola_intl_process;
+}
+
+static size_t ssr_dump_ring_avail(const struct ssr_dump_ring *ring)
+{
+    return ring->wr - ring->rd;
+}
+
+static void ssr_dump_ring_drain(struct ssr_dump_ring *ring)
+{
+    size_t rd, avail, offset, chunk;
+
+    pthread_mutex_lock(&ssrmod.dump_lock);
+    rd = ring->rd;
+    avail = ssr_dump_ring_avail(ring);
+    pthread_mutex_unlock(&ssrmod.dump_lock);
+
+    /* only this thread advances rd, so the data can't move under us */
+    while (avail) {
+        offset = rd % SSR_DUMP_RING_SIZE;
+        chunk = SSR_DUMP_RING_SIZE - offset;
+        if (chunk > avail)
+            chunk = avail;
+        fwrite(ring->buf + offset, 1, chunk, ring->fp);
+        rd += chunk;
+        avail -= chunk;
+    }
+
+    pthread_mutex_lock(&ssrmod.dump_lock);
+    ring->rd = rd;
+    pthread_mutex_unlock(&ssrmod.dump_lock);
+}
+
+static void *ssr_dump_thread_loop(void *context __unused)
+{
+    bool done = false;
+
+    while (!done) {
+        pthread_mutex_lock(&ssrmod.dump_lock);
+        while (!ssrmod.dump_thread_done &&
+               !ssr_dump_ring_avail(&ssrmod.dump_4ch) &&
+               !ssr_dump_ring_avail(&ssrmod.dump_6ch))
+            pthread_cond_wait(&ssrmod.dump_cond, &ssrmod.dump_lock);
+        done = ssrmod.dump_thread_done;
+        pthread_mutex_unlock(&ssrmod.dump_lock);
+
+        ssr_dump_ring_drain(&ssrmod.dump_4ch);
+        ssr_dump_ring_drain(&ssrmod.dump_6ch);
     }
+    return NULL;
+}
+
+/* Called from the capture thread; never blocks on file I/O */
+static void ssr_dump_write(struct ssr_dump_ring *ring, const void *data,
+                           size_t bytes)
+{
+    size_t offset, chunk;
 
-    fclose(flt1r);
-    fclose(flt2r);
-    fclose(flt3r);
-    fclose(flt4r);
-    fclose(flt1i);
-    fclose(flt2i);
-    fclose(flt3i);
-    fclose(flt4i);
+    if (!ring->fp)
+        return;
 
+    pthread_mutex_lock(&ssrmod.dump_lock);
+    if (SSR_DUMP_RING_SIZE - ssr_dump_ring_avail(ring) < bytes) {
+        ring->dropped += bytes;
+    } else {
+        offset = ring->wr % SSR_DUMP_RING_SIZE;
+        chunk = SSR_DUMP_RING_SIZE - offset;
+        if (chunk > bytes)
+            chunk = bytes;
+        memcpy(ring->buf + offset, data, chunk);
+        memcpy(ring->buf, (const unsigned char *)data + chunk, bytes - chunk);
+        ring->wr += bytes;
+        pthread_cond_signal(&ssrmod.dump_cond);
+    }
+    pthread_mutex_unlock(&ssrmod.dump_lock);
+}
+
+static void ssr_dump_ring_close(struct ssr_dump_ring *ring)
+{
+    if (ring->dropped)
+        ALOGW("%s: dropped %zu dump bytes", __func__, ring->dropped);
+    if (ring->fp)
+        fclose(ring->fp);
+    free(ring->buf);
+    memset(ring, 0, sizeof(*ring));
+}
+
+static int ssr_dump_ring_open(struct ssr_dump_ring *ring, const char *path)
+{
+    memset(ring, 0, sizeof(*ring));
+    ring->buf = (unsigned char *)malloc(SSR_DUMP_RING_SIZE);
+    ring->fp = fopen(path, "wb");
+    if (!ring->buf || !ring->fp) {
+        ALOGE("%s: %s open failed", __func__, path);
+        ssr_dump_ring_close(ring);
+        return -EINVAL;
+    }
     return 0;
 }
 
+static void ssr_dump_start()
+{
+    if (ssrmod.dump_thread_started)
+        return;
+
+    /* Remember to change file system permission of data(e.g. chmod 777 data/),
+      otherwise, fopen may fail */
+    if (ssr_dump_ring_open(&ssrmod.dump_4ch, "/data/4ch.pcm") ||
+        ssr_dump_ring_open(&ssrmod.dump_6ch, "/data/6ch.pcm"))
+        goto fail;
+
+    ssrmod.dump_thread_done = false;
+    if (pthread_create(&ssrmod.dump_thread, (const pthread_attr_t *) NULL,
+                       ssr_dump_thread_loop, NULL)) {
+        ALOGE("%s: failed to create dump thread", __func__);
+        goto fail;
+    }
+    ssrmod.dump_thread_started = true;
+    return;
+
+fail:
+    ssr_dump_ring_close(&ssrmod.dump_4ch);
+    ssr_dump_ring_close(&ssrmod.dump_6ch);
+}
+
+static void ssr_dump_stop()
+{
+    if (!ssrmod.dump_thread_started)
+        return;
+
+    pthread_mutex_lock(&ssrmod.dump_lock);
+    ssrmod.dump_thread_done = true;
+    pthread_cond_signal(&ssrmod.dump_cond);
+    pthread_mutex_unlock(&ssrmod.dump_lock);
+    pthread_join(ssrmod.dump_thread, (void **) NULL);
+    ssrmod.dump_thread_started = false;
+
+    ssr_dump_ring_close(&ssrmod.dump_4ch);
+    ssr_dump_ring_close(&ssrmod.dump_6ch);
+}
+
 static int32_t ssr_init_surround_sound_lib(unsigned long buffersize)
 {
     /* sub_woofer channel assignment: default as first
@@ -217,7 +372,7 @@ static int32_t ssr_init_surround_sound_lib(unsigned long buffersize)
     /* frequency upper bound for spatial processing:
        frequency=(high_freq-1)/FFT_SIZE*samplingRate, default as 100 */
     int high_freq = 100;
-    int i, ret = 0;
+    int ret = 0;
 
     if ( ssrmod.surround_obj ) {
         ALOGE("%s: ola filter library is already initialized", __func__);
@@ -233,29 +388,15 @@ static int32_t ssr_init_surround_sound_lib(unsigned long buffersize)
        goto init_fail;
     }
 
-    /* Allocate memory for real and imag coeffs array */
-    ssrmod.real_coeffs = (Word16 **) calloc(COEFF_ARRAY_SIZE, sizeof(Word16 *));
-    if ( !ssrmod.real_coeffs ) {
-        ALOGE("%s: Memory allocation failure during real "
-              "Coefficient array", __func__);
-        goto init_fail;
-    }
-
-    ssrmod.imag_coeffs = (Word16 **) calloc(COEFF_ARRAY_SIZE, sizeof(Word16 *));
-    if ( !ssrmod.imag_coeffs ) {
-        ALOGE("%s: Memory allocation failure during imaginary "
-              "Coefficient array", __func__);
-        goto init_fail;
-    }
-
-    if( ssr_read_coeffs_from_file() != 0) {
+    if( ssr_load_coeffs() != 0) {
         ALOGE("%s: Error while loading coeffs from file", __func__);
         goto init_fail;
     }
 
     ssrmod.surround_filters_handle = dlopen(LIB_SURROUND_PROC, RTLD_NOW);
     if (ssrmod.surround_filters_handle == NULL) {
-        ALOGE("%s: DLOPEN failed for %s", __func__, LIB_SURROUND_PROC);
+        ALOGW("%s: DLOPEN failed for %s", __func__, LIB_SURROUND_PROC);
+        ssr_use_builtin_filters();
     } else {
         ALOGV("%s: DLOPEN successful for %s", __func__, LIB_SURROUND_PROC);
         ssrmod.surround_filters_init = (surround_filters_init_t)
@@ -276,7 +417,9 @@ static int32_t ssr_init_surround_sound_lib(unsigned long buffersize)
             !ssrmod.surround_filters_intl_process){
             ALOGW("%s: Could not find the one of the symbols from %s",
                   __func__, LIB_SURROUND_PROC);
-            goto init_fail;
+            dlclose(ssrmod.surround_filters_handle);
+            ssrmod.surround_filters_handle = NULL;
+            ssr_use_builtin_filters();
         }
     }
 
@@ -293,8 +436,7 @@ static int32_t ssr_init_surround_sound_lib(unsigned long buffersize)
 
     if ( ret > 0 ) {
         ALOGV("%s: Allocating surroundObj size is %d", __func__, ret);
-        ssrmod.surround_obj = (void *)malloc(ret);
-        memset(ssrmod.surround_obj,0,ret);
+        ssrmod.surround_obj = calloc(1, ret);
         if (NULL != ssrmod.surround_obj) {
             /* initialize after allocating the memory for surround_obj */
             ret = ssrmod.surround_filters_init(ssrmod.surround_obj,
@@ -334,25 +476,9 @@ init_fail:
         free(ssrmod.surround_raw_buffer);
         ssrmod.surround_raw_buffer = NULL;
     }
-    if (ssrmod.real_coeffs){
-        for (i =0; i<COEFF_ARRAY_SIZE; i++ ) {
-            if (ssrmod.real_coeffs[i]) {
-                free(ssrmod.real_coeffs[i]);
-                ssrmod.real_coeffs[i] = NULL;
-            }
-        }
-        free(ssrmod.real_coeffs);
-        ssrmod.real_coeffs = NULL;
-    }
-    if (ssrmod.imag_coeffs){
-        for (i =0; i<COEFF_ARRAY_SIZE; i++ ) {
-            if (ssrmod.imag_coeffs[i]) {
-                free(ssrmod.imag_coeffs[i]);
-                ssrmod.imag_coeffs[i] = NULL;
-            }
-        }
-        free(ssrmod.imag_coeffs);
-        ssrmod.imag_coeffs = NULL;
+    if (ssrmod.surround_filters_handle) {
+        dlclose(ssrmod.surround_filters_handle);
+        ssrmod.surround_filters_handle = NULL;
     }
 
     return -ENOMEM;
@@ -402,15 +528,7 @@ int32_t audio_extn_ssr_init(struct stream_in *in)
 
     property_get("ssr.pcmdump",c_multi_ch_dump,"0");
     if (0 == strncmp("true", c_multi_ch_dump, sizeof("ssr.dump-pcm"))) {
-        /* Remember to change file system permission of data(e.g. chmod 777 data/),
-          otherwise, fopen may fail */
-        if ( !ssrmod.fp_4ch)
-            ssrmod.fp_4ch = fopen("/data/4ch.pcm", "wb");
-        if ( !ssrmod.fp_6ch)
-            ssrmod.fp_6ch = fopen("/data/6ch.pcm", "wb");
-        if ((!ssrmod.fp_4ch) || (!ssrmod.fp_6ch))
-            ALOGE("%s: mfp_4ch or mfp_6ch open failed: mfp_4ch:%p mfp_6ch:%p",
-                  __func__, ssrmod.fp_4ch, ssrmod.fp_6ch);
+        ssr_dump_start();
     }
 
     return 0;
@@ -418,43 +536,18 @@ int32_t audio_extn_ssr_init(struct stream_in *in)
 
 int32_t audio_extn_ssr_deinit()
 {
-    int i;
-
     if (ssrmod.surround_obj) {
         ALOGV("%s: entry", __func__);
         ssrmod.surround_filters_release(ssrmod.surround_obj);
         if (ssrmod.surround_obj)
             free(ssrmod.surround_obj);
         ssrmod.surround_obj = NULL;
-        if (ssrmod.real_coeffs){
-            for (i =0; i<COEFF_ARRAY_SIZE; i++ ) {
-                if (ssrmod.real_coeffs[i]) {
-                    free(ssrmod.real_coeffs[i]);
-                    ssrmod.real_coeffs[i] = NULL;
-                }
-            }
-            free(ssrmod.real_coeffs);
-            ssrmod.real_coeffs = NULL;
-        }
-        if (ssrmod.imag_coeffs){
-            for (i =0; i<COEFF_ARRAY_SIZE; i++ ) {
-                if (ssrmod.imag_coeffs[i]) {
-                    free(ssrmod.imag_coeffs[i]);
-                    ssrmod.imag_coeffs[i] = NULL;
-                }
-            }
-            free(ssrmod.imag_coeffs);
-            ssrmod.imag_coeffs = NULL;
-        }
         if (ssrmod.surround_raw_buffer) {
             free(ssrmod.surround_raw_buffer);
             ssrmod.surround_raw_buffer = NULL;
         }
-        if (ssrmod.fp_4ch)
-            fclose(ssrmod.fp_4ch);
-        if (ssrmod.fp_6ch)
-            fclose(ssrmod.fp_6ch);
     }
+    ssr_dump_stop();
 
     if(ssrmod.surround_filters_handle) {
         dlclose(ssrmod.surround_filters_handle);
@@ -492,10 +585,8 @@ int32_t audio_extn_ssr_read(struct audio_stream_in *stream,
         buffer, ssrmod.surround_raw_buffer);
 
     /*dump for raw pcm data*/
-    if (ssrmod.fp_4ch)
-        fwrite(ssrmod.surround_raw_buffer, 1, peroid_bytes, ssrmod.fp_4ch);
-    if (ssrmod.fp_6ch)
-        fwrite(buffer, 1, bytes, ssrmod.fp_6ch);
+    ssr_dump_write(&ssrmod.dump_4ch, ssrmod.surround_raw_buffer, peroid_bytes);
+    ssr_dump_write(&ssrmod.dump_6ch, buffer, bytes);
 
     return ret;
 }
@@ -0,0 +1,418 @@
+/*
+ * Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "audio_hw_ssr_ola"
+/*#define LOG_NDEBUG 0*/
+
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <cutils/log.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SSR_OLA_NEON
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define SSR_OLA_SSE
+#endif
+
+#include "ssr_ola.h"
+
+#define N               SSR_OLA_FFT_SIZE
+#define HOP             SSR_OLA_BLOCK_FRAMES
+#define BINS            SSR_OLA_NUM_BINS
+#define NUM_IN          SSR_OLA_NUM_INPUTS
+#define NUM_OUT         SSR_OLA_NUM_OUTPUTS
+#define LFE_OUT         (NUM_OUT - 1)
+/* Pad the per bin arrays so the vector loops never need a scalar tail */
+#define BINS_ALIGNED    ((BINS + 3) & ~3)
+#define Q15_SCALE       (1.0f / 32768.0f)
+
+struct ssr_ola {
+    int sub_woofer;
+    int low_freq;
+    int high_freq;
+    int chan_map[NUM_OUT];
+
+    /* filter responses, [input][output][bin] */
+    float h_re[NUM_IN][NUM_OUT][BINS_ALIGNED];
+    float h_im[NUM_IN][NUM_OUT][BINS_ALIGNED];
+
+    /* input and output spectra of the current block */
+    float x_re[NUM_IN][BINS_ALIGNED];
+    float x_im[NUM_IN][BINS_ALIGNED];
+    float y_re[NUM_OUT][BINS_ALIGNED];
+    float y_im[NUM_OUT][BINS_ALIGNED];
+
+    /* complex FFT work buffers; two real channels are packed per FFT */
+    float z_re[N];
+    float z_im[N];
+    /* twiddles of the stage with half length h at [h, 2h), so each
+       stage reads them contiguously */
+    float tw_re[N];
+    float tw_im[N];
+    uint16_t bitrev[N];
+
+    /* second half of the previous block's output, per output channel */
+    float tail[NUM_OUT][HOP];
+    float out[NUM_OUT][HOP];
+};
+
+static void fft_init(struct ssr_ola *ola)
+{
+    int i, j, half, bits = 0;
+
+    while ((1 << bits) < N)
+        bits++;
+
+    for (half = 1; half < N; half <<= 1) {
+        for (i = 0; i < half; i++) {
+            ola->tw_re[half + i] = (float)cos(M_PI * i / half);
+            ola->tw_im[half + i] = (float)-sin(M_PI * i / half);
+        }
+    }
+    for (i = 0; i < N; i++) {
+        int r = 0;
+        for (j = 0; j < bits; j++)
+            r |= ((i >> j) & 1) << (bits - 1 - j);
+        ola->bitrev[i] = (uint16_t)r;
+    }
+}
+
+/*
+ * In place FFT of z_re/z_im. The inverse is unscaled.
+ *
+ * The first two radix-2 stages have trivial twiddles and run as one
+ * scalar radix-4 pass. Every later stage has at least four butterflies
+ * per group sharing contiguous twiddles, so they run four at a time.
+ */
+static void fft(struct ssr_ola *ola, bool inverse)
+{
+    float *re = ola->z_re, *im = ola->z_im;
+    float sign = inverse ? -1.0f : 1.0f;
+    int i, j, k, half;
+
+    for (i = 0; i < N; i++) {
+        j = ola->bitrev[i];
+        if (j > i) {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    /* len 2 and 4; the odd len 4 twiddle is -j, or +j for the inverse */
+    for (i = 0; i < N; i += 4) {
+        float a0r = re[i] + re[i + 1], a0i = im[i] + im[i + 1];
+        float a1r = re[i] - re[i + 1], a1i = im[i] - im[i + 1];
+        float a2r = re[i + 2] + re[i + 3], a2i = im[i + 2] + im[i + 3];
+        float a3r = re[i + 2] - re[i + 3], a3i = im[i + 2] - im[i + 3];
+        float tr = sign * a3i, ti = -sign * a3r;
+
+        re[i] = a0r + a2r;
+        im[i] = a0i + a2i;
+        re[i + 2] = a0r - a2r;
+        im[i + 2] = a0i - a2i;
+        re[i + 1] = a1r + tr;
+        im[i + 1] = a1i + ti;
+        re[i + 3] = a1r - tr;
+        im[i + 3] = a1i - ti;
+    }
+
+    for (half = 4; half < N; half <<= 1) {
+        const float *twr = ola->tw_re + half, *twi = ola->tw_im + half;
+
+        for (i = 0; i < N; i += 2 * half) {
+            float *ar = re + i, *ai = im + i;
+            float *br = ar + half, *bi = ai + half;
+
+            for (k = 0; k < half; k += 4) {
+#if defined(SSR_OLA_NEON)
+                float32x4_t vwr = vld1q_f32(twr + k);
+                float32x4_t vwi = vmulq_n_f32(vld1q_f32(twi + k), sign);
+                float32x4_t vbr = vld1q_f32(br + k), vbi = vld1q_f32(bi + k);
+                float32x4_t var = vld1q_f32(ar + k), vai = vld1q_f32(ai + k);
+                float32x4_t tr = vmlsq_f32(vmulq_f32(vbr, vwr), vbi, vwi);
+                float32x4_t ti = vmlaq_f32(vmulq_f32(vbr, vwi), vbi, vwr);
+                vst1q_f32(br + k, vsubq_f32(var, tr));
+                vst1q_f32(bi + k, vsubq_f32(vai, ti));
+                vst1q_f32(ar + k, vaddq_f32(var, tr));
+                vst1q_f32(ai + k, vaddq_f32(vai, ti));
+#elif defined(SSR_OLA_SSE)
+                __m128 vwr = _mm_loadu_ps(twr + k);
+                __m128 vwi = _mm_mul_ps(_mm_loadu_ps(twi + k), _mm_set1_ps(sign));
+                __m128 vbr = _mm_loadu_ps(br + k), vbi = _mm_loadu_ps(bi + k);
+                __m128 var = _mm_loadu_ps(ar + k), vai = _mm_loadu_ps(ai + k);
+                __m128 tr = _mm_sub_ps(_mm_mul_ps(vbr, vwr), _mm_mul_ps(vbi, vwi));
+                __m128 ti = _mm_add_ps(_mm_mul_ps(vbr, vwi), _mm_mul_ps(vbi, vwr));
+                _mm_storeu_ps(br + k, _mm_sub_ps(var, tr));
+                _mm_storeu_ps(bi + k, _mm_sub_ps(vai, ti));
+                _mm_storeu_ps(ar + k, _mm_add_ps(var, tr));
+                _mm_storeu_ps(ai + k, _mm_add_ps(vai, ti));
+#else
+                int l;
+                for (l = k; l < k + 4; l++) {
+                    float wr = twr[l], wi = sign * twi[l];
+                    float tr = br[l] * wr - bi[l] * wi;
+                    float ti = br[l] * wi + bi[l] * wr;
+                    br[l] = ar[l] - tr;
+                    bi[l] = ai[l] - ti;
+                    ar[l] += tr;
+                    ai[l] += ti;
+                }
+#endif
+            }
+        }
+    }
+}
+
+/* Forward transform of input channels a and b of one interleaved block */
+static void analyze_pair(struct ssr_ola *ola, const Word16 *in, int a, int b)
+{
+    int n, k;
+
+    for (n = 0; n < HOP; n++) {
+        ola->z_re[n] = in[n * NUM_IN + a] * Q15_SCALE;
+        ola->z_im[n] = in[n * NUM_IN + b] * Q15_SCALE;
+    }
+    memset(&ola->z_re[HOP], 0, sizeof(float) * (N - HOP));
+    memset(&ola->z_im[HOP], 0, sizeof(float) * (N - HOP));
+
+    fft(ola, false);
+
+    /* split Z = A + jB using the conjugate symmetry of real signals */
+    for (k = 0; k < BINS; k++) {
+        int nk = (N - k) & (N - 1);
+        float zr = ola->z_re[k], zi = ola->z_im[k];
+        float cr = ola->z_re[nk], ci = -ola->z_im[nk];
+
+        ola->x_re[a][k] = 0.5f * (zr + cr);
+        ola->x_im[a][k] = 0.5f * (zi + ci);
+        ola->x_re[b][k] = 0.5f * (zi - ci);
+        ola->x_im[b][k] = -0.5f * (zr - cr);
+    }
+}
+
+/* Inverse transform of output channels a and b, with overlap-add */
+static void synthesize_pair(struct ssr_ola *ola, float *out_a, float *out_b,
+                            int a, int b)
+{
+    const float scale = 1.0f / N;
+    int n, k;
+
+    for (k = 0; k < BINS; k++) {
+        ola->z_re[k] = ola->y_re[a][k] - ola->y_im[b][k];
+        ola->z_im[k] = ola->y_im[a][k] + ola->y_re[b][k];
+    }
+    for (k = 1; k < N - BINS + 1; k++) {
+        /* conj(Ya[k]) + j conj(Yb[k]) */
+        ola->z_re[N - k] = ola->y_re[a][k] + ola->y_im[b][k];
+        ola->z_im[N - k] = -ola->y_im[a][k] + ola->y_re[b][k];
+    }
+
+    fft(ola, true);
+
+    for (n = 0; n < HOP; n++) {
+        out_a[n] = ola->z_re[n] * scale + ola->tail[a][n];
+        out_b[n] = ola->z_im[n] * scale + ola->tail[b][n];
+        ola->tail[a][n] = ola->z_re[n + HOP] * scale;
+        ola->tail[b][n] = ola->z_im[n + HOP] * scale;
+    }
+}
+
+/* y[out] = sum over inputs of x[in] * h[in][out], four bins at a time */
+static void apply_filters(struct ssr_ola *ola)
+{
+    int i, j, k;
+
+    for (j = 0; j < NUM_OUT; j++) {
+        float *yr = ola->y_re[j], *yi = ola->y_im[j];
+
+        memset(yr, 0, sizeof(ola->y_re[j]));
+        memset(yi, 0, sizeof(ola->y_im[j]));
+        for (i = 0; i < NUM_IN; i++) {
+            const float *xr = ola->x_re[i], *xi = ola->x_im[i];
+            const float *hr = ola->h_re[i][j], *hi = ola->h_im[i][j];
+
+            for (k = 0; k < BINS_ALIGNED; k += 4) {
+#if defined(SSR_OLA_NEON)
+                float32x4_t vxr = vld1q_f32(xr + k), vxi = vld1q_f32(xi + k);
+                float32x4_t vhr = vld1q_f32(hr + k), vhi = vld1q_f32(hi + k);
+                float32x4_t vyr = vld1q_f32(yr + k), vyi = vld1q_f32(yi + k);
+                vyr = vmlaq_f32(vyr, vxr, vhr);
+                vyr = vmlsq_f32(vyr, vxi, vhi);
+                vyi = vmlaq_f32(vyi, vxr, vhi);
+                vyi = vmlaq_f32(vyi, vxi, vhr);
+                vst1q_f32(yr + k, vyr);
+                vst1q_f32(yi + k, vyi);
+#elif defined(SSR_OLA_SSE)
+                __m128 vxr = _mm_loadu_ps(xr + k), vxi = _mm_loadu_ps(xi + k);
+                __m128 vhr = _mm_loadu_ps(hr + k), vhi = _mm_loadu_ps(hi + k);
+                __m128 vyr = _mm_loadu_ps(yr + k), vyi = _mm_loadu_ps(yi + k);
+                vyr = _mm_add_ps(vyr, _mm_sub_ps(_mm_mul_ps(vxr, vhr),
+                                                 _mm_mul_ps(vxi, vhi)));
+                vyi = _mm_add_ps(vyi, _mm_add_ps(_mm_mul_ps(vxr, vhi),
+                                                 _mm_mul_ps(vxi, vhr)));
+                _mm_storeu_ps(yr + k, vyr);
+                _mm_storeu_ps(yi + k, vyi);
+#else
+                int l;
+                for (l = k; l < k + 4; l++) {
+                    yr[l] += xr[l] * hr[l] - xi[l] * hi[l];
+                    yi[l] += xr[l] * hi[l] + xi[l] * hr[l];
+                }
+#endif
+            }
+        }
+    }
+}
+
+static inline Word16 clamp16(float v)
+{
+    int s = (int)lrintf(v * 32768.0f);
+
+    if (s > 32767)
+        return 32767;
+    if (s < -32768)
+        return -32768;
+    return (Word16)s;
+}
+
+int ssr_ola_init(void *obj, int num_out_chan, int num_in_chan,
+                 Word16 **real_coeffs, Word16 **imag_coeffs,
+                 int sub_woofer, int low_freq, int high_freq,
+                 Profiler *profiler __unused)
+{
+    struct ssr_ola *ola = (struct ssr_ola *)obj;
+    int i, j, k;
+
+    if (num_out_chan != NUM_OUT || num_in_chan != NUM_IN) {
+        ALOGE("%s: unsupported %d to %d channel config", __func__,
+              num_in_chan, num_out_chan);
+        return -EINVAL;
+    }
+    if (sub_woofer < 0 || sub_woofer >= NUM_IN)
+        return -EINVAL;
+
+    /* size query, mirroring libsurround_proc */
+    if (ola == NULL)
+        return sizeof(struct ssr_ola);
+
+    if (!real_coeffs || !imag_coeffs)
+        return -EINVAL;
+
+    memset(ola, 0, sizeof(*ola));
+    ola->sub_woofer = sub_woofer;
+    ola->low_freq = low_freq < 0 ? 0 : (low_freq > BINS ? BINS : low_freq);
+    ola->high_freq = high_freq < 1 ? 1 : (high_freq > BINS ? BINS : high_freq);
+    for (j = 0; j < NUM_OUT; j++)
+        ola->chan_map[j] = j;
+
+    /*
+     * Above high_freq the spatial filters are held at their high_freq - 1
+     * response. The LFE output only carries the sub woofer microphone
+     * below low_freq.
+     */
+    for (i = 0; i < NUM_IN; i++) {
+        if (!real_coeffs[i] || !imag_coeffs[i])
+            return -EINVAL;
+        for (j = 0; j < LFE_OUT; j++) {
+            const Word16 *re = real_coeffs[i] + j * BINS;
+            const Word16 *im = imag_coeffs[i] + j * BINS;
+            for (k = 0; k < BINS; k++) {
+                int src = k < ola->high_freq ? k : ola->high_freq - 1;
+                ola->h_re[i][j][k] = re[src] * Q15_SCALE;
+                ola->h_im[i][j][k] = im[src] * Q15_SCALE;
+            }
+        }
+    }
+    for (k = 0; k < ola->low_freq; k++)
+        ola->h_re[sub_woofer][LFE_OUT][k] = 1.0f;
+
+    fft_init(ola);
+    return 0;
+}
+
+void ssr_ola_release(void *obj)
+{
+    struct ssr_ola *ola = (struct ssr_ola *)obj;
+
+    /* all state lives in the caller allocated object */
+    if (ola)
+        memset(ola->tail, 0, sizeof(ola->tail));
+}
+
+int ssr_ola_set_channel_map(void *obj, const int *chan_map)
+{
+    struct ssr_ola *ola = (struct ssr_ola *)obj;
+    unsigned int seen = 0;
+    int j;
+
+    if (!ola || !chan_map)
+        return -EINVAL;
+
+    for (j = 0; j < NUM_OUT; j++) {
+        if (chan_map[j] < 0 || chan_map[j] >= NUM_OUT ||
+            (seen & (1u << chan_map[j]))) {
+            ALOGE("%s: invalid channel map", __func__);
+            return -EINVAL;
+        }
+        seen |= 1u << chan_map[j];
+    }
+    memcpy(ola->chan_map, chan_map, sizeof(ola->chan_map));
+    return 0;
+}
+
+void ssr_ola_intl_process(void *obj, Word16 *out_pcm, Word16 *in_pcm)
+{
+    struct ssr_ola *ola = (struct ssr_ola *)obj;
+    int j, n;
+
+    analyze_pair(ola, in_pcm, 0, 1);
+    analyze_pair(ola, in_pcm, 2, 3);
+
+    apply_filters(ola);
+
+    /* outputs are real, so DC and Nyquist must be too */
+    for (j = 0; j < NUM_OUT; j++) {
+        ola->y_im[j][0] = 0.0f;
+        ola->y_im[j][BINS - 1] = 0.0f;
+    }
+
+    for (j = 0; j < NUM_OUT; j += 2)
+        synthesize_pair(ola, ola->out[j], ola->out[j + 1], j, j + 1);
+
+    for (j = 0; j < NUM_OUT; j++) {
+        Word16 *dst = out_pcm + ola->chan_map[j];
+        for (n = 0; n < HOP; n++)
+            dst[n * NUM_OUT] = clamp16(ola->out[j][n]);
+    }
+}
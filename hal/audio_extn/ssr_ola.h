@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SSR_OLA_H
+#define SSR_OLA_H
+
+#include "surround_filters_interface.h"
+
+/*
+ * In-tree FFT overlap-add 4ch to 6ch surround engine. It implements the
+ * surround_filters_* entry points of libsurround_proc.so and is used by
+ * ssr.c when that library is not available on the target.
+ *
+ * Each call to ssr_ola_intl_process() consumes SSR_OLA_BLOCK_FRAMES
+ * interleaved 4ch frames and produces the same number of interleaved
+ * 6ch frames. Coefficients are Q15 frequency responses laid out as
+ * [input][output * SSR_OLA_NUM_BINS + bin], the layout of the
+ * filter*.pcm files.
+ */
+#define SSR_OLA_BLOCK_FRAMES        512
+#define SSR_OLA_FFT_SIZE            (2 * SSR_OLA_BLOCK_FRAMES)
+#define SSR_OLA_NUM_BINS            (SSR_OLA_FFT_SIZE / 2 + 1)
+#define SSR_OLA_NUM_INPUTS          4
+#define SSR_OLA_NUM_OUTPUTS         6
+
+int  ssr_ola_init(void *obj, int num_out_chan, int num_in_chan,
+                  Word16 **real_coeffs, Word16 **imag_coeffs,
+                  int sub_woofer, int low_freq, int high_freq,
+                  Profiler *profiler);
+void ssr_ola_release(void *obj);
+int  ssr_ola_set_channel_map(void *obj, const int *chan_map);
+void ssr_ola_intl_process(void *obj, Word16 *out_pcm, Word16 *in_pcm);
+
+#endif /* SSR_OLA_H */
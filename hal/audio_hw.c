@@ -48,6 +48,7 @@
 #include <audio_effects/effect_ns.h>
 #include "audio_hw.h"
 #include "platform_api.h"
+#include "audio_config.h"
 #include <platform.h>
 #include "audio_extn.h"
 #include "voice_extn.h"
@@ -62,6 +63,15 @@
 
 #define PROXY_OPEN_RETRY_COUNT           100
 #define PROXY_OPEN_WAIT_TIME             20
+/* Pause before failing a read or write while the sound card restarts */
+#define SND_CARD_OFFLINE_BACKOFF_MS      5
+
+#define AUDIO_PARAMETER_KEY_SND_CARD_STATUS "SND_CARD_STATUS"
+#define AUDIO_PARAMETER_KEY_SND_CARD_RECOVERY_STATS "snd_card_recovery_stats"
+#define AUDIO_PARAMETER_KEY_BACKLOG_READ "backlog_read"
+#define AUDIO_PARAMETER_KEY_AVAIL_FRAMES "avail_frames"
+#define AUDIO_PARAMETER_KEY_CAPTURE_POSITION "capture_position"
+#define AUDIO_PARAMETER_KEY_RENDER_LATENCY "render_latency"
 
 #define USECASE_AUDIO_PLAYBACK_PRIMARY USECASE_AUDIO_PLAYBACK_DEEP_BUFFER
 
@@ -204,15 +214,15 @@ static int set_voice_volume_l(struct audio_device *adev, float volume);
 static int check_and_set_gapless_mode(struct audio_device *adev) {
 
 
-    char value[PROPERTY_VALUE_MAX] = {0};
-    bool gapless_enabled = false;
+    struct audio_config_snapshot config;
+    bool gapless_enabled;
     const char *mixer_ctl_name = "Compress Gapless Playback";
     struct mixer_ctl *ctl;
 
     ALOGV("%s:", __func__);
-    property_get("audio.offload.gapless.enabled", value, NULL);
-    gapless_enabled = atoi(value) || !strncmp("true", value, 4);
 
+    audio_config_get(&config);
+    gapless_enabled = config.offload_gapless;
     ctl = mixer_get_ctl_by_name(adev->mixer, mixer_ctl_name);
     if (!ctl) {
         ALOGE("%s: Could not get ctl for mixer cmd - %s",
@@ -430,6 +440,26 @@ int disable_snd_device(struct audio_device *adev,
     return 0;
 }
 
+/*
+ * Called with adev->lock held whenever the route of a playback usecase
+ * changes. Usecases that only borrow a stream, like FM on the primary
+ * output, must not overwrite the latency of the stream's own usecase.
+ */
+static void out_update_device_latency_l(struct audio_device *adev,
+                                        struct audio_usecase *usecase)
+{
+    int64_t latency;
+
+    if (usecase->type != PCM_PLAYBACK || usecase->stream.out == NULL ||
+        usecase->stream.out->usecase != usecase->id)
+        return;
+
+    latency = platform_snd_device_render_latency(adev->platform,
+                                                 usecase->out_snd_device);
+    android_atomic_release_store((int32_t)latency,
+                                 &usecase->stream.out->device_latency_us);
+}
+
 static void check_usecases_codec_backend(struct audio_device *adev,
                                           struct audio_usecase *uc_info,
                                           snd_device_t snd_device)
@@ -459,7 +489,8 @@ static void check_usecases_codec_backend(struct audio_device *adev,
         if (usecase->type != PCM_CAPTURE &&
                 usecase != uc_info &&
                 usecase->out_snd_device != snd_device &&
-                usecase->devices & AUDIO_DEVICE_OUT_ALL_CODEC_BACKEND) {
+                usecase->devices & AUDIO_DEVICE_OUT_ALL_CODEC_BACKEND &&
+                !voice_defer_usecase_reroute(adev, usecase)) {
             ALOGV("%s: Usecase (%s) is active on (%s) - disabling ..",
                   __func__, use_case_table[usecase->id],
                   platform_get_snd_device_name(usecase->out_snd_device));
@@ -495,6 +526,7 @@ static void check_usecases_codec_backend(struct audio_device *adev,
             /* Update the out_snd_device only before enabling the audio route */
             if (switch_device[usecase->id] ) {
                 usecase->out_snd_device = snd_device;
+                out_update_device_latency_l(adev, usecase);
                 enable_audio_route(adev, usecase);
             }
         }
@@ -527,7 +559,8 @@ static void check_and_route_capture_usecases(struct audio_device *adev,
         usecase = node_to_item(node, struct audio_usecase, list);
         if (usecase->type != PCM_PLAYBACK &&
                 usecase != uc_info &&
-                usecase->in_snd_device != snd_device) {
+                usecase->in_snd_device != snd_device &&
+                !voice_defer_usecase_reroute(adev, usecase)) {
             ALOGV("%s: Usecase (%s) is active on (%s) - disabling ..",
                   __func__, use_case_table[usecase->id],
                   platform_get_snd_device_name(usecase->in_snd_device));
@@ -626,6 +659,46 @@ struct audio_usecase *get_usecase_from_list(struct audio_device *adev,
     return NULL;
 }
 
+/*
+ * Delay in Us from the end of the HAL buffer to the output device: the DSP
+ * buffering and post processing of the usecase plus the backend of the
+ * current route (HDMI, BT, USB proxy, speaker protection), either estimated
+ * or calibrated at runtime through render_latency_cal.
+ */
+static int64_t out_render_latency(struct stream_out *out)
+{
+    int64_t latency = android_atomic_acquire_load(&out->device_latency_us);
+
+    if (!is_offload_usecase(out->usecase))
+        latency += platform_render_latency(out->usecase);
+    return latency;
+}
+
+/*
+ * Delay in Us of the data buffered below the HAL: the ALSA buffer for PCM,
+ * the compress buffer held by the DSP for offload.
+ */
+static int64_t out_buffer_latency(struct stream_out *out)
+{
+    if (is_offload_usecase(out->usecase)) {
+        if ((out->format == AUDIO_FORMAT_PCM_16_BIT_OFFLOAD) &&
+            (!out->non_blocking) &&
+            (out->sample_rate) &&
+            (out->compr_config.codec->ch_in) &&
+            (audio_bytes_per_sample(AUDIO_FORMAT_PCM_16_BIT_OFFLOAD)))
+            /* ToDo: Add check for 24 bit offload */
+            return (out->compr_config.fragments *
+                   out->compr_config.fragment_size * 1000000LL) /
+                   (out->sample_rate * out->compr_config.codec->ch_in *
+                   audio_bytes_per_sample(AUDIO_FORMAT_PCM_16_BIT_OFFLOAD));
+        else
+            return COMPRESS_OFFLOAD_PLAYBACK_LATENCY * 1000LL;
+    }
+
+    return (out->config.period_count * out->config.period_size * 1000000LL) /
+           (out->config.rate);
+}
+
 int select_devices(struct audio_device *adev, audio_usecase_t uc_id)
 {
     snd_device_t out_snd_device = SND_DEVICE_NONE;
@@ -646,9 +719,18 @@ int select_devices(struct audio_device *adev, audio_usecase_t uc_id)
     if ((usecase->type == VOICE_CALL) ||
         (usecase->type == VOIP_CALL)  ||
         (usecase->type == PCM_HFP_CALL)) {
-        out_snd_device = platform_get_output_snd_device(adev->platform,
-                                                        usecase->stream.out->devices);
-        in_snd_device = platform_get_input_snd_device(adev->platform, usecase->stream.out->devices);
+        int planned_out, planned_in;
+
+        if (usecase->type == VOICE_CALL &&
+            voice_get_planned_snd_devices(adev, usecase, &planned_out, &planned_in)) {
+            out_snd_device = planned_out;
+            in_snd_device = planned_in;
+        } else {
+            out_snd_device = platform_get_output_snd_device(adev->platform,
+                                                            usecase->stream.out->devices);
+            in_snd_device = platform_get_input_snd_device(adev->platform,
+                                                          usecase->stream.out->devices);
+        }
         usecase->devices = usecase->stream.out->devices;
     } else {
         /*
@@ -771,6 +853,7 @@ int select_devices(struct audio_device *adev, audio_usecase_t uc_id)
 
     usecase->in_snd_device = in_snd_device;
     usecase->out_snd_device = out_snd_device;
+    out_update_device_latency_l(adev, usecase);
 
     enable_audio_route(adev, usecase);
 
@@ -785,6 +868,123 @@ int select_devices(struct audio_device *adev, audio_usecase_t uc_id)
     return status;
 }
 
+static int64_t get_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static bool snd_card_offline(struct audio_device *adev)
+{
+    return android_atomic_acquire_load(&adev->recovery.state) ==
+               SND_CARD_STATE_OFFLINE;
+}
+
+/*
+ * The codec and the DSP come back from a restart with their defaults, while
+ * audio_route still holds the values of the active paths and only writes
+ * differences. Reset it to the defaults, then apply and write the paths of
+ * the active sound devices and usecases again, with their calibration.
+ */
+static void snd_card_reapply_routes_l(struct audio_device *adev)
+{
+    char mixer_path[MIXER_PATH_MAX_LENGTH];
+    char device_name[DEVICE_NAME_MAX_SIZE];
+    struct audio_usecase *usecase;
+    struct listnode *node;
+    int snd_device;
+
+    audio_route_reset(adev->audio_route);
+    audio_route_update_mixer(adev->audio_route);
+
+    for (snd_device = SND_DEVICE_MIN; snd_device < SND_DEVICE_MAX; snd_device++) {
+        if (adev->snd_dev_ref_cnt[snd_device] <= 0)
+            continue;
+        if ((snd_device == SND_DEVICE_OUT_SPEAKER ||
+            snd_device == SND_DEVICE_OUT_VOICE_SPEAKER) &&
+            audio_extn_spkr_prot_is_enabled())
+            continue;
+        if (platform_get_snd_device_name_extn(adev->platform, snd_device,
+                                              device_name) < 0)
+            continue;
+        platform_send_audio_calibration(adev->platform, snd_device);
+        audio_route_apply_path(adev->audio_route, device_name);
+    }
+
+    list_for_each(node, &adev->usecase_list) {
+        usecase = node_to_item(node, struct audio_usecase, list);
+        strcpy(mixer_path, use_case_table[usecase->id]);
+        platform_add_backend_name(mixer_path, usecase->type == PCM_CAPTURE ?
+                                  usecase->in_snd_device : usecase->out_snd_device);
+        audio_route_apply_path(adev->audio_route, mixer_path);
+    }
+    audio_route_update_mixer(adev->audio_route);
+}
+
+/*
+ * Sound card restart coordination, called with adev->lock held.
+ *
+ * OFFLINE marks the streams of the active usecases; their read and write
+ * calls then close the handles and fail without touching the card until
+ * it is back. ONLINE restores the routing and calibration of the usecases
+ * still active, and each marked stream reopens its PCM or compress handle
+ * on its next read or write, so streams come back in parallel on their
+ * own threads instead of one after the other.
+ */
+static void snd_card_set_state_l(struct audio_device *adev, int state)
+{
+    struct snd_card_recovery *rec = &adev->recovery;
+    struct audio_usecase *usecase;
+    struct listnode *node;
+
+    if (rec->state == state)
+        return;
+
+    if (state == SND_CARD_STATE_OFFLINE) {
+        rec->offline_ns = get_now_ns();
+        rec->outages++;
+        rec->marked = 0;
+        rec->reopened = 0;
+        list_for_each(node, &adev->usecase_list) {
+            usecase = node_to_item(node, struct audio_usecase, list);
+            if (usecase->type == PCM_PLAYBACK && usecase->stream.out) {
+                android_atomic_release_store(1, &usecase->stream.out->ssr_pending);
+                rec->marked++;
+            } else if (usecase->type == PCM_CAPTURE && usecase->stream.in) {
+                android_atomic_release_store(1, &usecase->stream.in->ssr_pending);
+                rec->marked++;
+            }
+        }
+        android_atomic_release_store(state, &rec->state);
+        ALOGW("%s: sound card %d offline, %u active streams",
+              __func__, adev->snd_card, rec->marked);
+    } else {
+        rec->online_ns = get_now_ns();
+        snd_card_reapply_routes_l(adev);
+        android_atomic_release_store(state, &rec->state);
+        ALOGW("%s: sound card %d online after %lld ms", __func__, adev->snd_card,
+              (long long)((rec->online_ns - rec->offline_ns) / 1000000));
+    }
+}
+
+/* A marked stream has reopened its handles, called with adev->lock held */
+static void snd_card_stream_reopened_l(struct audio_device *adev)
+{
+    struct snd_card_recovery *rec = &adev->recovery;
+    int64_t now = get_now_ns();
+
+    rec->reopened++;
+    rec->last_ns = now - rec->offline_ns;
+    if (rec->last_ns > rec->max_ns)
+        rec->max_ns = rec->last_ns;
+    ALOGD("%s: stream %u/%u back %lld ms after online, outage %lld ms",
+          __func__, rec->reopened, rec->marked,
+          (long long)((now - rec->online_ns) / 1000000),
+          (long long)(rec->last_ns / 1000000));
+}
+
 static int stop_input_stream(struct stream_in *in)
 {
     int i, ret = 0;
@@ -864,7 +1064,8 @@ int start_input_stream(struct stream_in *in)
     if (in->usecase == USECASE_AUDIO_RECORD_AFE_PROXY) {
         flags |= PCM_MMAP | PCM_NOIRQ;
         pcm_open_retry_count = PROXY_OPEN_RETRY_COUNT;
-    }
+    } else
+        flags |= PCM_MONOTONIC;
 
     while (1) {
         in->pcm = pcm_open(adev->snd_card, in->pcm_device_id,
@@ -938,11 +1139,10 @@ static audio_usecase_t get_offload_usecase(struct audio_device *adev)
 {
     audio_usecase_t ret = USECASE_AUDIO_PLAYBACK_OFFLOAD;
     unsigned int i, num_usecase = 1;
-    char value[PROPERTY_VALUE_MAX] = {0};
+    struct audio_config_snapshot config;
 
-    property_get("audio.offload.passthrough", value, NULL);
-
-    if ((atoi(value) || !strncmp("true", value, 4)))
+    audio_config_get(&config);
+    if (config.offload_passthrough)
         num_usecase = sizeof(offload_usecases)/sizeof(offload_usecases[0]);
 
     ALOGV("%s: num_usecase: %d", __func__, num_usecase);
@@ -1232,9 +1432,9 @@ int start_output_stream(struct stream_out *out)
 {
     int ret = 0;
     int sink_channels = 0;
-    char prop_value[PROPERTY_VALUE_MAX] = {0};
     struct audio_usecase *uc_info;
     struct audio_device *adev = out->dev;
+    struct audio_config_snapshot config;
 
     ALOGV("%s: enter: usecase(%d: %s) devices(%#x)",
           __func__, out->usecase, use_case_table[out->usecase], out->devices);
@@ -1260,8 +1460,8 @@ int start_output_stream(struct stream_out *out)
                 audio_extn_dolby_update_passt_stream_configuration(adev, out);
             }
         }
-        property_get("audio.use.hdmi.sink.cap", prop_value, NULL);
-        if (!strncmp("true", prop_value, 4)) {
+        audio_config_get(&config);
+        if (config.use_hdmi_sink_cap) {
             sink_channels = platform_edid_get_max_channels(out->dev->platform);
             ALOGD("%s: set HDMI channel count[%d] based on sink capability",
                    __func__, sink_channels);
@@ -1451,22 +1651,11 @@ static int out_set_format(struct audio_stream *stream __unused,
     return -ENOSYS;
 }
 
-static int out_standby(struct audio_stream *stream)
+/* must be called with out->lock locked */
+static void out_standby_l(struct stream_out *out)
 {
-    struct stream_out *out = (struct stream_out *)stream;
     struct audio_device *adev = out->dev;
 
-    ALOGV("%s: enter: usecase(%d: %s)", __func__,
-          out->usecase, use_case_table[out->usecase]);
-    if (out->usecase == USECASE_COMPRESS_VOIP_CALL) {
-        /* Ignore standby in case of voip call because the voip output
-         * stream is closed in adev_close_output_stream()
-         */
-        ALOGV("%s: Ignore Standby in VOIP call", __func__);
-        return 0;
-    }
-
-    pthread_mutex_lock(&out->lock);
     if (!out->standby) {
         pthread_mutex_lock(&adev->lock);
         out->standby = true;
@@ -1487,6 +1676,24 @@ static int out_standby(struct audio_stream *stream)
         stop_output_stream(out);
         pthread_mutex_unlock(&adev->lock);
     }
+}
+
+static int out_standby(struct audio_stream *stream)
+{
+    struct stream_out *out = (struct stream_out *)stream;
+
+    ALOGV("%s: enter: usecase(%d: %s)", __func__,
+          out->usecase, use_case_table[out->usecase]);
+    if (out->usecase == USECASE_COMPRESS_VOIP_CALL) {
+        /* Ignore standby in case of voip call because the voip output
+         * stream is closed in adev_close_output_stream()
+         */
+        ALOGV("%s: Ignore Standby in VOIP call", __func__);
+        return 0;
+    }
+
+    pthread_mutex_lock(&out->lock);
+    out_standby_l(out);
     pthread_mutex_unlock(&out->lock);
     ALOGV("%s: exit", __func__);
     return 0;
@@ -1614,6 +1821,8 @@ static int out_set_parameters(struct audio_stream *stream, const char *kvpairs)
 
             if (!out->standby)
                 select_devices(adev, out->usecase);
+            if (out == adev->primary_output)
+                voice_update_call_plan(adev);
 
             if ((adev->mode == AUDIO_MODE_IN_CALL) &&
                     output_drives_call(adev, out)) {
@@ -1710,6 +1919,20 @@ static char* out_get_parameters(const struct audio_stream *stream, const char *k
         str_parms_add_str(reply, AUDIO_PARAMETER_STREAM_SUP_FORMATS, value);
         str = str_parms_to_str(reply);
     }
+
+    /* buffer, DSP and device delay in Us, as the presentation position sees them */
+    ret = str_parms_get_str(query, AUDIO_PARAMETER_KEY_RENDER_LATENCY, value, sizeof(value));
+    if (ret >= 0) {
+        int64_t device_us = android_atomic_acquire_load(&out->device_latency_us);
+        int64_t total_us = out_buffer_latency(out) + out_render_latency(out);
+
+        snprintf(value, sizeof(value), "dsp_us %lld device_us %lld total_us %lld",
+                 (long long)(total_us - device_us), (long long)device_us,
+                 (long long)total_us);
+        str_parms_add_str(reply, AUDIO_PARAMETER_KEY_RENDER_LATENCY, value);
+        free(str);
+        str = str_parms_to_str(reply);
+    }
     str_parms_destroy(query);
     str_parms_destroy(reply);
     ALOGV("%s: exit: returns - %s", __func__, str);
@@ -1720,23 +1943,11 @@ static uint32_t out_get_latency(const struct audio_stream_out *stream)
 {
     struct stream_out *out = (struct stream_out *)stream;
 
-    if (is_offload_usecase(out->usecase)) {
-        if ((out->format == AUDIO_FORMAT_PCM_16_BIT_OFFLOAD) &&
-            (!out->non_blocking) &&
-            (out->sample_rate) &&
-            (out->compr_config.codec->ch_in) &&
-            (audio_bytes_per_sample(AUDIO_FORMAT_PCM_16_BIT_OFFLOAD)))
-            /* ToDo: Add check for 24 bit offload */
-            return (out->compr_config.fragments *
-                   out->compr_config.fragment_size * 1000) /
-                   (out->sample_rate * out->compr_config.codec->ch_in *
-                   audio_bytes_per_sample(AUDIO_FORMAT_PCM_16_BIT_OFFLOAD));
-        else
-            return COMPRESS_OFFLOAD_PLAYBACK_LATENCY;
-    }
-
-    return (out->config.period_count * out->config.period_size * 1000) /
-           (out->config.rate);
+    /*
+     * Only the buffering below the HAL, as AudioFlinger expects. The DSP and
+     * device delay are applied to the presentation position instead.
+     */
+    return (uint32_t)(out_buffer_latency(out) / 1000);
 }
 
 static int out_set_volume(struct audio_stream_out *stream, float left,
@@ -1758,23 +1969,14 @@ static int out_set_volume(struct audio_stream_out *stream, float left,
              */
             audio_extn_dolby_set_passt_volume(out, (left == 0.0f));
         } else {
-            char mixer_ctl_name[128];
-            struct audio_device *adev = out->dev;
-            struct mixer_ctl *ctl;
-            int pcm_device_id = platform_get_pcm_device_id(out->usecase,
-                                                       PCM_PLAYBACK);
-
-            snprintf(mixer_ctl_name, sizeof(mixer_ctl_name),
-                     "Compress Playback %d Volume", pcm_device_id);
-            ctl = mixer_get_ctl_by_name(adev->mixer, mixer_ctl_name);
-            if (!ctl) {
-                ALOGE("%s: Could not get ctl for mixer cmd - %s",
-                      __func__, mixer_ctl_name);
-                return -EINVAL;
-            }
             volume[0] = (int)(left * COMPRESS_PLAYBACK_VOLUME_MAX);
             volume[1] = (int)(right * COMPRESS_PLAYBACK_VOLUME_MAX);
-            mixer_ctl_set_array(ctl, volume, sizeof(volume)/sizeof(volume[0]));
+            if (mixer_volume_set(&out->volume, volume,
+                                 sizeof(volume)/sizeof(volume[0])) < 0) {
+                ALOGE("%s: no volume control for usecase %d",
+                      __func__, out->usecase);
+                return -EINVAL;
+            }
             return 0;
         }
     }
@@ -1788,8 +1990,21 @@ static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
     struct stream_out *out = (struct stream_out *)stream;
     struct audio_device *adev = out->dev;
     ssize_t ret = 0;
+    bool reopen;
 
     pthread_mutex_lock(&out->lock);
+    if (snd_card_offline(adev)) {
+        /* The DSP is restarting: do not wait on or reopen the device */
+        ret = -ENETRESET;
+        goto exit;
+    }
+
+    reopen = android_atomic_acquire_load(&out->ssr_pending);
+    if (reopen) {
+        /* The handles are from before the restart */
+        out_standby_l(out);
+    }
+
     if (out->standby) {
         out->standby = false;
         pthread_mutex_lock(&adev->lock);
@@ -1797,12 +2012,18 @@ static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
             ret = voice_extn_compress_voip_start_output_stream(out);
         else
             ret = start_output_stream(out);
+        if (ret == 0 && reopen) {
+            android_atomic_release_store(0, &out->ssr_pending);
+            snd_card_stream_reopened_l(adev);
+        }
         pthread_mutex_unlock(&adev->lock);
         /* ToDo: If use case is compress offload should return 0 */
         if (ret != 0) {
             out->standby = true;
             goto exit;
         }
+        if (reopen && is_offload_usecase(out->usecase))
+            mixer_volume_restore(&out->volume);
     }
 
     if (is_offload_usecase(out->usecase)) {
@@ -1832,18 +2053,32 @@ static ssize_t out_write(struct audio_stream_out *stream, const void *buffer,
             ALOGVV("%s: writing buffer (%d bytes) to pcm device", __func__, bytes);
             if (out->usecase == USECASE_AUDIO_PLAYBACK_AFE_PROXY)
                 ret = pcm_mmap_write(out->pcm, (void *)buffer, bytes);
+            else if (voice_extn_compress_voip_ring_active(out->usecase, PCM_PLAYBACK))
+                ret = voice_extn_compress_voip_ring_write(buffer, bytes);
             else
                 ret = pcm_write(out->pcm, (void *)buffer, bytes);
             if (ret < 0)
                 ret = -errno;
-            else if (ret == 0)
+            else if (ret == 0) {
                 out->written += bytes / (out->config.channels * sizeof(short));
+                audio_extn_pcm_tap_out(out, buffer, bytes);
+            }
         }
     }
 
 exit:
     pthread_mutex_unlock(&out->lock);
 
+    if (ret == -ENETRESET) {
+        /*
+         * Drop the handles from before the restart and fail without the
+         * buffer duration sleep, which would hold the caller for up to a
+         * deep buffer period per write until the card is back.
+         */
+        out_standby(&out->stream.common);
+        usleep(SND_CARD_OFFLINE_BACKOFF_MS * 1000);
+        return ret;
+    }
     if (ret != 0) {
         if (out->pcm)
             ALOGE("%s: error %d - %s", __func__, ret, pcm_get_error(out->pcm));
@@ -1906,7 +2141,11 @@ static int out_get_presentation_position(const struct audio_stream_out *stream,
                     &out->sample_rate);
             ALOGVV("%s rendered frames %ld sample_rate %d",
                    __func__, dsp_frames, out->sample_rate);
-            *frames = dsp_frames;
+            /* the DSP counts rendered frames, the backend adds its own delay */
+            int64_t device_frames = out_render_latency(out) *
+                                    out->sample_rate / 1000000LL;
+            *frames = (int64_t)dsp_frames > device_frames ?
+                      dsp_frames - device_frames : 0;
             ret = 0;
             /* this is the best we can do */
             clock_gettime(CLOCK_MONOTONIC, timestamp);
@@ -1918,9 +2157,10 @@ static int out_get_presentation_position(const struct audio_stream_out *stream,
                 size_t kernel_buffer_size = out->config.period_size * out->config.period_count;
                 int64_t signed_frames = out->written - kernel_buffer_size + avail;
                 // This adjustment accounts for buffering after app processor.
-                // It is based on estimated DSP latency per use case, rather than exact.
+                // It is based on estimated DSP latency per use case and output
+                // backend delay of the route, unless calibrated at runtime.
                 signed_frames -=
-                    (platform_render_latency(out->usecase) * out->sample_rate / 1000000LL);
+                    (out_render_latency(out) * out->sample_rate / 1000000LL);
 
                 // It would be unusual for this value to be negative, but check just in case ...
                 if (signed_frames >= 0) {
@@ -2061,22 +2301,12 @@ static int in_set_format(struct audio_stream *stream __unused,
     return -ENOSYS;
 }
 
-static int in_standby(struct audio_stream *stream)
+/* must be called with in->lock locked */
+static int in_standby_l(struct stream_in *in)
 {
-    struct stream_in *in = (struct stream_in *)stream;
     struct audio_device *adev = in->dev;
     int status = 0;
-    ALOGV("%s: enter", __func__);
-
-    if (in->usecase == USECASE_COMPRESS_VOIP_CALL) {
-        /* Ignore standby in case of voip call because the voip input
-         * stream is closed in adev_close_input_stream()
-         */
-        ALOGV("%s: Ignore Standby in VOIP call", __func__);
-        return status;
-    }
 
-    pthread_mutex_lock(&in->lock);
     if (!in->standby && in->is_st_session) {
         ALOGD("%s: sound trigger pcm stop lab", __func__);
         audio_extn_sound_trigger_stop_lab(in);
@@ -2086,6 +2316,7 @@ static int in_standby(struct audio_stream *stream)
     if (!in->standby) {
         pthread_mutex_lock(&adev->lock);
         in->standby = true;
+        in->last_read_ns = 0;
         if (in->pcm) {
             pcm_close(in->pcm);
             in->pcm = NULL;
@@ -2093,6 +2324,25 @@ static int in_standby(struct audio_stream *stream)
         status = stop_input_stream(in);
         pthread_mutex_unlock(&adev->lock);
     }
+    return status;
+}
+
+static int in_standby(struct audio_stream *stream)
+{
+    struct stream_in *in = (struct stream_in *)stream;
+    int status = 0;
+    ALOGV("%s: enter", __func__);
+
+    if (in->usecase == USECASE_COMPRESS_VOIP_CALL) {
+        /* Ignore standby in case of voip call because the voip input
+         * stream is closed in adev_close_input_stream()
+         */
+        ALOGV("%s: Ignore Standby in VOIP call", __func__);
+        return status;
+    }
+
+    pthread_mutex_lock(&in->lock);
+    status = in_standby_l(in);
     pthread_mutex_unlock(&in->lock);
     ALOGV("%s: exit:  status(%d)", __func__, status);
     return status;
@@ -2104,6 +2354,77 @@ static int in_dump(const struct audio_stream *stream __unused,
     return 0;
 }
 
+/* true for the capture paths that read the pcm or the LAB ring as is */
+static bool in_is_plain_read(struct stream_in *in)
+{
+    if (in->st_lab)
+        return true;
+    return !(audio_extn_ssr_get_enabled() &&
+             audio_channel_count_from_in_mask(in->channel_mask) == 6) &&
+           !audio_extn_compr_cap_usecase_supported(in->usecase) &&
+           in->usecase != USECASE_AUDIO_RECORD_AFE_PROXY &&
+           !voice_extn_compress_voip_ring_active(in->usecase, PCM_CAPTURE);
+}
+
+/* Frames a read can return without blocking, must be called with in->lock locked */
+static unsigned int in_get_avail_frames_l(struct stream_in *in)
+{
+    struct timespec ts;
+    unsigned int avail;
+
+    if (in->st_lab)
+        return audio_extn_sound_trigger_avail(in) /
+                   audio_stream_in_frame_size(&in->stream);
+    if (!in->pcm || !in_is_plain_read(in) ||
+        pcm_get_htimestamp(in->pcm, &avail, &ts) < 0)
+        return 0;
+    return avail;
+}
+
+/*
+ * Capture counterpart of out_get_presentation_position(): frames is the
+ * number of frames captured so far, read or still buffered, and time is
+ * when the last of them reached the microphone, CLOCK_MONOTONIC in ns.
+ * Must be called with in->lock locked.
+ */
+static int in_get_capture_position_l(struct stream_in *in,
+                                     int64_t *frames, int64_t *time)
+{
+    struct timespec timestamp;
+    unsigned int avail;
+
+    if (in->standby || !in->pcm || in->st_lab || !in_is_plain_read(in))
+        return -ENOSYS;
+    if (pcm_get_htimestamp(in->pcm, &avail, &timestamp) < 0)
+        return -ENODATA;
+
+    *frames = in->frames_read + avail;
+    *time = timestamp.tv_sec * 1000000000LL + timestamp.tv_nsec -
+                platform_capture_latency(in->usecase) * 1000LL;
+    return 0;
+}
+
+/*
+ * Once the capture buffer is full, or the driver has stopped it on an
+ * overrun, the frames that keep arriving are dropped. Count what arrived
+ * since the previous read beyond what the buffer could hold.
+ */
+static void in_update_frames_lost_l(struct stream_in *in, int64_t now)
+{
+    unsigned int avail, buffer_frames;
+    struct timespec ts;
+    int64_t elapsed;
+
+    if (!in->last_read_ns)
+        return;
+    buffer_frames = in->config.period_size * in->config.period_count;
+    if (pcm_get_htimestamp(in->pcm, &avail, &ts) == 0 && avail < buffer_frames)
+        return;
+    elapsed = (now - in->last_read_ns) * in->config.rate / 1000000000LL;
+    if (elapsed > buffer_frames)
+        android_atomic_add((int32_t)(elapsed - buffer_frames), &in->frames_lost);
+}
+
 static int in_set_parameters(struct audio_stream *stream, const char *kvpairs)
 {
     struct stream_in *in = (struct stream_in *)stream;
@@ -2150,6 +2471,10 @@ static int in_set_parameters(struct audio_stream *stream, const char *kvpairs)
         }
     }
 
+    err = str_parms_get_str(parms, AUDIO_PARAMETER_KEY_BACKLOG_READ, value, sizeof(value));
+    if (err >= 0)
+        in->backlog_read = !strcmp(value, "true");
+
 done:
     pthread_mutex_unlock(&adev->lock);
     pthread_mutex_unlock(&in->lock);
@@ -2177,6 +2502,29 @@ static char* in_get_parameters(const struct audio_stream *stream,
 
     voice_extn_in_get_parameters(in, query, reply);
 
+    if (str_parms_get_str(query, AUDIO_PARAMETER_KEY_AVAIL_FRAMES,
+                          value, sizeof(value)) >= 0) {
+        pthread_mutex_lock(&in->lock);
+        str_parms_add_int(reply, AUDIO_PARAMETER_KEY_AVAIL_FRAMES,
+                          in->standby ? 0 : (int)in_get_avail_frames_l(in));
+        pthread_mutex_unlock(&in->lock);
+    }
+
+    if (str_parms_get_str(query, AUDIO_PARAMETER_KEY_CAPTURE_POSITION,
+                          value, sizeof(value)) >= 0) {
+        int64_t frames, time;
+        int ret;
+
+        pthread_mutex_lock(&in->lock);
+        ret = in_get_capture_position_l(in, &frames, &time);
+        pthread_mutex_unlock(&in->lock);
+        if (ret == 0) {
+            snprintf(value, sizeof(value), "frames %lld time_ns %lld",
+                     (long long)frames, (long long)time);
+            str_parms_add_str(reply, AUDIO_PARAMETER_KEY_CAPTURE_POSITION, value);
+        }
+    }
+
     str = str_parms_to_str(reply);
     str_parms_destroy(query);
     str_parms_destroy(reply);
@@ -2197,8 +2545,21 @@ static ssize_t in_read(struct audio_stream_in *stream, void *buffer,
     struct stream_in *in = (struct stream_in *)stream;
     struct audio_device *adev = in->dev;
     int i, ret = -1;
+    bool reopen;
 
     pthread_mutex_lock(&in->lock);
+    if (snd_card_offline(adev)) {
+        /* The DSP is restarting: do not wait on or reopen the device */
+        ret = -ENETRESET;
+        goto exit;
+    }
+
+    reopen = android_atomic_acquire_load(&in->ssr_pending);
+    if (reopen) {
+        /* The handle is from before the restart */
+        in_standby_l(in);
+    }
+
     if (in->standby) {
         if (!in->is_st_session) {
             pthread_mutex_lock(&adev->lock);
@@ -2206,24 +2567,63 @@ static ssize_t in_read(struct audio_stream_in *stream, void *buffer,
                 ret = voice_extn_compress_voip_start_input_stream(in);
             else
                 ret = start_input_stream(in);
+            if (ret == 0 && reopen) {
+                android_atomic_release_store(0, &in->ssr_pending);
+                snd_card_stream_reopened_l(adev);
+            }
             pthread_mutex_unlock(&adev->lock);
             if (ret != 0) {
                 goto exit;
             }
+        } else {
+            audio_extn_sound_trigger_start_lab(in);
         }
         in->standby = 0;
     }
 
-    if (in->pcm) {
+    /*
+     * Backlog reads return what is buffered, possibly nothing, instead of
+     * blocking. The first pcm read still blocks as it starts the capture.
+     */
+    if (in->backlog_read && in_is_plain_read(in) &&
+        (in->st_lab || in->last_read_ns)) {
+        size_t avail = in_get_avail_frames_l(in) *
+                           audio_stream_in_frame_size(stream);
+
+        if (avail < bytes)
+            bytes = avail;
+        if (!bytes) {
+            ret = 0;
+            goto exit;
+        }
+    }
+
+    if (in->st_lab) {
+        ret = audio_extn_sound_trigger_read(in, buffer, bytes);
+    } else if (in->pcm) {
         if (audio_extn_ssr_get_enabled() &&
             audio_channel_count_from_in_mask(in->channel_mask) == 6)
             ret = audio_extn_ssr_read(stream, buffer, bytes);
-        else if (audio_extn_compr_cap_usecase_supported(in->usecase))
-            ret = audio_extn_compr_cap_read(in, buffer, bytes);
-        else if (in->usecase == USECASE_AUDIO_RECORD_AFE_PROXY)
+        else if (audio_extn_compr_cap_usecase_supported(in->usecase)) {
+            /* frames are variable size, only report what was filled */
+            ssize_t filled = audio_extn_compr_cap_read(in, buffer, bytes);
+
+            if (filled >= 0) {
+                bytes = filled;
+                ret = 0;
+            } else {
+                ret = filled;
+            }
+        } else if (in->usecase == USECASE_AUDIO_RECORD_AFE_PROXY)
             ret = pcm_mmap_read(in->pcm, buffer, bytes);
-        else
+        else if (voice_extn_compress_voip_ring_active(in->usecase, PCM_CAPTURE))
+            ret = voice_extn_compress_voip_ring_read(buffer, bytes);
+        else {
+            in_update_frames_lost_l(in, get_now_ns());
             ret = pcm_read(in->pcm, buffer, bytes);
+            if (ret == 0)
+                in->last_read_ns = get_now_ns();
+        }
     }
 
     /*
@@ -2233,11 +2633,23 @@ static ssize_t in_read(struct audio_stream_in *stream, void *buffer,
     if (ret == 0 && voice_get_mic_mute(adev) && !adev->voice.in_call)
         memset(buffer, 0, bytes);
 
+    if (ret == 0) {
+        in->frames_read += bytes / audio_stream_in_frame_size(stream);
+        audio_extn_pcm_tap_in(in, buffer, bytes);
+    }
+
 exit:
     pthread_mutex_unlock(&in->lock);
 
+    if (ret == -ENETRESET) {
+        in_standby(&in->stream.common);
+        memset(buffer, 0, bytes);
+        usleep(SND_CARD_OFFLINE_BACKOFF_MS * 1000);
+        return ret;
+    }
     if (ret != 0) {
         in_standby(&in->stream.common);
+        memset(buffer, 0, bytes);
         ALOGV("%s: read failed status %d- sleeping for buffer duration", __func__, ret);
         usleep(bytes * 1000000 / audio_stream_in_frame_size(stream) /
                in_get_sample_rate(&in->stream.common));
@@ -2245,9 +2657,12 @@ exit:
     return bytes;
 }
 
-static uint32_t in_get_input_frames_lost(struct audio_stream_in *stream __unused)
+/* No stream lock: in_read() holds it across a blocking pcm_read() */
+static uint32_t in_get_input_frames_lost(struct audio_stream_in *stream)
 {
-    return 0;
+    struct stream_in *in = (struct stream_in *)stream;
+
+    return (uint32_t)android_atomic_swap(0, &in->frames_lost);
 }
 
 static int add_remove_audio_effect(const struct audio_stream *stream,
@@ -2457,6 +2872,15 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
         out->offload_state = OFFLOAD_STATE_IDLE;
         out->playback_started = 0;
 
+        if (!audio_extn_dolby_is_passthrough_stream(out->flags)) {
+            char mixer_ctl_name[128];
+
+            snprintf(mixer_ctl_name, sizeof(mixer_ctl_name),
+                     "Compress Playback %d Volume",
+                     platform_get_pcm_device_id(out->usecase, PCM_PLAYBACK));
+            mixer_volume_init(&out->volume, adev->mixer, mixer_ctl_name);
+        }
+
         create_offload_callback_thread(out);
         ALOGV("%s: offloaded output offload_info version %04x bit rate %d",
                 __func__, config->offload_info.version,
@@ -2586,6 +3010,7 @@ static void adev_close_output_stream(struct audio_hw_device *dev __unused,
 
     if (is_offload_usecase(out->usecase)) {
         destroy_offload_callback_thread(out);
+        mixer_volume_release(&out->volume);
         free_offload_usecase(adev, out->usecase);
         if (out->compr_config.codec != NULL)
             free(out->compr_config.codec);
@@ -2623,6 +3048,18 @@ static int adev_set_parameters(struct audio_hw_device *dev, const char *kvpairs)
     if (status != 0)
         goto done;
 
+    ret = str_parms_get_str(parms, AUDIO_PARAMETER_KEY_RENDER_LATENCY_CAL,
+                            value, sizeof(value));
+    if (ret >= 0) {
+        struct listnode *node;
+        struct audio_usecase *usecase;
+
+        list_for_each(node, &adev->usecase_list) {
+            usecase = node_to_item(node, struct audio_usecase, list);
+            out_update_device_latency_l(adev, usecase);
+        }
+    }
+
     ret = str_parms_get_str(parms, AUDIO_PARAMETER_KEY_BT_NREC, value, sizeof(value));
     if (ret >= 0) {
         /* When set to false, HAL should disable EC and NS
@@ -2634,6 +3071,25 @@ static int adev_set_parameters(struct audio_hw_device *dev, const char *kvpairs)
             adev->bluetooth_nrec = false;
     }
 
+    ret = str_parms_get_str(parms, AUDIO_PARAMETER_KEY_CONFIG_RELOAD,
+                            value, sizeof(value));
+    if (ret >= 0)
+        audio_config_reload();
+
+    /* "<card>,ONLINE" or "<card>,OFFLINE" from audiod */
+    ret = str_parms_get_str(parms, AUDIO_PARAMETER_KEY_SND_CARD_STATUS,
+                            value, sizeof(value));
+    if (ret >= 0) {
+        char *state = strchr(value, ',');
+
+        if (state && atoi(value) == adev->snd_card) {
+            if (!strcmp(state + 1, "OFFLINE"))
+                snd_card_set_state_l(adev, SND_CARD_STATE_OFFLINE);
+            else if (!strcmp(state + 1, "ONLINE"))
+                snd_card_set_state_l(adev, SND_CARD_STATE_ONLINE);
+        }
+    }
+
     ret = str_parms_get_str(parms, "screen_state", value, sizeof(value));
     if (ret >= 0) {
         if (strcmp(value, AUDIO_PARAMETER_VALUE_ON) == 0)
@@ -2710,9 +3166,25 @@ static char* adev_get_parameters(const struct audio_hw_device *dev,
     struct str_parms *reply = str_parms_create();
     struct str_parms *query = str_parms_create_str(keys);
     char *str;
+    char value[32];
 
     pthread_mutex_lock(&adev->lock);
 
+    if (str_parms_get_str(query, AUDIO_PARAMETER_KEY_SND_CARD_RECOVERY_STATS,
+                          value, sizeof(value)) >= 0) {
+        struct snd_card_recovery *rec = &adev->recovery;
+        char stats[160];
+
+        snprintf(stats, sizeof(stats), "state %s outages %u streams %u "
+                 "reopened %u last_outage_ms %lld max_outage_ms %lld",
+                 rec->state == SND_CARD_STATE_OFFLINE ? "offline" : "online",
+                 rec->outages, rec->marked, rec->reopened,
+                 (long long)(rec->last_ns / 1000000),
+                 (long long)(rec->max_ns / 1000000));
+        str_parms_add_str(reply, AUDIO_PARAMETER_KEY_SND_CARD_RECOVERY_STATS,
+                          stats);
+    }
+
     audio_extn_get_parameters(adev, query, reply);
     voice_get_parameters(adev, query, reply);
     platform_get_parameters(adev->platform, query, reply);
@@ -2778,6 +3250,7 @@ static int adev_set_mode(struct audio_hw_device *dev, audio_mode_t mode)
              voice_stop_call(adev);
              adev->current_call_output = NULL;
         }
+        voice_update_call_plan(adev);
     }
     pthread_mutex_unlock(&adev->lock);
     return 0;
@@ -2982,6 +3455,8 @@ static int adev_close(hw_device_t *device)
     if ((--audio_device_ref_count) == 0) {
         audio_extn_sound_trigger_deinit(adev);
         audio_extn_listen_deinit(adev);
+        audio_extn_pcm_tap_deinit();
+        mixer_volume_deinit();
         audio_route_free(adev->audio_route);
         free(adev->snd_dev_ref_cnt);
         platform_deinit(adev->platform);
@@ -3050,6 +3525,7 @@ static int adev_open(const hw_module_t *module, const char *name,
     list_init(&adev->usecase_list);
 
     adev->offload_usecases_state = 0;
+    audio_config_reload();
     /* Loads platform specific libraries dynamically */
     adev->platform = platform_init(adev);
     if (!adev->platform) {
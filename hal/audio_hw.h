@@ -27,6 +27,7 @@
 
 #include <audio_route/audio_route.h>
 #include "audio_defs.h"
+#include "mixer_volume.h"
 #include "voice.h"
 
 #define VISUALIZER_LIBRARY_PATH "/system/lib/soundfx/libqcomvisualizer.so"
@@ -177,6 +178,9 @@ struct stream_out {
     void *offload_cookie;
     struct compr_gapless_mdata gapless_mdata;
     int send_new_metadata;
+    struct mixer_volume volume; /* offload volume control */
+    int32_t ssr_pending; /* started before a sound card restart */
+    int32_t device_latency_us; /* output backend delay of the current route */
 
     struct audio_device *dev;
 };
@@ -197,6 +201,12 @@ struct stream_in {
     audio_format_t format;
     audio_io_handle_t capture_handle;
     bool is_st_session;
+    struct sound_trigger_lab *st_lab; /* LAB ring, see soundtrigger.c */
+    bool backlog_read; /* in_read() returns what is buffered without blocking */
+    volatile int32_t frames_lost; /* since the last get_input_frames_lost(), atomic */
+    uint64_t frames_read; /* total frames read, not cleared when entering standby */
+    int64_t last_read_ns; /* end of the last pcm read, 0 before the first */
+    int32_t ssr_pending; /* started before a sound card restart */
 
     struct audio_device *dev;
 };
@@ -224,6 +234,27 @@ struct audio_usecase {
     union stream_ptr stream;
 };
 
+enum {
+    SND_CARD_STATE_ONLINE,
+    SND_CARD_STATE_OFFLINE,
+};
+
+/*
+ * Sound card restart (DSP SSR) bookkeeping. The state is read without
+ * adev->lock by the stream read/write paths, everything else is protected
+ * by adev->lock.
+ */
+struct snd_card_recovery {
+    int32_t state;
+    int64_t offline_ns;
+    int64_t online_ns;
+    unsigned int outages;
+    unsigned int marked;        /* streams active when the card went offline */
+    unsigned int reopened;      /* streams reopened since the card came back */
+    int64_t last_ns;            /* offline to the latest stream reopen */
+    int64_t max_ns;
+};
+
 struct audio_device {
     struct audio_hw_device device;
     pthread_mutex_t lock; /* see note below on mutex acquisition order */
@@ -246,6 +277,7 @@ struct audio_device {
     bool bt_wb_speech_enabled;
 
     int snd_card;
+    struct snd_card_recovery recovery;
     void *platform;
     unsigned int offload_usecases_state;
     void *visualizer_lib;
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EDID_SAD_H
+#define EDID_SAD_H
+
+#include <stddef.h>
+
+/*
+ * Table driven decoder for CEA-861 short audio descriptors (SAD) and
+ * speaker allocation data blocks. Used by both the primary HAL (edid.c)
+ * and the legacy ALSA HAL (AudioUtil.cpp), so it must stay plain C that
+ * also compiles as C++ and must not depend on either HAL's headers.
+ */
+
+#define EDID_SAD_LENGTH                 3
+#define EDID_SAD_FORMAT_LPCM            1
+#define EDID_SAD_MAX_FORMAT_ID          15
+#define EDID_SAD_RATE_BITS              7
+#define EDID_SAD_BPS_BITS               3
+#define EDID_SAD_SPKR_ALLOC_BITS        11
+
+struct edid_sad {
+    int format_id;
+    int channels;
+    int sampling_freq;
+    int bits_per_sample;
+};
+
+/* Audio format code (SAD byte 0, bits 6:3) */
+static const char * const edid_sad_format_names[EDID_SAD_MAX_FORMAT_ID + 1] = {
+    "Reserved",
+    "LPCM",
+    "AC-3",
+    "MPEG1 (Layers 1 & 2)",
+    "MP3 (MPEG1 Layer 3)",
+    "MPEG2 (multichannel)",
+    "AAC",
+    "DTS",
+    "ATRAC",
+    "One-bit audio aka SACD",
+    "Dolby Digital +",
+    "DTS-HD",
+    "MAT (MLP)",
+    "DST",
+    "WMA Pro",
+    "Extended",
+};
+
+/* Sample rate per bit of SAD byte 1; the highest supported rate wins */
+static const int edid_sad_sample_rates[EDID_SAD_RATE_BITS] = {
+    32000, 44100, 48000, 88200, 96000, 176000, 192000,
+};
+
+/* LPCM sample size per bit of SAD byte 2; the largest supported size wins */
+static const int edid_sad_lpcm_bps[EDID_SAD_BPS_BITS] = {
+    16, 20, 24,
+};
+
+/* Speaker names per bit of (allocation[1] << 8 | allocation[0]) */
+static const char * const edid_sad_spkr_alloc_names[EDID_SAD_SPKR_ALLOC_BITS] = {
+    "FL/FR", "LFE", "FC", "RL/RR", "RC", "FLC/FRC", "RLC/RRC", "FLW/FRW",
+    "FLH/FRH", "TC", "FCH",
+};
+
+/*
+ * Speaker allocation (allocation[1] << 8 | allocation[0]) for each CEA-861
+ * channel allocation (CA) code, indexed by the CA code.
+ */
+static const unsigned short edid_sad_ca_spkr_alloc[] = {
+    0x0001, 0x0003, 0x0005, 0x0007, 0x0011, 0x0013, 0x0015, 0x0017,
+    0x0009, 0x000B, 0x000D, 0x000F, 0x0019, 0x001B, 0x001D, 0x001F,
+    0x0049, 0x004B, 0x004D, 0x004F, 0x0021, 0x0023, 0x0025, 0x0027,
+    0x0031, 0x0033, 0x0035, 0x0037, 0x0029, 0x002B, 0x002D, 0x002F,
+    0x040D, 0x040F, 0x020D, 0x020F, 0x0109, 0x010B, 0x0089, 0x008B,
+    0x021D, 0x021F, 0x041D, 0x041F, 0x060D, 0x060F, 0x010D, 0x010F,
+    0x008D, 0x008F,
+};
+
+#define EDID_SAD_CA_COUNT \
+    ((int)(sizeof(edid_sad_ca_spkr_alloc) / sizeof(edid_sad_ca_spkr_alloc[0])))
+
+static inline int edid_sad_highest_bit(unsigned int mask)
+{
+    return 31 - __builtin_clz(mask);
+}
+
+static inline const char *edid_sad_format_name(int format_id)
+{
+    if (format_id < 0 || format_id > EDID_SAD_MAX_FORMAT_ID)
+        return "Invalid";
+    return edid_sad_format_names[format_id];
+}
+
+static inline int edid_sad_sampling_freq(unsigned char byte)
+{
+    unsigned int mask = byte & ((1u << EDID_SAD_RATE_BITS) - 1);
+
+    return mask ? edid_sad_sample_rates[edid_sad_highest_bit(mask)] : 0;
+}
+
+static inline int edid_sad_bits_per_sample(unsigned char byte, int format_id)
+{
+    unsigned int mask = byte & ((1u << EDID_SAD_BPS_BITS) - 1);
+
+    if (format_id != EDID_SAD_FORMAT_LPCM || !mask)
+        return 0;
+    return edid_sad_lpcm_bps[edid_sad_highest_bit(mask)];
+}
+
+static inline void edid_sad_decode(const unsigned char *sad,
+                                   struct edid_sad *out)
+{
+    out->channels = (sad[0] & 0x7) + 1;
+    out->format_id = (sad[0] >> 3) & 0xF;
+    out->sampling_freq = edid_sad_sampling_freq(sad[1]);
+    out->bits_per_sample = edid_sad_bits_per_sample(sad[2], out->format_id);
+}
+
+/* Returns the CA code for a speaker allocation, or 0 (FL/FR) if undefined */
+static inline int edid_sad_channel_allocation(const unsigned char *spkr_alloc)
+{
+    unsigned short alloc = (unsigned short)((spkr_alloc[1] << 8) | spkr_alloc[0]);
+    int ca;
+
+    for (ca = 0; ca < EDID_SAD_CA_COUNT; ca++) {
+        if (edid_sad_ca_spkr_alloc[ca] == alloc)
+            return ca;
+    }
+    return 0;
+}
+
+/*
+ * Parses an audio data block as the HDMI driver reports it: a length byte,
+ * then that many bytes of SADs with the speaker allocation as the last
+ * EDID_SAD_LENGTH bytes. Bytes short of a whole descriptor at the end are
+ * ignored. The first max_sads SADs are decoded into sads.
+ *
+ * Returns the number of SADs in the block, which may exceed max_sads, or
+ * -1 if the block is shorter than its length byte or has no speaker
+ * allocation.
+ */
+static inline int edid_sad_parse(const unsigned char *blob, size_t size,
+                                 struct edid_sad *sads, int max_sads,
+                                 unsigned char *spkr_alloc)
+{
+    int count, i;
+
+    if (size < 1 || (size_t)blob[0] > size - 1)
+        return -1;
+    count = blob[0] / EDID_SAD_LENGTH - 1;
+    if (count < 0)
+        return -1;
+
+    blob++;
+    for (i = 0; i < count && i < max_sads; i++)
+        edid_sad_decode(blob + i * EDID_SAD_LENGTH, &sads[i]);
+    blob += count * EDID_SAD_LENGTH;
+    for (i = 0; i < EDID_SAD_LENGTH; i++)
+        spkr_alloc[i] = blob[i];
+    return count;
+}
+
+#endif /* EDID_SAD_H */
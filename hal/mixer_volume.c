@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "mixer_volume"
+/*#define LOG_NDEBUG 0*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <cutils/log.h>
+#include <cutils/sched_policy.h>
+#include <system/thread_defs.h>
+
+#include "mixer_volume.h"
+
+#define MIXER_VOLUME_COALESCE_NS    ((int64_t)MIXER_VOLUME_COALESCE_MS * 1000000LL)
+
+/* Controls with a coalesced value waiting for their window to pass */
+struct mixer_volume_module {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    bool thread_started;
+    bool exit;
+    struct listnode pending_list;
+};
+
+static struct mixer_volume_module vmod = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .thread_started = false,
+    .exit = false,
+    .pending_list = { &vmod.pending_list, &vmod.pending_list },
+};
+
+static int64_t mixer_volume_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void mixer_volume_write_l(struct mixer_volume *vol, const int *values,
+                                 int64_t now)
+{
+    mixer_ctl_set_array(vol->ctl, values, vol->num_values);
+    memcpy(vol->values, values, vol->num_values * sizeof(int));
+    vol->written = true;
+    vol->last_write_ns = now;
+    vol->writes++;
+}
+
+static void *mixer_volume_thread_loop(void *context __unused)
+{
+    struct listnode *node, *tmp;
+    struct mixer_volume *vol;
+    struct timespec ts;
+    int64_t now, next;
+
+    setpriority(PRIO_PROCESS, 0, ANDROID_PRIORITY_AUDIO);
+    set_sched_policy(0, SP_FOREGROUND);
+    prctl(PR_SET_NAME, (unsigned long)"Mixer Volume", 0, 0, 0);
+
+    pthread_mutex_lock(&vmod.lock);
+    while (!vmod.exit) {
+        now = mixer_volume_now_ns();
+        next = 0;
+        list_for_each_safe(node, tmp, &vmod.pending_list) {
+            vol = node_to_item(node, struct mixer_volume, node);
+            if (vol->deadline_ns <= now) {
+                list_remove(node);
+                vol->is_pending = false;
+                mixer_volume_write_l(vol, vol->pending, now);
+            } else if (!next || vol->deadline_ns < next) {
+                next = vol->deadline_ns;
+            }
+        }
+
+        if (!next) {
+            pthread_cond_wait(&vmod.cond, &vmod.lock);
+            continue;
+        }
+        clock_gettime(CLOCK_REALTIME, &ts);
+        next = next - now + ts.tv_nsec;
+        ts.tv_sec += next / 1000000000LL;
+        ts.tv_nsec = next % 1000000000LL;
+        pthread_cond_timedwait(&vmod.cond, &vmod.lock, &ts);
+    }
+    pthread_mutex_unlock(&vmod.lock);
+
+    return NULL;
+}
+
+int mixer_volume_init(struct mixer_volume *vol, struct mixer *mixer,
+                      const char *ctl_name)
+{
+    struct mixer_ctl *ctl;
+
+    ctl = mixer_get_ctl_by_name(mixer, ctl_name);
+    if (!ctl) {
+        ALOGE("%s: Could not get ctl for mixer cmd - %s",
+              __func__, ctl_name);
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&vmod.lock);
+    if (vol->is_pending)
+        list_remove(&vol->node);
+    memset(vol, 0, sizeof(*vol));
+    vol->ctl = ctl;
+    pthread_mutex_unlock(&vmod.lock);
+
+    return 0;
+}
+
+void mixer_volume_release(struct mixer_volume *vol)
+{
+    pthread_mutex_lock(&vmod.lock);
+    if (vol->is_pending) {
+        list_remove(&vol->node);
+        vol->is_pending = false;
+    }
+    if (vol->ctl)
+        ALOGV("%s: %s: %u requests, %u writes", __func__,
+              mixer_ctl_get_name(vol->ctl), vol->requests, vol->writes);
+    vol->ctl = NULL;
+    vol->written = false;
+    pthread_mutex_unlock(&vmod.lock);
+}
+
+int mixer_volume_set(struct mixer_volume *vol, const int *values,
+                     unsigned int num_values)
+{
+    size_t size = num_values * sizeof(int);
+    int64_t now;
+    int ret = 0;
+
+    if (num_values == 0 || num_values > MIXER_VOLUME_MAX_VALUES)
+        return -EINVAL;
+
+    pthread_mutex_lock(&vmod.lock);
+    if (!vol->ctl) {
+        ret = -ENODEV;
+        goto exit;
+    }
+    vol->requests++;
+
+    if (vol->is_pending) {
+        if (!memcmp(values, vol->values, size)) {
+            /* The ramp came back to what is already set */
+            list_remove(&vol->node);
+            vol->is_pending = false;
+        } else {
+            memcpy(vol->pending, values, size);
+        }
+        goto exit;
+    }
+
+    if (vol->written && vol->num_values == num_values &&
+        !memcmp(values, vol->values, size))
+        goto exit;
+
+    vol->num_values = num_values;
+    now = mixer_volume_now_ns();
+    if (!vol->written || now - vol->last_write_ns >= MIXER_VOLUME_COALESCE_NS) {
+        mixer_volume_write_l(vol, values, now);
+        goto exit;
+    }
+
+    if (!vmod.thread_started) {
+        if (pthread_create(&vmod.thread, (const pthread_attr_t *) NULL,
+                           mixer_volume_thread_loop, NULL)) {
+            ALOGE("%s: thread create failed, not coalescing", __func__);
+            mixer_volume_write_l(vol, values, now);
+            goto exit;
+        }
+        vmod.thread_started = true;
+    }
+    memcpy(vol->pending, values, size);
+    vol->deadline_ns = vol->last_write_ns + MIXER_VOLUME_COALESCE_NS;
+    vol->is_pending = true;
+    list_add_tail(&vmod.pending_list, &vol->node);
+    pthread_cond_signal(&vmod.cond);
+
+exit:
+    pthread_mutex_unlock(&vmod.lock);
+    return ret;
+}
+
+void mixer_volume_restore(struct mixer_volume *vol)
+{
+    pthread_mutex_lock(&vmod.lock);
+    if (vol->is_pending) {
+        list_remove(&vol->node);
+        vol->is_pending = false;
+        mixer_volume_write_l(vol, vol->pending, mixer_volume_now_ns());
+    } else if (vol->ctl && vol->written) {
+        mixer_volume_write_l(vol, vol->values, mixer_volume_now_ns());
+    }
+    pthread_mutex_unlock(&vmod.lock);
+}
+
+void mixer_volume_deinit(void)
+{
+    struct listnode *node, *tmp;
+
+    pthread_mutex_lock(&vmod.lock);
+    if (!vmod.thread_started) {
+        pthread_mutex_unlock(&vmod.lock);
+        return;
+    }
+    vmod.exit = true;
+    pthread_cond_signal(&vmod.cond);
+    pthread_mutex_unlock(&vmod.lock);
+
+    pthread_join(vmod.thread, (void **) NULL);
+
+    pthread_mutex_lock(&vmod.lock);
+    list_for_each_safe(node, tmp, &vmod.pending_list) {
+        list_remove(node);
+        node_to_item(node, struct mixer_volume, node)->is_pending = false;
+    }
+    vmod.thread_started = false;
+    vmod.exit = false;
+    pthread_mutex_unlock(&vmod.lock);
+}
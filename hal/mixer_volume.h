@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MIXER_VOLUME_H
+#define MIXER_VOLUME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <cutils/list.h>
+#include <tinyalsa/asoundlib.h>
+
+/*
+ * Volume mixer control with a cached handle. The control is looked up
+ * once, values equal to the last ones written are dropped, and the steps
+ * of a volume ramp are coalesced: a change is written right away when the
+ * control has been idle for MIXER_VOLUME_COALESCE_MS, otherwise only the
+ * latest value is written once that window has passed.
+ */
+#define MIXER_VOLUME_MAX_VALUES         4
+#define MIXER_VOLUME_COALESCE_MS        20
+
+struct mixer_volume {
+    struct mixer_ctl *ctl;
+    unsigned int num_values;
+    int values[MIXER_VOLUME_MAX_VALUES];    /* last written */
+    int pending[MIXER_VOLUME_MAX_VALUES];
+    bool written;
+    bool is_pending;
+    int64_t last_write_ns;
+    int64_t deadline_ns;
+    struct listnode node;
+    uint32_t requests;
+    uint32_t writes;
+};
+
+int mixer_volume_init(struct mixer_volume *vol, struct mixer *mixer,
+                      const char *ctl_name);
+void mixer_volume_release(struct mixer_volume *vol);
+int mixer_volume_set(struct mixer_volume *vol, const int *values,
+                     unsigned int num_values);
+/* Writes the last values again, for a control whose DSP state was lost */
+void mixer_volume_restore(struct mixer_volume *vol);
+void mixer_volume_deinit(void);
+
+#endif /* MIXER_VOLUME_H */
@@ -201,6 +201,13 @@ static const int acdb_device_table[SND_DEVICE_MAX] = {
 
 #define DEEP_BUFFER_PLATFORM_DELAY (29*1000LL)
 #define LOW_LATENCY_PLATFORM_DELAY (13*1000LL)
+#define AUDIO_RECORD_PLATFORM_DELAY (12*1000LL)
+#define LOW_LATENCY_RECORD_PLATFORM_DELAY (6*1000LL)
+#define HDMI_RENDER_DELAY (15*1000LL)
+#define BT_SCO_RENDER_DELAY (20*1000LL)
+/* One USB proxy period plus half of the USB playback buffer, see usb.c */
+#define USB_PROXY_RENDER_DELAY (59*1000LL)
+#define SPKR_PROT_RENDER_DELAY (5*1000LL)
 
 static void set_echo_reference(struct audio_device *adev, bool enable)
 {
@@ -530,6 +537,13 @@ int platform_switch_voice_call_device_post(void *platform,
     return ret;
 }
 
+int platform_preload_voice_calibration(void *platform __unused,
+                                       snd_device_t out_snd_device __unused,
+                                       snd_device_t in_snd_device __unused)
+{
+    return -ENOSYS;
+}
+
 int platform_start_voice_call(void *platform, uint32_t vsid __unused)
 {
     struct platform_data *my_data = (struct platform_data *)platform;
@@ -619,11 +633,12 @@ int platform_set_device_mute(void *platform __unused, bool state __unused, char
     return -ENOSYS;
 }
 
-snd_device_t platform_get_output_snd_device(void *platform, audio_devices_t devices)
+snd_device_t platform_get_output_snd_device_for_mode(void *platform,
+                                                     audio_devices_t devices,
+                                                     audio_mode_t mode)
 {
     struct platform_data *my_data = (struct platform_data *)platform;
     struct audio_device *adev = my_data->adev;
-    audio_mode_t mode = adev->mode;
     snd_device_t snd_device = SND_DEVICE_NONE;
 
     ALOGV("%s: enter: output devices(%#x)", __func__, devices);
@@ -708,14 +723,23 @@ exit:
     return snd_device;
 }
 
-snd_device_t platform_get_input_snd_device(void *platform, audio_devices_t out_device)
+snd_device_t platform_get_output_snd_device(void *platform, audio_devices_t devices)
+{
+    struct platform_data *my_data = (struct platform_data *)platform;
+
+    return platform_get_output_snd_device_for_mode(platform, devices,
+                                                   my_data->adev->mode);
+}
+
+snd_device_t platform_get_input_snd_device_for_mode(void *platform,
+                                                    audio_devices_t out_device,
+                                                    audio_mode_t mode)
 {
     struct platform_data *my_data = (struct platform_data *)platform;
     struct audio_device *adev = my_data->adev;
     audio_source_t  source = (adev->active_input == NULL) ?
                                 AUDIO_SOURCE_DEFAULT : adev->active_input->source;
 
-    audio_mode_t    mode   = adev->mode;
     audio_devices_t in_device = ((adev->active_input == NULL) ?
                                     AUDIO_DEVICE_NONE : adev->active_input->device)
                                 & ~AUDIO_DEVICE_BIT_IN;
@@ -870,6 +894,14 @@ exit:
     return snd_device;
 }
 
+snd_device_t platform_get_input_snd_device(void *platform, audio_devices_t out_device)
+{
+    struct platform_data *my_data = (struct platform_data *)platform;
+
+    return platform_get_input_snd_device_for_mode(platform, out_device,
+                                                  my_data->adev->mode);
+}
+
 int platform_set_hdmi_channels(void *platform,  int channel_count)
 {
     struct platform_data *my_data = (struct platform_data *)platform;
@@ -1003,6 +1035,43 @@ int64_t platform_render_latency(audio_usecase_t usecase)
     }
 }
 
+/* Delay in Us, from the microphone to the capture buffer */
+int64_t platform_capture_latency(audio_usecase_t usecase)
+{
+    switch (usecase) {
+        case USECASE_AUDIO_RECORD:
+            return AUDIO_RECORD_PLATFORM_DELAY;
+        case USECASE_AUDIO_RECORD_LOW_LATENCY:
+            return LOW_LATENCY_RECORD_PLATFORM_DELAY;
+        default:
+            return 0;
+    }
+}
+
+/* Delay in Us added after the DSP by the output backend of a sound device */
+int64_t platform_snd_device_render_latency(void *platform __unused, snd_device_t snd_device)
+{
+    if (snd_device < SND_DEVICE_OUT_BEGIN || snd_device >= SND_DEVICE_OUT_END)
+        return 0;
+
+    switch (snd_device) {
+        case SND_DEVICE_OUT_HDMI:
+        case SND_DEVICE_OUT_SPEAKER_AND_HDMI:
+            return HDMI_RENDER_DELAY;
+        case SND_DEVICE_OUT_BT_SCO:
+        case SND_DEVICE_OUT_BT_SCO_WB:
+            return BT_SCO_RENDER_DELAY;
+        case SND_DEVICE_OUT_USB_HEADSET:
+        case SND_DEVICE_OUT_SPEAKER_AND_USB_HEADSET:
+            return USB_PROXY_RENDER_DELAY;
+        case SND_DEVICE_OUT_SPEAKER:
+        case SND_DEVICE_OUT_SPEAKER_REVERSE:
+            return audio_extn_spkr_prot_is_enabled() ? SPKR_PROT_RENDER_DELAY : 0;
+        default:
+            return 0;
+    }
+}
+
 int platform_update_usecase_from_source(int source, int usecase)
 {
     ALOGV("%s: input source :%d", __func__, source);
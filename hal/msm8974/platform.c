@@ -40,6 +40,8 @@
 #include "audio_extn.h"
 #include "voice_extn.h"
 #include "edid.h"
+#include "mixer_volume.h"
+#include "audio_config.h"
 #include "mdm_detect.h"
 #include "sound/compress_params.h"
 #include "sound/msmcal-hwdep.h"
@@ -154,6 +156,14 @@ struct platform_data {
     void *hw_info;
     struct csd_data *csd;
     void *edid_info;
+    /* Voice Rx Gain control and volume percent to volume index table */
+    struct mixer_volume voice_volume;
+    int voice_vol_index[101];
+    /* measured output backend delays in Us, -1 if not calibrated */
+    int64_t render_latency_cal[SND_DEVICE_OUT_END];
+    /* acdb ids of the voice calibration sent ahead of the call, 0 if none */
+    int preloaded_voice_cal_rx;
+    int preloaded_voice_cal_tx;
 };
 
 static int pcm_device_table[AUDIO_USECASE_MAX][2] = {
@@ -477,6 +487,13 @@ static struct name_to_index usecase_name_index[AUDIO_USECASE_MAX] = {
 
 #define DEEP_BUFFER_PLATFORM_DELAY (29*1000LL)
 #define LOW_LATENCY_PLATFORM_DELAY (13*1000LL)
+#define AUDIO_RECORD_PLATFORM_DELAY (12*1000LL)
+#define LOW_LATENCY_RECORD_PLATFORM_DELAY (6*1000LL)
+#define HDMI_RENDER_DELAY (15*1000LL)
+#define BT_SCO_RENDER_DELAY (20*1000LL)
+/* One USB proxy period plus half of the USB playback buffer, see usb.c */
+#define USB_PROXY_RENDER_DELAY (59*1000LL)
+#define SPKR_PROT_RENDER_DELAY (5*1000LL)
 
 static void set_echo_reference(struct audio_device *adev, bool enable)
 {
@@ -787,7 +804,7 @@ void *platform_init(struct audio_device *adev)
 {
     char value[PROPERTY_VALUE_MAX];
     struct platform_data *my_data = NULL;
-    int retry_num = 0, snd_card_num = 0;
+    int retry_num = 0, snd_card_num = 0, idx;
     const char *snd_card_name;
 
     my_data = calloc(1, sizeof(struct platform_data));
@@ -952,6 +969,12 @@ void *platform_init(struct audio_device *adev)
     audio_extn_spkr_prot_init(adev);
     my_data->edid_info = NULL;
     audio_hwdep_send_cal(my_data);
+    for (idx = 0; idx < (int)ARRAY_SIZE(my_data->voice_vol_index); idx++)
+        my_data->voice_vol_index[idx] =
+            (int)percent_to_index(idx, MIN_VOL_INDEX, MAX_VOL_INDEX);
+    for (idx = 0; idx < SND_DEVICE_OUT_END; idx++)
+        my_data->render_latency_cal[idx] = -1;
+
     return my_data;
 }
 
@@ -966,6 +989,7 @@ void platform_deinit(void *platform)
 
     hw_info_deinit(my_data->hw_info);
     close_csd_client(my_data->csd);
+    mixer_volume_release(&my_data->voice_volume);
 
     int32_t dev;
     for (dev = 0; dev < SND_DEVICE_MAX; dev++) {
@@ -1235,13 +1259,53 @@ int platform_switch_voice_call_device_post(void *platform,
         acdb_rx_id = acdb_device_table[out_snd_device];
         acdb_tx_id = acdb_device_table[in_snd_device];
 
-        if (acdb_rx_id > 0 && acdb_tx_id > 0)
+        if (acdb_rx_id > 0 && acdb_tx_id > 0 &&
+                acdb_rx_id == my_data->preloaded_voice_cal_rx &&
+                acdb_tx_id == my_data->preloaded_voice_cal_tx)
+            ALOGV("%s: voice calibration (rx: %d tx: %d) already sent",
+                  __func__, acdb_rx_id, acdb_tx_id);
+        else if (acdb_rx_id > 0 && acdb_tx_id > 0)
             my_data->acdb_send_voice_cal(acdb_rx_id, acdb_tx_id);
         else
             ALOGE("%s: Incorrect ACDB IDs (rx: %d tx: %d)", __func__,
                   acdb_rx_id, acdb_tx_id);
     }
+    my_data->preloaded_voice_cal_rx = 0;
+    my_data->preloaded_voice_cal_tx = 0;
+
+    return 0;
+}
+
+/*
+ * Sends the voice calibration of a device pair ahead of the call, while the
+ * phone rings; the next platform_switch_voice_call_device_post() skips it
+ * for the same pair. A SND_DEVICE_NONE pair forgets what was sent.
+ */
+int platform_preload_voice_calibration(void *platform,
+                                       snd_device_t out_snd_device,
+                                       snd_device_t in_snd_device)
+{
+    struct platform_data *my_data = (struct platform_data *)platform;
+    int acdb_rx_id, acdb_tx_id;
+
+    my_data->preloaded_voice_cal_rx = 0;
+    my_data->preloaded_voice_cal_tx = 0;
+    if (out_snd_device == SND_DEVICE_NONE || in_snd_device == SND_DEVICE_NONE)
+        return 0;
+    if (my_data->acdb_send_voice_cal == NULL)
+        return -ENOSYS;
+
+    acdb_rx_id = acdb_device_table[out_snd_device];
+    acdb_tx_id = acdb_device_table[in_snd_device];
+    if (acdb_rx_id <= 0 || acdb_tx_id <= 0) {
+        ALOGE("%s: Incorrect ACDB IDs (rx: %d tx: %d)", __func__,
+              acdb_rx_id, acdb_tx_id);
+        return -EINVAL;
+    }
 
+    my_data->acdb_send_voice_cal(acdb_rx_id, acdb_tx_id);
+    my_data->preloaded_voice_cal_rx = acdb_rx_id;
+    my_data->preloaded_voice_cal_tx = acdb_tx_id;
     return 0;
 }
 
@@ -1324,27 +1388,28 @@ int platform_set_voice_volume(void *platform, int volume)
 {
     struct platform_data *my_data = (struct platform_data *)platform;
     struct audio_device *adev = my_data->adev;
-    struct mixer_ctl *ctl;
     const char *mixer_ctl_name = "Voice Rx Gain";
-    int vol_index = 0, ret = 0;
-    uint32_t set_values[ ] = {0,
-                              ALL_SESSION_VSID,
-                              DEFAULT_VOLUME_RAMP_DURATION_MS};
+    int ret = 0;
+    int set_values[ ] = {0,
+                         (int)ALL_SESSION_VSID,
+                         DEFAULT_VOLUME_RAMP_DURATION_MS};
 
     // Voice volume levels are mapped to adsp volume levels as follows.
     // 100 -> 5, 80 -> 4, 60 -> 3, 40 -> 2, 20 -> 1  0 -> 0
     // But this values don't changed in kernel. So, below change is need.
-    vol_index = (int)percent_to_index(volume, MIN_VOL_INDEX, MAX_VOL_INDEX);
-    set_values[0] = vol_index;
-
-    ctl = mixer_get_ctl_by_name(adev->mixer, mixer_ctl_name);
-    if (!ctl) {
-        ALOGE("%s: Could not get ctl for mixer cmd - %s",
-              __func__, mixer_ctl_name);
+    if (volume < 0)
+        volume = 0;
+    else if (volume > 100)
+        volume = 100;
+    set_values[0] = my_data->voice_vol_index[volume];
+
+    if (!my_data->voice_volume.ctl &&
+        mixer_volume_init(&my_data->voice_volume, adev->mixer,
+                          mixer_ctl_name) < 0)
         return -EINVAL;
-    }
     ALOGV("Setting voice volume index: %d", set_values[0]);
-    mixer_ctl_set_array(ctl, set_values, ARRAY_SIZE(set_values));
+    mixer_volume_set(&my_data->voice_volume, set_values,
+                     ARRAY_SIZE(set_values));
 
     if (my_data->csd != NULL) {
         ret = my_data->csd->volume(ALL_SESSION_VSID, volume,
@@ -1425,11 +1490,12 @@ int platform_set_device_mute(void *platform, bool state, char *dir)
     return ret;
 }
 
-snd_device_t platform_get_output_snd_device(void *platform, audio_devices_t devices)
+snd_device_t platform_get_output_snd_device_for_mode(void *platform,
+                                                     audio_devices_t devices,
+                                                     audio_mode_t mode)
 {
     struct platform_data *my_data = (struct platform_data *)platform;
     struct audio_device *adev = my_data->adev;
-    audio_mode_t mode = adev->mode;
     snd_device_t snd_device = SND_DEVICE_NONE;
 
     audio_channel_mask_t channel_mask = (adev->active_input == NULL) ?
@@ -1570,14 +1636,23 @@ exit:
     return snd_device;
 }
 
-snd_device_t platform_get_input_snd_device(void *platform, audio_devices_t out_device)
+snd_device_t platform_get_output_snd_device(void *platform, audio_devices_t devices)
+{
+    struct platform_data *my_data = (struct platform_data *)platform;
+
+    return platform_get_output_snd_device_for_mode(platform, devices,
+                                                   my_data->adev->mode);
+}
+
+snd_device_t platform_get_input_snd_device_for_mode(void *platform,
+                                                    audio_devices_t out_device,
+                                                    audio_mode_t mode)
 {
     struct platform_data *my_data = (struct platform_data *)platform;
     struct audio_device *adev = my_data->adev;
     audio_source_t  source = (adev->active_input == NULL) ?
                                 AUDIO_SOURCE_DEFAULT : adev->active_input->source;
 
-    audio_mode_t    mode   = adev->mode;
     audio_devices_t in_device = ((adev->active_input == NULL) ?
                                     AUDIO_DEVICE_NONE : adev->active_input->device)
                                 & ~AUDIO_DEVICE_BIT_IN;
@@ -1816,6 +1891,14 @@ exit:
     return snd_device;
 }
 
+snd_device_t platform_get_input_snd_device(void *platform, audio_devices_t out_device)
+{
+    struct platform_data *my_data = (struct platform_data *)platform;
+
+    return platform_get_input_snd_device_for_mode(platform, out_device,
+                                                  my_data->adev->mode);
+}
+
 int platform_set_hdmi_channels(void *platform,  int channel_count)
 {
     struct platform_data *my_data = (struct platform_data *)platform;
@@ -1950,6 +2033,34 @@ int platform_set_parameters(void *platform, struct str_parms *parms)
         }
     }
 
+    /* "<sound device>,<latency in Us>", e.g. from a loopback measurement;
+       a negative latency goes back to the estimate */
+    err = str_parms_get_str(parms, AUDIO_PARAMETER_KEY_RENDER_LATENCY_CAL,
+                            value, sizeof(value));
+    if (err >= 0) {
+        char *latency = strchr(value, ',');
+        int snd_device = SND_DEVICE_OUT_END;
+
+        if (latency) {
+            *latency++ = '\0';
+            for (snd_device = SND_DEVICE_OUT_BEGIN; snd_device < SND_DEVICE_OUT_END;
+                 snd_device++) {
+                if (device_table[snd_device] &&
+                    !strcmp(device_table[snd_device], value))
+                    break;
+            }
+        }
+        if (snd_device == SND_DEVICE_OUT_END) {
+            ALOGE("%s: invalid render latency calibration", __func__);
+            ret = -EINVAL;
+        } else {
+            my_data->render_latency_cal[snd_device] =
+                atoll(latency) < 0 ? -1 : atoll(latency);
+            ALOGD("%s: %s render latency %lld Us", __func__, value,
+                  (long long)platform_snd_device_render_latency(my_data, snd_device));
+        }
+    }
+
     ALOGV("%s: exit with code(%d)", __func__, ret);
     free(kv_pairs);
     return ret;
@@ -2102,6 +2213,48 @@ int64_t platform_render_latency(audio_usecase_t usecase)
     }
 }
 
+/* Delay in Us, from the microphone to the capture buffer */
+int64_t platform_capture_latency(audio_usecase_t usecase)
+{
+    switch (usecase) {
+        case USECASE_AUDIO_RECORD:
+            return AUDIO_RECORD_PLATFORM_DELAY;
+        case USECASE_AUDIO_RECORD_LOW_LATENCY:
+            return LOW_LATENCY_RECORD_PLATFORM_DELAY;
+        default:
+            return 0;
+    }
+}
+
+/* Delay in Us added after the DSP by the output backend of a sound device */
+int64_t platform_snd_device_render_latency(void *platform, snd_device_t snd_device)
+{
+    struct platform_data *my_data = (struct platform_data *)platform;
+
+    if (snd_device < SND_DEVICE_OUT_BEGIN || snd_device >= SND_DEVICE_OUT_END)
+        return 0;
+    if (my_data->render_latency_cal[snd_device] >= 0)
+        return my_data->render_latency_cal[snd_device];
+
+    switch (snd_device) {
+        case SND_DEVICE_OUT_HDMI:
+        case SND_DEVICE_OUT_SPEAKER_AND_HDMI:
+            return HDMI_RENDER_DELAY;
+        case SND_DEVICE_OUT_BT_SCO:
+        case SND_DEVICE_OUT_BT_SCO_WB:
+            return BT_SCO_RENDER_DELAY;
+        case SND_DEVICE_OUT_USB_HEADSET:
+        case SND_DEVICE_OUT_SPEAKER_AND_USB_HEADSET:
+            return USB_PROXY_RENDER_DELAY;
+        case SND_DEVICE_OUT_SPEAKER:
+        case SND_DEVICE_OUT_SPEAKER_REVERSE:
+        case SND_DEVICE_OUT_SPEAKER_PROTECTED:
+            return audio_extn_spkr_prot_is_enabled() ? SPKR_PROT_RENDER_DELAY : 0;
+        default:
+            return 0;
+    }
+}
+
 int platform_update_usecase_from_source(int source, int usecase)
 {
     ALOGV("%s: input source :%d", __func__, source);
@@ -2145,12 +2298,12 @@ bool platform_sound_trigger_usecase_needs_event(audio_usecase_t uc_id __unused)
  */
 uint32_t platform_get_compress_offload_buffer_size(audio_offload_info_t* info)
 {
-    char value[PROPERTY_VALUE_MAX] = {0};
+    struct audio_config_snapshot config;
     uint32_t fragment_size = COMPRESS_OFFLOAD_FRAGMENT_SIZE;
-    if((property_get("audio.offload.buffer.size.kb", value, "")) &&
-            atoi(value)) {
-        fragment_size =  atoi(value) * 1024;
-    }
+
+    audio_config_get(&config);
+    if (config.offload_buffer_kb)
+        fragment_size = config.offload_buffer_kb * 1024;
 
     if (info != NULL && info->has_video && info->is_streaming) {
         fragment_size = COMPRESS_OFFLOAD_FRAGMENT_SIZE_FOR_AV_STREAMING;
@@ -2172,28 +2325,23 @@ uint32_t platform_get_pcm_offload_buffer_size(audio_offload_info_t* info)
 {
     uint32_t fragment_size = 0;
     uint32_t bits_per_sample = 16;
-    char value[PROPERTY_VALUE_MAX] = {0};
-    char propValue[PROPERTY_VALUE_MAX] = {0};
-    bool track_offload = false;
-
-    property_get("audio.offload.track.enabled", value, "0");
-    track_offload = atoi(value) || !strncmp("true", propValue, sizeof("true"));
+    struct audio_config_snapshot config;
 
+    audio_config_get(&config);
     if (info->format == AUDIO_FORMAT_PCM_24_BIT_OFFLOAD) {
         bits_per_sample = 32;
     }
 
-    if((property_get("audio.offload.pcm.buffer.size", value, "")) &&
-            atoi(value)) {
-        fragment_size =  atoi(value) * 1024;
+    if (config.pcm_offload_buffer_kb) {
+        fragment_size = config.pcm_offload_buffer_kb * 1024;
         ALOGV("Using buffer size from sys prop %d", fragment_size);
     }
 
-    if(track_offload && info->use_small_bufs &&
-          (property_get("audio.offload.track.buffer.size", value, "")) &&
-           atoi(value)) {
-        ALOGV("Track offload Fragment size set by property to %dkb", atoi(value));
-        fragment_size =  atoi(value) * 1024;
+    if (config.offload_track && info->use_small_bufs &&
+            config.track_offload_buffer_kb) {
+        ALOGV("Track offload Fragment size set by property to %dkb",
+              config.track_offload_buffer_kb);
+        fragment_size = config.track_offload_buffer_kb * 1024;
     } else if (info->use_small_bufs) {
         fragment_size = (PCM_OFFLOAD_SMALL_BUFFER_DURATION
                             * info->sample_rate
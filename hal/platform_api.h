@@ -40,6 +40,9 @@ int platform_switch_voice_call_enable_device_config(void *platform,
 int platform_switch_voice_call_device_post(void *platform,
                                            snd_device_t out_snd_device,
                                            snd_device_t in_snd_device);
+int platform_preload_voice_calibration(void *platform,
+                                       snd_device_t out_snd_device,
+                                       snd_device_t in_snd_device);
 int platform_switch_voice_call_usecase_route_post(void *platform,
                                                   snd_device_t out_snd_device,
                                                   snd_device_t in_snd_device);
@@ -51,6 +54,12 @@ int platform_get_sample_rate(void *platform, uint32_t *rate);
 int platform_set_device_mute(void *platform, bool state, char *dir);
 snd_device_t platform_get_output_snd_device(void *platform, audio_devices_t devices);
 snd_device_t platform_get_input_snd_device(void *platform, audio_devices_t out_device);
+snd_device_t platform_get_output_snd_device_for_mode(void *platform,
+                                                     audio_devices_t devices,
+                                                     audio_mode_t mode);
+snd_device_t platform_get_input_snd_device_for_mode(void *platform,
+                                                    audio_devices_t out_device,
+                                                    audio_mode_t mode);
 int platform_set_hdmi_channels(void *platform, int channel_count);
 int platform_edid_get_max_channels(void *platform);
 void platform_get_parameters(void *platform, struct str_parms *query,
@@ -65,6 +74,11 @@ int platform_update_lch(void *platform, struct voice_session *session,
                         enum voice_lch_mode lch_mode);
 /* returns the latency for a usecase in Us */
 int64_t platform_render_latency(audio_usecase_t usecase);
+/* returns the capture latency for a usecase in Us */
+int64_t platform_capture_latency(audio_usecase_t usecase);
+/* returns the latency the output backend of a sound device adds in Us */
+int64_t platform_snd_device_render_latency(void *platform, snd_device_t snd_device);
+#define AUDIO_PARAMETER_KEY_RENDER_LATENCY_CAL "render_latency_cal"
 int platform_update_usecase_from_source(int source, audio_usecase_t usecase);
 
 bool platform_listen_update_status(snd_device_t snd_device);
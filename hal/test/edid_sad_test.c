@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *  * Neither the name of The Linux Foundation nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host test for edid_sad.h: runs each audio data block of the corpus
+ * through edid_sad_parse(), edid_sad_decode() and
+ * edid_sad_channel_allocation() and compares the result with the
+ * matching .expected file.
+ *
+ *   edid-sad-test FILE.hex...
+ *
+ * A .hex file holds one block as the HDMI driver reports it, length
+ * byte first, as hex bytes; '#' starts a comment. The .expected file
+ * has "invalid" for a block the parser must reject, otherwise the SAD
+ * count, one line per decoded SAD and the speaker allocation with its
+ * CA code.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "edid_sad.h"
+
+#define EDID_TEST_MAX_BLOB      256
+#define EDID_TEST_MAX_SADS      10      /* MAX_EDID_BLOCKS in edid.h */
+#define EDID_TEST_MAX_OUTPUT    4096
+
+static int edid_test_load_hex(const char *path, unsigned char *blob,
+                              size_t *size)
+{
+    FILE *f = fopen(path, "r");
+    unsigned int byte;
+    int c;
+
+    if (!f)
+        return -1;
+    *size = 0;
+    for (;;) {
+        c = fgetc(f);
+        if (c == EOF)
+            break;
+        if (c == '#') {
+            while (c != EOF && c != '\n')
+                c = fgetc(f);
+            continue;
+        }
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+            continue;
+        ungetc(c, f);
+        if (fscanf(f, "%2x", &byte) != 1 || *size == EDID_TEST_MAX_BLOB) {
+            fclose(f);
+            return -1;
+        }
+        blob[(*size)++] = (unsigned char)byte;
+    }
+    fclose(f);
+    return 0;
+}
+
+static int edid_test_load_text(const char *path, char *text, size_t len)
+{
+    FILE *f = fopen(path, "r");
+    size_t n;
+
+    if (!f)
+        return -1;
+    n = fread(text, 1, len - 1, f);
+    text[n] = '\0';
+    fclose(f);
+    return 0;
+}
+
+static void edid_test_run(const unsigned char *blob, size_t size,
+                          char *out, size_t len)
+{
+    struct edid_sad sads[EDID_TEST_MAX_SADS];
+    unsigned char spkr_alloc[EDID_SAD_LENGTH];
+    size_t pos;
+    int count, i;
+
+    count = edid_sad_parse(blob, size, sads, EDID_TEST_MAX_SADS, spkr_alloc);
+    if (count < 0) {
+        snprintf(out, len, "invalid\n");
+        return;
+    }
+    pos = snprintf(out, len, "sads %d\n", count);
+    for (i = 0; i < count && i < EDID_TEST_MAX_SADS && pos < len; i++)
+        pos += snprintf(out + pos, len - pos,
+                        "sad %d %s ch %d rate %d bps %d\n", i,
+                        edid_sad_format_name(sads[i].format_id),
+                        sads[i].channels, sads[i].sampling_freq,
+                        sads[i].bits_per_sample);
+    if (pos < len)
+        snprintf(out + pos, len - pos, "spkr 0x%04x ca 0x%02x\n",
+                 (spkr_alloc[1] << 8) | spkr_alloc[0],
+                 edid_sad_channel_allocation(spkr_alloc));
+}
+
+int main(int argc, char **argv)
+{
+    unsigned char blob[EDID_TEST_MAX_BLOB];
+    char expected[EDID_TEST_MAX_OUTPUT], actual[EDID_TEST_MAX_OUTPUT];
+    char path[512];
+    const char *dot;
+    size_t size;
+    int i, failed = 0;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s FILE.hex...\n", argv[0]);
+        return 2;
+    }
+
+    for (i = 1; i < argc; i++) {
+        dot = strrchr(argv[i], '.');
+        if (!dot || strcmp(dot, ".hex") ||
+            snprintf(path, sizeof(path), "%.*s.expected",
+                     (int)(dot - argv[i]), argv[i]) >= (int)sizeof(path)) {
+            fprintf(stderr, "%s: not a .hex file\n", argv[i]);
+            failed++;
+            continue;
+        }
+        if (edid_test_load_hex(argv[i], blob, &size) ||
+            edid_test_load_text(path, expected, sizeof(expected))) {
+            fprintf(stderr, "%s: cannot read the blob or %s\n", argv[i], path);
+            failed++;
+            continue;
+        }
+        edid_test_run(blob, size, actual, sizeof(actual));
+        if (strcmp(actual, expected)) {
+            printf("FAIL: %s\n--- expected\n%s--- actual\n%s", argv[i],
+                   expected, actual);
+            failed++;
+        } else {
+            printf("PASS: %s\n", argv[i]);
+        }
+    }
+    printf("%d of %d EDID blobs failed\n", failed, argc - 1);
+    return failed ? 1 : 0;
+}
@@ -23,6 +23,8 @@
 
 #include <errno.h>
 #include <math.h>
+#include <pthread.h>
+#include <time.h>
 #include <cutils/log.h>
 #include <cutils/str_parms.h>
 
@@ -43,6 +45,53 @@ struct pcm_config pcm_config_voice_call = {
 
 extern const char * const use_case_table[AUDIO_USECASE_MAX];
 
+struct voice_pcm_open_req {
+    unsigned int card;
+    unsigned int device;
+    unsigned int flags;
+    struct pcm_config *config;
+    struct pcm *pcm;
+};
+
+static int64_t voice_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static void *voice_pcm_open_thread(void *context)
+{
+    struct voice_pcm_open_req *req = (struct voice_pcm_open_req *)context;
+
+    req->pcm = pcm_open(req->card, req->device, req->flags, req->config);
+    return NULL;
+}
+
+/*
+ * Device the call audio will most likely be routed to, given what the
+ * primary output plays to while ringing. Mirrors the phone strategy of
+ * the policy manager: SCO, then wired headset, then earpiece.
+ */
+static audio_devices_t voice_predict_call_devices(struct audio_device *adev)
+{
+    audio_devices_t devices = AUDIO_DEVICE_NONE;
+    audio_devices_t sco;
+
+    if (adev->primary_output)
+        devices = adev->primary_output->devices;
+
+    sco = devices & AUDIO_DEVICE_OUT_ALL_SCO;
+    if (sco)
+        return sco & (~sco + 1);
+    if (devices & AUDIO_DEVICE_OUT_WIRED_HEADSET)
+        return AUDIO_DEVICE_OUT_WIRED_HEADSET;
+    if (devices & AUDIO_DEVICE_OUT_WIRED_HEADPHONE)
+        return AUDIO_DEVICE_OUT_WIRED_HEADPHONE;
+    return AUDIO_DEVICE_OUT_EARPIECE;
+}
+
 static struct voice_session *voice_get_session_from_use_case(struct audio_device *adev,
                               audio_usecase_t usecase_id)
 {
@@ -57,11 +106,79 @@ static struct voice_session *voice_get_session_from_use_case(struct audio_device
     return session;
 }
 
+/*
+ * Per session lock, taken with adev->lock held. Starting and stopping a
+ * session means PCM opens and closes on the voice front ends, which wait
+ * for the DSP, so start_call() and stop_call() drop adev->lock around
+ * them and only keep the session locked. Media streams and the other
+ * voice sessions go on meanwhile. Waiting for the session releases
+ * adev->lock, so the lock order stays adev->lock then session.
+ *
+ * The usecase of a locked session stays in the usecase list, so routing
+ * paths must not touch it, see voice_defer_usecase_reroute().
+ */
+void voice_session_lock(struct audio_device *adev,
+                        struct voice_session *session)
+{
+    while (session->busy)
+        pthread_cond_wait(&session->cond, &adev->lock);
+    session->busy = true;
+}
+
+/* Applies a reroute deferred while the session was locked */
+void voice_session_unlock(struct audio_device *adev,
+                          struct voice_session *session)
+{
+    struct listnode *node;
+    struct audio_usecase *usecase;
+
+    if (session->reroute_pending) {
+        session->reroute_pending = false;
+        list_for_each(node, &adev->usecase_list) {
+            usecase = node_to_item(node, struct audio_usecase, list);
+            if (usecase->type == VOICE_CALL &&
+                voice_get_session_from_use_case(adev, usecase->id) == session) {
+                ALOGD("%s: applying deferred reroute of %s", __func__,
+                      use_case_table[usecase->id]);
+                usecase->stream.out = adev->current_call_output;
+                select_devices(adev, usecase->id);
+                break;
+            }
+        }
+    }
+    session->busy = false;
+    pthread_cond_broadcast(&session->cond);
+}
+
+/*
+ * Called with adev->lock held by the paths that reroute usecases other
+ * than their own. Returns true for a voice usecase whose session is being
+ * started or stopped by another thread, which must be left alone; the
+ * reroute is applied when that session is unlocked, if it still exists.
+ */
+bool voice_defer_usecase_reroute(struct audio_device *adev,
+                                 struct audio_usecase *usecase)
+{
+    struct voice_session *session;
+
+    if (usecase->type != VOICE_CALL)
+        return false;
+
+    session = voice_get_session_from_use_case(adev, usecase->id);
+    if (session == NULL || !session->busy)
+        return false;
+
+    session->reroute_pending = true;
+    return true;
+}
+
+/* Called with adev->lock held and the session locked */
 int stop_call(struct audio_device *adev, audio_usecase_t usecase_id)
 {
     int i, ret = 0;
     struct audio_usecase *uc_info;
     struct voice_session *session = NULL;
+    struct pcm *pcm_rx, *pcm_tx;
 
     ALOGD("%s: enter usecase:%s", __func__, use_case_table[usecase_id]);
 
@@ -71,13 +188,17 @@ int stop_call(struct audio_device *adev, audio_usecase_t usecase_id)
     ret = platform_stop_voice_call(adev->platform, session->vsid);
 
     /* 1. Close the PCM devices */
-    if (session->pcm_rx) {
-        pcm_close(session->pcm_rx);
-        session->pcm_rx = NULL;
-    }
-    if (session->pcm_tx) {
-        pcm_close(session->pcm_tx);
-        session->pcm_tx = NULL;
+    pcm_rx = session->pcm_rx;
+    pcm_tx = session->pcm_tx;
+    session->pcm_rx = NULL;
+    session->pcm_tx = NULL;
+    if (pcm_rx || pcm_tx) {
+        pthread_mutex_unlock(&adev->lock);
+        if (pcm_rx)
+            pcm_close(pcm_rx);
+        if (pcm_tx)
+            pcm_close(pcm_tx);
+        pthread_mutex_lock(&adev->lock);
     }
 
     uc_info = get_usecase_from_list(adev, usecase_id);
@@ -101,6 +222,7 @@ int stop_call(struct audio_device *adev, audio_usecase_t usecase_id)
     return ret;
 }
 
+/* Called with adev->lock held and the session locked */
 int start_call(struct audio_device *adev, audio_usecase_t usecase_id)
 {
     int i, ret = 0;
@@ -109,10 +231,25 @@ int start_call(struct audio_device *adev, audio_usecase_t usecase_id)
     uint32_t sample_rate = 8000;
     struct voice_session *session = NULL;
     struct pcm_config voice_config = pcm_config_voice_call;
+    struct voice_setup_plan *plan = &adev->voice.plan;
+    struct voice_setup_timing *timing = &adev->voice.timing;
+    struct voice_pcm_open_req tx_req;
+    struct pcm *pcm_rx, *pcm_tx;
+    pthread_t tx_thread;
+    bool tx_thread_started;
+    int64_t start_us, stage_us, now_us;
 
     ALOGD("%s: enter usecase:%s", __func__, use_case_table[usecase_id]);
 
+    start_us = stage_us = voice_now_us();
+    memset(timing, 0, sizeof(*timing));
+
     session = (struct voice_session *)voice_get_session_from_use_case(adev, usecase_id);
+    if (get_usecase_from_list(adev, usecase_id) != NULL) {
+        ALOGD("%s: usecase %s is already started", __func__,
+              use_case_table[usecase_id]);
+        return 0;
+    }
     uc_info = (struct audio_usecase *)calloc(1, sizeof(struct audio_usecase));
     uc_info->id = usecase_id;
     uc_info->type = VOICE_CALL;
@@ -123,10 +260,22 @@ int start_call(struct audio_device *adev, audio_usecase_t usecase_id)
 
     list_add_tail(&adev->usecase_list, &uc_info->list);
 
+    /* select_devices() takes the planned sound devices on a match */
+    timing->plan_used = plan->valid && plan->usecase == usecase_id &&
+                        plan->devices == uc_info->devices;
     select_devices(adev, usecase_id);
 
-    pcm_dev_rx_id = platform_get_pcm_device_id(uc_info->id, PCM_PLAYBACK);
-    pcm_dev_tx_id = platform_get_pcm_device_id(uc_info->id, PCM_CAPTURE);
+    now_us = voice_now_us();
+    timing->select_devices_us = now_us - stage_us;
+    stage_us = now_us;
+
+    if (timing->plan_used) {
+        pcm_dev_rx_id = plan->pcm_dev_rx_id;
+        pcm_dev_tx_id = plan->pcm_dev_tx_id;
+    } else {
+        pcm_dev_rx_id = platform_get_pcm_device_id(uc_info->id, PCM_PLAYBACK);
+        pcm_dev_tx_id = platform_get_pcm_device_id(uc_info->id, PCM_CAPTURE);
+    }
 
     if (pcm_dev_rx_id < 0 || pcm_dev_tx_id < 0) {
         ALOGE("%s: Invalid PCM devices (rx: %d tx: %d) for the usecase(%d)",
@@ -137,43 +286,84 @@ int start_call(struct audio_device *adev, audio_usecase_t usecase_id)
     ret = platform_get_sample_rate(adev->platform, &sample_rate);
     if (ret < 0) {
         ALOGE("platform_get_sample_rate error %d\n", ret);
+        ret = 0;
     } else {
         voice_config.rate = sample_rate;
     }
     ALOGD("voice_config.rate %d\n", voice_config.rate);
 
+    /*
+     * The RX and TX front ends are independent, so open the capture side
+     * on a helper thread while the playback side is opened here. Neither
+     * touches shared state, so adev->lock is not held meanwhile; the PCMs
+     * are only published to the session once it is taken again.
+     */
+    pthread_mutex_unlock(&adev->lock);
+
+    ALOGV("%s: Opening PCM capture device card_id(%d) device_id(%d)",
+          __func__, adev->snd_card, pcm_dev_tx_id);
+    tx_req.card = adev->snd_card;
+    tx_req.device = pcm_dev_tx_id;
+    tx_req.flags = PCM_IN;
+    tx_req.config = &voice_config;
+    tx_req.pcm = NULL;
+    tx_thread_started = !pthread_create(&tx_thread, (const pthread_attr_t *) NULL,
+                                        voice_pcm_open_thread, &tx_req);
+    if (!tx_thread_started)
+        voice_pcm_open_thread(&tx_req);
+
     ALOGV("%s: Opening PCM playback device card_id(%d) device_id(%d)",
           __func__, adev->snd_card, pcm_dev_rx_id);
-    session->pcm_rx = pcm_open(adev->snd_card,
-                               pcm_dev_rx_id,
-                               PCM_OUT, &voice_config);
-    if (session->pcm_rx && !pcm_is_ready(session->pcm_rx)) {
-        ALOGE("%s: %s", __func__, pcm_get_error(session->pcm_rx));
+    pcm_rx = pcm_open(adev->snd_card,
+                      pcm_dev_rx_id,
+                      PCM_OUT, &voice_config);
+
+    if (tx_thread_started)
+        pthread_join(tx_thread, (void **) NULL);
+    pcm_tx = tx_req.pcm;
+
+    now_us = voice_now_us();
+    timing->pcm_open_us = now_us - stage_us;
+    stage_us = now_us;
+
+    if (pcm_rx && !pcm_is_ready(pcm_rx)) {
+        ALOGE("%s: %s", __func__, pcm_get_error(pcm_rx));
         ret = -EIO;
-        goto error_start_voice;
+    } else if (pcm_tx && !pcm_is_ready(pcm_tx)) {
+        ALOGE("%s: %s", __func__, pcm_get_error(pcm_tx));
+        ret = -EIO;
+    } else {
+        pcm_start(pcm_rx);
+        pcm_start(pcm_tx);
     }
 
-    ALOGV("%s: Opening PCM capture device card_id(%d) device_id(%d)",
-          __func__, adev->snd_card, pcm_dev_tx_id);
-    session->pcm_tx = pcm_open(adev->snd_card,
-                               pcm_dev_tx_id,
-                               PCM_IN, &voice_config);
-    if (session->pcm_tx && !pcm_is_ready(session->pcm_tx)) {
-        ALOGE("%s: %s", __func__, pcm_get_error(session->pcm_tx));
-        ret = -EIO;
+    pthread_mutex_lock(&adev->lock);
+    session->pcm_rx = pcm_rx;
+    session->pcm_tx = pcm_tx;
+    if (ret < 0)
         goto error_start_voice;
-    }
-    pcm_start(session->pcm_rx);
-    pcm_start(session->pcm_tx);
 
     voice_set_volume(adev, adev->voice.volume);
 
+    now_us = voice_now_us();
+    timing->pcm_start_us = now_us - stage_us;
+    stage_us = now_us;
+
     ret = platform_start_voice_call(adev->platform, session->vsid);
     if (ret < 0) {
         ALOGE("%s: platform_start_voice_call error %d\n", __func__, ret);
         goto error_start_voice;
     }
 
+    now_us = voice_now_us();
+    timing->start_voice_us = now_us - stage_us;
+    timing->total_us = now_us - start_us;
+    ALOGD("%s: setup took %lld us (plan %s): select_devices %lld, pcm_open %lld, "
+          "pcm_start %lld, start_voice %lld", __func__,
+          (long long)timing->total_us, timing->plan_used ? "used" : "unused",
+          (long long)timing->select_devices_us, (long long)timing->pcm_open_us,
+          (long long)timing->pcm_start_us, (long long)timing->start_voice_us);
+
     session->state.current = CALL_ACTIVE;
     goto done;
 
@@ -341,27 +531,130 @@ int voice_set_volume(struct audio_device *adev, float volume)
     return err;
 }
 
+static void voice_discard_call_plan(struct audio_device *adev)
+{
+    struct voice_setup_plan *plan = &adev->voice.plan;
+
+    if (plan->valid && plan->calibration_sent)
+        platform_preload_voice_calibration(adev->platform, SND_DEVICE_NONE,
+                                           SND_DEVICE_NONE);
+    plan->valid = false;
+}
+
+/*
+ * Resolves, while the phone rings, what start_call() would otherwise work
+ * out once the call is answered: the voice sound device pair for the
+ * likely call device, their voice calibration, which is sent right away
+ * as it does not touch the ringtone path, and the PCM device ids. The
+ * devices are computed for AUDIO_MODE_IN_CALL without changing adev->mode.
+ * Nothing is routed; the mixer paths of the pair are applied by
+ * select_devices() when the call starts.
+ */
+static void voice_prepare_call(struct audio_device *adev)
+{
+    struct voice_setup_plan *plan = &adev->voice.plan;
+    int64_t start_us = voice_now_us();
+
+    voice_discard_call_plan(adev);
+
+    /* VoIP shares the voice calibration */
+    if (voice_extn_compress_voip_is_active(adev))
+        return;
+
+    plan->usecase = USECASE_VOICE_CALL;
+    plan->devices = voice_predict_call_devices(adev);
+    plan->out_snd_device = platform_get_output_snd_device_for_mode(adev->platform,
+                                   plan->devices, AUDIO_MODE_IN_CALL);
+    plan->in_snd_device = platform_get_input_snd_device_for_mode(adev->platform,
+                                   plan->devices, AUDIO_MODE_IN_CALL);
+    if (plan->out_snd_device == SND_DEVICE_NONE ||
+        plan->in_snd_device == SND_DEVICE_NONE)
+        return;
+
+    plan->pcm_dev_rx_id = platform_get_pcm_device_id(plan->usecase,
+                                                     PCM_PLAYBACK);
+    plan->pcm_dev_tx_id = platform_get_pcm_device_id(plan->usecase,
+                                                     PCM_CAPTURE);
+    if (plan->pcm_dev_rx_id < 0 || plan->pcm_dev_tx_id < 0) {
+        ALOGE("%s: Invalid PCM devices (rx: %d tx: %d)", __func__,
+              plan->pcm_dev_rx_id, plan->pcm_dev_tx_id);
+        return;
+    }
+
+    plan->calibration_sent = platform_preload_voice_calibration(adev->platform,
+                                     plan->out_snd_device, plan->in_snd_device) == 0;
+    plan->valid = true;
+    ALOGD("%s: devices %#x snd devices (%d: %s, %d: %s) calibration %s in %lld us",
+          __func__, plan->devices,
+          plan->out_snd_device, platform_get_snd_device_name(plan->out_snd_device),
+          plan->in_snd_device, platform_get_snd_device_name(plan->in_snd_device),
+          plan->calibration_sent ? "sent" : "deferred",
+          (long long)(voice_now_us() - start_us));
+}
+
+/*
+ * Called with adev->lock held when the mode, the routing of the primary
+ * output or the TTY mode changes. The plan is rebuilt while the phone
+ * rings, kept across the switch to AUDIO_MODE_IN_CALL, where start_call()
+ * checks it against the call devices, and thrown away otherwise.
+ */
+void voice_update_call_plan(struct audio_device *adev)
+{
+    if (adev->mode == AUDIO_MODE_RINGTONE && !voice_is_in_call(adev))
+        voice_prepare_call(adev);
+    else if (adev->mode != AUDIO_MODE_IN_CALL)
+        voice_discard_call_plan(adev);
+}
+
+/* Sound devices planned for a voice usecase, see select_devices() */
+bool voice_get_planned_snd_devices(struct audio_device *adev,
+                                   struct audio_usecase *usecase,
+                                   int *out_snd_device, int *in_snd_device)
+{
+    struct voice_setup_plan *plan = &adev->voice.plan;
+
+    if (!plan->valid || plan->usecase != (int)usecase->id ||
+        plan->devices != usecase->stream.out->devices)
+        return false;
+
+    *out_snd_device = plan->out_snd_device;
+    *in_snd_device = plan->in_snd_device;
+    return true;
+}
+
 int voice_start_call(struct audio_device *adev)
 {
+    struct voice_session *session = &adev->voice.session[VOICE_SESS_IDX];
     int ret = 0;
 
+    /*
+     * Set before the start, which drops adev->lock for a while, so that a
+     * mode change meanwhile sees the call and waits to stop it.
+     */
+    adev->voice.in_call = true;
     ret = voice_extn_start_call(adev);
     if (ret == -ENOSYS) {
+        voice_session_lock(adev, session);
         ret = start_call(adev, USECASE_VOICE_CALL);
+        voice_session_unlock(adev, session);
     }
-    adev->voice.in_call = true;
+    /* the preloaded calibration, if any, was consumed by the call */
+    adev->voice.plan.valid = false;
 
     return ret;
 }
 
 int voice_stop_call(struct audio_device *adev)
 {
+    struct voice_session *session = &adev->voice.session[VOICE_SESS_IDX];
     int ret = 0;
 
     adev->voice.in_call = false;
     ret = voice_extn_stop_call(adev);
     if (ret == -ENOSYS) {
+        voice_session_lock(adev, session);
         ret = stop_call(adev, USECASE_VOICE_CALL);
+        voice_session_unlock(adev, session);
     }
 
     return ret;
@@ -371,7 +664,25 @@ void voice_get_parameters(struct audio_device *adev,
                           struct str_parms *query,
                           struct str_parms *reply)
 {
+    struct voice_setup_timing *timing = &adev->voice.timing;
+    char value[160];
+    int ret;
+
     voice_extn_get_parameters(adev, query, reply);
+
+    ret = str_parms_get_str(query, AUDIO_PARAMETER_KEY_VOICE_SETUP_TIMING,
+                            value, sizeof(value));
+    if (ret >= 0) {
+        snprintf(value, sizeof(value), "plan %d select_devices_us %lld "
+                 "pcm_open_us %lld pcm_start_us %lld start_voice_us %lld "
+                 "total_us %lld", timing->plan_used,
+                 (long long)timing->select_devices_us,
+                 (long long)timing->pcm_open_us,
+                 (long long)timing->pcm_start_us,
+                 (long long)timing->start_voice_us,
+                 (long long)timing->total_us);
+        str_parms_add_str(reply, AUDIO_PARAMETER_KEY_VOICE_SETUP_TIMING, value);
+    }
 }
 
 int voice_set_parameters(struct audio_device *adev, struct str_parms *parms)
@@ -422,6 +733,7 @@ int voice_set_parameters(struct audio_device *adev, struct str_parms *parms)
             adev->acdb_settings = (adev->acdb_settings & TTY_MODE_CLEAR) | tty_mode;
             if (voice_is_call_state_active(adev))
                voice_update_devices_for_all_voice_usecases(adev);
+            voice_update_call_plan(adev);
         }
     }
 
@@ -456,6 +768,10 @@ void voice_init(struct audio_device *adev)
         adev->voice.session[i].state.current = CALL_INACTIVE;
         adev->voice.session[i].state.new = CALL_INACTIVE;
         adev->voice.session[i].vsid = VOICE_VSID;
+        adev->voice.session[i].busy = false;
+        adev->voice.session[i].reroute_pending = false;
+        pthread_cond_init(&adev->voice.session[i].cond,
+                          (const pthread_condattr_t *) NULL);
     }
 
     voice_extn_init(adev);
@@ -468,7 +784,8 @@ void voice_update_devices_for_all_voice_usecases(struct audio_device *adev)
 
     list_for_each(node, &adev->usecase_list) {
         usecase = node_to_item(node, struct audio_usecase, list);
-        if (usecase->type == VOICE_CALL) {
+        if (usecase->type == VOICE_CALL &&
+            !voice_defer_usecase_reroute(adev, usecase)) {
             ALOGV("%s: updating device for usecase:%s", __func__,
                   use_case_table[usecase->id]);
             usecase->stream.out = adev->current_call_output;
@@ -20,6 +20,8 @@
 #ifndef VOICE_H
 #define VOICE_H
 
+#include <pthread.h>
+
 #define BASE_SESS_IDX       0
 #define VOICE_SESS_IDX     (BASE_SESS_IDX)
 
@@ -36,9 +38,11 @@
 #define VOICE_VSID  0x10C01000
 
 #define AUDIO_PARAMETER_KEY_INCALLMUSIC "incall_music_enabled"
+#define AUDIO_PARAMETER_KEY_VOICE_SETUP_TIMING "voice_setup_timing"
 #define AUDIO_PARAMETER_VALUE_TRUE "true"
 
 struct audio_device;
+struct audio_usecase;
 struct str_parms;
 struct stream_in;
 struct stream_out;
@@ -53,6 +57,36 @@ struct voice_session {
     struct pcm *pcm_tx;
     struct call_state state;
     uint32_t vsid;
+    /* Session lock, see voice_session_lock() */
+    bool busy;
+    bool reroute_pending;
+    pthread_cond_t cond;
+};
+
+/*
+ * Call setup work done ahead of the call while the phone rings, see
+ * voice_update_call_plan(). select_devices() and start_call() use it when
+ * the call comes up on the usecase and devices it was built for.
+ */
+struct voice_setup_plan {
+    bool valid;
+    int usecase;
+    audio_devices_t devices;
+    int out_snd_device;
+    int in_snd_device;
+    bool calibration_sent;          /* voice calibration already sent */
+    int pcm_dev_rx_id;
+    int pcm_dev_tx_id;
+};
+
+/* Stage durations of the last start_call(), in microseconds */
+struct voice_setup_timing {
+    bool plan_used;
+    int64_t select_devices_us;
+    int64_t pcm_open_us;
+    int64_t pcm_start_us;
+    int64_t start_voice_us;
+    int64_t total_us;
 };
 
 struct voice {
@@ -61,6 +95,8 @@ struct voice {
     bool mic_mute;
     float volume;
     bool in_call;
+    struct voice_setup_plan plan;
+    struct voice_setup_timing timing;
 };
 
 enum {
@@ -70,6 +106,16 @@ enum {
     INCALL_REC_UPLINK_AND_DOWNLINK,
 };
 
+void voice_session_lock(struct audio_device *adev,
+                        struct voice_session *session);
+void voice_session_unlock(struct audio_device *adev,
+                          struct voice_session *session);
+bool voice_defer_usecase_reroute(struct audio_device *adev,
+                                 struct audio_usecase *usecase);
+void voice_update_call_plan(struct audio_device *adev);
+bool voice_get_planned_snd_devices(struct audio_device *adev,
+                                   struct audio_usecase *usecase,
+                                   int *out_snd_device, int *in_snd_device);
 int voice_start_call(struct audio_device *adev);
 int voice_stop_call(struct audio_device *adev);
 int voice_set_parameters(struct audio_device *adev, struct str_parms *parms);
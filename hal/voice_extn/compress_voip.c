@@ -25,11 +25,17 @@
 #include <pthread.h>
 #include <stdint.h>
 #include <sys/time.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
 #include <stdlib.h>
 #include <math.h>
+#include <time.h>
+#include <unistd.h>
 #include <cutils/log.h>
+#include <cutils/sched_policy.h>
 #include <cutils/str_parms.h>
 #include <cutils/properties.h>
+#include <system/thread_defs.h>
 
 #include "audio_hw.h"
 #include "platform_api.h"
@@ -55,6 +61,53 @@ struct pcm_config pcm_config_voip_wb = {
     .format = PCM_FORMAT_S16_LE,
 };
 
+/*
+ * Frame ring between the VoIP streams and the voip pcm devices. With a
+ * non zero target depth a worker thread per direction owns the blocking
+ * pcm_write()/pcm_read() and out_write()/in_read() only move timestamped
+ * frames in and out of the ring, so the latency the framework's jitter
+ * buffer sees is set by the ring depth and not by the kernel buffering.
+ */
+#define VOIP_RING_MAX_FRAMES        16
+#define VOIP_RING_DEPTH_PROPERTY    "audio.voip.ring.depth"
+/* How many frame periods a stream waits on the ring before giving up */
+#define VOIP_RING_WAIT_PERIODS      4
+
+struct voip_frame {
+    uint32_t size;
+    int64_t timestamp_ns;           /* CLOCK_MONOTONIC, when queued */
+};
+
+struct voip_ring_stats {
+    uint32_t frames;                /* frames that went through the ring */
+    uint32_t late;                  /* frames handed over past their due time */
+    uint32_t early;                 /* frames dropped above the target depth */
+    uint32_t max_depth;
+    int64_t delay_sum_ns;           /* time spent in the ring */
+    int64_t delay_max_ns;
+    int64_t jitter_ns;              /* RFC 3550 interarrival jitter */
+    int64_t last_arrival_ns;
+    int64_t last_pop_ns;
+};
+
+struct voip_ring {
+    const char *name;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    bool thread_started;
+    bool exit;
+    struct pcm *pcm;
+    unsigned char *buf;
+    uint32_t frame_size;
+    int64_t period_ns;
+    uint32_t target;
+    uint32_t head;
+    uint32_t count;
+    struct voip_frame frames[VOIP_RING_MAX_FRAMES];
+    struct voip_ring_stats stats;
+};
+
 struct voip_data {
     struct pcm *pcm_rx;
     struct pcm *pcm_tx;
@@ -62,6 +115,9 @@ struct voip_data {
     uint32_t out_stream_count;
     uint32_t in_stream_count;
     uint32_t sample_rate;
+    uint32_t ring_depth;
+    struct voip_ring rx_ring;
+    struct voip_ring tx_ring;
 };
 
 #define MODE_IS127              0x2
@@ -80,6 +136,8 @@ struct voip_data {
 #define AUDIO_PARAMETER_KEY_VOIP_CHECK              "voip_flag"
 #define AUDIO_PARAMETER_KEY_VOIP_OUT_STREAM_COUNT   "voip_out_stream_count"
 #define AUDIO_PARAMETER_KEY_VOIP_SAMPLE_RATE        "voip_sample_rate"
+#define AUDIO_PARAMETER_KEY_VOIP_RING_DEPTH         "voip_ring_depth"
+#define AUDIO_PARAMETER_KEY_VOIP_RING_STATS         "voip_ring_stats"
 
 static struct voip_data voip_data = {
   .pcm_rx = NULL,
@@ -87,7 +145,18 @@ static struct voip_data voip_data = {
   .out_stream = NULL,
   .out_stream_count = 0,
   .in_stream_count = 0,
-  .sample_rate = 0
+  .sample_rate = 0,
+  .ring_depth = 0,
+  .rx_ring = {
+    .name = "rx",
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+  },
+  .tx_ring = {
+    .name = "tx",
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+  },
 };
 
 static int voip_set_volume(struct audio_device *adev, int volume);
@@ -278,6 +347,346 @@ static int voip_set_dtx(struct audio_device *adev, bool enable)
     return 0;
 }
 
+static int64_t voip_ring_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Waits on the ring condition for at most timeout_ns, lock held */
+static int voip_ring_wait(struct voip_ring *ring, int64_t timeout_ns)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    timeout_ns += ts.tv_nsec;
+    ts.tv_sec += timeout_ns / 1000000000LL;
+    ts.tv_nsec = timeout_ns % 1000000000LL;
+    return pthread_cond_timedwait(&ring->cond, &ring->lock, &ts);
+}
+
+static unsigned char *voip_ring_slot(struct voip_ring *ring, uint32_t idx)
+{
+    return ring->buf + (idx % VOIP_RING_MAX_FRAMES) * ring->frame_size;
+}
+
+static void voip_ring_drop_oldest(struct voip_ring *ring)
+{
+    ring->head = (ring->head + 1) % VOIP_RING_MAX_FRAMES;
+    ring->count--;
+    ring->stats.early++;
+}
+
+/*
+ * Queues one frame, lock held. With wait set the producer is held back
+ * while the ring is at its target depth; once that fails, or without
+ * wait, the oldest frame is dropped so the queueing delay stays bounded.
+ */
+static void voip_ring_push(struct voip_ring *ring, const void *buffer,
+                           size_t bytes, bool wait)
+{
+    struct voip_ring_stats *stats = &ring->stats;
+    struct voip_frame *frame;
+    int64_t now, d;
+    uint32_t tail;
+
+    if (bytes > ring->frame_size)
+        bytes = ring->frame_size;
+
+    if (wait && ring->count >= ring->target) {
+        int64_t deadline = voip_ring_now_ns() +
+                           VOIP_RING_WAIT_PERIODS * ring->period_ns;
+
+        while (!ring->exit && ring->count >= ring->target) {
+            now = voip_ring_now_ns();
+            if (now >= deadline)
+                break;
+            voip_ring_wait(ring, deadline - now);
+        }
+    }
+    while (ring->count && (ring->count >= ring->target ||
+                           ring->count == VOIP_RING_MAX_FRAMES))
+        voip_ring_drop_oldest(ring);
+
+    now = voip_ring_now_ns();
+    if (stats->last_arrival_ns) {
+        d = now - stats->last_arrival_ns - ring->period_ns;
+        if (d < 0)
+            d = -d;
+        stats->jitter_ns += (d - stats->jitter_ns) / 16;
+    }
+    stats->last_arrival_ns = now;
+
+    tail = (ring->head + ring->count) % VOIP_RING_MAX_FRAMES;
+    frame = &ring->frames[tail];
+    memcpy(voip_ring_slot(ring, tail), buffer, bytes);
+    frame->size = bytes;
+    frame->timestamp_ns = now;
+    ring->count++;
+    if (ring->count > stats->max_depth)
+        stats->max_depth = ring->count;
+    pthread_cond_broadcast(&ring->cond);
+}
+
+/*
+ * Dequeues one frame into buffer, lock held. A frame is due when it is
+ * asked for, but not before a period after the previous one; it counts as
+ * late when it is handed over more than half a period after that, so time
+ * the consumer spends waiting on an idle ring is not counted. timeout_ns
+ * < 0 waits until the ring stops. Returns the frame size, 0 if the ring
+ * was stopped or -ETIMEDOUT.
+ */
+static int voip_ring_pop(struct voip_ring *ring, void *buffer, size_t bytes,
+                         int64_t timeout_ns)
+{
+    struct voip_ring_stats *stats = &ring->stats;
+    struct voip_frame *frame;
+    int64_t deadline, due, now, delay;
+    size_t size;
+
+    now = voip_ring_now_ns();
+    due = now;
+    if (stats->last_pop_ns && stats->last_pop_ns + ring->period_ns > due)
+        due = stats->last_pop_ns + ring->period_ns;
+
+    deadline = now + timeout_ns;
+    while (!ring->count && !ring->exit) {
+        if (timeout_ns < 0) {
+            pthread_cond_wait(&ring->cond, &ring->lock);
+            continue;
+        }
+        now = voip_ring_now_ns();
+        if (now >= deadline)
+            return -ETIMEDOUT;
+        voip_ring_wait(ring, deadline - now);
+    }
+    if (!ring->count)
+        return 0;
+
+    frame = &ring->frames[ring->head];
+    size = frame->size < bytes ? frame->size : bytes;
+    memcpy(buffer, voip_ring_slot(ring, ring->head), size);
+    if (size < bytes)
+        memset((char *)buffer + size, 0, bytes - size);
+
+    now = voip_ring_now_ns();
+    if (stats->last_pop_ns && now > due + ring->period_ns / 2)
+        stats->late++;
+    stats->last_pop_ns = now;
+
+    delay = now - frame->timestamp_ns;
+    stats->frames++;
+    stats->delay_sum_ns += delay;
+    if (delay > stats->delay_max_ns)
+        stats->delay_max_ns = delay;
+
+    ring->head = (ring->head + 1) % VOIP_RING_MAX_FRAMES;
+    ring->count--;
+    pthread_cond_broadcast(&ring->cond);
+    return size;
+}
+
+/* Drains the rx ring into the playback device */
+static void *voip_rx_thread_loop(void *context)
+{
+    struct voip_ring *ring = (struct voip_ring *)context;
+    unsigned char *frame = malloc(ring->frame_size);
+    int size;
+
+    setpriority(PRIO_PROCESS, 0, ANDROID_PRIORITY_URGENT_AUDIO);
+    set_sched_policy(0, SP_FOREGROUND);
+    prctl(PR_SET_NAME, (unsigned long)"VoIP Rx", 0, 0, 0);
+
+    pthread_mutex_lock(&ring->lock);
+    while (frame && !ring->exit) {
+        size = voip_ring_pop(ring, frame, ring->frame_size, -1);
+        if (size <= 0)
+            continue;
+        pthread_mutex_unlock(&ring->lock);
+        if (pcm_write(ring->pcm, frame, size) < 0)
+            ALOGE("%s: pcm_write failed: %s", __func__,
+                  pcm_get_error(ring->pcm));
+        pthread_mutex_lock(&ring->lock);
+    }
+    pthread_mutex_unlock(&ring->lock);
+
+    free(frame);
+    return NULL;
+}
+
+/* Fills the tx ring from the capture device */
+static void *voip_tx_thread_loop(void *context)
+{
+    struct voip_ring *ring = (struct voip_ring *)context;
+    unsigned char *frame = malloc(ring->frame_size);
+    bool exit = (frame == NULL);
+
+    setpriority(PRIO_PROCESS, 0, ANDROID_PRIORITY_URGENT_AUDIO);
+    set_sched_policy(0, SP_FOREGROUND);
+    prctl(PR_SET_NAME, (unsigned long)"VoIP Tx", 0, 0, 0);
+
+    while (!exit) {
+        if (pcm_read(ring->pcm, frame, ring->frame_size) < 0) {
+            ALOGE("%s: pcm_read failed: %s", __func__,
+                  pcm_get_error(ring->pcm));
+            usleep(ring->period_ns / 1000);
+            pthread_mutex_lock(&ring->lock);
+        } else {
+            pthread_mutex_lock(&ring->lock);
+            if (!ring->exit)
+                voip_ring_push(ring, frame, ring->frame_size, false);
+        }
+        exit = ring->exit;
+        pthread_mutex_unlock(&ring->lock);
+    }
+
+    free(frame);
+    return NULL;
+}
+
+static void voip_ring_format_stats(struct voip_ring *ring, char *str,
+                                   size_t len)
+{
+    struct voip_ring_stats *stats = &ring->stats;
+
+    pthread_mutex_lock(&ring->lock);
+    snprintf(str, len, "%s frames %u late %u early %u depth %u max_depth %u "
+             "avg_delay_us %lld max_delay_us %lld jitter_us %lld",
+             ring->name, stats->frames, stats->late, stats->early,
+             ring->count, stats->max_depth,
+             stats->frames ?
+                 (long long)(stats->delay_sum_ns / stats->frames / 1000) : 0LL,
+             (long long)(stats->delay_max_ns / 1000),
+             (long long)(stats->jitter_ns / 1000));
+    pthread_mutex_unlock(&ring->lock);
+}
+
+static int voip_ring_start(struct voip_ring *ring, struct pcm *pcm,
+                           struct pcm_config *config, uint32_t target,
+                           void *(*thread_loop)(void *))
+{
+    int ret;
+
+    pthread_mutex_lock(&ring->lock);
+    ring->pcm = pcm;
+    /* The voip pcm configs are all PCM_FORMAT_S16_LE */
+    ring->frame_size = config->period_size * config->channels *
+                       sizeof(int16_t);
+    ring->period_ns = (int64_t)config->period_size * 1000000000LL /
+                      config->rate;
+    ring->target = target;
+    ring->head = 0;
+    ring->count = 0;
+    ring->exit = false;
+    memset(&ring->stats, 0, sizeof(ring->stats));
+    ring->buf = calloc(VOIP_RING_MAX_FRAMES, ring->frame_size);
+    pthread_mutex_unlock(&ring->lock);
+    if (!ring->buf)
+        return -ENOMEM;
+
+    ret = pthread_create(&ring->thread, (const pthread_attr_t *) NULL,
+                         thread_loop, ring);
+    if (ret) {
+        ALOGE("%s: %s thread create failed: %d", __func__, ring->name, ret);
+        free(ring->buf);
+        ring->buf = NULL;
+        return -ret;
+    }
+    ring->thread_started = true;
+    ALOGD("%s: %s ring started, frame %u bytes, target depth %u",
+          __func__, ring->name, ring->frame_size, target);
+    return 0;
+}
+
+static void voip_ring_stop(struct voip_ring *ring)
+{
+    char stats[160];
+
+    if (!ring->thread_started)
+        return;
+
+    pthread_mutex_lock(&ring->lock);
+    ring->exit = true;
+    pthread_cond_broadcast(&ring->cond);
+    pthread_mutex_unlock(&ring->lock);
+
+    /* A worker blocked in the driver returns once the pcm is stopped */
+    pcm_stop(ring->pcm);
+    pthread_join(ring->thread, (void **) NULL);
+    ring->thread_started = false;
+
+    voip_ring_format_stats(ring, stats, sizeof(stats));
+    ALOGD("%s: %s", __func__, stats);
+
+    pthread_mutex_lock(&ring->lock);
+    free(ring->buf);
+    ring->buf = NULL;
+    ring->pcm = NULL;
+    ring->count = 0;
+    pthread_mutex_unlock(&ring->lock);
+}
+
+/* A depth set through voip_ring_depth wins over the property */
+static uint32_t voip_ring_depth(void)
+{
+    char value[PROPERTY_VALUE_MAX] = {0};
+    int depth;
+
+    if (voip_data.ring_depth)
+        return voip_data.ring_depth;
+
+    property_get(VOIP_RING_DEPTH_PROPERTY, value, "0");
+    depth = atoi(value);
+    if (depth < 0)
+        depth = 0;
+    else if (depth > VOIP_RING_MAX_FRAMES)
+        depth = VOIP_RING_MAX_FRAMES;
+    return depth;
+}
+
+/* type is PCM_PLAYBACK for the rx ring, PCM_CAPTURE for the tx ring */
+bool voice_extn_compress_voip_ring_active(audio_usecase_t usecase,
+                                          usecase_type_t type)
+{
+    struct voip_ring *ring = type == PCM_CAPTURE ? &voip_data.tx_ring :
+                                                   &voip_data.rx_ring;
+
+    return usecase == USECASE_COMPRESS_VOIP_CALL && ring->thread_started;
+}
+
+int voice_extn_compress_voip_ring_write(const void *buffer, size_t bytes)
+{
+    struct voip_ring *ring = &voip_data.rx_ring;
+
+    pthread_mutex_lock(&ring->lock);
+    if (ring->exit) {
+        pthread_mutex_unlock(&ring->lock);
+        errno = EPIPE;
+        return -1;
+    }
+    voip_ring_push(ring, buffer, bytes, true);
+    pthread_mutex_unlock(&ring->lock);
+    return 0;
+}
+
+int voice_extn_compress_voip_ring_read(void *buffer, size_t bytes)
+{
+    struct voip_ring *ring = &voip_data.tx_ring;
+    int ret;
+
+    pthread_mutex_lock(&ring->lock);
+    ret = voip_ring_pop(ring, buffer, bytes,
+                        VOIP_RING_WAIT_PERIODS * ring->period_ns);
+    pthread_mutex_unlock(&ring->lock);
+    if (ret <= 0) {
+        errno = ret ? -ret : EPIPE;
+        return -1;
+    }
+    return 0;
+}
+
 static int voip_stop_call(struct audio_device *adev)
 {
     int i, ret = 0;
@@ -294,7 +703,9 @@ static int voip_stop_call(struct audio_device *adev)
             return -EINVAL;
         }
 
-        /* 1. Close the PCM devices */
+        /* 1. Stop the frame rings and close the PCM devices */
+        voip_ring_stop(&voip_data.rx_ring);
+        voip_ring_stop(&voip_data.tx_ring);
         if (voip_data.pcm_rx) {
             pcm_close(voip_data.pcm_rx);
             voip_data.pcm_rx = NULL;
@@ -328,6 +739,7 @@ static int voip_start_call(struct audio_device *adev,
     int i, ret = 0;
     struct audio_usecase *uc_info;
     int pcm_dev_rx_id, pcm_dev_tx_id;
+    uint32_t depth;
 
     ALOGD("%s: enter", __func__);
 
@@ -390,6 +802,25 @@ static int voip_start_call(struct audio_device *adev,
         pcm_start(voip_data.pcm_rx);
         pcm_start(voip_data.pcm_tx);
 
+        depth = voip_ring_depth();
+        if (depth) {
+            ret = voip_ring_start(&voip_data.rx_ring, voip_data.pcm_rx,
+                                  voip_config, depth, voip_rx_thread_loop);
+            if (!ret)
+                ret = voip_ring_start(&voip_data.tx_ring, voip_data.pcm_tx,
+                                      voip_config, depth, voip_tx_thread_loop);
+            if (ret < 0) {
+                ALOGE("%s: frame ring start failed: %d", __func__, ret);
+                /*
+                 * voip_stop_call() is a no-op while a stream is counted,
+                 * so do not leave a started rx ring behind
+                 */
+                voip_ring_stop(&voip_data.rx_ring);
+                voip_ring_stop(&voip_data.tx_ring);
+                goto error_start_voip;
+            }
+        }
+
         voice_extn_compress_voip_set_volume(adev, adev->voice.volume);
 
         if (ret < 0) {
@@ -419,7 +850,7 @@ int voice_extn_compress_voip_set_parameters(struct audio_device *adev,
 {
     char *str;
     char value[32]={0};
-    int ret = 0, err, rate;
+    int ret = 0, err, rate, depth;
     int min_rate, max_rate;
     bool flag;
     char *kv_pairs = str_parms_to_str(parms);
@@ -463,6 +894,31 @@ int voice_extn_compress_voip_set_parameters(struct audio_device *adev,
         voip_set_dtx(adev, flag);
     }
 
+    memset(value, 0, sizeof(value));
+    err = str_parms_get_str(parms, AUDIO_PARAMETER_KEY_VOIP_RING_DEPTH,
+                            value, sizeof(value));
+    if (err >= 0) {
+        depth = atoi(value);
+        if (depth < 0 || depth > VOIP_RING_MAX_FRAMES) {
+            ALOGE("%s: invalid voip ring depth %d", __func__, depth);
+            ret = -EINVAL;
+            goto done;
+        }
+        /*
+         * Enabling or disabling the ring takes effect on the next call,
+         * a running ring only picks up the new target depth.
+         */
+        voip_data.ring_depth = depth;
+        if (depth) {
+            pthread_mutex_lock(&voip_data.rx_ring.lock);
+            voip_data.rx_ring.target = depth;
+            pthread_mutex_unlock(&voip_data.rx_ring.lock);
+            pthread_mutex_lock(&voip_data.tx_ring.lock);
+            voip_data.tx_ring.target = depth;
+            pthread_mutex_unlock(&voip_data.tx_ring.lock);
+        }
+    }
+
 done:
     ALOGV("%s: exit", __func__);
     free(kv_pairs);
@@ -489,6 +945,20 @@ void voice_extn_compress_voip_get_parameters(struct str_parms *query,
         str_parms_add_int(reply, AUDIO_PARAMETER_KEY_VOIP_SAMPLE_RATE,
                           voip_data.sample_rate);
     }
+
+    ret = str_parms_get_str(query, AUDIO_PARAMETER_KEY_VOIP_RING_STATS,
+                            value, sizeof(value));
+    if (ret >= 0) {
+        char stats[320];
+        size_t len;
+
+        voip_ring_format_stats(&voip_data.rx_ring, stats, sizeof(stats));
+        strlcat(stats, ", ", sizeof(stats));
+        len = strlen(stats);
+        voip_ring_format_stats(&voip_data.tx_ring, stats + len,
+                               sizeof(stats) - len);
+        str_parms_add_str(reply, AUDIO_PARAMETER_KEY_VOIP_RING_STATS, stats);
+    }
 }
 
 void voice_extn_compress_voip_out_get_parameters(struct stream_out *out,
@@ -144,12 +144,33 @@ static uint32_t get_session_id_with_state(struct audio_device *adev,
     return session_id;
 }
 
+/*
+ * LCH only talks to the session's own TX pcm or to the modem, so it
+ * runs with adev->lock dropped like the session start and stop.
+ */
+static int update_lch(struct audio_device *adev, struct voice_session *session,
+                      enum voice_lch_mode lch_mode)
+{
+    int ret;
+
+    pthread_mutex_unlock(&adev->lock);
+    ret = platform_update_lch(adev->platform, session, lch_mode);
+    pthread_mutex_lock(&adev->lock);
+
+    return ret;
+}
+
+/*
+ * Each session is locked for its own transition only, so a handover or
+ * a second subscription waits for nothing but that session.
+ */
 static int update_calls(struct audio_device *adev)
 {
     int i = 0;
     audio_usecase_t usecase_id = 0;
     enum voice_lch_mode lch_mode;
     struct voice_session *session = NULL;
+    int new_state;
     int fd = 0;
     int ret = 0;
 
@@ -158,10 +179,16 @@ static int update_calls(struct audio_device *adev)
     for (i = 0; i < MAX_VOICE_SESSIONS; i++) {
         usecase_id = voice_extn_get_usecase_for_session_idx(i);
         session = &adev->voice.session[i];
+        voice_session_lock(adev, session);
         ALOGD("%s: cur_state=%d new_state=%d vsid=%x",
               __func__, session->state.current, session->state.new, session->vsid);
 
-        switch(session->state.new)
+        /*
+         * The state may be updated again while the session drops adev->lock,
+         * that is picked up by the update_calls() waiting for this session.
+         */
+        new_state = session->state.new;
+        switch(new_state)
         {
         case CALL_ACTIVE:
             switch(session->state.current)
@@ -173,23 +200,23 @@ static int update_calls(struct audio_device *adev)
                     ALOGE("%s: voice_start_call() failed for usecase: %d\n",
                           __func__, usecase_id);
                 } else {
-                    session->state.current = session->state.new;
+                    session->state.current = new_state;
                 }
                 break;
 
             case CALL_HOLD:
                 ALOGD("%s: HOLD -> ACTIVE vsid:%x", __func__, session->vsid);
-                session->state.current = session->state.new;
+                session->state.current = new_state;
                 break;
 
             case CALL_LOCAL_HOLD:
                 ALOGD("%s: LOCAL_HOLD -> ACTIVE vsid:%x", __func__, session->vsid);
                 lch_mode = VOICE_LCH_STOP;
-                ret = platform_update_lch(adev->platform, session, lch_mode);
+                ret = update_lch(adev, session, lch_mode);
                 if (ret < 0)
                     ALOGE("%s: lch mode update failed, ret = %d", __func__, ret);
                 else
-                    session->state.current = session->state.new;
+                    session->state.current = new_state;
                 break;
 
             default:
@@ -211,7 +238,7 @@ static int update_calls(struct audio_device *adev)
                     ALOGE("%s: voice_end_call() failed for usecase: %d\n",
                           __func__, usecase_id);
                 } else {
-                    session->state.current = session->state.new;
+                    session->state.current = new_state;
                 }
                 break;
 
@@ -227,17 +254,17 @@ static int update_calls(struct audio_device *adev)
             {
             case CALL_ACTIVE:
                 ALOGD("%s: CALL_ACTIVE -> HOLD vsid:%x", __func__, session->vsid);
-                session->state.current = session->state.new;
+                session->state.current = new_state;
                 break;
 
             case CALL_LOCAL_HOLD:
                 ALOGD("%s: CALL_LOCAL_HOLD -> HOLD vsid:%x", __func__, session->vsid);
                 lch_mode = VOICE_LCH_STOP;
-                ret = platform_update_lch(adev->platform, session, lch_mode);
+                ret = update_lch(adev, session, lch_mode);
                 if (ret < 0)
                     ALOGE("%s: lch mode update failed, ret = %d", __func__, ret);
                 else
-                    session->state.current = session->state.new;
+                    session->state.current = new_state;
                 break;
 
             default:
@@ -255,11 +282,11 @@ static int update_calls(struct audio_device *adev)
                 ALOGD("%s: ACTIVE/CALL_HOLD -> LOCAL_HOLD vsid:%x", __func__,
                       session->vsid);
                 lch_mode = VOICE_LCH_START;
-                ret = platform_update_lch(adev->platform, session, lch_mode);
+                ret = update_lch(adev, session, lch_mode);
                 if (ret < 0)
                     ALOGE("%s: lch mode update failed, ret = %d", __func__, ret);
                 else
-                    session->state.current = session->state.new;
+                    session->state.current = new_state;
                 break;
 
             default:
@@ -272,6 +299,7 @@ static int update_calls(struct audio_device *adev)
         default:
             break;
         } //end out switch loop
+        voice_session_unlock(adev, session);
     } //end for loop
 
     return ret;
@@ -145,6 +145,10 @@ bool voice_extn_compress_voip_pcm_prop_check();
 bool voice_extn_compress_voip_is_active(struct audio_device *adev);
 bool voice_extn_compress_voip_is_format_supported(audio_format_t format);
 bool voice_extn_compress_voip_is_config_supported(struct audio_config *config);
+bool voice_extn_compress_voip_ring_active(audio_usecase_t usecase,
+                                          usecase_type_t type);
+int voice_extn_compress_voip_ring_write(const void *buffer, size_t bytes);
+int voice_extn_compress_voip_ring_read(void *buffer, size_t bytes);
 #else
 static int voice_extn_compress_voip_close_output_stream(struct audio_stream *stream __unused)
 {
@@ -264,6 +268,29 @@ static bool voice_extn_compress_voip_is_config_supported(struct audio_config *co
     ALOGE("%s: COMPRESS_VOIP_ENABLED is not defined", __func__);
     return true;
 }
+
+/* Called for every buffer, so no log here */
+static bool voice_extn_compress_voip_ring_active(audio_usecase_t usecase __unused,
+                                                 usecase_type_t type __unused)
+{
+    return false;
+}
+
+static int voice_extn_compress_voip_ring_write(const void *buffer __unused,
+                                               size_t bytes __unused)
+{
+    ALOGE("%s: COMPRESS_VOIP_ENABLED is not defined", __func__);
+    errno = ENOSYS;
+    return -1;
+}
+
+static int voice_extn_compress_voip_ring_read(void *buffer __unused,
+                                              size_t bytes __unused)
+{
+    ALOGE("%s: COMPRESS_VOIP_ENABLED is not defined", __func__);
+    errno = ENOSYS;
+    return -1;
+}
 #endif
 
 #endif //VOICE_EXTN_H
@@ -58,6 +58,7 @@ LOCAL_C_INCLUDES += hardware/libhardware/include
 LOCAL_C_INCLUDES += hardware/libhardware_legacy/include
 LOCAL_C_INCLUDES += frameworks/base/include
 LOCAL_C_INCLUDES += system/core/include
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../../hal
 
 
 LOCAL_MODULE := audio.primary.msm8960
@@ -117,6 +118,7 @@ ifneq ($(ALSA_DEFAULT_SAMPLE_RATE),)
 endif
 
 LOCAL_C_INCLUDES += $(TARGET_OUT_HEADERS)/mm-audio/libalsa-intf
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../../hal
 
 LOCAL_SRC_FILES:= \
     alsa_default.cpp \
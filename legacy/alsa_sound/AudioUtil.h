@@ -61,10 +61,6 @@ public:
     static bool getHDMIAudioSinkCaps(EDID_AUDIO_INFO*);
 
 private:
-    static int printFormatFromEDID(unsigned char format);
-    static int getSamplingFrequencyFromEDID(unsigned char byte);
-    static int getBitsPerSampleFromEDID(unsigned char byte,
-        unsigned char format);
     static bool getSpeakerAllocation(EDID_AUDIO_INFO* pInfo);
 };
 
@@ -16,6 +16,12 @@ libOmxAacEnc-def += -D_DEBUG
 ifeq ($(strip $(TARGET_USES_QCOM_MM_AUDIO)),true)
 libOmxAacEnc-def += -DAUDIOV2
 endif
+ifneq ($(strip $(AUDIO_FEATURE_AENC_FRAMES_PER_BUF)),)
+libOmxAacEnc-def += -DNUMOFFRAMES=$(AUDIO_FEATURE_AENC_FRAMES_PER_BUF)
+endif
+ifneq ($(strip $(AUDIO_FEATURE_AENC_PIPE_DEPTH)),)
+libOmxAacEnc-def += -DAENC_PIPE_DEPTH=$(AUDIO_FEATURE_AENC_PIPE_DEPTH)
+endif
 
 # ---------------------------------------------------------------------------------
 #             Make the Shared library (libOmxAacEnc)
@@ -24,6 +30,7 @@ endif
 include $(CLEAR_VARS)
 
 libOmxAacEnc-inc       := $(LOCAL_PATH)/inc
+libOmxAacEnc-inc       += $(LOCAL_PATH)/../../aenc-common/inc
 libOmxAacEnc-inc       += $(TARGET_OUT_HEADERS)/mm-core/omxcore
 
 LOCAL_MODULE            := libOmxAacEnc
@@ -49,6 +56,7 @@ include $(CLEAR_VARS)
 
 mm-aac-enc-test-inc    := $(LOCAL_PATH)/inc
 mm-aac-enc-test-inc    += $(LOCAL_PATH)/test
+mm-aac-enc-test-inc    += $(LOCAL_PATH)/../../aenc-common/inc
 ifeq ($(strip $(TARGET_USES_QCOM_MM_AUDIO)),true)
 mm-aac-enc-test-inc    += $(TARGET_OUT_HEADERS)/mm-audio/audio-alsa 
 endif
@@ -54,11 +54,14 @@ This module contains the class definition for openMAX encoder component.
 #include "OMX_Core.h"
 #include "OMX_Audio.h"
 #include "aenc_svr.h"
+#include "aenc_io.h"
+#include "omx_aenc_core.h"
 #include "qc_omx_component.h"
 #include "Map.h"
 #include <semaphore.h>
 #include <linux/msm_audio.h>
 #include <linux/msm_audio_aac.h>
+#include "aenc_pipe.h"
 extern "C" {
     void * get_omx_component_factory_fn(void);
 }
@@ -72,6 +75,7 @@ extern "C" {
 
 #define OMX_SPEC_VERSION  0x00000101
 #define min(x,y) (((x) < (y)) ? (x) : (y))
+#define MIN(x,y) (((x) < (y)) ? (x) : (y))
 #define MAX(x,y) (x >= y?x:y)
 
 //////////////////////////////////////////////////////////////////////////////
@@ -133,7 +137,10 @@ extern "C" {
 #define FALSE 0
 
 
+/* frames per driver read, set with AUDIO_SET_BUF_CFG */
+#ifndef NUMOFFRAMES
 #define NUMOFFRAMES                   1
+#endif
 #define MAXFRAMELENGTH                1536
 #define OMX_AAC_OUTPUT_BUFFER_SIZE    ((NUMOFFRAMES * (sizeof(ENC_META_OUT)+ MAXFRAMELENGTH + 1)\
                                           + 1023) & (~1023))
@@ -208,6 +215,18 @@ static struct sample_rate_idx sample_idx_tbl[10] = {
     {48000, 0x03},
     {64000, 0x02},
 };
+// Codec description for the shared encoder core (omx_aenc_core.h)
+struct aenc_aac_traits
+{
+    static const char *device() { return "/dev/msm_aac_in"; }
+    enum
+    {
+        frame_duration_us = 0,
+        dsp_timestamps = 0,
+        frames_per_buf = NUMOFFRAMES,
+    };
+};
+
 class omx_aac_aenc;
 
 // OMX AAC audio encoder class
@@ -334,6 +353,10 @@ public:
         OMX_COMPONENT_RESUME               = 0x0a
     };
 private:
+    friend struct aenc_core<omx_aac_aenc>;
+
+    typedef aenc_aac_traits traits;
+    typedef aenc_core<omx_aac_aenc> core;
 
     ///////////////////////////////////////////////////////////
     // Type definitions
@@ -371,27 +394,7 @@ private:
         OMX_CORE_OUTPUT_PORT_INDEX       =1
     };
 
-    struct omx_event
-    {
-        unsigned param1;
-        unsigned param2;
-        unsigned id;
-    };
-
-    struct omx_cmd_queue
-    {
-        omx_event m_q[OMX_CORE_CONTROL_CMDQ_SIZE];
-        unsigned m_read;
-        unsigned m_write;
-        unsigned m_size;
-
-        omx_cmd_queue();
-        ~omx_cmd_queue();
-        bool insert_entry(unsigned p1, unsigned p2, unsigned id);
-        bool pop_entry(unsigned *p1,unsigned *p2, unsigned *id);
-        bool get_msg_id(unsigned *id);
-        bool get_msg_with_id(unsigned *p1,unsigned *p2, unsigned id);
-    };
+    typedef aenc_cmd_queue<OMX_CORE_CONTROL_CMDQ_SIZE> omx_cmd_queue;
 
     typedef struct TIMESTAMP
     {
@@ -431,7 +434,6 @@ private:
     // Member variables
     ///////////////////////////////////////////////////////////
     OMX_U8                         *m_tmp_meta_buf;
-    OMX_U8                         *m_tmp_out_meta_buf;
     OMX_U8                         m_flush_cnt ;
     OMX_U8                         m_comp_deinit;
 
@@ -521,6 +523,9 @@ private:
     OMX_STATETYPE                  nState;
     OMX_CALLBACKTYPE               m_cb;         // Application callbacks
     AAC_PB_STATS                  m_aac_pb_stats;
+    struct aenc_io_stats           m_io_stats;
+    struct aenc_pipe               m_pipe;
+    struct aenc_shm_pool           m_shm;
     struct aac_ipc_info           *m_ipc_to_in_th;    // for input thread
     struct aac_ipc_info           *m_ipc_to_out_th;    // for output thread
     struct aac_ipc_info           *m_ipc_to_cmd_th;    // for command thread
@@ -533,58 +538,20 @@ private:
     ///////////////////////////////////////////////////////////
     // Private methods
     ///////////////////////////////////////////////////////////
-    OMX_ERRORTYPE allocate_output_buffer(OMX_HANDLETYPE       hComp,
-                                         OMX_BUFFERHEADERTYPE **bufferHdr,
-                                         OMX_U32 port,OMX_PTR appData,
-                                         OMX_U32              bytes);
-
-    OMX_ERRORTYPE allocate_input_buffer(OMX_HANDLETYPE       hComp,
-                                        OMX_BUFFERHEADERTYPE **bufferHdr,
-                                        OMX_U32              port,
-                                        OMX_PTR              appData,
-                                        OMX_U32              bytes);
-
-    OMX_ERRORTYPE use_input_buffer(OMX_IN OMX_HANDLETYPE          hComp,
-                                   OMX_INOUT OMX_BUFFERHEADERTYPE **bufHdr,
-                                   OMX_IN OMX_U32                 port,
-                                   OMX_IN OMX_PTR                 appData,
-                                   OMX_IN OMX_U32                 bytes,
-                                   OMX_IN OMX_U8*                 buffer);
-
-    OMX_ERRORTYPE use_output_buffer(OMX_IN OMX_HANDLETYPE          hComp,
-                                    OMX_INOUT OMX_BUFFERHEADERTYPE **bufHdr,
-                                    OMX_IN OMX_U32                 port,
-                                    OMX_IN OMX_PTR                 appData,
-                                    OMX_IN OMX_U32                 bytes,
-                                    OMX_IN OMX_U8*                 buffer);
-
     OMX_ERRORTYPE fill_this_buffer_proxy(OMX_HANDLETYPE       hComp,
                                          OMX_BUFFERHEADERTYPE *buffer);
 
-    OMX_ERRORTYPE send_command_proxy(OMX_HANDLETYPE  hComp,
-                                     OMX_COMMANDTYPE cmd,
-                                     OMX_U32         param1,
-                                     OMX_PTR         cmdData);
-
     OMX_ERRORTYPE send_command(OMX_HANDLETYPE hComp,
                                OMX_COMMANDTYPE  cmd,
                                OMX_U32       param1,
                                OMX_PTR      cmdData);
 
-    bool allocate_done(void);
-
-    bool release_done(OMX_U32         param1);
-
     bool execute_omx_flush(OMX_IN OMX_U32 param1, bool cmd_cmpl=true);
 
     bool execute_input_omx_flush(void);
 
     bool execute_output_omx_flush(void);
 
-    bool search_input_bufhdr(OMX_BUFFERHEADERTYPE *buffer);
-
-    bool search_output_bufhdr(OMX_BUFFERHEADERTYPE *buffer);
-
     bool post_input(unsigned int p1, unsigned int p2,
                     unsigned int id);
 
@@ -609,6 +576,13 @@ private:
 
     void out_th_wakeup();
 
+    // Codec hooks of the shared state machine
+    void configure_encoder();
+
+    void configure_pcm(struct msm_audio_config *pcm_cfg);
+
+    void reset_encoder();
+
     void flush_ack();
     void deinit_encoder();
     void audaac_rec_install_adif_header_variable (OMX_U16  byte_num,
@@ -47,25 +47,23 @@ void *omx_aac_msg(void *info)
 {
     struct aac_ipc_info *aac_info = (struct aac_ipc_info*)info;
     unsigned char id;
-    int n;
 
     DEBUG_DETAIL("\n%s: message thread start\n", __FUNCTION__);
-    while (!aac_info->dead)
+    for (;;)
     {
-        n = read(aac_info->pipe_in, &id, 1);
-        if (0 == n) break;
-        if (1 == n)
+        // Drain everything posted since the last wakeup in one go
+        while (aenc_msgq_pop(&aac_info->msgq, &id))
         {
-          DEBUG_DETAIL("\n%s-->pipe_in=%d pipe_out=%d\n",
-                                               aac_info->thread_name,
-                                               aac_info->pipe_in,
-                                               aac_info->pipe_out);
-
+            DEBUG_DETAIL("\n%s-->id=%d\n", aac_info->thread_name, id);
             aac_info->process_msg_cb(aac_info->client_data, id);
         }
-        if ((n < 0) && (errno != EINTR)) break;
+        if (__atomic_load_n(&aac_info->dead, __ATOMIC_ACQUIRE))
+            break;
+        aenc_msgq_wait(&aac_info->msgq);
     }
-    DEBUG_DETAIL("%s: message thread stop\n", __FUNCTION__);
+    DEBUG_DETAIL("%s: message thread stop, %u msgs in %u wakeups\n",
+                 aac_info->thread_name, aac_info->msgq.posted,
+                 aac_info->msgq.wakeups);
 
     return 0;
 }
@@ -95,7 +93,6 @@ struct aac_ipc_info *omx_aac_thread_create(
                                     char* th_name)
 {
     int r;
-    int fds[2];
     struct aac_ipc_info *aac_info;
 
     aac_info = calloc(1, sizeof(struct aac_ipc_info));
@@ -108,14 +105,11 @@ struct aac_ipc_info *omx_aac_thread_create(
     aac_info->process_msg_cb = cb;
     strlcpy(aac_info->thread_name, th_name, sizeof(aac_info->thread_name));
 
-    if (pipe(fds))
+    if (aenc_msgq_init(&aac_info->msgq))
     {
-        DEBUG_PRINT_ERROR("\n%s: pipe creation failed\n", __FUNCTION__);
-        goto fail_pipe;
+        DEBUG_PRINT_ERROR("\n%s: eventfd creation failed\n", __FUNCTION__);
+        goto fail_msgq;
     }
-
-    aac_info->pipe_in = fds[0];
-    aac_info->pipe_out = fds[1];
    
     r = pthread_create(&aac_info->thr, 0, omx_aac_msg, aac_info);
     if (r < 0) goto fail_thread;
@@ -125,10 +119,9 @@ struct aac_ipc_info *omx_aac_thread_create(
 
 
 fail_thread:
-    close(aac_info->pipe_in);
-    close(aac_info->pipe_out);
+    aenc_msgq_deinit(&aac_info->msgq);
 
-fail_pipe:
+fail_msgq:
     free(aac_info);
 
     return 0;
@@ -148,7 +141,6 @@ struct aac_ipc_info *omx_aac_event_thread_create(
                                     char* th_name)
 {
     int r;
-    int fds[2];
     struct aac_ipc_info *aac_info;
 
     aac_info = calloc(1, sizeof(struct aac_ipc_info));
@@ -161,15 +153,12 @@ struct aac_ipc_info *omx_aac_event_thread_create(
     aac_info->process_msg_cb = cb;
     strlcpy(aac_info->thread_name, th_name, sizeof(aac_info->thread_name));
 
-    if (pipe(fds))
+    if (aenc_msgq_init(&aac_info->msgq))
     {
-        DEBUG_PRINT("\n%s: pipe creation failed\n", __FUNCTION__);
-        goto fail_pipe;
+        DEBUG_PRINT("\n%s: eventfd creation failed\n", __FUNCTION__);
+        goto fail_msgq;
     }
 
-    aac_info->pipe_in = fds[0];
-    aac_info->pipe_out = fds[1];
-
     r = pthread_create(&aac_info->thr, 0, omx_aac_events, aac_info);
     if (r < 0) goto fail_thread;
 
@@ -178,10 +167,9 @@ struct aac_ipc_info *omx_aac_event_thread_create(
 
 
 fail_thread:
-    close(aac_info->pipe_in);
-    close(aac_info->pipe_out);
+    aenc_msgq_deinit(&aac_info->msgq);
 
-fail_pipe:
+fail_msgq:
     free(aac_info);
 
     return 0;
@@ -189,18 +177,15 @@ fail_pipe:
 
 void omx_aac_thread_stop(struct aac_ipc_info *aac_info) {
     DEBUG_DETAIL("%s stop server\n", __FUNCTION__);
-    close(aac_info->pipe_in);
-    close(aac_info->pipe_out);
+    __atomic_store_n(&aac_info->dead, 1, __ATOMIC_RELEASE);
+    aenc_msgq_wake(&aac_info->msgq);
     pthread_join(aac_info->thr,NULL);
-    aac_info->pipe_out = -1;
-    aac_info->pipe_in = -1;
-    DEBUG_DETAIL("%s: message thread close fds%d %d\n", aac_info->thread_name,
-        aac_info->pipe_in,aac_info->pipe_out);
+    aenc_msgq_deinit(&aac_info->msgq);
+    DEBUG_DETAIL("%s: message thread closed\n", aac_info->thread_name);
     free(aac_info);
 }
 
 void omx_aac_post_msg(struct aac_ipc_info *aac_info, unsigned char id) {
     DEBUG_DETAIL("\n%s id=%d\n", __FUNCTION__,id);
- 
-    write(aac_info->pipe_out, &id, 1);
+    aenc_msgq_post(&aac_info->msgq, id);
 }
@@ -45,85 +45,11 @@ using namespace std;
 
 #define SLEEP_MS 100
 
-// omx_cmd_queue destructor
-omx_aac_aenc::omx_cmd_queue::~omx_cmd_queue()
-{
-    // Nothing to do
-}
-
-// omx cmd queue constructor
-omx_aac_aenc::omx_cmd_queue::omx_cmd_queue(): m_read(0),m_write(0),m_size(0)
-{
-    memset(m_q,      0,sizeof(omx_event)*OMX_CORE_CONTROL_CMDQ_SIZE);
-}
-
-// omx cmd queue insert
-bool omx_aac_aenc::omx_cmd_queue::insert_entry(unsigned p1,
-                                                unsigned p2,
-                                                unsigned id)
-{
-    bool ret = true;
-    if (m_size < OMX_CORE_CONTROL_CMDQ_SIZE)
-    {
-        m_q[m_write].id       = id;
-        m_q[m_write].param1   = p1;
-        m_q[m_write].param2   = p2;
-        m_write++;
-        m_size ++;
-        if (m_write >= OMX_CORE_CONTROL_CMDQ_SIZE)
-        {
-            m_write = 0;
-        }
-    } else
-    {
-        ret = false;
-        DEBUG_PRINT_ERROR("ERROR!!! Command Queue Full");
-    }
-    return ret;
-}
-
-bool omx_aac_aenc::omx_cmd_queue::pop_entry(unsigned *p1,
-                                             unsigned *p2, unsigned *id)
-{
-    bool ret = true;
-    if (m_size > 0)
-    {
-        *id = m_q[m_read].id;
-        *p1 = m_q[m_read].param1;
-        *p2 = m_q[m_read].param2;
-        // Move the read pointer ahead
-        ++m_read;
-        --m_size;
-        if (m_read >= OMX_CORE_CONTROL_CMDQ_SIZE)
-        {
-            m_read = 0;
-
-        }
-    } else
-    {
-        ret = false;
-        DEBUG_PRINT_ERROR("ERROR Delete!!! Command Queue Empty");
-    }
-    return ret;
-}
-
 // factory function executed by the core to create instances
 void *get_omx_component_factory_fn(void)
 {
     return(new omx_aac_aenc);
 }
-bool omx_aac_aenc::omx_cmd_queue::get_msg_id(unsigned *id)
-{
-   if(m_size > 0)
-   {
-       *id = m_q[m_read].id;
-       DEBUG_PRINT("get_msg_id=%d\n",*id);
-   }
-   else{
-       return false;
-   }
-   return true;
-}
 /*=============================================================================
 FUNCTION:
   wait_for_event
@@ -254,7 +180,6 @@ RETURN VALUE
   None.
 ========================================================================== */
 omx_aac_aenc::omx_aac_aenc(): m_tmp_meta_buf(NULL),
-        m_tmp_out_meta_buf(NULL),
         m_flush_cnt(255),
         m_comp_deinit(0),
         adif_flag(0),
@@ -291,6 +216,9 @@ omx_aac_aenc::omx_aac_aenc(): m_tmp_meta_buf(NULL),
     memset(&m_cmp, 0, sizeof(m_cmp));
     memset(&m_cb, 0, sizeof(m_cb));
     memset(&m_aac_pb_stats, 0, sizeof(m_aac_pb_stats));
+    memset(&m_io_stats, 0, sizeof(m_io_stats));
+    aenc_pipe_init(&m_pipe);
+    aenc_shm_pool_init(&m_shm, -1);
     memset(&m_pcm_param, 0, sizeof(m_pcm_param));
     memset(&m_aac_param, 0, sizeof(m_aac_param));
     memset(&m_buffer_supplier, 0, sizeof(m_buffer_supplier));
@@ -392,6 +320,7 @@ omx_aac_aenc::~omx_aac_aenc()
     {
         deinit_encoder();
     }
+    aenc_pipe_deinit(&m_pipe);
     pthread_mutexattr_destroy(&m_lock_attr);
     pthread_mutex_destroy(&m_lock);
 
@@ -839,9 +768,8 @@ void omx_aac_aenc::process_command_msg(void *client_data, unsigned char id)
         }
     } else if (OMX_COMPONENT_GENERATE_COMMAND == id)
     {
-        pThis->send_command_proxy(&pThis->m_cmp,
-                                  (OMX_COMMANDTYPE)p1,
-                                  (OMX_U32)p2,(OMX_PTR)NULL);
+        core::send_command_proxy(pThis, &pThis->m_cmp, (OMX_COMMANDTYPE)p1,
+                                 (OMX_U32)p2, (OMX_PTR)NULL);
     } else if (OMX_COMPONENT_PORTSETTINGS_CHANGED == id)
     {
         DEBUG_DETAIL("CMD-->RXED PORTSETTINGS_CHANGED");
@@ -1129,20 +1057,14 @@ OMX_ERRORTYPE omx_aac_aenc::component_init(OMX_STRING role)
             return OMX_ErrorInsufficientResources;
 	}
     }
-    m_tmp_out_meta_buf =
-	(OMX_U8*)malloc(sizeof(OMX_U8)*OMX_AAC_OUTPUT_BUFFER_SIZE);
-        if ( m_tmp_out_meta_buf == NULL ) {
-            DEBUG_PRINT_ERROR("Mem alloc failed for out meta buf\n");
-            return OMX_ErrorInsufficientResources;
-	}
 
     if(0 == pcm_input)
     {
-        m_drv_fd = open("/dev/msm_aac_in",O_RDONLY);
+        m_drv_fd = open(aenc_aac_traits::device(),O_RDONLY);
     }
     else
     {
-        m_drv_fd = open("/dev/msm_aac_in",O_RDWR);
+        m_drv_fd = open(aenc_aac_traits::device(),O_RDWR);
     }
     if (m_drv_fd < 0)
     {
@@ -1155,6 +1077,7 @@ OMX_ERRORTYPE omx_aac_aenc::component_init(OMX_STRING role)
     {
         DEBUG_PRINT_ERROR("AUDIO_GET_SESSION_ID FAILED\n");
     }
+    aenc_shm_pool_init(&m_shm, m_drv_fd);
     if(pcm_input)
     {
         if (!m_ipc_to_in_th)
@@ -1277,697 +1200,120 @@ OMX_ERRORTYPE  omx_aac_aenc::send_command(OMX_IN OMX_HANDLETYPE hComp,
 }
 
 /**
- @brief member function performs actual processing of commands excluding
-  empty buffer call
-
- @param hComp handle to component
- @param cmd command type
- @param param1 parameter associated with the command
- @param cmdData
-
- @return error status
+ @brief codec hook of the shared state machine, sets up the AAC encoder
+  and the frame duration used for the output time stamps before the
+  session starts
 */
-OMX_ERRORTYPE  omx_aac_aenc::send_command_proxy(OMX_IN OMX_HANDLETYPE hComp,
-                                                 OMX_IN OMX_COMMANDTYPE  cmd,
-                                                 OMX_IN OMX_U32       param1,
-                                                 OMX_IN OMX_PTR      cmdData)
+void omx_aac_aenc::configure_encoder()
 {
-    OMX_ERRORTYPE eRet = OMX_ErrorNone;
-    //   Handle only IDLE and executing
-    OMX_STATETYPE eState = (OMX_STATETYPE) param1;
-    int bFlag = 1;
-    nState = eState;
+    struct msm_audio_aac_enc_config drv_aac_enc_config;
+    struct msm_audio_aac_config drv_aac_config;
 
-    if(hComp == NULL)
+    if (ioctl(m_drv_fd, AUDIO_GET_AAC_ENC_CONFIG, &drv_aac_enc_config) == -1)
     {
-        cmdData = NULL;
-        DEBUG_PRINT_ERROR("Returning OMX_ErrorBadParameter\n");
-        return OMX_ErrorBadParameter;
+        DEBUG_PRINT_ERROR("ioctl AUDIO_GET_AAC_ENC_CONFIG failed, "
+                          "errno[%d]\n", errno);
     }
-    if (OMX_CommandStateSet == cmd)
+    drv_aac_enc_config.channels = m_aac_param.nChannels;
+    drv_aac_enc_config.sample_rate = m_aac_param.nSampleRate;
+    drv_aac_enc_config.bit_rate =  m_aac_param.nBitRate;
+    DEBUG_PRINT("aac config %lu,%lu,%lu %d\n",
+                m_aac_param.nChannels,m_aac_param.nSampleRate,
+                m_aac_param.nBitRate,m_aac_param.eAACStreamFormat);
+    switch(m_aac_param.eAACStreamFormat)
     {
-        /***************************/
-        /* Current State is Loaded */
-        /***************************/
-        if (OMX_StateLoaded == m_state)
+        case 0:
+        case 1:
         {
-            if (OMX_StateIdle == eState)
-            {
-
-                 if (allocate_done() ||
-                        (m_inp_bEnabled == OMX_FALSE
-                         && m_out_bEnabled == OMX_FALSE))
-                 {
-                       DEBUG_PRINT("SCP-->Allocate Done Complete\n");
-                 }
-                 else
-                 {
-                        DEBUG_PRINT("SCP-->Loaded to Idle-Pending\n");
-                        BITMASK_SET(&m_flags, OMX_COMPONENT_IDLE_PENDING);
-                        bFlag = 0;
-                 }
-
-            } else if (eState == OMX_StateLoaded)
-            {
-                DEBUG_PRINT("OMXCORE-SM: Loaded-->Loaded\n");
-                m_cb.EventHandler(&this->m_cmp,
-                                  this->m_app_data,
-                                  OMX_EventError,
-                                  OMX_ErrorSameState,
-                                  0, NULL );
-                eRet = OMX_ErrorSameState;
-            }
-
-            else if (eState == OMX_StateWaitForResources)
-            {
-                DEBUG_PRINT("OMXCORE-SM: Loaded-->WaitForResources\n");
-                eRet = OMX_ErrorNone;
-            }
-
-            else if (eState == OMX_StateExecuting)
-            {
-                DEBUG_PRINT("OMXCORE-SM: Loaded-->Executing\n");
-                m_cb.EventHandler(&this->m_cmp,
-                                  this->m_app_data,
-                                  OMX_EventError,
-                                  OMX_ErrorIncorrectStateTransition,
-                                  0, NULL );
-                eRet = OMX_ErrorIncorrectStateTransition;
-            }
-
-            else if (eState == OMX_StatePause)
-            {
-                DEBUG_PRINT("OMXCORE-SM: Loaded-->Pause\n");
-                m_cb.EventHandler(&this->m_cmp,
-                                  this->m_app_data,
-                                  OMX_EventError,
-                                  OMX_ErrorIncorrectStateTransition,
-                                  0, NULL );
-                eRet = OMX_ErrorIncorrectStateTransition;
-            }
-
-            else if (eState == OMX_StateInvalid)
-            {
-                DEBUG_PRINT("OMXCORE-SM: Loaded-->Invalid\n");
-                m_cb.EventHandler(&this->m_cmp,
-                                  this->m_app_data,
-                                  OMX_EventError,
-                                  OMX_ErrorInvalidState,
-                                  0, NULL );
-                m_state = OMX_StateInvalid;
-                eRet = OMX_ErrorInvalidState;
-            } else
-            {
-                DEBUG_PRINT_ERROR("SCP-->Loaded to Invalid(%d))\n",eState);
-                eRet = OMX_ErrorBadParameter;
-            }
+            drv_aac_enc_config.stream_format = 65535;
+            DEBUG_PRINT("Setting AUDIO_AAC_FORMAT_ADTS\n");
+            break;
         }
-
-        /***************************/
-        /* Current State is IDLE */
-        /***************************/
-        else if (OMX_StateIdle == m_state)
+        case 4:
+        case 5:
+        case 6:
         {
-            if (OMX_StateLoaded == eState)
-            {
-                if (release_done(-1))
-                {
-                   if (ioctl(m_drv_fd, AUDIO_STOP, 0) == -1)
-                    {
-                        DEBUG_PRINT_ERROR("SCP:Idle->Loaded,ioctl \
-					stop failed %d\n", errno);
-                    }
-                    nTimestamp=0;
-                    ts = 0; 
-                    frameduration = 0;
-                    DEBUG_PRINT("SCP-->Idle to Loaded\n");
-                } else
-                {
-                    DEBUG_PRINT("SCP--> Idle to Loaded-Pending\n");
-                    BITMASK_SET(&m_flags, OMX_COMPONENT_LOADING_PENDING);
-                    // Skip the event notification
-                    bFlag = 0;
-                }
-            }
-            else if (OMX_StateExecuting == eState)
-            {
-
-                struct msm_audio_aac_enc_config drv_aac_enc_config;
-                struct msm_audio_aac_config drv_aac_config;
-                struct msm_audio_stream_config drv_stream_config;
-                struct msm_audio_buf_cfg buf_cfg;
-                struct msm_audio_config pcm_cfg;
-                if(ioctl(m_drv_fd, AUDIO_GET_STREAM_CONFIG, &drv_stream_config)
-			== -1)
-                {
-                    DEBUG_PRINT_ERROR("ioctl AUDIO_GET_STREAM_CONFIG failed, \
-					errno[%d]\n", errno);
-                }
-                if(ioctl(m_drv_fd, AUDIO_SET_STREAM_CONFIG, &drv_stream_config)
-			== -1)
-                {
-                    DEBUG_PRINT_ERROR("ioctl AUDIO_SET_STREAM_CONFIG failed, \
-					errno[%d]\n", errno);
-                }
-
-                if(ioctl(m_drv_fd, AUDIO_GET_AAC_ENC_CONFIG,
-			&drv_aac_enc_config) == -1)
-                {
-                    DEBUG_PRINT_ERROR("ioctl AUDIO_GET_AAC_ENC_CONFIG failed, \
-					errno[%d]\n", errno);
-                }
-                drv_aac_enc_config.channels = m_aac_param.nChannels;
-                drv_aac_enc_config.sample_rate = m_aac_param.nSampleRate;
-                drv_aac_enc_config.bit_rate =  m_aac_param.nBitRate;
-                DEBUG_PRINT("aac config %lu,%lu,%lu %d\n",
-                            m_aac_param.nChannels,m_aac_param.nSampleRate,
-			    m_aac_param.nBitRate,m_aac_param.eAACStreamFormat);
-                switch(m_aac_param.eAACStreamFormat)
-                {
-
-                    case 0:
-                    case 1:
-                    {
-                        drv_aac_enc_config.stream_format = 65535;
-                        DEBUG_PRINT("Setting AUDIO_AAC_FORMAT_ADTS\n");
-                        break;
-                    }
-                    case 4:
-                    case 5:
-                    case 6:
-                    {
-                        drv_aac_enc_config.stream_format = AUDIO_AAC_FORMAT_RAW;
-                        DEBUG_PRINT("Setting AUDIO_AAC_FORMAT_RAW\n");
-                        break;
-                    }
-                    default:
-                           break;
-                }
-                DEBUG_PRINT("Stream format = %d\n",
-				drv_aac_enc_config.stream_format);
-                if(ioctl(m_drv_fd, AUDIO_SET_AAC_ENC_CONFIG,
-			&drv_aac_enc_config) == -1)
-                {
-                    DEBUG_PRINT_ERROR("ioctl AUDIO_SET_AAC_ENC_CONFIG failed, \
-					errno[%d]\n", errno);
-                }
-                if (ioctl(m_drv_fd, AUDIO_GET_AAC_CONFIG, &drv_aac_config)
-			== -1) {
-                    DEBUG_PRINT_ERROR("ioctl AUDIO_GET_AAC_CONFIG failed, \
-					errno[%d]\n", errno);
-                }
-
-                drv_aac_config.sbr_on_flag = 0;
-                drv_aac_config.sbr_ps_on_flag = 0;
-				/* Other members of drv_aac_config are not used,
-				 so not setting them */
-                switch(m_aac_param.eAACProfile)
-                {
-                    case OMX_AUDIO_AACObjectLC:
-                    {
-                        DEBUG_PRINT("AAC_Profile: OMX_AUDIO_AACObjectLC\n");
-                        drv_aac_config.sbr_on_flag = 0;
-                        drv_aac_config.sbr_ps_on_flag = 0;
-                        break;
-                    }
-                    case OMX_AUDIO_AACObjectHE:
-                    {
-                        DEBUG_PRINT("AAC_Profile: OMX_AUDIO_AACObjectHE\n");
-                        drv_aac_config.sbr_on_flag = 1;
-                        drv_aac_config.sbr_ps_on_flag = 0;
-                        break;
-                    }
-                    case OMX_AUDIO_AACObjectHE_PS:
-                    {
-                        DEBUG_PRINT("AAC_Profile: OMX_AUDIO_AACObjectHE_PS\n");
-                        drv_aac_config.sbr_on_flag = 1;
-                        drv_aac_config.sbr_ps_on_flag = 1;
-                        break;
-                    }
-                    default:
-                    {
-                        DEBUG_PRINT_ERROR("Unsupported AAC Profile Type = %d\n",
-						m_aac_param.eAACProfile);
-                        break;
-                    }
-                }
-                DEBUG_PRINT("sbr_flag = %d, sbr_ps_flag = %d\n",
-				drv_aac_config.sbr_on_flag,
-				drv_aac_config.sbr_ps_on_flag);
-
-                if (ioctl(m_drv_fd, AUDIO_SET_AAC_CONFIG, &drv_aac_config)
-			== -1) {
-                    DEBUG_PRINT_ERROR("ioctl AUDIO_SET_AAC_CONFIG failed, \
-					errno[%d]\n", errno);
-                }
-
-                if (ioctl(m_drv_fd, AUDIO_GET_BUF_CFG, &buf_cfg) == -1)
-                {
-                    DEBUG_PRINT_ERROR("ioctl AUDIO_GET_BUF_CFG, errno[%d]\n",
-					errno);
-                }
-                buf_cfg.meta_info_enable = 1;
-                buf_cfg.frames_per_buf = NUMOFFRAMES;
-                if (ioctl(m_drv_fd, AUDIO_SET_BUF_CFG, &buf_cfg) == -1)
-                {
-                    DEBUG_PRINT_ERROR("ioctl AUDIO_SET_BUF_CFG, errno[%d]\n",
-					errno);
-                }
-                if(pcm_input)
-                {
-                    if (ioctl(m_drv_fd, AUDIO_GET_CONFIG, &pcm_cfg) == -1)
-                    {
-                        DEBUG_PRINT_ERROR("ioctl AUDIO_GET_CONFIG, errno[%d]\n",
-					errno);
-                    }
-                    pcm_cfg.channel_count = m_pcm_param.nChannels;
-                    pcm_cfg.sample_rate  =  m_pcm_param.nSamplingRate;
-                    pcm_cfg.buffer_size =  input_buffer_size;
-                    pcm_cfg.buffer_count =  m_inp_current_buf_count;
-                    DEBUG_PRINT("pcm config %lu %lu\n",m_pcm_param.nChannels,
-				m_pcm_param.nSamplingRate);
-
-                    if (ioctl(m_drv_fd, AUDIO_SET_CONFIG, &pcm_cfg) == -1)
-                    {
-                        DEBUG_PRINT_ERROR("ioctl AUDIO_SET_CONFIG, errno[%d]\n",
-						errno);
-                    }
-                }
-                if(ioctl(m_drv_fd, AUDIO_START, 0) == -1)
-                {
-                    DEBUG_PRINT_ERROR("ioctl AUDIO_START failed, errno[%d]\n",
-					errno);
-                    m_state = OMX_StateInvalid;
-                    this->m_cb.EventHandler(&this->m_cmp, this->m_app_data,
-                                        OMX_EventError, OMX_ErrorInvalidState,
-                                        0, NULL );
-                    eRet = OMX_ErrorInvalidState;
-                }
-                DEBUG_PRINT("SCP-->Idle to Executing\n");
-                nState = eState;
-                frameduration = (1024*1000000)/m_aac_param.nSampleRate;
-            } else if (eState == OMX_StateIdle)
-            {
-                DEBUG_PRINT("OMXCORE-SM: Idle-->Idle\n");
-                m_cb.EventHandler(&this->m_cmp,
-                                  this->m_app_data,
-                                  OMX_EventError,
-                                  OMX_ErrorSameState,
-                                  0, NULL );
-                eRet = OMX_ErrorSameState;
-            } else if (eState == OMX_StateWaitForResources)
-            {
-                DEBUG_PRINT("OMXCORE-SM: Idle-->WaitForResources\n");
-                this->m_cb.EventHandler(&this->m_cmp, this->m_app_data,
-                                        OMX_EventError,
-                                        OMX_ErrorIncorrectStateTransition,
-                                        0, NULL );
-                eRet = OMX_ErrorIncorrectStateTransition;
-            }
-
-            else if (eState == OMX_StatePause)
-            {
-                DEBUG_PRINT("OMXCORE-SM: Idle-->Pause\n");
-            }
-
-            else if (eState == OMX_StateInvalid)
-            {
-                DEBUG_PRINT("OMXCORE-SM: Idle-->Invalid\n");
-                m_state = OMX_StateInvalid;
-                this->m_cb.EventHandler(&this->m_cmp,
-                                        this->m_app_data,
-                                        OMX_EventError,
-                                        OMX_ErrorInvalidState,
-                                        0, NULL );
-                eRet = OMX_ErrorInvalidState;
-            } else
-            {
-                DEBUG_PRINT_ERROR("SCP--> Idle to %d Not Handled\n",eState);
-                eRet = OMX_ErrorBadParameter;
-            }
+            drv_aac_enc_config.stream_format = AUDIO_AAC_FORMAT_RAW;
+            DEBUG_PRINT("Setting AUDIO_AAC_FORMAT_RAW\n");
+            break;
         }
+        default:
+            break;
+    }
+    DEBUG_PRINT("Stream format = %d\n", drv_aac_enc_config.stream_format);
+    if (ioctl(m_drv_fd, AUDIO_SET_AAC_ENC_CONFIG, &drv_aac_enc_config) == -1)
+    {
+        DEBUG_PRINT_ERROR("ioctl AUDIO_SET_AAC_ENC_CONFIG failed, "
+                          "errno[%d]\n", errno);
+    }
+    if (ioctl(m_drv_fd, AUDIO_GET_AAC_CONFIG, &drv_aac_config) == -1)
+    {
+        DEBUG_PRINT_ERROR("ioctl AUDIO_GET_AAC_CONFIG failed, "
+                          "errno[%d]\n", errno);
+    }
 
-        /******************************/
-        /* Current State is Executing */
-        /******************************/
-        else if (OMX_StateExecuting == m_state)
-        {
-            if (OMX_StateIdle == eState)
-            {
-                DEBUG_PRINT("SCP-->Executing to Idle \n");
-                if(pcm_input)
-                    execute_omx_flush(-1,false);
-                else
-                    execute_omx_flush(1,false);
-
-
-            } else if (OMX_StatePause == eState)
-            {
-                DEBUG_DETAIL("*************************\n");
-                DEBUG_PRINT("SCP-->RXED PAUSE STATE\n");
-                DEBUG_DETAIL("*************************\n");
-                //ioctl(m_drv_fd, AUDIO_PAUSE, 0);
-            } else if (eState == OMX_StateLoaded)
-            {
-                DEBUG_PRINT("\n OMXCORE-SM: Executing --> Loaded \n");
-                this->m_cb.EventHandler(&this->m_cmp, this->m_app_data,
-                                        OMX_EventError,
-                                        OMX_ErrorIncorrectStateTransition,
-                                        0, NULL );
-                eRet = OMX_ErrorIncorrectStateTransition;
-            } else if (eState == OMX_StateWaitForResources)
-            {
-                DEBUG_PRINT("\n OMXCORE-SM: Executing --> WaitForResources \n");
-                this->m_cb.EventHandler(&this->m_cmp, this->m_app_data,
-                                        OMX_EventError,
-                                        OMX_ErrorIncorrectStateTransition,
-                                        0, NULL );
-                eRet = OMX_ErrorIncorrectStateTransition;
-            } else if (eState == OMX_StateExecuting)
-            {
-                DEBUG_PRINT("\n OMXCORE-SM: Executing --> Executing \n");
-                this->m_cb.EventHandler(&this->m_cmp, this->m_app_data,
-                                        OMX_EventError, OMX_ErrorSameState,
-                                        0, NULL );
-                eRet = OMX_ErrorSameState;
-            } else if (eState == OMX_StateInvalid)
-            {
-                DEBUG_PRINT("\n OMXCORE-SM: Executing --> Invalid \n");
-                m_state = OMX_StateInvalid;
-                this->m_cb.EventHandler(&this->m_cmp, this->m_app_data,
-                                        OMX_EventError, OMX_ErrorInvalidState,
-                                        0, NULL );
-                eRet = OMX_ErrorInvalidState;
-            } else
-            {
-                DEBUG_PRINT_ERROR("SCP--> Executing to %d Not Handled\n",
-				eState);
-                eRet = OMX_ErrorBadParameter;
-            }
-        }
-        /***************************/
-        /* Current State is Pause  */
-        /***************************/
-        else if (OMX_StatePause == m_state)
-        {
-            if( (eState == OMX_StateExecuting || eState == OMX_StateIdle) )
-            {
-                pthread_mutex_lock(&m_out_th_lock_1);
-                if(is_out_th_sleep)
-                {
-                    DEBUG_DETAIL("PE: WAKING UP OUT THREAD\n");
-                    is_out_th_sleep = false;
-                    out_th_wakeup();
-                }
-                pthread_mutex_unlock(&m_out_th_lock_1);
-            }
-            if ( OMX_StateExecuting == eState )
-            {
-                nState = eState;
-            } else if ( OMX_StateIdle == eState )
-            {
-                DEBUG_PRINT("SCP-->Paused to Idle \n");
-                DEBUG_PRINT ("\n Internal flush issued");
-                pthread_mutex_lock(&m_flush_lock);
-                m_flush_cnt = 2;
-                pthread_mutex_unlock(&m_flush_lock);
-                if(pcm_input)
-                    execute_omx_flush(-1,false);
-                else
-                    execute_omx_flush(1,false);
-
-            } else if ( eState == OMX_StateLoaded )
-            {
-                DEBUG_PRINT("\n Pause --> loaded \n");
-                this->m_cb.EventHandler(&this->m_cmp, this->m_app_data,
-                                        OMX_EventError,
-					OMX_ErrorIncorrectStateTransition,
-                                        0, NULL );
-                eRet = OMX_ErrorIncorrectStateTransition;
-            } else if (eState == OMX_StateWaitForResources)
-            {
-                DEBUG_PRINT("\n Pause --> WaitForResources \n");
-                this->m_cb.EventHandler(&this->m_cmp, this->m_app_data,
-                                        OMX_EventError,
-					OMX_ErrorIncorrectStateTransition,
-                                        0, NULL );
-                eRet = OMX_ErrorIncorrectStateTransition;
-            } else if (eState == OMX_StatePause)
-            {
-                DEBUG_PRINT("\n Pause --> Pause \n");
-                this->m_cb.EventHandler(&this->m_cmp, this->m_app_data,
-                                        OMX_EventError, OMX_ErrorSameState,
-                                        0, NULL );
-                eRet = OMX_ErrorSameState;
-            } else if (eState == OMX_StateInvalid)
-            {
-                DEBUG_PRINT("\n Pause --> Invalid \n");
-                m_state = OMX_StateInvalid;
-                this->m_cb.EventHandler(&this->m_cmp, this->m_app_data,
-                                        OMX_EventError, OMX_ErrorInvalidState,
-                                        0, NULL );
-                eRet = OMX_ErrorInvalidState;
-            } else
-            {
-                DEBUG_PRINT("SCP-->Paused to %d Not Handled\n",eState);
-                eRet = OMX_ErrorBadParameter;
-            }
-        }
-        /**************************************/
-        /* Current State is WaitForResources  */
-        /**************************************/
-        else if (m_state == OMX_StateWaitForResources)
-        {
-            if (eState == OMX_StateLoaded)
-            {
-                DEBUG_PRINT("OMXCORE-SM: WaitForResources-->Loaded\n");
-            } else if (eState == OMX_StateWaitForResources)
-            {
-                DEBUG_PRINT("OMXCORE-SM: \
-				WaitForResources-->WaitForResources\n");
-                this->m_cb.EventHandler(&this->m_cmp, this->m_app_data,
-                                        OMX_EventError, OMX_ErrorSameState,
-                                        0, NULL );
-                eRet = OMX_ErrorSameState;
-            } else if (eState == OMX_StateExecuting)
-            {
-                DEBUG_PRINT("OMXCORE-SM: WaitForResources-->Executing\n");
-                this->m_cb.EventHandler(&this->m_cmp, this->m_app_data,
-                                        OMX_EventError,
-                                        OMX_ErrorIncorrectStateTransition,
-                                        0, NULL );
-                eRet = OMX_ErrorIncorrectStateTransition;
-            } else if (eState == OMX_StatePause)
-            {
-                DEBUG_PRINT("OMXCORE-SM: WaitForResources-->Pause\n");
-                this->m_cb.EventHandler(&this->m_cmp, this->m_app_data,
-                                        OMX_EventError,
-                                        OMX_ErrorIncorrectStateTransition,
-                                        0, NULL );
-                eRet = OMX_ErrorIncorrectStateTransition;
-            } else if (eState == OMX_StateInvalid)
-            {
-                DEBUG_PRINT("OMXCORE-SM: WaitForResources-->Invalid\n");
-                m_state = OMX_StateInvalid;
-                this->m_cb.EventHandler(&this->m_cmp, this->m_app_data,
-                                        OMX_EventError,
-                                        OMX_ErrorInvalidState,
-                                        0, NULL );
-                eRet = OMX_ErrorInvalidState;
-            } else
-            {
-                DEBUG_PRINT_ERROR("SCP--> %d to %d(Not Handled)\n",
-					m_state,eState);
-                eRet = OMX_ErrorBadParameter;
-            }
-        }
-        /****************************/
-        /* Current State is Invalid */
-        /****************************/
-        else if (m_state == OMX_StateInvalid)
-        {
-            if (OMX_StateLoaded == eState || OMX_StateWaitForResources == eState
-                || OMX_StateIdle == eState || OMX_StateExecuting == eState
-                || OMX_StatePause == eState || OMX_StateInvalid == eState)
-            {
-                DEBUG_PRINT("OMXCORE-SM: Invalid-->Loaded/Idle/Executing"
-                            "/Pause/Invalid/WaitForResources\n");
-                m_state = OMX_StateInvalid;
-                this->m_cb.EventHandler(&this->m_cmp, this->m_app_data,
-                                        OMX_EventError, OMX_ErrorInvalidState,
-                                        0, NULL );
-                eRet = OMX_ErrorInvalidState;
-            }
-        } else
-        {
-            DEBUG_PRINT_ERROR("OMXCORE-SM: %d --> %d(Not Handled)\n",\
-                              m_state,eState);
-            eRet = OMX_ErrorBadParameter;
-        }
-    } else if (OMX_CommandFlush == cmd)
-    {
-        DEBUG_DETAIL("*************************\n");
-        DEBUG_PRINT("SCP-->RXED FLUSH COMMAND port=%lu\n",param1);
-        DEBUG_DETAIL("*************************\n");
-        bFlag = 0;
-        if ( param1 == OMX_CORE_INPUT_PORT_INDEX ||
-             param1 == OMX_CORE_OUTPUT_PORT_INDEX ||
-            (signed)param1 == -1 )
-        {
-            execute_omx_flush(param1);
-        } else
-        {
-            eRet = OMX_ErrorBadPortIndex;
-            m_cb.EventHandler(&m_cmp, m_app_data, OMX_EventError,
-                OMX_CommandFlush, OMX_ErrorBadPortIndex, NULL );
-        }
-    } else if ( cmd == OMX_CommandPortDisable )
+    /* Other members of drv_aac_config are not used, so not setting them */
+    drv_aac_config.sbr_on_flag = 0;
+    drv_aac_config.sbr_ps_on_flag = 0;
+    switch(m_aac_param.eAACProfile)
     {
-        bFlag = 0;
-        if ( param1 == OMX_CORE_INPUT_PORT_INDEX || param1 == OMX_ALL )
+        case OMX_AUDIO_AACObjectLC:
         {
-            DEBUG_PRINT("SCP: Disabling Input port Indx\n");
-            m_inp_bEnabled = OMX_FALSE;
-            if ( (m_state == OMX_StateLoaded || m_state == OMX_StateIdle)
-                && release_done(0) )
-            {
-                DEBUG_PRINT("send_command_proxy:OMX_CommandPortDisable:\
-                            OMX_CORE_INPUT_PORT_INDEX:release_done \n");
-                DEBUG_PRINT("************* OMX_CommandPortDisable:\
-                            m_inp_bEnabled=%d********\n",m_inp_bEnabled);
-
-                post_command(OMX_CommandPortDisable,
-                             OMX_CORE_INPUT_PORT_INDEX,
-                             OMX_COMPONENT_GENERATE_EVENT);
-            }
-
-            else
-            {
-                if (m_state == OMX_StatePause ||m_state == OMX_StateExecuting)
-                {
-                    DEBUG_PRINT("SCP: execute_omx_flush in Disable in "\
-                                " param1=%lu m_state=%d \n",param1, m_state);
-                    execute_omx_flush(param1);
-                }
-                DEBUG_PRINT("send_command_proxy:OMX_CommandPortDisable:\
-                            OMX_CORE_INPUT_PORT_INDEX \n");
-                BITMASK_SET(&m_flags, OMX_COMPONENT_INPUT_DISABLE_PENDING);
-                // Skip the event notification
-
-            }
-
+            DEBUG_PRINT("AAC_Profile: OMX_AUDIO_AACObjectLC\n");
+            drv_aac_config.sbr_on_flag = 0;
+            drv_aac_config.sbr_ps_on_flag = 0;
+            break;
         }
-        if (param1 == OMX_CORE_OUTPUT_PORT_INDEX || param1 == OMX_ALL)
-        {
-
-            DEBUG_PRINT("SCP: Disabling Output port Indx\n");
-            m_out_bEnabled = OMX_FALSE;
-            if ((m_state == OMX_StateLoaded || m_state == OMX_StateIdle)
-                && release_done(1))
-            {
-                DEBUG_PRINT("send_command_proxy:OMX_CommandPortDisable:\
-                            OMX_CORE_OUTPUT_PORT_INDEX:release_done \n");
-                DEBUG_PRINT("************* OMX_CommandPortDisable:\
-                            m_out_bEnabled=%d********\n",m_inp_bEnabled);
-
-                post_command(OMX_CommandPortDisable,
-                             OMX_CORE_OUTPUT_PORT_INDEX,
-                             OMX_COMPONENT_GENERATE_EVENT);
-            } else
-            {
-                if (m_state == OMX_StatePause ||m_state == OMX_StateExecuting)
-                {
-                    DEBUG_PRINT("SCP: execute_omx_flush in Disable out "\
-                                "param1=%lu m_state=%d \n",param1, m_state);
-                    execute_omx_flush(param1);
-                }
-                BITMASK_SET(&m_flags, OMX_COMPONENT_OUTPUT_DISABLE_PENDING);
-                // Skip the event notification
-
-            }
-        } else
+        case OMX_AUDIO_AACObjectHE:
         {
-            DEBUG_PRINT_ERROR("OMX_CommandPortDisable: disable wrong port ID");
+            DEBUG_PRINT("AAC_Profile: OMX_AUDIO_AACObjectHE\n");
+            drv_aac_config.sbr_on_flag = 1;
+            drv_aac_config.sbr_ps_on_flag = 0;
+            break;
         }
-
-    } else if (cmd == OMX_CommandPortEnable)
-    {
-        bFlag = 0;
-        if (param1 == OMX_CORE_INPUT_PORT_INDEX  || param1 == OMX_ALL)
+        case OMX_AUDIO_AACObjectHE_PS:
         {
-            m_inp_bEnabled = OMX_TRUE;
-            DEBUG_PRINT("SCP: Enabling Input port Indx\n");
-            if ((m_state == OMX_StateLoaded
-                 && !BITMASK_PRESENT(&m_flags,OMX_COMPONENT_IDLE_PENDING))
-                || (m_state == OMX_StateWaitForResources)
-                || (m_inp_bPopulated == OMX_TRUE))
-            {
-                post_command(OMX_CommandPortEnable,
-                             OMX_CORE_INPUT_PORT_INDEX,
-                             OMX_COMPONENT_GENERATE_EVENT);
-
-
-            } else
-            {
-                BITMASK_SET(&m_flags, OMX_COMPONENT_INPUT_ENABLE_PENDING);
-                // Skip the event notification
-
-            }
+            DEBUG_PRINT("AAC_Profile: OMX_AUDIO_AACObjectHE_PS\n");
+            drv_aac_config.sbr_on_flag = 1;
+            drv_aac_config.sbr_ps_on_flag = 1;
+            break;
         }
-
-        if (param1 == OMX_CORE_OUTPUT_PORT_INDEX || param1 == OMX_ALL)
-        {
-            DEBUG_PRINT("SCP: Enabling Output port Indx\n");
-            m_out_bEnabled = OMX_TRUE;
-            if ((m_state == OMX_StateLoaded
-                 && !BITMASK_PRESENT(&m_flags,OMX_COMPONENT_IDLE_PENDING))
-                || (m_state == OMX_StateWaitForResources)
-                || (m_out_bPopulated == OMX_TRUE))
-            {
-                post_command(OMX_CommandPortEnable,
-                             OMX_CORE_OUTPUT_PORT_INDEX,
-                             OMX_COMPONENT_GENERATE_EVENT);
-            } else
-            {
-                DEBUG_PRINT("send_command_proxy:OMX_CommandPortEnable:\
-                            OMX_CORE_OUTPUT_PORT_INDEX:release_done \n");
-                BITMASK_SET(&m_flags, OMX_COMPONENT_OUTPUT_ENABLE_PENDING);
-                // Skip the event notification
-
-            }
-            pthread_mutex_lock(&m_in_th_lock_1);
-            if(is_in_th_sleep)
-            {
-                    is_in_th_sleep = false;
-                    DEBUG_DETAIL("SCP:WAKING UP IN THREADS\n");
-                    in_th_wakeup();
-            }
-            pthread_mutex_unlock(&m_in_th_lock_1);
-            pthread_mutex_lock(&m_out_th_lock_1);
-            if (is_out_th_sleep)
-            {
-                is_out_th_sleep = false;
-                DEBUG_PRINT("SCP:WAKING OUT THR, OMX_CommandPortEnable\n");
-                out_th_wakeup();
-            }
-            pthread_mutex_unlock(&m_out_th_lock_1);
-        } else
+        default:
         {
-            DEBUG_PRINT_ERROR("OMX_CommandPortEnable: disable wrong port ID");
+            DEBUG_PRINT_ERROR("Unsupported AAC Profile Type = %d\n",
+                              m_aac_param.eAACProfile);
+            break;
         }
-
-    } else
-    {
-        DEBUG_PRINT_ERROR("SCP-->ERROR: Invali Command [%d]\n",cmd);
-        eRet = OMX_ErrorNotImplemented;
     }
-    DEBUG_PRINT("posting sem_States\n");
-    sem_post (&sem_States);
-    if (eRet == OMX_ErrorNone && bFlag)
+    DEBUG_PRINT("sbr_flag = %d, sbr_ps_flag = %d\n",
+                drv_aac_config.sbr_on_flag,
+                drv_aac_config.sbr_ps_on_flag);
+    if (ioctl(m_drv_fd, AUDIO_SET_AAC_CONFIG, &drv_aac_config) == -1)
     {
-        post_command(cmd,eState,OMX_COMPONENT_GENERATE_EVENT);
+        DEBUG_PRINT_ERROR("ioctl AUDIO_SET_AAC_CONFIG failed, "
+                          "errno[%d]\n", errno);
     }
-    return eRet;
+    frameduration = (1024*1000000)/m_aac_param.nSampleRate;
+}
+
+/**
+ @brief codec hook of the shared state machine, the tunnel less PCM
+  input also takes the input buffer geometry
+*/
+void omx_aac_aenc::configure_pcm(struct msm_audio_config *pcm_cfg)
+{
+    pcm_cfg->buffer_size = input_buffer_size;
+    pcm_cfg->buffer_count = m_inp_current_buf_count;
+}
+
+/**
+ @brief codec hook of the shared state machine, restarts the running
+  time stamp once the encoder is stopped
+*/
+void omx_aac_aenc::reset_encoder()
+{
+    ts = 0;
+    frameduration = 0;
 }
 
 /*=============================================================================
@@ -2273,6 +1619,8 @@ bool omx_aac_aenc::execute_output_omx_flush()
     unsigned      tot_qsize=0;                   // qsize
 
     DEBUG_PRINT("Execute_omx_flush on output port");
+    // Read ahead data is dropped, time stamps still advance over it
+    ts += (OMX_U64)frameduration * aenc_pipe_flush(&m_pipe);
 
     pthread_mutex_lock(&m_outputlock);
     do
@@ -2982,6 +2330,12 @@ OMX_ERRORTYPE  omx_aac_aenc::set_parameter(OMX_IN OMX_HANDLETYPE     hComp,
                 }
                 break;
             }
+        case AENC_SHM_INDEX:
+            {
+                eRet = core::set_shared_buffer(this,
+                                   (struct aenc_shm_param *) paramData);
+                break;
+            }
         case OMX_IndexParamSuspensionPolicy:
             {
                 eRet = OMX_ErrorNotImplemented;
@@ -3216,6 +2570,10 @@ OMX_ERRORTYPE  omx_aac_aenc::get_extension_index(
       DEBUG_PRINT("Extension index type - %d\n", *indexType);
 
   }
+  else if(strcmp(paramName, AENC_SHM_EXTENSION) == 0)
+  {
+      *indexType = AENC_SHM_INDEX;
+  }
   else
   {
       return OMX_ErrorBadParameter;
@@ -3284,12 +2642,13 @@ OMX_ERRORTYPE  omx_aac_aenc::component_tunnel_request
     return OMX_ErrorNotImplemented;
 }
 
+// AllocateBuffer  -- API Call
 /* ======================================================================
 FUNCTION
-  omx_aac_aenc::AllocateInputBuffer
+  omx_aac_aenc::AllocateBuffer
 
 DESCRIPTION
-  Helper function for allocate buffer in the input pin
+  Returns zero if all the buffers released..
 
 PARAMETERS
   None.
@@ -3298,7 +2657,7 @@ RETURN VALUE
   true/false
 
 ========================================================================== */
-OMX_ERRORTYPE  omx_aac_aenc::allocate_input_buffer
+OMX_ERRORTYPE  omx_aac_aenc::allocate_buffer
 (
     OMX_IN OMX_HANDLETYPE                hComp,
     OMX_INOUT OMX_BUFFERHEADERTYPE** bufferHdr,
@@ -3306,213 +2665,8 @@ OMX_ERRORTYPE  omx_aac_aenc::allocate_input_buffer
     OMX_IN OMX_PTR                     appData,
     OMX_IN OMX_U32                       bytes)
 {
-    OMX_ERRORTYPE         eRet = OMX_ErrorNone;
-    OMX_BUFFERHEADERTYPE  *bufHdr;
-    unsigned              nBufSize = MAX(bytes, input_buffer_size);
-    char                  *buf_ptr;
-  if(m_inp_current_buf_count < m_inp_act_buf_count)
-  {
-    buf_ptr = (char *) calloc((nBufSize + \
-		sizeof(OMX_BUFFERHEADERTYPE)+sizeof(META_IN)) , 1);
-
-    if(hComp == NULL)
-    {
-        port = 0;
-        DEBUG_PRINT_ERROR("Returning OMX_ErrorBadParameter\n");
-        free(buf_ptr);
-        return OMX_ErrorBadParameter;
-    }
-    if (buf_ptr != NULL)
-    {
-        bufHdr = (OMX_BUFFERHEADERTYPE *) buf_ptr;
-        *bufferHdr = bufHdr;
-        memset(bufHdr,0,sizeof(OMX_BUFFERHEADERTYPE));
-
-        bufHdr->pBuffer           = (OMX_U8 *)((buf_ptr) + sizeof(META_IN)+
-                                               sizeof(OMX_BUFFERHEADERTYPE));
-        bufHdr->nSize             = sizeof(OMX_BUFFERHEADERTYPE);
-        bufHdr->nVersion.nVersion = OMX_SPEC_VERSION;
-        bufHdr->nAllocLen         = nBufSize;
-        bufHdr->pAppPrivate       = appData;
-        bufHdr->nInputPortIndex   = OMX_CORE_INPUT_PORT_INDEX;
-        m_input_buf_hdrs.insert(bufHdr, NULL);
-
-        m_inp_current_buf_count++;
-        DEBUG_PRINT("AIB:bufHdr %p bufHdr->pBuffer %p m_inp_buf_cnt=%d \
-		bytes=%lu",bufHdr, bufHdr->pBuffer,m_inp_current_buf_count,
-		bytes);
-
-    } else
-    {
-        DEBUG_PRINT("Input buffer memory allocation failed 1 \n");
-        eRet =  OMX_ErrorInsufficientResources;
-    }
-  }
-  else
-  {
-     DEBUG_PRINT("Input buffer memory allocation failed 2\n");
-    eRet =  OMX_ErrorInsufficientResources;
-  }
-    return eRet;
-}
-
-OMX_ERRORTYPE  omx_aac_aenc::allocate_output_buffer
-(
-    OMX_IN OMX_HANDLETYPE                hComp,
-    OMX_INOUT OMX_BUFFERHEADERTYPE** bufferHdr,
-    OMX_IN OMX_U32                        port,
-    OMX_IN OMX_PTR                     appData,
-    OMX_IN OMX_U32                       bytes)
-{
-    OMX_ERRORTYPE         eRet = OMX_ErrorNone;
-    OMX_BUFFERHEADERTYPE  *bufHdr;
-    unsigned                   nBufSize = MAX(bytes,output_buffer_size);
-    char                  *buf_ptr;
-
-    if(hComp == NULL)
-    {
-        port = 0;
-        DEBUG_PRINT_ERROR("Returning OMX_ErrorBadParameter\n");
-        return OMX_ErrorBadParameter;
-    }
-    if (m_out_current_buf_count < m_out_act_buf_count)
-    {
-        buf_ptr = (char *) calloc( (nBufSize + sizeof(OMX_BUFFERHEADERTYPE)),1);
-
-        if (buf_ptr != NULL)
-        {
-            bufHdr = (OMX_BUFFERHEADERTYPE *) buf_ptr;
-            *bufferHdr = bufHdr;
-            memset(bufHdr,0,sizeof(OMX_BUFFERHEADERTYPE));
-
-            bufHdr->pBuffer           = (OMX_U8 *)((buf_ptr)+
-					sizeof(OMX_BUFFERHEADERTYPE));
-
-            bufHdr->nSize             = sizeof(OMX_BUFFERHEADERTYPE);
-            bufHdr->nVersion.nVersion = OMX_SPEC_VERSION;
-            bufHdr->nAllocLen         = nBufSize;
-            bufHdr->pAppPrivate       = appData;
-            bufHdr->nOutputPortIndex   = OMX_CORE_OUTPUT_PORT_INDEX;
-            m_output_buf_hdrs.insert(bufHdr, NULL);
-            m_out_current_buf_count++;
-            DEBUG_PRINT("AOB::bufHdr %p bufHdr->pBuffer %p m_out_buf_cnt=%d "\
-                        "bytes=%lu",bufHdr, bufHdr->pBuffer,\
-                        m_out_current_buf_count, bytes);
-        } else
-        {
-            DEBUG_PRINT("Output buffer memory allocation failed 1 \n");
-            eRet =  OMX_ErrorInsufficientResources;
-        }
-    } else
-    {
-        DEBUG_PRINT("Output buffer memory allocation failed\n");
-        eRet =  OMX_ErrorInsufficientResources;
-    }
-    return eRet;
-}
-
-
-// AllocateBuffer  -- API Call
-/* ======================================================================
-FUNCTION
-  omx_aac_aenc::AllocateBuffer
-
-DESCRIPTION
-  Returns zero if all the buffers released..
-
-PARAMETERS
-  None.
-
-RETURN VALUE
-  true/false
-
-========================================================================== */
-OMX_ERRORTYPE  omx_aac_aenc::allocate_buffer
-(
-    OMX_IN OMX_HANDLETYPE                hComp,
-    OMX_INOUT OMX_BUFFERHEADERTYPE** bufferHdr,
-    OMX_IN OMX_U32                        port,
-    OMX_IN OMX_PTR                     appData,
-    OMX_IN OMX_U32                       bytes)
-{
-
-    OMX_ERRORTYPE eRet = OMX_ErrorNone;          // OMX return type
-
-    if (m_state == OMX_StateInvalid)
-    {
-        DEBUG_PRINT_ERROR("Allocate Buf in Invalid State\n");
-        return OMX_ErrorInvalidState;
-    }
-    // What if the client calls again.
-    if (OMX_CORE_INPUT_PORT_INDEX == port)
-    {
-        eRet = allocate_input_buffer(hComp,bufferHdr,port,appData,bytes);
-    } else if (OMX_CORE_OUTPUT_PORT_INDEX == port)
-    {
-        eRet = allocate_output_buffer(hComp,bufferHdr,port,appData,bytes);
-    } else
-    {
-        DEBUG_PRINT_ERROR("Error: Invalid Port Index received %d\n",
-                          (int)port);
-        eRet = OMX_ErrorBadPortIndex;
-    }
-
-    if (eRet == OMX_ErrorNone)
-    {
-        DEBUG_PRINT("allocate_buffer:  before allocate_done \n");
-        if (allocate_done())
-        {
-            DEBUG_PRINT("allocate_buffer:  after allocate_done \n");
-            if (BITMASK_PRESENT(&m_flags,OMX_COMPONENT_IDLE_PENDING))
-            {
-                BITMASK_CLEAR(&m_flags, OMX_COMPONENT_IDLE_PENDING);
-                post_command(OMX_CommandStateSet,OMX_StateIdle,
-                             OMX_COMPONENT_GENERATE_EVENT);
-                DEBUG_PRINT("allocate_buffer:  post idle transition event \n");
-            }
-            DEBUG_PRINT("allocate_buffer:  complete \n");
-        }
-        if (port == OMX_CORE_INPUT_PORT_INDEX && m_inp_bPopulated)
-        {
-            if (BITMASK_PRESENT(&m_flags,OMX_COMPONENT_INPUT_ENABLE_PENDING))
-            {
-                BITMASK_CLEAR((&m_flags),OMX_COMPONENT_INPUT_ENABLE_PENDING);
-                post_command(OMX_CommandPortEnable, OMX_CORE_INPUT_PORT_INDEX,
-                             OMX_COMPONENT_GENERATE_EVENT);
-            }
-        }
-        if (port == OMX_CORE_OUTPUT_PORT_INDEX && m_out_bPopulated)
-        {
-            if (BITMASK_PRESENT(&m_flags,OMX_COMPONENT_OUTPUT_ENABLE_PENDING))
-            {
-                BITMASK_CLEAR((&m_flags),OMX_COMPONENT_OUTPUT_ENABLE_PENDING);
-                m_out_bEnabled = OMX_TRUE;
-
-                DEBUG_PRINT("AllocBuf-->is_out_th_sleep=%d\n",is_out_th_sleep);
-                pthread_mutex_lock(&m_out_th_lock_1);
-                if (is_out_th_sleep)
-                {
-                    is_out_th_sleep = false;
-                    DEBUG_DETAIL("AllocBuf:WAKING UP OUT THREADS\n");
-                    out_th_wakeup();
-                }
-                pthread_mutex_unlock(&m_out_th_lock_1);
-                pthread_mutex_lock(&m_in_th_lock_1);
-                if(is_in_th_sleep)
-                {
-                   is_in_th_sleep = false;
-                   DEBUG_DETAIL("AB:WAKING UP IN THREADS\n");
-                   in_th_wakeup();
-                }
-                pthread_mutex_unlock(&m_in_th_lock_1);
-                post_command(OMX_CommandPortEnable, OMX_CORE_OUTPUT_PORT_INDEX,
-                             OMX_COMPONENT_GENERATE_EVENT);
-            }
-        }
-    }
-    DEBUG_PRINT("Allocate Buffer exit with ret Code %d\n", eRet);
-    return eRet;
-}
+    return core::allocate_buffer(this, hComp, bufferHdr, port, appData, bytes);
+}
 
 /*=============================================================================
 FUNCTION:
@@ -3547,288 +2701,8 @@ OMX_ERRORTYPE  omx_aac_aenc::use_buffer
     OMX_IN OMX_U32                   bytes,
     OMX_IN OMX_U8*                   buffer)
 {
-    OMX_ERRORTYPE eRet = OMX_ErrorNone;
-
-    if (OMX_CORE_INPUT_PORT_INDEX == port)
-    {
-        eRet = use_input_buffer(hComp,bufferHdr,port,appData,bytes,buffer);
-
-    } else if (OMX_CORE_OUTPUT_PORT_INDEX == port)
-    {
-        eRet = use_output_buffer(hComp,bufferHdr,port,appData,bytes,buffer);
-    } else
-    {
-        DEBUG_PRINT_ERROR("Error: Invalid Port Index received %d\n",(int)port);
-        eRet = OMX_ErrorBadPortIndex;
-    }
-
-    if (eRet == OMX_ErrorNone)
-    {
-        DEBUG_PRINT("Checking for Output Allocate buffer Done");
-        if (allocate_done())
-        {
-            if (BITMASK_PRESENT(&m_flags,OMX_COMPONENT_IDLE_PENDING))
-            {
-                BITMASK_CLEAR(&m_flags, OMX_COMPONENT_IDLE_PENDING);
-                post_command(OMX_CommandStateSet,OMX_StateIdle,
-                             OMX_COMPONENT_GENERATE_EVENT);
-            }
-        }
-        if (port == OMX_CORE_INPUT_PORT_INDEX && m_inp_bPopulated)
-        {
-            if (BITMASK_PRESENT(&m_flags,OMX_COMPONENT_INPUT_ENABLE_PENDING))
-            {
-                BITMASK_CLEAR((&m_flags),OMX_COMPONENT_INPUT_ENABLE_PENDING);
-                post_command(OMX_CommandPortEnable, OMX_CORE_INPUT_PORT_INDEX,
-                             OMX_COMPONENT_GENERATE_EVENT);
-
-            }
-        }
-        if (port == OMX_CORE_OUTPUT_PORT_INDEX && m_out_bPopulated)
-        {
-            if (BITMASK_PRESENT(&m_flags,OMX_COMPONENT_OUTPUT_ENABLE_PENDING))
-            {
-                BITMASK_CLEAR((&m_flags),OMX_COMPONENT_OUTPUT_ENABLE_PENDING);
-                post_command(OMX_CommandPortEnable, OMX_CORE_OUTPUT_PORT_INDEX,
-                             OMX_COMPONENT_GENERATE_EVENT);
-                pthread_mutex_lock(&m_out_th_lock_1);
-                if (is_out_th_sleep)
-                {
-                    is_out_th_sleep = false;
-                    DEBUG_DETAIL("UseBuf:WAKING UP OUT THREADS\n");
-                    out_th_wakeup();
-                }
-                pthread_mutex_unlock(&m_out_th_lock_1);
-                pthread_mutex_lock(&m_in_th_lock_1);
-                if(is_in_th_sleep)
-                {
-                   is_in_th_sleep = false;
-                   DEBUG_DETAIL("UB:WAKING UP IN THREADS\n");
-                   in_th_wakeup();
-                }
-                pthread_mutex_unlock(&m_in_th_lock_1);
-        }
-    }
-  }
-    DEBUG_PRINT("Use Buffer for port[%lu] eRet[%d]\n", port,eRet);
-    return eRet;
-}
-/*=============================================================================
-FUNCTION:
-  use_input_buffer
-
-DESCRIPTION:
-  Helper function for Use buffer in the input pin
-
-INPUT/OUTPUT PARAMETERS:
-  [INOUT] bufferHdr
-  [IN] hComp
-  [IN] port
-  [IN] appData
-  [IN] bytes
-  [IN] buffer
-
-RETURN VALUE:
-  OMX_ERRORTYPE
-
-Dependency:
-  None
-
-SIDE EFFECTS:
-  None
-=============================================================================*/
-OMX_ERRORTYPE  omx_aac_aenc::use_input_buffer
-(
-    OMX_IN OMX_HANDLETYPE            hComp,
-    OMX_INOUT OMX_BUFFERHEADERTYPE** bufferHdr,
-    OMX_IN OMX_U32                   port,
-    OMX_IN OMX_PTR                   appData,
-    OMX_IN OMX_U32                   bytes,
-    OMX_IN OMX_U8*                   buffer)
-{
-    OMX_ERRORTYPE         eRet = OMX_ErrorNone;
-    OMX_BUFFERHEADERTYPE  *bufHdr;
-    unsigned              nBufSize = MAX(bytes, input_buffer_size);
-    char                  *buf_ptr;
-
-    if(hComp == NULL)
-    {
-        port = 0;
-        DEBUG_PRINT_ERROR("Returning OMX_ErrorBadParameter\n");
-        return OMX_ErrorBadParameter;
-    }
-    if(bytes < input_buffer_size)
-    {
-      /* return if i\p buffer size provided by client
-       is less than min i\p buffer size supported by omx component*/
-      return OMX_ErrorInsufficientResources;
-    }
-    if (m_inp_current_buf_count < m_inp_act_buf_count)
-    {
-        buf_ptr = (char *) calloc(sizeof(OMX_BUFFERHEADERTYPE), 1);
-
-        if (buf_ptr != NULL)
-        {
-            bufHdr = (OMX_BUFFERHEADERTYPE *) buf_ptr;
-            *bufferHdr = bufHdr;
-            memset(bufHdr,0,sizeof(OMX_BUFFERHEADERTYPE));
-
-            bufHdr->pBuffer           = (OMX_U8 *)(buffer);
-            DEBUG_PRINT("use_input_buffer:bufHdr %p bufHdr->pBuffer %p \
-			bytes=%lu", bufHdr, bufHdr->pBuffer,bytes);
-            bufHdr->nSize             = sizeof(OMX_BUFFERHEADERTYPE);
-            bufHdr->nVersion.nVersion = OMX_SPEC_VERSION;
-            bufHdr->nAllocLen         = nBufSize;
-            input_buffer_size         = nBufSize;
-            bufHdr->pAppPrivate       = appData;
-            bufHdr->nInputPortIndex   = OMX_CORE_INPUT_PORT_INDEX;
-            bufHdr->nOffset           = 0;
-            m_input_buf_hdrs.insert(bufHdr, NULL);
-            m_inp_current_buf_count++;
-        } else
-        {
-            DEBUG_PRINT("Input buffer memory allocation failed 1 \n");
-            eRet =  OMX_ErrorInsufficientResources;
-        }
-    } else
-    {
-        DEBUG_PRINT("Input buffer memory allocation failed\n");
-        eRet =  OMX_ErrorInsufficientResources;
-    }
-    return eRet;
-}
-
-/*=============================================================================
-FUNCTION:
-  use_output_buffer
-
-DESCRIPTION:
-  Helper function for Use buffer in the output pin
-
-INPUT/OUTPUT PARAMETERS:
-  [INOUT] bufferHdr
-  [IN] hComp
-  [IN] port
-  [IN] appData
-  [IN] bytes
-  [IN] buffer
-
-RETURN VALUE:
-  OMX_ERRORTYPE
-
-Dependency:
-  None
-
-SIDE EFFECTS:
-  None
-=============================================================================*/
-OMX_ERRORTYPE  omx_aac_aenc::use_output_buffer
-(
-    OMX_IN OMX_HANDLETYPE            hComp,
-    OMX_INOUT OMX_BUFFERHEADERTYPE** bufferHdr,
-    OMX_IN OMX_U32                   port,
-    OMX_IN OMX_PTR                   appData,
-    OMX_IN OMX_U32                   bytes,
-    OMX_IN OMX_U8*                   buffer)
-{
-    OMX_ERRORTYPE         eRet = OMX_ErrorNone;
-    OMX_BUFFERHEADERTYPE  *bufHdr;
-    unsigned              nBufSize = MAX(bytes,output_buffer_size);
-    char                  *buf_ptr;
-
-    if(hComp == NULL)
-    {
-        port = 0;
-        DEBUG_PRINT_ERROR("Returning OMX_ErrorBadParameter\n");
-        return OMX_ErrorBadParameter;
-    }
-    if (bytes < output_buffer_size)
-    {
-        /* return if o\p buffer size provided by client
-        is less than min o\p buffer size supported by omx component*/
-        return OMX_ErrorInsufficientResources;
-    }
-
-    DEBUG_PRINT("Inside omx_aac_aenc::use_output_buffer");
-    if (m_out_current_buf_count < m_out_act_buf_count)
-    {
-
-        buf_ptr = (char *) calloc(sizeof(OMX_BUFFERHEADERTYPE), 1);
-
-        if (buf_ptr != NULL)
-        {
-            bufHdr = (OMX_BUFFERHEADERTYPE *) buf_ptr;
-            DEBUG_PRINT("BufHdr=%p buffer=%p\n",bufHdr,buffer);
-            *bufferHdr = bufHdr;
-            memset(bufHdr,0,sizeof(OMX_BUFFERHEADERTYPE));
-
-            bufHdr->pBuffer           = (OMX_U8 *)(buffer);
-            DEBUG_PRINT("use_output_buffer:bufHdr %p bufHdr->pBuffer %p \
-			len=%lu\n", bufHdr, bufHdr->pBuffer,bytes);
-            bufHdr->nSize             = sizeof(OMX_BUFFERHEADERTYPE);
-            bufHdr->nVersion.nVersion = OMX_SPEC_VERSION;
-            bufHdr->nAllocLen         = nBufSize;
-            output_buffer_size        = nBufSize;
-            bufHdr->pAppPrivate       = appData;
-            bufHdr->nOutputPortIndex   = OMX_CORE_OUTPUT_PORT_INDEX;
-            bufHdr->nOffset           = 0;
-            m_output_buf_hdrs.insert(bufHdr, NULL);
-            m_out_current_buf_count++;
-
-        } else
-        {
-            DEBUG_PRINT("Output buffer memory allocation failed\n");
-            eRet =  OMX_ErrorInsufficientResources;
-        }
-    } else
-    {
-        DEBUG_PRINT("Output buffer memory allocation failed 2\n");
-        eRet =  OMX_ErrorInsufficientResources;
-    }
-    return eRet;
-}
-/**
- @brief member function that searches for caller buffer
-
- @param buffer pointer to buffer header
- @return bool value indicating whether buffer is found
- */
-bool omx_aac_aenc::search_input_bufhdr(OMX_BUFFERHEADERTYPE *buffer)
-{
-
-    bool eRet = false;
-    OMX_BUFFERHEADERTYPE *temp = NULL;
-
-    //access only in IL client context
-    temp = m_input_buf_hdrs.find_ele(buffer);
-    if (buffer && temp)
-    {
-        DEBUG_DETAIL("search_input_bufhdr %x \n", buffer);
-        eRet = true;
-    }
-    return eRet;
-}
-
-/**
- @brief member function that searches for caller buffer
-
- @param buffer pointer to buffer header
- @return bool value indicating whether buffer is found
- */
-bool omx_aac_aenc::search_output_bufhdr(OMX_BUFFERHEADERTYPE *buffer)
-{
-
-    bool eRet = false;
-    OMX_BUFFERHEADERTYPE *temp = NULL;
-
-    //access only in IL client context
-    temp = m_output_buf_hdrs.find_ele(buffer);
-    if (buffer && temp)
-    {
-        DEBUG_DETAIL("search_output_bufhdr %x \n", buffer);
-        eRet = true;
-    }
-    return eRet;
+    return core::use_buffer(this, hComp, bufferHdr, port, appData, bytes,
+                            buffer);
 }
 
 // Free Buffer - API call
@@ -3847,136 +2721,7 @@ OMX_ERRORTYPE  omx_aac_aenc::free_buffer(OMX_IN OMX_HANDLETYPE         hComp,
                                           OMX_IN OMX_U32                 port,
                                           OMX_IN OMX_BUFFERHEADERTYPE* buffer)
 {
-    OMX_ERRORTYPE eRet = OMX_ErrorNone;
-
-    DEBUG_PRINT("Free_Buffer buf %p\n", buffer);
-    if(hComp == NULL)
-    {
-        DEBUG_PRINT_ERROR("Returning OMX_ErrorBadParameter\n");
-        return OMX_ErrorBadParameter;
-    }
-    if (m_state == OMX_StateIdle &&
-        (BITMASK_PRESENT(&m_flags ,OMX_COMPONENT_LOADING_PENDING)))
-    {
-        DEBUG_PRINT(" free buffer while Component in Loading pending\n");
-    } else if ((m_inp_bEnabled == OMX_FALSE &&
-		port == OMX_CORE_INPUT_PORT_INDEX)||
-               (m_out_bEnabled == OMX_FALSE &&
-		port == OMX_CORE_OUTPUT_PORT_INDEX))
-    {
-        DEBUG_PRINT("Free Buffer while port %lu disabled\n", port);
-    } else if (m_state == OMX_StateExecuting || m_state == OMX_StatePause)
-    {
-        DEBUG_PRINT("Invalid state to free buffer,ports need to be disabled:\
-                    OMX_ErrorPortUnpopulated\n");
-        post_command(OMX_EventError,
-                     OMX_ErrorPortUnpopulated,
-                     OMX_COMPONENT_GENERATE_EVENT);
-
-        return eRet;
-    } else
-    {
-        DEBUG_PRINT("free_buffer: Invalid state to free buffer,ports need to be\
-                    disabled:OMX_ErrorPortUnpopulated\n");
-        post_command(OMX_EventError,
-                     OMX_ErrorPortUnpopulated,
-                     OMX_COMPONENT_GENERATE_EVENT);
-    }
-    if (OMX_CORE_INPUT_PORT_INDEX == port)
-    {
-        if (m_inp_current_buf_count != 0)
-        {
-            m_inp_bPopulated = OMX_FALSE;
-            if (true == search_input_bufhdr(buffer))
-            {
-                /* Buffer exist */
-                //access only in IL client context
-                DEBUG_PRINT("Free_Buf:in_buffer[%p]\n",buffer);
-                m_input_buf_hdrs.erase(buffer);
-                free(buffer);
-                m_inp_current_buf_count--;
-            } else
-            {
-                DEBUG_PRINT_ERROR("Free_Buf:Error-->free_buffer, \
-                                  Invalid Input buffer header\n");
-                eRet = OMX_ErrorBadParameter;
-            }
-        } else
-        {
-            DEBUG_PRINT_ERROR("Error: free_buffer,Port Index calculation \
-                              came out Invalid\n");
-            eRet = OMX_ErrorBadPortIndex;
-        }
-        if (BITMASK_PRESENT((&m_flags),OMX_COMPONENT_INPUT_DISABLE_PENDING)
-            && release_done(0))
-        {
-            DEBUG_PRINT("INPUT PORT MOVING TO DISABLED STATE \n");
-            BITMASK_CLEAR((&m_flags),OMX_COMPONENT_INPUT_DISABLE_PENDING);
-            post_command(OMX_CommandPortDisable,
-                         OMX_CORE_INPUT_PORT_INDEX,
-                         OMX_COMPONENT_GENERATE_EVENT);
-        }
-    } else if (OMX_CORE_OUTPUT_PORT_INDEX == port)
-    {
-        if (m_out_current_buf_count != 0)
-        {
-            m_out_bPopulated = OMX_FALSE;
-            if (true == search_output_bufhdr(buffer))
-            {
-                /* Buffer exist */
-                //access only in IL client context
-                DEBUG_PRINT("Free_Buf:out_buffer[%p]\n",buffer);
-                m_output_buf_hdrs.erase(buffer);
-                free(buffer);
-                m_out_current_buf_count--;
-            } else
-            {
-                DEBUG_PRINT("Free_Buf:Error-->free_buffer , \
-                            Invalid Output buffer header\n");
-                eRet = OMX_ErrorBadParameter;
-            }
-        } else
-        {
-            eRet = OMX_ErrorBadPortIndex;
-        }
-
-        if (BITMASK_PRESENT((&m_flags),OMX_COMPONENT_OUTPUT_DISABLE_PENDING)
-            && release_done(1))
-        {
-            DEBUG_PRINT("OUTPUT PORT MOVING TO DISABLED STATE \n");
-            BITMASK_CLEAR((&m_flags),OMX_COMPONENT_OUTPUT_DISABLE_PENDING);
-            post_command(OMX_CommandPortDisable,
-                         OMX_CORE_OUTPUT_PORT_INDEX,
-                         OMX_COMPONENT_GENERATE_EVENT);
-
-        }
-    } else
-    {
-        eRet = OMX_ErrorBadPortIndex;
-    }
-    if ((OMX_ErrorNone == eRet) &&
-        (BITMASK_PRESENT(&m_flags ,OMX_COMPONENT_LOADING_PENDING)))
-    {
-        if (release_done(-1))
-        {
-            if(ioctl(m_drv_fd, AUDIO_STOP, 0) < 0)
-               DEBUG_PRINT_ERROR("AUDIO STOP in free buffer failed\n");
-            else
-               DEBUG_PRINT("AUDIO STOP in free buffer passed\n");
-
-            DEBUG_PRINT("Free_Buf: Free buffer\n");
-
-            // Send the callback now
-            BITMASK_CLEAR((&m_flags),OMX_COMPONENT_LOADING_PENDING);
-            DEBUG_PRINT("Before OMX_StateLoaded \
-			OMX_COMPONENT_GENERATE_EVENT\n");
-            post_command(OMX_CommandStateSet,
-                         OMX_StateLoaded,OMX_COMPONENT_GENERATE_EVENT);
-            DEBUG_PRINT("After OMX_StateLoaded OMX_COMPONENT_GENERATE_EVENT\n");
-
-        }
-    }
-    return eRet;
+    return core::free_buffer(this, hComp, port, buffer);
 }
 
 
@@ -4032,7 +2777,7 @@ OMX_ERRORTYPE  omx_aac_aenc::empty_this_buffer(
     }
     if (OMX_ErrorNone == eRet)
     {
-        if (search_input_bufhdr(buffer) == true)
+        if (core::search_input_bufhdr(this, buffer) == true)
         {
             post_input((unsigned)hComp,
                        (unsigned) buffer,OMX_COMPONENT_GENERATE_ETB);
@@ -4069,15 +2814,19 @@ OMX_ERRORTYPE  omx_aac_aenc::empty_this_buffer_proxy
     OMX_U8 *data = NULL;
     PrintFrameHdr(OMX_COMPONENT_GENERATE_ETB,buffer);
     memset(&meta_in,0,sizeof(meta_in));
-    if ( search_input_bufhdr(buffer) == false )
+    if ( core::search_input_bufhdr(this, buffer) == false )
     {
         DEBUG_PRINT("ETBP: INVALID BUF HDR\n");
         buffer_done_cb((OMX_BUFFERHEADERTYPE *)buffer);
         return OMX_ErrorBadParameter;
     }
-    if (m_tmp_meta_buf)
-    {
+    // Buffers from allocate_input_buffer carry META_IN head room and go
+    // to the driver in place, client buffers are staged in m_tmp_meta_buf
+    data = (OMX_U8 *)buffer->pInputPortPrivate;
+    if (!data)
         data = m_tmp_meta_buf;
+    if (data)
+    {
 
         // copy the metadata info from the BufHdr and insert to payload
         meta_in.offsetVal  = sizeof(META_IN);
@@ -4095,7 +2844,15 @@ OMX_ERRORTYPE  omx_aac_aenc::empty_this_buffer_proxy
         DEBUG_PRINT("meta_in.nFlags = %d\n",meta_in.nFlags);
     }
 
-    memcpy(&data[sizeof(META_IN)],buffer->pBuffer,buffer->nFilledLen);
+    if (data == m_tmp_meta_buf)
+    {
+        memcpy(&data[sizeof(META_IN)],buffer->pBuffer,buffer->nFilledLen);
+        m_io_stats.in_copied_bytes += buffer->nFilledLen;
+    }
+    else
+    {
+        m_io_stats.in_direct_bytes += buffer->nFilledLen;
+    }
     write(m_drv_fd, data, buffer->nFilledLen+sizeof(META_IN));
     pthread_mutex_lock(&m_state_lock);
     get_state(&m_cmp, &state);
@@ -4125,48 +2882,35 @@ OMX_ERRORTYPE  omx_aac_aenc::fill_this_buffer_proxy
     ENC_META_OUT *meta_out = NULL;
     int nReadbytes = 0;
     int szadifhr = 0;
-    int numframes = 0;
-    int metainfo  = 0;
-    OMX_U8 *src = buffer->pBuffer;
 
     pthread_mutex_lock(&m_state_lock);
     get_state(&m_cmp, &state);
     pthread_mutex_unlock(&m_state_lock);
 
-    if (true == search_output_bufhdr(buffer))
+    if (true == core::search_output_bufhdr(this, buffer))
     {
         if((m_aac_param.eAACStreamFormat == OMX_AUDIO_AACStreamFormatADIF)
                 && (adif_flag == 0))
         {
-
+            szadifhr = AUDAAC_MAX_ADIF_HEADER_LENGTH;
+            // Leave room for the ADIF header ahead of the driver data and
+            // splice it in front of the first frame without moving frames
             DEBUG_PRINT("\nBefore Read..m_drv_fd = %d,\n",m_drv_fd);
-            nReadbytes = read(m_drv_fd,m_tmp_out_meta_buf,output_buffer_size );
+            nReadbytes = aenc_pipe_read(&m_pipe, m_drv_fd,
+                                        buffer->pBuffer + szadifhr,
+                                        MIN(output_buffer_size,
+                                            buffer->nAllocLen - szadifhr),
+                                        &m_io_stats);
             DEBUG_DETAIL("FTBP->Al_len[%d]buf[%p]size[%d]numOutBuf[%d]\n",\
-                         buffer->nAllocLen,m_tmp_out_meta_buf,
+                         buffer->nAllocLen,buffer->pBuffer,
                          nReadbytes,nNumOutputBuf);
-            if(*m_tmp_out_meta_buf <= 0)
+            if(nReadbytes <= 0)
                 return OMX_ErrorBadParameter;
-            szadifhr = AUDAAC_MAX_ADIF_HEADER_LENGTH; 
-            numframes =  *m_tmp_out_meta_buf;
-            metainfo  = ((sizeof(ENC_META_OUT) * numframes)+
-			sizeof(unsigned char));
             audaac_rec_install_adif_header_variable(0,sample_idx,
 						m_aac_param.nChannels);
-            memcpy(buffer->pBuffer,m_tmp_out_meta_buf,metainfo);
-            memcpy(buffer->pBuffer + metainfo,&audaac_header_adif[0],szadifhr);
-            memcpy(buffer->pBuffer + metainfo + szadifhr,
-            m_tmp_out_meta_buf + metainfo,(nReadbytes - metainfo));
-            src += sizeof(unsigned char);
-            meta_out = (ENC_META_OUT *)src;
-            meta_out->frame_size += szadifhr;
-            numframes--;
-            while(numframes > 0)
-            {
-                 src += sizeof(ENC_META_OUT);
-                 meta_out = (ENC_META_OUT *)src;
-                 meta_out->offset_to_frame += szadifhr;
-                 numframes--;
-            }
+            if (aenc_io_insert_header(buffer->pBuffer, nReadbytes,
+                                      &audaac_header_adif[0], szadifhr) < 0)
+                return OMX_ErrorBadParameter;
             buffer->nFlags = OMX_BUFFERFLAG_CODECCONFIG;
             adif_flag++;
         }
@@ -4190,7 +2934,8 @@ OMX_ERRORTYPE  omx_aac_aenc::fill_this_buffer_proxy
         {
 
             DEBUG_PRINT("\nBefore Read..m_drv_fd = %d,\n",m_drv_fd);
-            nReadbytes = read(m_drv_fd,buffer->pBuffer,output_buffer_size );
+            nReadbytes = aenc_pipe_read(&m_pipe, m_drv_fd, buffer->pBuffer,
+                                        output_buffer_size, &m_io_stats);
             DEBUG_DETAIL("FTBP->Al_len[%d]buf[%p]size[%d]numOutBuf[%d]\n",\
                          buffer->nAllocLen,buffer->pBuffer,
                          nReadbytes,nNumOutputBuf);
@@ -4205,15 +2950,9 @@ OMX_ERRORTYPE  omx_aac_aenc::fill_this_buffer_proxy
         }
 
          meta_out = (ENC_META_OUT *)(buffer->pBuffer + sizeof(unsigned char));
-         buffer->nTimeStamp = (((OMX_TICKS)meta_out->msw_ts << 32)+
-				meta_out->lsw_ts);
-
-         ts += frameduration;
-         buffer->nTimeStamp = ts;
+         aenc_core_set_output<aenc_aac_traits>(buffer, nReadbytes, szadifhr,
+                                               &ts, frameduration);
          nTimestamp = buffer->nTimeStamp;
-         buffer->nFlags |= meta_out->nflags;
-         buffer->nOffset =  meta_out->offset_to_frame + 1;
-         buffer->nFilledLen = nReadbytes - buffer->nOffset + szadifhr;
          DEBUG_PRINT("nflags %d frame_size %d offset_to_frame %d \
 		timestamp %lld\n", meta_out->nflags,
 		meta_out->frame_size,
@@ -4407,7 +3146,21 @@ void  omx_aac_aenc::deinit_encoder()
                 m_aac_pb_stats.fbd_cnt,m_aac_pb_stats.ftb_cnt,
                 m_aac_pb_stats.etb_cnt,
                 m_aac_pb_stats.ebd_cnt);
+    DEBUG_PRINT("STATS: reads[%u]empty-reads[%u]frames[%u]max-frames[%u]"
+                "frames-per-read[%u.%02u]",
+                m_io_stats.reads, m_io_stats.empty_reads, m_io_stats.frames,
+                m_io_stats.max_frames,
+                aenc_io_frames_per_read_x100(&m_io_stats) / 100,
+                aenc_io_frames_per_read_x100(&m_io_stats) % 100);
+    DEBUG_PRINT("STATS: in-direct[%llu]in-copied[%llu]",
+                (unsigned long long)m_io_stats.in_direct_bytes,
+                (unsigned long long)m_io_stats.in_copied_bytes);
+    DEBUG_PRINT("STATS: shared-bufs[%u]", m_shm.shared_bufs);
+    DEBUG_PRINT("STATS: read-ahead[%u]max-filled[%u]stalls[%u]dropped[%u]",
+                AENC_PIPE_DEPTH, m_pipe.max_count, m_pipe.stalls,
+                m_pipe.dropped);
    memset(&m_aac_pb_stats,0,sizeof(AAC_PB_STATS));
+   memset(&m_io_stats,0,sizeof(m_io_stats));
 
     if((OMX_StateLoaded != m_state) && (OMX_StateInvalid != m_state))
     {
@@ -4475,16 +3228,13 @@ void  omx_aac_aenc::deinit_encoder()
 
     if(ioctl(m_drv_fd, AUDIO_STOP, 0) <0)
           DEBUG_PRINT_ERROR("De-init: AUDIO_STOP FAILED\n");
+    aenc_pipe_stop(&m_pipe);
 
     if(pcm_input && m_tmp_meta_buf )
     {
         free(m_tmp_meta_buf);
     }
 
-    if(m_tmp_out_meta_buf)
-    {
-        free(m_tmp_out_meta_buf);
-    }
     nNumInputBuf = 0;
     nNumOutputBuf = 0;
     m_inp_current_buf_count=0;
@@ -4500,6 +3250,7 @@ void  omx_aac_aenc::deinit_encoder()
     ts = 0;
     nTimestamp = 0;
     frameduration = 0;
+    aenc_shm_pool_deinit(&m_shm);
     if ( m_drv_fd >= 0 )
     {
         if(close(m_drv_fd) < 0)
@@ -4589,103 +3340,6 @@ OMX_ERRORTYPE  omx_aac_aenc::component_role_enum(OMX_IN OMX_HANDLETYPE hComp,
     return eRet;
 }
 
-
-
-
-/* ======================================================================
-FUNCTION
-  omx_aac_aenc::AllocateDone
-
-DESCRIPTION
-  Checks if entire buffer pool is allocated by IL Client or not.
-  Need this to move to IDLE state.
-
-PARAMETERS
-  None.
-
-RETURN VALUE
-  true/false.
-
-========================================================================== */
-bool omx_aac_aenc::allocate_done(void)
-{
-    OMX_BOOL bRet = OMX_FALSE;
-    if (pcm_input==1)
-    {
-        if ((m_inp_act_buf_count == m_inp_current_buf_count)
-            &&(m_out_act_buf_count == m_out_current_buf_count))
-        {
-            bRet=OMX_TRUE;
-
-        }
-        if ((m_inp_act_buf_count == m_inp_current_buf_count) && m_inp_bEnabled )
-        {
-            m_inp_bPopulated = OMX_TRUE;
-        }
-
-        if ((m_out_act_buf_count == m_out_current_buf_count) && m_out_bEnabled )
-        {
-            m_out_bPopulated = OMX_TRUE;
-        }
-    } else if (pcm_input==0)
-    {
-        if (m_out_act_buf_count == m_out_current_buf_count)
-        {
-            bRet=OMX_TRUE;
-
-        }
-        if ((m_out_act_buf_count == m_out_current_buf_count) && m_out_bEnabled )
-        {
-            m_out_bPopulated = OMX_TRUE;
-        }
-
-    }
-    return bRet;
-}
-
-
-/* ======================================================================
-FUNCTION
-  omx_aac_aenc::ReleaseDone
-
-DESCRIPTION
-  Checks if IL client has released all the buffers.
-
-PARAMETERS
-  None.
-
-RETURN VALUE
-  true/false
-
-========================================================================== */
-bool omx_aac_aenc::release_done(OMX_U32 param1)
-{
-    DEBUG_PRINT("Inside omx_aac_aenc::release_done");
-    OMX_BOOL bRet = OMX_FALSE;
-
-    if (param1 == OMX_ALL)
-    {
-
-        if ((0 == m_inp_current_buf_count)&&(0 == m_out_current_buf_count))
-        {
-            bRet=OMX_TRUE;
-        }
-    } else if (param1 == OMX_CORE_INPUT_PORT_INDEX )
-    {
-        if ((0 == m_inp_current_buf_count))
-        {
-            bRet=OMX_TRUE;
-        }
-    } else if (param1 == OMX_CORE_OUTPUT_PORT_INDEX)
-    {
-        if ((0 == m_out_current_buf_count))
-        {
-            bRet=OMX_TRUE;
-        }
-    }
-    return bRet;
-}
-
 void  omx_aac_aenc::audaac_rec_install_adif_header_variable (OMX_U16  byte_num,
                             OMX_U32 sample_index,
                             OMX_U8 channel_config)
@@ -5013,4 +3667,3 @@ void  omx_aac_aenc::audaac_rec_install_mp4ff_header_variable (OMX_U16  byte_num,
                           &(audaac_hdr_bit_index));
 
 }
-
@@ -16,6 +16,12 @@ libOmxAmrEnc-def += -D_DEBUG
 ifeq ($(strip $(TARGET_USES_QCOM_MM_AUDIO)),true)
 libOmxAmrEnc-def += -DAUDIOV2
 endif
+ifneq ($(strip $(AUDIO_FEATURE_AENC_FRAMES_PER_BUF)),)
+libOmxAmrEnc-def += -DNUMOFFRAMES=$(AUDIO_FEATURE_AENC_FRAMES_PER_BUF)
+endif
+ifneq ($(strip $(AUDIO_FEATURE_AENC_PIPE_DEPTH)),)
+libOmxAmrEnc-def += -DAENC_PIPE_DEPTH=$(AUDIO_FEATURE_AENC_PIPE_DEPTH)
+endif
 
 # ---------------------------------------------------------------------------------
 #             Make the Shared library (libOmxAmrEnc)
@@ -24,6 +30,7 @@ endif
 include $(CLEAR_VARS)
 
 libOmxAmrEnc-inc       := $(LOCAL_PATH)/inc
+libOmxAmrEnc-inc       += $(LOCAL_PATH)/../../aenc-common/inc
 libOmxAmrEnc-inc       += $(TARGET_OUT_HEADERS)/mm-core/omxcore
 
 LOCAL_MODULE            := libOmxAmrEnc
@@ -49,6 +56,7 @@ include $(CLEAR_VARS)
 
 mm-amr-enc-test-inc    := $(LOCAL_PATH)/inc
 mm-amr-enc-test-inc    += $(LOCAL_PATH)/test
+mm-amr-enc-test-inc    += $(LOCAL_PATH)/../../aenc-common/inc
 
 mm-amr-enc-test-inc    += $(TARGET_OUT_HEADERS)/mm-core/omxcore
 ifeq ($(strip $(TARGET_USES_QCOM_MM_AUDIO)),true)
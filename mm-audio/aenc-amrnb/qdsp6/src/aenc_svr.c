@@ -47,25 +47,23 @@ void *omx_amr_msg(void *info)
 {
     struct amr_ipc_info *amr_info = (struct amr_ipc_info*)info;
     unsigned char id;
-    int n;
 
     DEBUG_DETAIL("\n%s: message thread start\n", __FUNCTION__);
-    while (!amr_info->dead)
+    for (;;)
     {
-        n = read(amr_info->pipe_in, &id, 1);
-        if (0 == n) break;
-        if (1 == n)
+        // Drain everything posted since the last wakeup in one go
+        while (aenc_msgq_pop(&amr_info->msgq, &id))
         {
-          DEBUG_DETAIL("\n%s-->pipe_in=%d pipe_out=%d\n",
-                                               amr_info->thread_name,
-                                               amr_info->pipe_in,
-                                               amr_info->pipe_out);
-
+            DEBUG_DETAIL("\n%s-->id=%d\n", amr_info->thread_name, id);
             amr_info->process_msg_cb(amr_info->client_data, id);
         }
-        if ((n < 0) && (errno != EINTR)) break;
+        if (__atomic_load_n(&amr_info->dead, __ATOMIC_ACQUIRE))
+            break;
+        aenc_msgq_wait(&amr_info->msgq);
     }
-    DEBUG_DETAIL("%s: message thread stop\n", __FUNCTION__);
+    DEBUG_DETAIL("%s: message thread stop, %u msgs in %u wakeups\n",
+                 amr_info->thread_name, amr_info->msgq.posted,
+                 amr_info->msgq.wakeups);
 
     return 0;
 }
@@ -95,7 +93,6 @@ struct amr_ipc_info *omx_amr_thread_create(
                                     char* th_name)
 {
     int r;
-    int fds[2];
     struct amr_ipc_info *amr_info;
 
     amr_info = calloc(1, sizeof(struct amr_ipc_info));
@@ -108,15 +105,12 @@ struct amr_ipc_info *omx_amr_thread_create(
     amr_info->process_msg_cb = cb;
     strlcpy(amr_info->thread_name, th_name, sizeof(amr_info->thread_name));
 
-    if (pipe(fds))
+    if (aenc_msgq_init(&amr_info->msgq))
     {
-        DEBUG_PRINT_ERROR("\n%s: pipe creation failed\n", __FUNCTION__);
-        goto fail_pipe;
+        DEBUG_PRINT_ERROR("\n%s: eventfd creation failed\n", __FUNCTION__);
+        goto fail_msgq;
     }
 
-    amr_info->pipe_in = fds[0];
-    amr_info->pipe_out = fds[1];
-
     r = pthread_create(&amr_info->thr, 0, omx_amr_msg, amr_info);
     if (r < 0) goto fail_thread;
 
@@ -125,10 +119,9 @@ struct amr_ipc_info *omx_amr_thread_create(
 
 
 fail_thread:
-    close(amr_info->pipe_in);
-    close(amr_info->pipe_out);
+    aenc_msgq_deinit(&amr_info->msgq);
 
-fail_pipe:
+fail_msgq:
     free(amr_info);
 
     return 0;
@@ -148,7 +141,6 @@ struct amr_ipc_info *omx_amr_event_thread_create(
                                     char* th_name)
 {
     int r;
-    int fds[2];
     struct amr_ipc_info *amr_info;
 
     amr_info = calloc(1, sizeof(struct amr_ipc_info));
@@ -161,15 +153,12 @@ struct amr_ipc_info *omx_amr_event_thread_create(
     amr_info->process_msg_cb = cb;
     strlcpy(amr_info->thread_name, th_name, sizeof(amr_info->thread_name));
 
-    if (pipe(fds))
+    if (aenc_msgq_init(&amr_info->msgq))
     {
-        DEBUG_PRINT("\n%s: pipe creation failed\n", __FUNCTION__);
-        goto fail_pipe;
+        DEBUG_PRINT("\n%s: eventfd creation failed\n", __FUNCTION__);
+        goto fail_msgq;
     }
 
-    amr_info->pipe_in = fds[0];
-    amr_info->pipe_out = fds[1];
-
     r = pthread_create(&amr_info->thr, 0, omx_amr_events, amr_info);
     if (r < 0) goto fail_thread;
 
@@ -178,10 +167,9 @@ struct amr_ipc_info *omx_amr_event_thread_create(
 
 
 fail_thread:
-    close(amr_info->pipe_in);
-    close(amr_info->pipe_out);
+    aenc_msgq_deinit(&amr_info->msgq);
 
-fail_pipe:
+fail_msgq:
     free(amr_info);
 
     return 0;
@@ -189,17 +177,15 @@ fail_pipe:
 
 void omx_amr_thread_stop(struct amr_ipc_info *amr_info) {
     DEBUG_DETAIL("%s stop server\n", __FUNCTION__);
-    close(amr_info->pipe_in);
-    close(amr_info->pipe_out);
+    __atomic_store_n(&amr_info->dead, 1, __ATOMIC_RELEASE);
+    aenc_msgq_wake(&amr_info->msgq);
     pthread_join(amr_info->thr,NULL);
-    amr_info->pipe_out = -1;
-    amr_info->pipe_in = -1;
-    DEBUG_DETAIL("%s: message thread close fds%d %d\n", amr_info->thread_name,
-        amr_info->pipe_in,amr_info->pipe_out);
+    aenc_msgq_deinit(&amr_info->msgq);
+    DEBUG_DETAIL("%s: message thread closed\n", amr_info->thread_name);
     free(amr_info);
 }
 
 void omx_amr_post_msg(struct amr_ipc_info *amr_info, unsigned char id) {
     DEBUG_DETAIL("\n%s id=%d\n", __FUNCTION__,id);
-    write(amr_info->pipe_out, &id, 1);
+    aenc_msgq_post(&amr_info->msgq, id);
 }
@@ -57,6 +57,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <pthread.h>
 #include "QOMX_AudioExtensions.h"
 #include "QOMX_AudioIndexExtensions.h"
+#include "aenc_bench.h"
 #ifdef AUDIOV2
 #include "control.h"
 #endif
@@ -209,6 +210,7 @@ struct qcp_header {
 } __attribute__ ((packed));
 
 static unsigned totaldatalen = 0;
+static struct aenc_bench bench;
 static unsigned framecnt = 0;
 /************************************************************************/
 /*                GLOBAL INIT                    */
@@ -364,6 +366,7 @@ OMX_ERRORTYPE FillBufferDone(OMX_IN OMX_HANDLETYPE hComponent,
 
     /* To remove warning for unused variable to keep prototype same */
     (void)pAppData;
+    aenc_bench_fbd(&bench, pBuffer);
 
         if(((pBuffer->nFlags & OMX_BUFFERFLAG_EOS) == OMX_BUFFERFLAG_EOS)) {
             DEBUG_PRINT("FBD::EOS on output port\n ");
@@ -406,9 +409,11 @@ OMX_ERRORTYPE FillBufferDone(OMX_IN OMX_HANDLETYPE hComponent,
         }
         DEBUG_PRINT(" FillBufferDone size writen to file  %d count %d\n",total_bytes_writen, framecnt);
         totaldatalen += total_bytes_writen ;
+        bench.out_bytes += total_bytes_writen;
     framecnt++;
 
         DEBUG_PRINT(" FBD calling FTB\n");
+        aenc_bench_ftb(&bench, pBuffer);
         OMX_FillThisBuffer(hComponent,pBuffer);
 
         return OMX_ErrorNone;
@@ -521,10 +526,17 @@ int main(int argc, char **argv)
         dtxenable  = atoi(argv[5]);
         recpath      = atoi(argv[6]); // No configuration support yet..
         rectime      = atoi(argv[7]);
+        if (argc > 8)
+            bench.use_buffer = atoi(argv[8]);
+        if (argc > 9)
+            bench.sessions = atoi(argv[9]);
 
     } else {
           DEBUG_PRINT(" invalid format: \n");
           DEBUG_PRINT("ex: ./mm-aenc-omxamr-test INPUTFILE OUTPUTFILE Tunnel BANDMODE DTXENABLE RECORDPATH RECORDTIME\n");
+          DEBUG_PRINT("Optional BUFMODE 0: OMX_AllocateBuffer (default), 1: OMX_UseBuffer, "
+                      "2: OMX_UseBuffer on driver shared memory\n");
+          DEBUG_PRINT("Optional SESSIONS after BUFMODE: run that many sessions at once and print BENCH lines\n");
           DEBUG_PRINT("Bandmode 1-7, dtxenable 0-1\n");
           DEBUG_PRINT("RECORDPATH 0(TX),1(RX),2(BOTH),3(MIC)\n");
           DEBUG_PRINT("RECORDTIME in seconds for AST Automation\n");
@@ -534,6 +546,8 @@ int main(int argc, char **argv)
           DEBUG_PRINT("For RECORDPATH Only MIC supported\n");
           return 0;
     }
+    aenc_bench_spawn(&bench, "AMR");
+    out_filename = aenc_bench_name(&bench, out_filename);
     if(tunnel == 0)
         aud_comp = "OMX.qcom.audio.encoder.amrnb";
     else
@@ -568,6 +582,8 @@ int main(int argc, char **argv)
         if((bInputEosReached_tunnel) || ((bOutputEosReached) && !tunnel))
         {
 
+            aenc_bench_stop(&bench);
+            aenc_bench_report(&bench, "AMR");
             DEBUG_PRINT("\nMoving the decoder to idle state \n");
             OMX_SendCommand(amr_enc_handle, OMX_CommandStateSet, OMX_StateIdle,0);
             wait_for_event();
@@ -579,13 +595,13 @@ int main(int argc, char **argv)
             {
                 DEBUG_PRINT("\nFillBufferDone: Deallocating i/p buffers \n");
                 for(bufCnt=0; bufCnt < input_buf_cnt; ++bufCnt) {
-                    OMX_FreeBuffer(amr_enc_handle, 0, pInputBufHdrs[bufCnt]);
+                    aenc_bench_free(amr_enc_handle, 0, pInputBufHdrs[bufCnt], &bench);
                 }
             }
 
             DEBUG_PRINT ("\nFillBufferDone: Deallocating o/p buffers \n");
             for(bufCnt=0; bufCnt < output_buf_cnt; ++bufCnt) {
-                OMX_FreeBuffer(amr_enc_handle, 1, pOutputBufHdrs[bufCnt]);
+                aenc_bench_free(amr_enc_handle, 1, pOutputBufHdrs[bufCnt], &bench);
             }
             wait_for_event();
             fseek(outputBufferFile, 0,SEEK_SET);
@@ -856,12 +872,16 @@ int Play_Encoder()
     OMX_SendCommand(amr_enc_handle, OMX_CommandStateSet, OMX_StateExecuting,0);
     wait_for_event();
 
+    bench.pcm_rate = samplerate;
+    bench.pcm_channels = channels;
+    aenc_bench_start(&bench);
     DEBUG_PRINT(" Start sending OMX_FILLthisbuffer\n");
 
     for(i=0; i < output_buf_cnt; i++) {
         DEBUG_PRINT ("\nOMX_FillThisBuffer on output buf no.%d\n",i);
         pOutputBufHdrs[i]->nOutputPortIndex = 1;
         pOutputBufHdrs[i]->nFlags &= ~OMX_BUFFERFLAG_EOS;
+        aenc_bench_ftb(&bench, pOutputBufHdrs[i]);
         ret = OMX_FillThisBuffer(amr_enc_handle, pOutputBufHdrs[i]);
         if (OMX_ErrorNone != ret) {
             DEBUG_PRINT("OMX_FillThisBuffer failed with result %d\n", ret);
@@ -934,8 +954,8 @@ static OMX_ERRORTYPE Allocate_Buffer ( OMX_COMPONENTTYPE *avc_enc_handle,
 
     for(bufCnt=0; bufCnt < bufCntMin; ++bufCnt) {
         DEBUG_PRINT("\n OMX_AllocateBuffer No %ld \n", bufCnt);
-        error = OMX_AllocateBuffer(amr_enc_handle, &((*pBufHdrs)[bufCnt]),
-                                   nPortIndex, NULL, bufSize);
+        error = aenc_bench_alloc(amr_enc_handle, &((*pBufHdrs)[bufCnt]),
+                                   nPortIndex, bufSize, &bench);
     }
 
     return error;
@@ -953,7 +973,8 @@ static int Read_Buffer (OMX_BUFFERHEADERTYPE  *pBufHdr )
     pBufHdr->nFilledLen = 0;
     pBufHdr->nFlags |= OMX_BUFFERFLAG_EOS;
 
-     bytes_read = fread(pBufHdr->pBuffer, 1, pBufHdr->nAllocLen , inputBufferFile);
+     bytes_read = aenc_bench_read(&bench, pBufHdr->pBuffer,
+                                  pBufHdr->nAllocLen, inputBufferFile);
 
       pBufHdr->nFilledLen = bytes_read;
       // Time stamp logic
@@ -999,6 +1020,10 @@ static int open_audio_file ()
             DEBUG_PRINT("PCM parser failed \n");
             return -1;
         }
+        if(aenc_bench_map_input(&bench, inputBufferFile) != 0)
+        {
+            DEBUG_PRINT("Input mapping failed, reading the file\n");
+        }
     }
 
     DEBUG_PRINT("Inside %s filename=%s\n", __FUNCTION__, out_filename);
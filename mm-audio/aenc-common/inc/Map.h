@@ -0,0 +1,266 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2014, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+#ifndef _MAP_H_
+#define _MAP_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+using namespace std;
+
+/*
+ * Buffer header map shared by the QDSP6 encoders.
+ *
+ * Open addressed hash table with linear probing, keyed by pointer (or
+ * integer) value. Every empty_this_buffer/fill_this_buffer validates its
+ * header through find_ele(), so lookups are O(1) regardless of the
+ * number of buffers. The table doubles when more than half full and
+ * erase() shifts entries back instead of leaving tombstones.
+ */
+template <typename T,typename T2>
+class Map
+{
+    struct slot
+    {
+        T    data;
+        T2   data2;
+        bool used;
+    };
+    slot*    table;
+    unsigned capacity;          // power of two
+    unsigned shift;             // 32 - log2(capacity)
+    unsigned size_of_list;
+
+    enum { INITIAL_CAPACITY = 16 };      // 1 << 4
+
+    unsigned index_of(T key) const
+    {
+        uint64_t v = (uint64_t)(uintptr_t)key;
+        // Fibonacci hashing: take the top bits so that the constant low
+        // bits of aligned buffer header pointers do not matter
+        uint32_t h = (uint32_t)(v ^ (v >> 32)) * 2654435761u;
+        return h >> shift;
+    }
+    int  lookup(T key) const;
+    bool grow();
+public:
+    Map() : table(NULL), capacity(0), shift(32), size_of_list(0) {}
+    bool empty() const { return !size_of_list; }
+    operator bool() const { return !empty(); }
+    void insert(T,T2);
+    void show();
+    int  size();
+    T2 find(T); // Return VALUE
+    T find_ele(T);// Check if the KEY is present or not
+    T2 begin(); //give the first ele
+    bool erase(T);
+    bool eraseall();
+    bool isempty();
+    ~Map()
+    {
+        delete [] table;
+    }
+};
+
+template <typename T,typename T2>
+int Map<T,T2>::lookup(T key) const
+{
+    unsigned i;
+
+    if (!size_of_list)
+        return -1;
+    for (i = index_of(key); table[i].used; i = (i + 1) & (capacity - 1))
+    {
+        if (table[i].data == key)
+            return (int)i;
+    }
+    return -1;
+}
+
+template <typename T,typename T2>
+bool Map<T,T2>::grow()
+{
+    slot *old = table;
+    unsigned old_capacity = capacity;
+    unsigned old_shift = shift;
+    unsigned i, j;
+
+    if (capacity)
+    {
+        capacity *= 2;
+        shift--;
+    }
+    else
+    {
+        capacity = INITIAL_CAPACITY;
+        shift = 32 - 4;
+    }
+    table = new slot[capacity];
+    if (!table)
+    {
+        table = old;
+        capacity = old_capacity;
+        shift = old_shift;
+        return false;
+    }
+    for (i = 0; i < capacity; i++)
+        table[i].used = false;
+    for (i = 0; i < old_capacity; i++)
+    {
+        if (!old[i].used)
+            continue;
+        for (j = index_of(old[i].data); table[j].used;
+             j = (j + 1) & (capacity - 1))
+            ;
+        table[j] = old[i];
+    }
+    delete [] old;
+    return true;
+}
+
+template <typename T,typename T2>
+T2 Map<T,T2>::find(T d1)
+{
+    int i = lookup(d1);
+
+    return i < 0 ? 0 : table[i].data2;
+}
+
+template <typename T,typename T2>
+T Map<T,T2>::find_ele(T d1)
+{
+    int i = lookup(d1);
+
+    return i < 0 ? 0 : table[i].data;
+}
+
+template <typename T,typename T2>
+T2 Map<T,T2>::begin()
+{
+    unsigned i;
+
+    for (i = 0; size_of_list && i < capacity; i++)
+    {
+        if (table[i].used)
+            return table[i].data2;
+    }
+    return 0;
+}
+
+template <typename T,typename T2>
+void Map<T,T2>::show()
+{
+    unsigned i;
+
+    for (i = 0; size_of_list && i < capacity; i++)
+    {
+        if (table[i].used)
+            printf("%p-->%p\n", (void *)table[i].data, (void *)table[i].data2);
+    }
+}
+
+template <typename T,typename T2>
+int Map<T,T2>::size()
+{
+    return size_of_list;
+}
+
+template <typename T,typename T2>
+void Map<T,T2>::insert(T data, T2 data2)
+{
+    unsigned i;
+
+    if ((size_of_list + 1) * 2 > capacity && !grow())
+        return;
+    for (i = index_of(data); table[i].used; i = (i + 1) & (capacity - 1))
+        ;
+    table[i].data = data;
+    table[i].data2 = data2;
+    table[i].used = true;
+    size_of_list++;
+}
+
+template <typename T,typename T2>
+bool Map<T,T2>::erase(T d)
+{
+    int found = lookup(d);
+    unsigned hole, i, home;
+
+    if (found < 0)
+        return false;
+
+    // Backward shift: pull up later entries of the probe run that
+    // would otherwise become unreachable through the new hole.
+    hole = (unsigned)found;
+    table[hole].used = false;
+    for (i = (hole + 1) & (capacity - 1); table[i].used;
+         i = (i + 1) & (capacity - 1))
+    {
+        home = index_of(table[i].data);
+        if (((i - home) & (capacity - 1)) >= ((i - hole) & (capacity - 1)))
+        {
+            table[hole] = table[i];
+            table[i].used = false;
+            hole = i;
+        }
+    }
+    size_of_list--;
+    return true;
+}
+
+template <typename T,typename T2>
+bool Map<T,T2>::eraseall()
+{
+    // Be careful while using this method
+    // it not only removes the node but FREES(not delete) the allocated
+    // memory.
+    unsigned i;
+
+    for (i = 0; i < capacity; i++)
+    {
+        if (!table[i].used)
+            continue;
+        if (table[i].data)
+            free(table[i].data);
+        if (table[i].data2)
+            free(table[i].data2);
+        table[i].used = false;
+    }
+    size_of_list = 0;
+    return true;
+}
+
+
+template <typename T,typename T2>
+bool Map<T,T2>::isempty()
+{
+    if(!size_of_list) return true;
+    else return false;
+}
+
+#endif // _MAP_H_
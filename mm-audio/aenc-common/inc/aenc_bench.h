@@ -0,0 +1,526 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2014, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+#ifndef AENC_BENCH_H
+#define AENC_BENCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "OMX_Core.h"
+#include "aenc_shm.h"
+
+/*
+ * Throughput and CPU accounting for the mm-aenc-omx* test apps.
+ *
+ * The buffer mode selects who owns the port buffers:
+ *   0  OMX_AllocateBuffer, component memory; PCM and bitstream are
+ *      written to and read from the driver in place
+ *   1  OMX_UseBuffer, client heap memory; the component stages input
+ *      through a private copy
+ *   2  OMX_UseBuffer, client memory from one memfd region per port that
+ *      is registered with the driver first (aenc_shm.h); input goes to
+ *      the driver in place. If the driver refuses the region the
+ *      component copies as in mode 1
+ * so running the same clip in modes 1 and 2 shows the cost of the copy.
+ *
+ * With a session count the app runs as a benchmark: the parent forks
+ * that many sessions of the same clip, each in its own process with its
+ * own component instance and output file (OUTPUTFILE.<n>), and prints
+ * one BENCH line per session plus a summary once all have finished.
+ * Session input is read from a mapping of the clip rather than fread(),
+ * so file I/O stays out of the measurement. Latency is taken per output
+ * buffer, from OMX_FillThisBuffer to FillBufferDone.
+ */
+
+#define AENC_BENCH_MAX_SESSIONS     32
+#define AENC_BENCH_LAT_BUCKETS      256
+#define AENC_BENCH_SHM_BUFS         16      /* buffers per shared region */
+
+struct aenc_bench_result
+{
+    int done;
+    uint32_t pcm_rate;
+    uint32_t pcm_channels;
+    uint64_t wall_ns;
+    uint64_t cpu_ns;
+    uint64_t in_bytes;
+    uint64_t out_bytes;
+    uint32_t buffers;
+    uint32_t lat_us[4];         /* p50, p90, p99, max */
+};
+
+struct aenc_bench
+{
+    int use_buffer;
+    int sessions;               /* benchmark mode when > 0 */
+    int session;                /* this session, valid in benchmark mode */
+    struct timespec wall_start;
+    struct timespec cpu_start;
+    uint64_t wall_ns;
+    uint64_t cpu_ns;
+    uint64_t in_bytes;          /* PCM handed to the component */
+    uint64_t out_bytes;         /* encoded bytes received */
+    uint32_t pcm_rate;
+    uint32_t pcm_channels;
+    const uint8_t *map;         /* mapped input clip */
+    size_t map_len;
+    size_t map_pos;
+    uint32_t lat_hist[AENC_BENCH_LAT_BUCKETS];
+    uint32_t lat_max_us;
+    uint32_t buffers;
+    struct aenc_bench_result *results;  /* shared with the parent */
+    char out_name[256];
+    struct aenc_shm shm[2];     /* buffer mode 2, per port */
+    size_t shm_used[2];
+    unsigned int shm_bufs[2];   /* buffers handed out of shm[port] */
+};
+
+/* Per buffer state, kept in OMX_BUFFERHEADERTYPE::pAppPrivate */
+struct aenc_bench_buf
+{
+    struct timespec ftb;
+};
+
+static inline uint64_t aenc_bench_ns(const struct timespec *a,
+                                     const struct timespec *b)
+{
+    return (uint64_t)(b->tv_sec - a->tv_sec) * 1000000000ULL +
+           b->tv_nsec - a->tv_nsec;
+}
+
+/*
+ * Latency histogram with 8 buckets per power of two, so percentiles are
+ * within 12.5% whatever the range, in a fixed 1 KB per session.
+ */
+static inline unsigned int aenc_bench_lat_bucket(uint32_t us)
+{
+    unsigned int e;
+
+    if (us < 8)
+        return us;
+    e = 31 - __builtin_clz(us);
+    return (e - 2) * 8 + ((us >> (e - 3)) & 7);
+}
+
+static inline uint32_t aenc_bench_lat_value(unsigned int idx)
+{
+    unsigned int e;
+
+    if (idx < 8)
+        return idx;
+    e = idx / 8 + 2;
+    return (8 + idx % 8) << (e - 3);
+}
+
+static inline uint32_t aenc_bench_percentile(const struct aenc_bench *b,
+                                             unsigned int pct)
+{
+    uint64_t want = ((uint64_t)b->buffers * pct + 99) / 100;
+    uint64_t seen = 0;
+    unsigned int i;
+
+    if (!b->buffers)
+        return 0;
+    for (i = 0; i < AENC_BENCH_LAT_BUCKETS; i++) {
+        seen += b->lat_hist[i];
+        if (seen >= want)
+            return aenc_bench_lat_value(i);
+    }
+    return b->lat_max_us;
+}
+
+static inline void aenc_bench_start(struct aenc_bench *b)
+{
+    clock_gettime(CLOCK_MONOTONIC, &b->wall_start);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &b->cpu_start);
+}
+
+static inline void aenc_bench_stop(struct aenc_bench *b)
+{
+    struct timespec wall, cpu;
+
+    clock_gettime(CLOCK_MONOTONIC, &wall);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+    b->wall_ns = aenc_bench_ns(&b->wall_start, &wall);
+    b->cpu_ns = aenc_bench_ns(&b->cpu_start, &cpu);
+}
+
+/* Call right before OMX_FillThisBuffer */
+static inline void aenc_bench_ftb(struct aenc_bench *b,
+                                  OMX_BUFFERHEADERTYPE *hdr)
+{
+    struct aenc_bench_buf *bb = (struct aenc_bench_buf *)hdr->pAppPrivate;
+
+    (void)b;
+    if (bb)
+        clock_gettime(CLOCK_MONOTONIC, &bb->ftb);
+}
+
+/* Call on entry to FillBufferDone */
+static inline void aenc_bench_fbd(struct aenc_bench *b,
+                                  OMX_BUFFERHEADERTYPE *hdr)
+{
+    struct aenc_bench_buf *bb = (struct aenc_bench_buf *)hdr->pAppPrivate;
+    struct timespec now;
+    uint64_t us;
+
+    if (!bb || !bb->ftb.tv_sec)
+        return;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    us = aenc_bench_ns(&bb->ftb, &now) / 1000;
+    if (us > UINT32_MAX)
+        us = UINT32_MAX;
+    b->lat_hist[aenc_bench_lat_bucket((uint32_t)us)]++;
+    if (us > b->lat_max_us)
+        b->lat_max_us = (uint32_t)us;
+    b->buffers++;
+    bb->ftb.tv_sec = 0;
+}
+
+/* Audio seconds encoded per wall clock second */
+static inline double aenc_bench_realtime(uint64_t in_bytes, uint64_t wall_ns,
+                                         uint32_t rate, uint32_t channels)
+{
+    double audio_ns;
+
+    if (!wall_ns || !rate || !channels)
+        return 0.0;
+    audio_ns = in_bytes * 1e9 / ((double)rate * channels * 2);
+    return audio_ns / wall_ns;
+}
+
+static inline const char *aenc_bench_mode(int use_buffer)
+{
+    switch (use_buffer) {
+    case 0:
+        return "allocate";
+    case 2:
+        return "shared";
+    default:
+        return "use";
+    }
+}
+
+static inline void aenc_bench_print(const char *codec, int session,
+                                    const struct aenc_bench_result *r,
+                                    int use_buffer)
+{
+    double wall_ms = r->wall_ns / 1e6;
+    double cpu_ms = r->cpu_ns / 1e6;
+
+    printf("BENCH: %s", codec);
+    if (session >= 0)
+        printf(" session[%d]", session);
+    printf(" buffers[%s] in[%llu] out[%llu] wall[%.3f ms] "
+           "cpu[%.3f ms] in-rate[%.2f MB/s] cpu-load[%.1f%%] "
+           "x-realtime[%.2f] fbd[%u] lat-us p50[%u] p90[%u] p99[%u] "
+           "max[%u]\n",
+           aenc_bench_mode(use_buffer),
+           (unsigned long long)r->in_bytes,
+           (unsigned long long)r->out_bytes, wall_ms, cpu_ms,
+           wall_ms > 0 ? r->in_bytes / (wall_ms * 1000.0) : 0.0,
+           wall_ms > 0 ? 100.0 * cpu_ms / wall_ms : 0.0,
+           aenc_bench_realtime(r->in_bytes, r->wall_ns, r->pcm_rate,
+                               r->pcm_channels),
+           r->buffers, r->lat_us[0], r->lat_us[1], r->lat_us[2],
+           r->lat_us[3]);
+}
+
+static inline void aenc_bench_report(const struct aenc_bench *b,
+                                     const char *codec)
+{
+    struct aenc_bench_result r;
+
+    memset(&r, 0, sizeof(r));
+    r.done = 1;
+    r.pcm_rate = b->pcm_rate;
+    r.pcm_channels = b->pcm_channels;
+    r.wall_ns = b->wall_ns;
+    r.cpu_ns = b->cpu_ns;
+    r.in_bytes = b->in_bytes;
+    r.out_bytes = b->out_bytes;
+    r.buffers = b->buffers;
+    r.lat_us[0] = aenc_bench_percentile(b, 50);
+    r.lat_us[1] = aenc_bench_percentile(b, 90);
+    r.lat_us[2] = aenc_bench_percentile(b, 99);
+    r.lat_us[3] = b->lat_max_us;
+
+    if (b->results)
+        b->results[b->session] = r;
+    else
+        aenc_bench_print(codec, -1, &r, b->use_buffer);
+}
+
+/**
+ @brief Forks the benchmark sessions
+
+ Returns straight away unless b->sessions is set. Otherwise each child
+ returns with b->session set and stdout silenced, and runs the rest of
+ the test as one session. The parent never returns: it waits for every
+ session, prints the per session and summary BENCH lines and exits with
+ 0 only if all sessions completed.
+
+ @param b bench state, sessions filled in from the command line
+ @param codec name printed in the BENCH lines
+ */
+static inline void aenc_bench_spawn(struct aenc_bench *b, const char *codec)
+{
+    struct aenc_bench_result *res;
+    pid_t pids[AENC_BENCH_MAX_SESSIONS];
+    double xrt, min_xrt = 0.0;
+    uint64_t cpu_ns = 0;
+    uint32_t worst_p99 = 0;
+    int i, status, done = 0;
+
+    if (b->sessions <= 0)
+        return;
+    if (b->sessions > AENC_BENCH_MAX_SESSIONS)
+        b->sessions = AENC_BENCH_MAX_SESSIONS;
+
+    res = (struct aenc_bench_result *)mmap(NULL,
+            sizeof(*res) * b->sessions, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (res == MAP_FAILED) {
+        perror("bench results");
+        exit(1);
+    }
+    memset(res, 0, sizeof(*res) * b->sessions);
+
+    fflush(stdout);
+    for (i = 0; i < b->sessions; i++) {
+        pids[i] = fork();
+        if (pids[i] == 0) {
+            b->session = i;
+            b->results = res;
+            if (!freopen("/dev/null", "w", stdout))
+                perror("bench stdout");
+            return;
+        }
+        if (pids[i] < 0)
+            perror("bench fork");
+    }
+
+    for (i = 0; i < b->sessions; i++) {
+        if (pids[i] > 0)
+            waitpid(pids[i], &status, 0);
+    }
+
+    for (i = 0; i < b->sessions; i++) {
+        if (!res[i].done) {
+            printf("BENCH: %s session[%d] did not complete\n", codec, i);
+            continue;
+        }
+        aenc_bench_print(codec, i, &res[i], b->use_buffer);
+        xrt = aenc_bench_realtime(res[i].in_bytes, res[i].wall_ns,
+                                  res[i].pcm_rate, res[i].pcm_channels);
+        if (!done || xrt < min_xrt)
+            min_xrt = xrt;
+        if (res[i].lat_us[2] > worst_p99)
+            worst_p99 = res[i].lat_us[2];
+        cpu_ns += res[i].cpu_ns;
+        done++;
+    }
+    printf("BENCH: %s sessions[%d] completed[%d] min-x-realtime[%.2f] "
+           "worst-p99[%u us] cpu-total[%.3f ms] sustained[%s]\n",
+           codec, b->sessions, done, min_xrt, worst_p99, cpu_ns / 1e6,
+           done == b->sessions && min_xrt >= 1.0 ? "yes" : "no");
+    munmap(res, sizeof(*res) * b->sessions);
+    exit(done == b->sessions ? 0 : 1);
+}
+
+/* Output file name of this session, OUTPUTFILE.<n> in benchmark mode */
+static inline const char *aenc_bench_name(struct aenc_bench *b,
+                                          const char *name)
+{
+    if (b->sessions <= 0)
+        return name;
+    snprintf(b->out_name, sizeof(b->out_name), "%s.%d", name, b->session);
+    return b->out_name;
+}
+
+/*
+ * Maps the rest of the input clip, from the current position of f, for
+ * aenc_bench_read(). Only done in benchmark mode; fread() is kept for
+ * the plain test runs.
+ */
+static inline int aenc_bench_map_input(struct aenc_bench *b, FILE *f)
+{
+    long pos = ftell(f);
+    long end;
+    void *map;
+    int flags = MAP_PRIVATE;
+
+    if (b->sessions <= 0 || pos < 0)
+        return 0;
+    if (fseek(f, 0, SEEK_END) || (end = ftell(f)) < pos) {
+        fseek(f, pos, SEEK_SET);
+        return -1;
+    }
+    fseek(f, pos, SEEK_SET);
+    if (end == 0)
+        return 0;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;
+#endif
+    map = mmap(NULL, end, PROT_READ, flags, fileno(f), 0);
+    if (map == MAP_FAILED)
+        return -1;
+    b->map = (const uint8_t *)map;
+    b->map_len = end;
+    b->map_pos = pos;
+    return 0;
+}
+
+/* Reads the next input chunk, from the mapping if there is one */
+static inline size_t aenc_bench_read(struct aenc_bench *b, void *dst,
+                                     size_t len, FILE *f)
+{
+    size_t n;
+
+    if (b->map) {
+        n = b->map_len - b->map_pos;
+        if (n > len)
+            n = len;
+        memcpy(dst, b->map + b->map_pos, n);
+        b->map_pos += n;
+    } else {
+        n = fread(dst, 1, len, f);
+    }
+    b->in_bytes += n;
+    return n;
+}
+
+/*
+ * Buffer mode 2: carves a buffer with AENC_SHM_HEADROOM in front out of
+ * the shared region of the port. The region is created and registered
+ * with the component for the first buffer of the port.
+ */
+static inline OMX_U8 *aenc_bench_shm_get(struct aenc_bench *b,
+                                         OMX_HANDLETYPE handle,
+                                         OMX_U32 port, OMX_U32 bytes)
+{
+    struct aenc_shm *shm = &b->shm[port & 1];
+    size_t stride = (AENC_SHM_HEADROOM + bytes + 63) & ~(size_t)63;
+    struct aenc_shm_param param;
+    OMX_INDEXTYPE index;
+    OMX_U8 *mem;
+
+    if (!b->shm_bufs[port & 1]) {
+        if (aenc_shm_alloc(shm, stride * AENC_BENCH_SHM_BUFS)) {
+            perror("bench shared memory");
+            return NULL;
+        }
+        b->shm_used[port & 1] = 0;
+        memset(&param, 0, sizeof(param));
+        param.nSize = sizeof(param);
+        param.nPortIndex = port;
+        param.nFd = shm->fd;
+        param.pBase = shm->base;
+        param.nLen = shm->len;
+        if (OMX_GetExtensionIndex(handle, (OMX_STRING)AENC_SHM_EXTENSION,
+                                  &index) != OMX_ErrorNone ||
+            OMX_SetParameter(handle, index, &param) != OMX_ErrorNone)
+            printf("port %lu: shared region not mapped by the driver, "
+                   "input is copied\n", (unsigned long)port);
+    }
+    if (b->shm_used[port & 1] + stride > shm->len)
+        return NULL;
+    mem = shm->base + b->shm_used[port & 1] + AENC_SHM_HEADROOM;
+    b->shm_used[port & 1] += stride;
+    b->shm_bufs[port & 1]++;
+    return mem;
+}
+
+static inline void aenc_bench_shm_put(struct aenc_bench *b, OMX_U32 port)
+{
+    if (b->shm_bufs[port & 1] && !--b->shm_bufs[port & 1])
+        aenc_shm_free(&b->shm[port & 1]);
+}
+
+/* Allocates one port buffer in the selected mode */
+static inline OMX_ERRORTYPE aenc_bench_alloc(OMX_HANDLETYPE handle,
+                                             OMX_BUFFERHEADERTYPE **hdr,
+                                             OMX_U32 port, OMX_U32 bytes,
+                                             struct aenc_bench *b)
+{
+    OMX_ERRORTYPE error;
+    OMX_U8 *mem;
+    struct aenc_bench_buf *bb;
+
+    bb = (struct aenc_bench_buf *)calloc(1, sizeof(*bb));
+    if (!bb)
+        return OMX_ErrorInsufficientResources;
+
+    if (!b->use_buffer) {
+        error = OMX_AllocateBuffer(handle, hdr, port, bb, bytes);
+        if (error != OMX_ErrorNone)
+            free(bb);
+        return error;
+    }
+
+    if (b->use_buffer == 2)
+        mem = aenc_bench_shm_get(b, handle, port, bytes);
+    else
+        mem = (OMX_U8 *)calloc(bytes, 1);
+    if (!mem) {
+        free(bb);
+        return OMX_ErrorInsufficientResources;
+    }
+    error = OMX_UseBuffer(handle, hdr, port, bb, bytes, mem);
+    if (error != OMX_ErrorNone) {
+        if (b->use_buffer == 2)
+            aenc_bench_shm_put(b, port);
+        else
+            free(mem);
+        free(bb);
+    }
+    return error;
+}
+
+/* Frees a buffer from aenc_bench_alloc(), including client memory */
+static inline void aenc_bench_free(OMX_HANDLETYPE handle, OMX_U32 port,
+                                   OMX_BUFFERHEADERTYPE *hdr,
+                                   struct aenc_bench *b)
+{
+    OMX_U8 *mem = hdr->pBuffer;
+    void *bb = hdr->pAppPrivate;
+
+    OMX_FreeBuffer(handle, port, hdr);
+    if (b->use_buffer == 2)
+        aenc_bench_shm_put(b, port);
+    else if (b->use_buffer)
+        free(mem);
+    free(bb);
+}
+
+#endif /* AENC_BENCH_H */
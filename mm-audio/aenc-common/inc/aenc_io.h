@@ -0,0 +1,170 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2014, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+#ifndef AENC_IO_H
+#define AENC_IO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Driver read path shared by the QDSP6 encoders.
+ *
+ * Every read() on /dev/msm_*_in returns one driver buffer laid out as
+ *   1 byte                              number of frames (n)
+ *   n * struct aenc_meta_out            per frame meta data
+ *   frame data                          located by offset_to_frame
+ * where offset_to_frame is relative to the first meta entry. The number
+ * of frames per driver buffer is set with AUDIO_SET_BUF_CFG, so batching
+ * several frames into one read() only takes a larger frames_per_buf.
+ */
+
+struct aenc_meta_out
+{
+    uint32_t offset_to_frame;
+    uint32_t frame_size;
+    uint32_t encoded_pcm_samples;
+    uint32_t msw_ts;
+    uint32_t lsw_ts;
+    uint32_t nflags;
+} __attribute__ ((packed));
+
+struct aenc_io_stats
+{
+    uint32_t reads;             /* read() calls that returned data */
+    uint32_t empty_reads;       /* read() calls that returned 0 or failed */
+    uint32_t frames;
+    uint32_t max_frames;        /* most frames seen in a single read() */
+    uint64_t bytes;
+    uint64_t in_direct_bytes;   /* input written from the client buffer */
+    uint64_t in_copied_bytes;   /* input staged through m_tmp_meta_buf */
+};
+
+static inline unsigned int aenc_io_num_frames(const uint8_t *buf)
+{
+    return buf[0];
+}
+
+static inline size_t aenc_io_meta_size(unsigned int num_frames)
+{
+    return sizeof(uint8_t) + num_frames * sizeof(struct aenc_meta_out);
+}
+
+static inline struct aenc_meta_out *aenc_io_meta(uint8_t *buf, unsigned int i)
+{
+    return (struct aenc_meta_out *)(buf + aenc_io_meta_size(i));
+}
+
+/**
+ @brief Reads one driver buffer straight into the client buffer
+
+ @param fd driver file descriptor
+ @param buf destination, normally OMX_BUFFERHEADERTYPE::pBuffer
+ @param len bytes available at buf
+ @param stats counters updated for this read, may be NULL
+ @return bytes read, 0 at end of stream or -errno
+ */
+static inline int aenc_io_read(int fd, uint8_t *buf, size_t len,
+                               struct aenc_io_stats *stats)
+{
+    ssize_t n;
+    unsigned int frames;
+
+    do {
+        n = read(fd, buf, len);
+    } while (n < 0 && errno == EINTR);
+
+    if (n <= 0 || (size_t)n < aenc_io_meta_size(0)) {
+        if (stats)
+            stats->empty_reads++;
+        return n < 0 ? -errno : 0;
+    }
+
+    if (stats) {
+        frames = aenc_io_num_frames(buf);
+        stats->reads++;
+        stats->frames += frames;
+        stats->bytes += n;
+        if (frames > stats->max_frames)
+            stats->max_frames = frames;
+    }
+    return (int)n;
+}
+
+/**
+ @brief Places a stream header in front of the first frame in place
+
+ The driver buffer must have been read to buf + hdr_len. The meta block
+ is moved down to buf, the header is written between the meta block and
+ the first frame, and the frame sizes/offsets are patched so that the
+ header is part of the first frame. The frame payload itself is not
+ moved.
+
+ @param buf client buffer, hdr_len bytes of head room then driver data
+ @param nread bytes returned by the driver read
+ @param hdr stream header to insert (e.g. ADIF)
+ @param hdr_len size of hdr
+ @return bytes now valid at buf, or -EINVAL for a malformed buffer
+ */
+static inline int aenc_io_insert_header(uint8_t *buf, size_t nread,
+                                        const uint8_t *hdr, size_t hdr_len)
+{
+    unsigned int frames = aenc_io_num_frames(buf + hdr_len);
+    size_t meta_size = aenc_io_meta_size(frames);
+    unsigned int i;
+
+    if (frames == 0 || meta_size > nread)
+        return -EINVAL;
+
+    memmove(buf, buf + hdr_len, meta_size);
+    memcpy(buf + meta_size, hdr, hdr_len);
+
+    aenc_io_meta(buf, 0)->frame_size += hdr_len;
+    for (i = 1; i < frames; i++)
+        aenc_io_meta(buf, i)->offset_to_frame += hdr_len;
+
+    return (int)(nread + hdr_len);
+}
+
+/* Average frames per driver read in hundredths, for the STATS prints */
+static inline unsigned int aenc_io_frames_per_read_x100(
+        const struct aenc_io_stats *stats)
+{
+    return stats->reads ? (unsigned int)
+        ((uint64_t)stats->frames * 100 / stats->reads) : 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AENC_IO_H */
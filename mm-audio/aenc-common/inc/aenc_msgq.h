@@ -0,0 +1,170 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2014, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+#ifndef AENC_MSGQ_H
+#define AENC_MSGQ_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <errno.h>
+#include <sched.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+/*
+ * Message queue behind the encoder command/input/output threads.
+ *
+ * Any thread may post; only the owning message thread pops. Posting is
+ * lock free (bounded ring with per cell sequence numbers) and only costs
+ * a syscall when the consumer is actually asleep on the eventfd, so a
+ * burst of messages is drained with a single wakeup.
+ */
+
+#define AENC_MSGQ_SIZE      256     /* power of two */
+
+struct aenc_msgq_cell
+{
+    uint32_t seq;
+    unsigned char id;
+};
+
+struct aenc_msgq
+{
+    struct aenc_msgq_cell cells[AENC_MSGQ_SIZE];
+    uint32_t head;              /* next slot to post, shared by producers */
+    uint32_t tail;              /* next slot to pop, consumer only */
+    int      sleeping;          /* consumer is (about to be) in read() */
+    int      efd;
+    uint32_t posted;
+    uint32_t wakeups;
+};
+
+static inline int aenc_msgq_init(struct aenc_msgq *q)
+{
+    uint32_t i;
+
+    for (i = 0; i < AENC_MSGQ_SIZE; i++)
+        q->cells[i].seq = i;
+    q->head = 0;
+    q->tail = 0;
+    q->sleeping = 0;
+    q->posted = 0;
+    q->wakeups = 0;
+    q->efd = eventfd(0, 0);
+    return q->efd < 0 ? -errno : 0;
+}
+
+static inline void aenc_msgq_deinit(struct aenc_msgq *q)
+{
+    if (q->efd >= 0)
+        close(q->efd);
+    q->efd = -1;
+}
+
+/* Unconditionally wakes the consumer, e.g. to make it notice a stop */
+static inline void aenc_msgq_wake(struct aenc_msgq *q)
+{
+    uint64_t one = 1;
+    ssize_t n;
+
+    do {
+        n = write(q->efd, &one, sizeof(one));
+    } while (n < 0 && errno == EINTR);
+}
+
+static inline void aenc_msgq_post(struct aenc_msgq *q, unsigned char id)
+{
+    struct aenc_msgq_cell *cell;
+    uint32_t pos, seq;
+    int32_t diff;
+
+    pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    for (;;) {
+        cell = &q->cells[pos & (AENC_MSGQ_SIZE - 1)];
+        seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        diff = (int32_t)(seq - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED))
+                break;
+        } else if (diff < 0) {
+            /* full: the consumer is behind, give it the CPU */
+            sched_yield();
+            pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+        } else {
+            pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+        }
+    }
+    cell->id = id;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&q->posted, 1, __ATOMIC_RELAXED);
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_exchange_n(&q->sleeping, 0, __ATOMIC_SEQ_CST))
+        aenc_msgq_wake(q);
+}
+
+/* Consumer side; returns 0 when the queue is empty */
+static inline int aenc_msgq_pop(struct aenc_msgq *q, unsigned char *id)
+{
+    struct aenc_msgq_cell *cell = &q->cells[q->tail & (AENC_MSGQ_SIZE - 1)];
+
+    if (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != q->tail + 1)
+        return 0;
+    *id = cell->id;
+    __atomic_store_n(&cell->seq, q->tail + AENC_MSGQ_SIZE, __ATOMIC_RELEASE);
+    q->tail++;
+    return 1;
+}
+
+/* Consumer side; blocks until something was posted or a wake */
+static inline void aenc_msgq_wait(struct aenc_msgq *q)
+{
+    struct aenc_msgq_cell *cell = &q->cells[q->tail & (AENC_MSGQ_SIZE - 1)];
+    uint64_t count;
+    ssize_t n;
+
+    __atomic_store_n(&q->sleeping, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) == q->tail + 1) {
+        __atomic_store_n(&q->sleeping, 0, __ATOMIC_SEQ_CST);
+        return;
+    }
+    do {
+        n = read(q->efd, &count, sizeof(count));
+    } while (n < 0 && errno == EINTR);
+    q->wakeups++;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AENC_MSGQ_H */
@@ -0,0 +1,286 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2014, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+#ifndef AENC_PIPE_H
+#define AENC_PIPE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "aenc_io.h"
+
+/*
+ * Read ahead stage for the encoder output port.
+ *
+ * A reader thread keeps up to AENC_PIPE_DEPTH driver buffers read ahead
+ * of the client, so returning a buffer to the client (and whatever the
+ * client does in FillBufferDone) overlaps with the next driver read
+ * instead of leaving the DSP without a reader. Slots are handed out in
+ * read order, each with the meta data the driver produced for it, so
+ * time stamps are the same as with direct reads.
+ *
+ * The reader only blocks in read() or when every slot is full; the
+ * latter is counted as a stall, it means the client is holding all of
+ * its output buffers.
+ *
+ * Each slot is copied into the client buffer, which costs the copy the
+ * in-place output path avoids, so the stage is opt-in: the default depth
+ * of 0 disables it and the output port reads the driver directly into
+ * the client buffer. Targets whose client is slow to return buffers can
+ * set AUDIO_FEATURE_AENC_PIPE_DEPTH.
+ */
+
+#ifndef AENC_PIPE_DEPTH
+#define AENC_PIPE_DEPTH     0
+#endif
+
+struct aenc_pipe_slot
+{
+    uint8_t *buf;
+    int len;                    /* bytes read, 0 or -errno */
+};
+
+struct aenc_pipe
+{
+    int fd;
+    size_t slot_size;
+    unsigned int depth;
+    struct aenc_pipe_slot *slot;
+    unsigned int head;          /* next slot the reader fills */
+    unsigned int tail;          /* next slot handed to the client */
+    unsigned int count;         /* filled slots */
+    int running;
+    int exit;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct aenc_io_stats *stats;
+    uint32_t max_count;         /* most slots filled at once */
+    uint32_t stalls;            /* reader waited on a full ring */
+    uint32_t dropped;           /* slots discarded by a flush */
+};
+
+static inline void aenc_pipe_init(struct aenc_pipe *ap)
+{
+    memset(ap, 0, sizeof(*ap));
+    ap->fd = -1;
+    pthread_mutex_init(&ap->lock, NULL);
+    pthread_cond_init(&ap->cond, NULL);
+}
+
+static inline void aenc_pipe_deinit(struct aenc_pipe *ap)
+{
+    pthread_mutex_destroy(&ap->lock);
+    pthread_cond_destroy(&ap->cond);
+}
+
+static inline void *aenc_pipe_reader(void *arg)
+{
+    struct aenc_pipe *ap = (struct aenc_pipe *)arg;
+    struct aenc_pipe_slot *slot;
+    int n;
+
+    pthread_mutex_lock(&ap->lock);
+    while (!ap->exit) {
+        if (ap->count == ap->depth) {
+            ap->stalls++;
+            while (ap->count == ap->depth && !ap->exit)
+                pthread_cond_wait(&ap->cond, &ap->lock);
+            continue;
+        }
+        slot = &ap->slot[ap->head];
+        pthread_mutex_unlock(&ap->lock);
+
+        n = aenc_io_read(ap->fd, slot->buf, ap->slot_size, ap->stats);
+
+        pthread_mutex_lock(&ap->lock);
+        slot->len = n;
+        ap->head = (ap->head + 1) % ap->depth;
+        ap->count++;
+        if (ap->count > ap->max_count)
+            ap->max_count = ap->count;
+        pthread_cond_broadcast(&ap->cond);
+    }
+    pthread_mutex_unlock(&ap->lock);
+    return NULL;
+}
+
+/**
+ @brief Starts reading ahead, call once the driver is started
+
+ @param ap read ahead stage of the output port
+ @param fd driver file descriptor
+ @param slot_size bytes per driver read, the output buffer size
+ @param depth number of slots, 0 leaves the stage off
+ @param stats read counters, updated by the reader thread
+ @return 0, or -errno if the stage could not be started
+ */
+static inline int aenc_pipe_start(struct aenc_pipe *ap, int fd,
+                                  size_t slot_size, unsigned int depth,
+                                  struct aenc_io_stats *stats)
+{
+    unsigned int i;
+    uint8_t *mem;
+
+    if (ap->running || !depth)
+        return 0;
+
+    ap->slot = (struct aenc_pipe_slot *)calloc(depth, sizeof(*ap->slot));
+    mem = (uint8_t *)malloc(depth * slot_size);
+    if (!ap->slot || !mem) {
+        free(ap->slot);
+        free(mem);
+        ap->slot = NULL;
+        return -ENOMEM;
+    }
+    for (i = 0; i < depth; i++)
+        ap->slot[i].buf = mem + i * slot_size;
+
+    ap->fd = fd;
+    ap->slot_size = slot_size;
+    ap->depth = depth;
+    ap->head = ap->tail = ap->count = 0;
+    ap->stats = stats;
+    ap->exit = 0;
+    if (pthread_create(&ap->thread, NULL, aenc_pipe_reader, ap)) {
+        free(mem);
+        free(ap->slot);
+        ap->slot = NULL;
+        return -EAGAIN;
+    }
+    ap->running = 1;
+    return 0;
+}
+
+/**
+ @brief Stops the reader, call after AUDIO_STOP so a pending read returns
+
+ Idempotent; a waiting aenc_pipe_get() returns 0.
+ */
+static inline void aenc_pipe_stop(struct aenc_pipe *ap)
+{
+    if (!ap->running)
+        return;
+
+    pthread_mutex_lock(&ap->lock);
+    ap->exit = 1;
+    pthread_cond_broadcast(&ap->cond);
+    pthread_mutex_unlock(&ap->lock);
+    pthread_join(ap->thread, NULL);
+
+    pthread_mutex_lock(&ap->lock);
+    ap->running = 0;
+    ap->count = 0;
+    free(ap->slot[0].buf);
+    free(ap->slot);
+    ap->slot = NULL;
+    pthread_mutex_unlock(&ap->lock);
+}
+
+/**
+ @brief Copies the oldest read ahead buffer to the client
+
+ Blocks until the reader has a buffer.
+
+ @param ap read ahead stage of the output port
+ @param dst client buffer
+ @param len bytes available at dst
+ @return bytes copied, 0 at end of stream or once stopped, or -errno
+ */
+static inline int aenc_pipe_get(struct aenc_pipe *ap, uint8_t *dst,
+                                size_t len)
+{
+    struct aenc_pipe_slot *slot;
+    int n;
+
+    pthread_mutex_lock(&ap->lock);
+    while (!ap->count && !ap->exit)
+        pthread_cond_wait(&ap->cond, &ap->lock);
+    if (!ap->count) {
+        pthread_mutex_unlock(&ap->lock);
+        return 0;
+    }
+    slot = &ap->slot[ap->tail];
+    n = slot->len;
+    if (n > 0) {
+        if ((size_t)n > len)
+            n = (int)len;
+        memcpy(dst, slot->buf, n);
+    }
+    ap->tail = (ap->tail + 1) % ap->depth;
+    ap->count--;
+    pthread_cond_broadcast(&ap->cond);
+    pthread_mutex_unlock(&ap->lock);
+    return n;
+}
+
+/* Output port read: from the read ahead stage if running, else the driver */
+static inline int aenc_pipe_read(struct aenc_pipe *ap, int fd, uint8_t *dst,
+                                 size_t len, struct aenc_io_stats *stats)
+{
+    if (ap->running)
+        return aenc_pipe_get(ap, dst, len);
+    return aenc_io_read(fd, dst, len, stats);
+}
+
+/**
+ @brief Discards the read ahead buffers on an output port flush
+
+ @return number of encoded frames discarded, so callers that derive
+ time stamps from a frame count can keep them continuous
+ */
+static inline unsigned int aenc_pipe_flush(struct aenc_pipe *ap)
+{
+    unsigned int frames = 0;
+    struct aenc_pipe_slot *slot;
+
+    if (!ap->running)
+        return 0;
+
+    pthread_mutex_lock(&ap->lock);
+    while (ap->count) {
+        slot = &ap->slot[ap->tail];
+        if (slot->len > 0)
+            frames += aenc_io_num_frames(slot->buf);
+        ap->tail = (ap->tail + 1) % ap->depth;
+        ap->count--;
+        ap->dropped++;
+    }
+    pthread_cond_broadcast(&ap->cond);
+    pthread_mutex_unlock(&ap->lock);
+    return frames;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* AENC_PIPE_H */
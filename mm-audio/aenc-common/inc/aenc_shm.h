@@ -0,0 +1,247 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2014, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+#ifndef AENC_SHM_H
+#define AENC_SHM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/msm_audio.h>
+#include "OMX_Core.h"
+
+/*
+ * Client buffers shared with the encoder driver.
+ *
+ * A client that owns fd backed memory (ION on target, a memfd on a host
+ * running the stub driver) hands the region to the component once per
+ * port with the AENC_SHM_EXTENSION parameter, before OMX_UseBuffer. The
+ * component registers it with AUDIO_REGISTER_ION and then treats every
+ * OMX_UseBuffer pointer inside a registered region as shared:
+ *   - input buffers go to the driver in place. The AENC_SHM_HEADROOM
+ *     bytes in front of each input buffer belong to the component, which
+ *     writes META_IN there instead of staging the PCM in its private
+ *     copy
+ *   - output buffers are read into directly, as every output buffer is
+ * A region the driver refuses to map makes set_parameter fail with
+ * OMX_ErrorUnsupportedSetting; buffers in it, like any other client
+ * buffer, then go through the private copy.
+ */
+
+#define AENC_SHM_EXTENSION      "OMX.Qualcomm.index.audio.sharedBuffer"
+#define AENC_SHM_INDEX          ((OMX_INDEXTYPE)(OMX_IndexVendorStartUnused + 0xAE0))
+#define AENC_SHM_HEADROOM       32      /* >= sizeof(META_IN) of any encoder */
+#define AENC_SHM_MAX_REGIONS    4
+
+/* AENC_SHM_INDEX parameter, describes one region of client memory */
+struct aenc_shm_param
+{
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_S32 nFd;                /* kept open by the client while in use */
+    OMX_U8 *pBase;              /* mapping of nFd at offset 0 */
+    OMX_U32 nLen;
+};
+
+struct aenc_shm
+{
+    int fd;
+    OMX_U32 port;
+    uint8_t *base;
+    size_t len;
+};
+
+struct aenc_shm_pool
+{
+    struct aenc_shm region[AENC_SHM_MAX_REGIONS];
+    int drv_fd;
+    uint32_t shared_bufs;       /* use_buffer calls in a region */
+};
+
+static inline void aenc_shm_pool_init(struct aenc_shm_pool *pool, int drv_fd)
+{
+    unsigned int i;
+
+    memset(pool, 0, sizeof(*pool));
+    for (i = 0; i < AENC_SHM_MAX_REGIONS; i++)
+        pool->region[i].fd = -1;
+    pool->drv_fd = drv_fd;
+}
+
+/* Registers (reg) or deregisters a region with the driver */
+static inline int aenc_shm_ion(int drv_fd, int reg, const struct aenc_shm *shm)
+{
+#ifdef AUDIO_REGISTER_ION
+    struct msm_audio_ion_info info;
+
+    info.fd = shm->fd;
+    info.vaddr = shm->base;
+    if (ioctl(drv_fd, reg ? AUDIO_REGISTER_ION : AUDIO_DEREGISTER_ION,
+              &info) < 0)
+        return -errno;
+    return 0;
+#else
+    (void)drv_fd;
+    (void)reg;
+    (void)shm;
+    return -ENOSYS;
+#endif
+}
+
+/**
+ @brief Registers a client region with the driver
+
+ @param pool shared regions of the component
+ @param param region from the client
+ @return 0, -ENOSPC if all slots are taken or the error of the driver,
+         typically because it cannot map this kind of memory
+ */
+static inline int aenc_shm_pool_add(struct aenc_shm_pool *pool,
+                                    const struct aenc_shm_param *param)
+{
+    struct aenc_shm *shm = NULL;
+    unsigned int i;
+    int ret;
+
+    if (param->nFd < 0 || !param->pBase || !param->nLen)
+        return -EINVAL;
+    for (i = 0; i < AENC_SHM_MAX_REGIONS && !shm; i++) {
+        if (pool->region[i].fd < 0)
+            shm = &pool->region[i];
+    }
+    if (!shm)
+        return -ENOSPC;
+
+    shm->fd = dup(param->nFd);
+    if (shm->fd < 0)
+        return -errno;
+    shm->port = param->nPortIndex;
+    shm->base = param->pBase;
+    shm->len = param->nLen;
+    ret = aenc_shm_ion(pool->drv_fd, 1, shm);
+    if (ret) {
+        close(shm->fd);
+        shm->fd = -1;
+    }
+    return ret;
+}
+
+/**
+ @brief Tells whether [buf - head, buf + len) lies in a region of port
+
+ @return true if the buffer can be handed to the driver in place
+ */
+static inline int aenc_shm_pool_find(const struct aenc_shm_pool *pool,
+                                     OMX_U32 port, const uint8_t *buf,
+                                     size_t head, size_t len)
+{
+    const struct aenc_shm *shm;
+    unsigned int i;
+
+    for (i = 0; i < AENC_SHM_MAX_REGIONS; i++) {
+        shm = &pool->region[i];
+        if (shm->fd < 0 || shm->port != port)
+            continue;
+        if (buf >= shm->base + head && len <= shm->len &&
+            (size_t)(buf - shm->base) <= shm->len - len)
+            return 1;
+    }
+    return 0;
+}
+
+/* Deregisters every region; the driver must still be open */
+static inline void aenc_shm_pool_deinit(struct aenc_shm_pool *pool)
+{
+    unsigned int i;
+
+    for (i = 0; i < AENC_SHM_MAX_REGIONS; i++) {
+        if (pool->region[i].fd < 0)
+            continue;
+        aenc_shm_ion(pool->drv_fd, 0, &pool->region[i]);
+        close(pool->region[i].fd);
+        pool->region[i].fd = -1;
+    }
+    pool->shared_bufs = 0;
+}
+
+/**
+ @brief Client side: maps len bytes of memfd backed memory
+
+ Stand-in for an ION allocation on hosts without ION.
+
+ @param shm filled in with the region
+ @return 0 or -errno
+ */
+static inline int aenc_shm_alloc(struct aenc_shm *shm, size_t len)
+{
+    void *base;
+    int fd;
+
+#ifdef __NR_memfd_create
+    fd = syscall(__NR_memfd_create, "aenc_shm", 1 /* MFD_CLOEXEC */);
+#else
+    fd = -1;
+    errno = ENOSYS;
+#endif
+    if (fd < 0)
+        return -errno;
+    if (ftruncate(fd, len) < 0) {
+        close(fd);
+        return -errno;
+    }
+    base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return -errno;
+    }
+    shm->fd = fd;
+    shm->base = (uint8_t *)base;
+    shm->len = len;
+    return 0;
+}
+
+static inline void aenc_shm_free(struct aenc_shm *shm)
+{
+    if (shm->fd < 0)
+        return;
+    munmap(shm->base, shm->len);
+    close(shm->fd);
+    shm->fd = -1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* AENC_SHM_H */
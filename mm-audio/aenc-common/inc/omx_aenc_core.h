@@ -0,0 +1,1240 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2014, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+#ifndef OMX_AENC_CORE_H
+#define OMX_AENC_CORE_H
+
+/*
+ * Codec independent pieces of the QDSP6 OMX encoder components.
+ *
+ * Each component describes its codec with a traits structure and gets
+ * a compile time specialization of the shared code:
+ *
+ *   struct aenc_xxx_traits
+ *   {
+ *       static const char *device() { return "/dev/msm_xxx_in"; }
+ *       enum
+ *       {
+ *           frame_duration_us = 20000,  // 0: set at run time
+ *           dsp_timestamps = 1,         // use time stamps from meta data
+ *           frames_per_buf = 1,         // encoded frames per driver read
+ *       };
+ *   };
+ *
+ * The OMX state machine and the port/buffer bookkeeping live in
+ * aenc_core<Comp>, which the component befriends. The component keeps
+ * the codec specific driver setup behind three hooks:
+ *
+ *   void configure_encoder();        // codec ioctls before AUDIO_START
+ *   void configure_pcm(struct msm_audio_config *pcm_cfg);
+ *                                    // tweak the PCM config (tunnel less)
+ *   void reset_encoder();            // encoder stopped on Idle->Loaded
+ *
+ * Client memory shared with the driver (aenc_shm.h) is kept in the
+ * component's m_shm pool.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <linux/msm_audio.h>
+#include "OMX_Core.h"
+#include "aenc_io.h"
+#include "aenc_pipe.h"
+#include "aenc_shm.h"
+
+#ifndef DEBUG_PRINT_ERROR
+#define DEBUG_PRINT_ERROR(...)
+#endif
+#ifndef DEBUG_PRINT
+#define DEBUG_PRINT(...)
+#endif
+#ifndef DEBUG_DETAIL
+#define DEBUG_DETAIL(...)
+#endif
+
+#define AENC_CORE_SPEC_VERSION  0x00000101
+
+// Fixed size FIFO of component events, one per thread and direction
+template <unsigned SIZE>
+struct aenc_cmd_queue
+{
+    struct omx_event
+    {
+        unsigned param1;
+        unsigned param2;
+        unsigned id;
+    };
+
+    omx_event m_q[SIZE];
+    unsigned m_read;
+    unsigned m_write;
+    unsigned m_size;
+
+    aenc_cmd_queue() : m_read(0), m_write(0), m_size(0)
+    {
+        memset(m_q, 0, sizeof(m_q));
+    }
+
+    bool insert_entry(unsigned p1, unsigned p2, unsigned id)
+    {
+        if (m_size >= SIZE)
+        {
+            DEBUG_PRINT_ERROR("ERROR!!! Command Queue Full");
+            return false;
+        }
+        m_q[m_write].id       = id;
+        m_q[m_write].param1   = p1;
+        m_q[m_write].param2   = p2;
+        m_write = (m_write + 1) % SIZE;
+        m_size++;
+        return true;
+    }
+
+    bool pop_entry(unsigned *p1, unsigned *p2, unsigned *id)
+    {
+        if (m_size == 0)
+        {
+            DEBUG_PRINT_ERROR("ERROR Delete!!! Command Queue Empty");
+            return false;
+        }
+        *id = m_q[m_read].id;
+        *p1 = m_q[m_read].param1;
+        *p2 = m_q[m_read].param2;
+        m_read = (m_read + 1) % SIZE;
+        m_size--;
+        return true;
+    }
+
+    bool get_msg_id(unsigned *id)
+    {
+        if (m_size == 0)
+            return false;
+        *id = m_q[m_read].id;
+        return true;
+    }
+};
+
+/**
+ @brief Fills the OMX output header from the driver meta data
+
+ @param buffer output buffer holding a driver read
+ @param nread bytes returned by the driver
+ @param extra bytes inserted in front of the first frame (e.g. ADIF)
+ @param ts running time stamp, only used without DSP time stamps
+ @param frame_duration_us frame duration if Traits leaves it at 0
+ */
+template <typename Traits>
+inline void aenc_core_set_output(OMX_BUFFERHEADERTYPE *buffer, int nread,
+                                 unsigned extra, OMX_U64 *ts,
+                                 unsigned frame_duration_us =
+                                     Traits::frame_duration_us)
+{
+    struct aenc_meta_out *meta = aenc_io_meta(buffer->pBuffer, 0);
+
+    buffer->nFlags |= meta->nflags;
+    buffer->nOffset = meta->offset_to_frame + sizeof(unsigned char);
+    buffer->nFilledLen = nread - buffer->nOffset + extra;
+    if (Traits::dsp_timestamps)
+    {
+        buffer->nTimeStamp = ((OMX_TICKS)meta->msw_ts << 32) + meta->lsw_ts;
+    }
+    else
+    {
+        *ts += (OMX_U64)frame_duration_us *
+               aenc_io_num_frames(buffer->pBuffer);
+        buffer->nTimeStamp = *ts;
+    }
+}
+
+/**
+ @brief OMX state machine and port/buffer bookkeeping shared by the encoders
+
+ Every function takes the component it works on; Comp declares
+ aenc_core<Comp> a friend so the core can use its private state.
+ */
+template <typename Comp>
+struct aenc_core
+{
+    static OMX_ERRORTYPE send_command_proxy(Comp *c, OMX_HANDLETYPE hComp,
+                                            OMX_COMMANDTYPE cmd,
+                                            OMX_U32 param1, OMX_PTR cmdData);
+
+    static OMX_ERRORTYPE allocate_buffer(Comp *c, OMX_HANDLETYPE hComp,
+                                         OMX_BUFFERHEADERTYPE **bufferHdr,
+                                         OMX_U32 port, OMX_PTR appData,
+                                         OMX_U32 bytes);
+
+    static OMX_ERRORTYPE use_buffer(Comp *c, OMX_HANDLETYPE hComp,
+                                    OMX_BUFFERHEADERTYPE **bufferHdr,
+                                    OMX_U32 port, OMX_PTR appData,
+                                    OMX_U32 bytes, OMX_U8 *buffer);
+
+    static OMX_ERRORTYPE free_buffer(Comp *c, OMX_HANDLETYPE hComp,
+                                     OMX_U32 port,
+                                     OMX_BUFFERHEADERTYPE *buffer);
+
+    static OMX_ERRORTYPE set_shared_buffer(Comp *c,
+                                           const struct aenc_shm_param *param);
+
+    static bool allocate_done(Comp *c);
+
+    static bool release_done(Comp *c, OMX_U32 param1);
+
+    static bool search_input_bufhdr(Comp *c, OMX_BUFFERHEADERTYPE *buffer);
+
+    static bool search_output_bufhdr(Comp *c, OMX_BUFFERHEADERTYPE *buffer);
+
+private:
+    static bool flag_present(Comp *c, unsigned bit)
+    {
+        return (c->m_flags & (1 << bit)) != 0;
+    }
+
+    static void flag_set(Comp *c, unsigned bit)
+    {
+        c->m_flags |= (1 << bit);
+    }
+
+    static void flag_clear(Comp *c, unsigned bit)
+    {
+        c->m_flags &= ~(1 << bit);
+    }
+
+    static OMX_ERRORTYPE report_error(Comp *c, OMX_ERRORTYPE err)
+    {
+        c->m_cb.EventHandler(&c->m_cmp, c->m_app_data, OMX_EventError,
+                             err, 0, NULL);
+        return err;
+    }
+
+    static OMX_ERRORTYPE go_invalid(Comp *c)
+    {
+        c->m_state = OMX_StateInvalid;
+        return report_error(c, OMX_ErrorInvalidState);
+    }
+
+    static void wake_in_thread(Comp *c)
+    {
+        pthread_mutex_lock(&c->m_in_th_lock_1);
+        if (c->is_in_th_sleep)
+        {
+            c->is_in_th_sleep = false;
+            DEBUG_DETAIL("WAKING UP IN THREAD\n");
+            c->in_th_wakeup();
+        }
+        pthread_mutex_unlock(&c->m_in_th_lock_1);
+    }
+
+    static void wake_out_thread(Comp *c)
+    {
+        pthread_mutex_lock(&c->m_out_th_lock_1);
+        if (c->is_out_th_sleep)
+        {
+            c->is_out_th_sleep = false;
+            DEBUG_DETAIL("WAKING UP OUT THREAD\n");
+            c->out_th_wakeup();
+        }
+        pthread_mutex_unlock(&c->m_out_th_lock_1);
+    }
+
+    static void stop_encoder(Comp *c)
+    {
+        if (ioctl(c->m_drv_fd, AUDIO_STOP, 0) == -1)
+        {
+            DEBUG_PRINT_ERROR("AUDIO_STOP failed, errno[%d]\n", errno);
+        }
+        aenc_pipe_stop(&c->m_pipe);
+    }
+
+    static OMX_ERRORTYPE start_encoder(Comp *c);
+
+    static void complete_allocation(Comp *c, OMX_U32 port);
+
+    static OMX_ERRORTYPE allocate_input_buffer(Comp *c, OMX_HANDLETYPE hComp,
+                                               OMX_BUFFERHEADERTYPE **bufferHdr,
+                                               OMX_PTR appData, OMX_U32 bytes);
+
+    static OMX_ERRORTYPE allocate_output_buffer(Comp *c, OMX_HANDLETYPE hComp,
+                                                OMX_BUFFERHEADERTYPE **bufHdr,
+                                                OMX_PTR appData, OMX_U32 bytes);
+
+    static OMX_ERRORTYPE use_port_buffer(Comp *c, OMX_HANDLETYPE hComp,
+                                         OMX_BUFFERHEADERTYPE **bufferHdr,
+                                         OMX_U32 port, OMX_PTR appData,
+                                         OMX_U32 bytes, OMX_U8 *buffer);
+};
+
+/**
+ @brief configures the driver and moves the encoder from Idle to Executing
+
+ @param c component
+ @return OMX_ErrorInvalidState if the DSP session did not start
+ */
+template <typename Comp>
+OMX_ERRORTYPE aenc_core<Comp>::start_encoder(Comp *c)
+{
+    struct msm_audio_stream_config drv_stream_config;
+    struct msm_audio_buf_cfg buf_cfg;
+    struct msm_audio_config pcm_cfg;
+
+    if (ioctl(c->m_drv_fd, AUDIO_GET_STREAM_CONFIG, &drv_stream_config) == -1)
+    {
+        DEBUG_PRINT_ERROR("ioctl AUDIO_GET_STREAM_CONFIG failed, errno[%d]\n",
+                          errno);
+    }
+    if (ioctl(c->m_drv_fd, AUDIO_SET_STREAM_CONFIG, &drv_stream_config) == -1)
+    {
+        DEBUG_PRINT_ERROR("ioctl AUDIO_SET_STREAM_CONFIG failed, errno[%d]\n",
+                          errno);
+    }
+
+    c->configure_encoder();
+
+    if (ioctl(c->m_drv_fd, AUDIO_GET_BUF_CFG, &buf_cfg) == -1)
+    {
+        DEBUG_PRINT_ERROR("ioctl AUDIO_GET_BUF_CFG, errno[%d]\n", errno);
+    }
+    buf_cfg.meta_info_enable = 1;
+    buf_cfg.frames_per_buf = Comp::traits::frames_per_buf;
+    if (ioctl(c->m_drv_fd, AUDIO_SET_BUF_CFG, &buf_cfg) == -1)
+    {
+        DEBUG_PRINT_ERROR("ioctl AUDIO_SET_BUF_CFG, errno[%d]\n", errno);
+    }
+    if (c->pcm_input)
+    {
+        if (ioctl(c->m_drv_fd, AUDIO_GET_CONFIG, &pcm_cfg) == -1)
+        {
+            DEBUG_PRINT_ERROR("ioctl AUDIO_GET_CONFIG, errno[%d]\n", errno);
+        }
+        pcm_cfg.channel_count = c->m_pcm_param.nChannels;
+        pcm_cfg.sample_rate = c->m_pcm_param.nSamplingRate;
+        c->configure_pcm(&pcm_cfg);
+        DEBUG_PRINT("pcm config %lu %lu\n", c->m_pcm_param.nChannels,
+                    c->m_pcm_param.nSamplingRate);
+        if (ioctl(c->m_drv_fd, AUDIO_SET_CONFIG, &pcm_cfg) == -1)
+        {
+            DEBUG_PRINT_ERROR("ioctl AUDIO_SET_CONFIG, errno[%d]\n", errno);
+        }
+    }
+    if (ioctl(c->m_drv_fd, AUDIO_START, 0) == -1)
+    {
+        DEBUG_PRINT_ERROR("ioctl AUDIO_START failed, errno[%d]\n", errno);
+        return go_invalid(c);
+    }
+    if (aenc_pipe_start(&c->m_pipe, c->m_drv_fd, c->output_buffer_size,
+                        AENC_PIPE_DEPTH, &c->m_io_stats))
+    {
+        DEBUG_PRINT_ERROR("SCP:read ahead not started, reading "
+                          "the driver directly\n");
+    }
+    return OMX_ErrorNone;
+}
+
+/**
+ @brief member function performs actual processing of commands excluding
+  empty buffer call
+
+ @param c component
+ @param hComp handle to component
+ @param cmd command type
+ @param param1 parameter associated with the command
+ @param cmdData
+
+ @return error status
+*/
+template <typename Comp>
+OMX_ERRORTYPE aenc_core<Comp>::send_command_proxy(Comp *c,
+                                                  OMX_HANDLETYPE hComp,
+                                                  OMX_COMMANDTYPE cmd,
+                                                  OMX_U32 param1,
+                                                  OMX_PTR cmdData)
+{
+    OMX_ERRORTYPE eRet = OMX_ErrorNone;
+    OMX_STATETYPE eState = (OMX_STATETYPE) param1;
+    int bFlag = 1;
+
+    (void)cmdData;
+    c->nState = eState;
+
+    if (hComp == NULL)
+    {
+        DEBUG_PRINT_ERROR("Returning OMX_ErrorBadParameter\n");
+        return OMX_ErrorBadParameter;
+    }
+    if (OMX_CommandStateSet == cmd)
+    {
+        DEBUG_PRINT("OMXCORE-SM: %d --> %d\n", c->m_state, eState);
+
+        /***************************/
+        /* Current State is Loaded */
+        /***************************/
+        if (OMX_StateLoaded == c->m_state)
+        {
+            if (OMX_StateIdle == eState)
+            {
+                if (allocate_done(c) ||
+                    (c->m_inp_bEnabled == OMX_FALSE &&
+                     c->m_out_bEnabled == OMX_FALSE))
+                {
+                    DEBUG_PRINT("SCP-->Allocate Done Complete\n");
+                } else
+                {
+                    DEBUG_PRINT("SCP-->Loaded to Idle-Pending\n");
+                    flag_set(c, Comp::OMX_COMPONENT_IDLE_PENDING);
+                    bFlag = 0;
+                }
+            } else if (OMX_StateLoaded == eState)
+            {
+                eRet = report_error(c, OMX_ErrorSameState);
+            } else if (OMX_StateWaitForResources == eState)
+            {
+                eRet = OMX_ErrorNone;
+            } else if (OMX_StateExecuting == eState ||
+                       OMX_StatePause == eState)
+            {
+                eRet = report_error(c, OMX_ErrorIncorrectStateTransition);
+            } else if (OMX_StateInvalid == eState)
+            {
+                eRet = go_invalid(c);
+            } else
+            {
+                DEBUG_PRINT_ERROR("SCP-->Loaded to Invalid(%d))\n", eState);
+                eRet = OMX_ErrorBadParameter;
+            }
+        }
+
+        /***************************/
+        /* Current State is IDLE */
+        /***************************/
+        else if (OMX_StateIdle == c->m_state)
+        {
+            if (OMX_StateLoaded == eState)
+            {
+                if (release_done(c, -1))
+                {
+                    stop_encoder(c);
+                    c->nTimestamp = 0;
+                    c->reset_encoder();
+                    DEBUG_PRINT("SCP-->Idle to Loaded\n");
+                } else
+                {
+                    DEBUG_PRINT("SCP--> Idle to Loaded-Pending\n");
+                    flag_set(c, Comp::OMX_COMPONENT_LOADING_PENDING);
+                    // Skip the event notification
+                    bFlag = 0;
+                }
+            } else if (OMX_StateExecuting == eState)
+            {
+                eRet = start_encoder(c);
+                DEBUG_PRINT("SCP-->Idle to Executing\n");
+                c->nState = eState;
+            } else if (OMX_StateIdle == eState)
+            {
+                eRet = report_error(c, OMX_ErrorSameState);
+            } else if (OMX_StateWaitForResources == eState)
+            {
+                eRet = report_error(c, OMX_ErrorIncorrectStateTransition);
+            } else if (OMX_StatePause == eState)
+            {
+                DEBUG_PRINT("OMXCORE-SM: Idle-->Pause\n");
+            } else if (OMX_StateInvalid == eState)
+            {
+                eRet = go_invalid(c);
+            } else
+            {
+                DEBUG_PRINT_ERROR("SCP--> Idle to %d Not Handled\n", eState);
+                eRet = OMX_ErrorBadParameter;
+            }
+        }
+
+        /******************************/
+        /* Current State is Executing */
+        /******************************/
+        else if (OMX_StateExecuting == c->m_state)
+        {
+            if (OMX_StateIdle == eState)
+            {
+                DEBUG_PRINT("SCP-->Executing to Idle \n");
+                c->execute_omx_flush(c->pcm_input ? -1 : 1, false);
+            } else if (OMX_StatePause == eState)
+            {
+                DEBUG_PRINT("SCP-->RXED PAUSE STATE\n");
+            } else if (OMX_StateLoaded == eState ||
+                       OMX_StateWaitForResources == eState)
+            {
+                eRet = report_error(c, OMX_ErrorIncorrectStateTransition);
+            } else if (OMX_StateExecuting == eState)
+            {
+                eRet = report_error(c, OMX_ErrorSameState);
+            } else if (OMX_StateInvalid == eState)
+            {
+                eRet = go_invalid(c);
+            } else
+            {
+                DEBUG_PRINT_ERROR("SCP--> Executing to %d Not Handled\n",
+                                  eState);
+                eRet = OMX_ErrorBadParameter;
+            }
+        }
+
+        /***************************/
+        /* Current State is Pause  */
+        /***************************/
+        else if (OMX_StatePause == c->m_state)
+        {
+            if (OMX_StateExecuting == eState || OMX_StateIdle == eState)
+            {
+                wake_out_thread(c);
+            }
+            if (OMX_StateExecuting == eState)
+            {
+                c->nState = eState;
+            } else if (OMX_StateIdle == eState)
+            {
+                DEBUG_PRINT("SCP-->Paused to Idle, internal flush issued\n");
+                pthread_mutex_lock(&c->m_flush_lock);
+                c->m_flush_cnt = 2;
+                pthread_mutex_unlock(&c->m_flush_lock);
+                c->execute_omx_flush(c->pcm_input ? -1 : 1, false);
+            } else if (OMX_StateLoaded == eState ||
+                       OMX_StateWaitForResources == eState)
+            {
+                eRet = report_error(c, OMX_ErrorIncorrectStateTransition);
+            } else if (OMX_StatePause == eState)
+            {
+                eRet = report_error(c, OMX_ErrorSameState);
+            } else if (OMX_StateInvalid == eState)
+            {
+                eRet = go_invalid(c);
+            } else
+            {
+                DEBUG_PRINT("SCP-->Paused to %d Not Handled\n", eState);
+                eRet = OMX_ErrorBadParameter;
+            }
+        }
+
+        /**************************************/
+        /* Current State is WaitForResources  */
+        /**************************************/
+        else if (OMX_StateWaitForResources == c->m_state)
+        {
+            if (OMX_StateLoaded == eState)
+            {
+                DEBUG_PRINT("OMXCORE-SM: WaitForResources-->Loaded\n");
+            } else if (OMX_StateWaitForResources == eState)
+            {
+                eRet = report_error(c, OMX_ErrorSameState);
+            } else if (OMX_StateExecuting == eState ||
+                       OMX_StatePause == eState)
+            {
+                eRet = report_error(c, OMX_ErrorIncorrectStateTransition);
+            } else if (OMX_StateInvalid == eState)
+            {
+                eRet = go_invalid(c);
+            } else
+            {
+                DEBUG_PRINT_ERROR("SCP--> %d to %d(Not Handled)\n",
+                                  c->m_state, eState);
+                eRet = OMX_ErrorBadParameter;
+            }
+        }
+
+        /****************************/
+        /* Current State is Invalid */
+        /****************************/
+        else if (OMX_StateInvalid == c->m_state)
+        {
+            if (OMX_StateLoaded == eState || OMX_StateWaitForResources == eState
+                || OMX_StateIdle == eState || OMX_StateExecuting == eState
+                || OMX_StatePause == eState || OMX_StateInvalid == eState)
+            {
+                eRet = go_invalid(c);
+            }
+        } else
+        {
+            DEBUG_PRINT_ERROR("OMXCORE-SM: %d --> %d(Not Handled)\n",
+                              c->m_state, eState);
+            eRet = OMX_ErrorBadParameter;
+        }
+    } else if (OMX_CommandFlush == cmd)
+    {
+        DEBUG_PRINT("SCP-->RXED FLUSH COMMAND port=%lu\n", param1);
+        bFlag = 0;
+        if (param1 == Comp::OMX_CORE_INPUT_PORT_INDEX ||
+            param1 == Comp::OMX_CORE_OUTPUT_PORT_INDEX ||
+            (signed)param1 == -1)
+        {
+            c->execute_omx_flush(param1);
+        } else
+        {
+            eRet = OMX_ErrorBadPortIndex;
+            c->m_cb.EventHandler(&c->m_cmp, c->m_app_data, OMX_EventError,
+                                 OMX_CommandFlush, OMX_ErrorBadPortIndex, NULL);
+        }
+    } else if (OMX_CommandPortDisable == cmd)
+    {
+        bFlag = 0;
+        if (param1 == Comp::OMX_CORE_INPUT_PORT_INDEX || param1 == OMX_ALL)
+        {
+            DEBUG_PRINT("SCP: Disabling Input port Indx\n");
+            c->m_inp_bEnabled = OMX_FALSE;
+            if ((c->m_state == OMX_StateLoaded ||
+                 c->m_state == OMX_StateIdle) && release_done(c, 0))
+            {
+                c->post_command(OMX_CommandPortDisable,
+                                Comp::OMX_CORE_INPUT_PORT_INDEX,
+                                Comp::OMX_COMPONENT_GENERATE_EVENT);
+            } else
+            {
+                if (c->m_state == OMX_StatePause ||
+                    c->m_state == OMX_StateExecuting)
+                {
+                    DEBUG_PRINT("SCP: execute_omx_flush in Disable in "
+                                "param1=%lu m_state=%d\n", param1, c->m_state);
+                    c->execute_omx_flush(param1);
+                }
+                // Skip the event notification
+                flag_set(c, Comp::OMX_COMPONENT_INPUT_DISABLE_PENDING);
+            }
+        }
+        if (param1 == Comp::OMX_CORE_OUTPUT_PORT_INDEX || param1 == OMX_ALL)
+        {
+            DEBUG_PRINT("SCP: Disabling Output port Indx\n");
+            c->m_out_bEnabled = OMX_FALSE;
+            if ((c->m_state == OMX_StateLoaded ||
+                 c->m_state == OMX_StateIdle) && release_done(c, 1))
+            {
+                c->post_command(OMX_CommandPortDisable,
+                                Comp::OMX_CORE_OUTPUT_PORT_INDEX,
+                                Comp::OMX_COMPONENT_GENERATE_EVENT);
+            } else
+            {
+                if (c->m_state == OMX_StatePause ||
+                    c->m_state == OMX_StateExecuting)
+                {
+                    DEBUG_PRINT("SCP: execute_omx_flush in Disable out "
+                                "param1=%lu m_state=%d\n", param1, c->m_state);
+                    c->execute_omx_flush(param1);
+                }
+                // Skip the event notification
+                flag_set(c, Comp::OMX_COMPONENT_OUTPUT_DISABLE_PENDING);
+            }
+        } else
+        {
+            DEBUG_PRINT_ERROR("OMX_CommandPortDisable: disable wrong port ID");
+        }
+    } else if (OMX_CommandPortEnable == cmd)
+    {
+        bFlag = 0;
+        if (param1 == Comp::OMX_CORE_INPUT_PORT_INDEX || param1 == OMX_ALL)
+        {
+            DEBUG_PRINT("SCP: Enabling Input port Indx\n");
+            c->m_inp_bEnabled = OMX_TRUE;
+            if ((c->m_state == OMX_StateLoaded &&
+                 !flag_present(c, Comp::OMX_COMPONENT_IDLE_PENDING))
+                || (c->m_state == OMX_StateWaitForResources)
+                || (c->m_inp_bPopulated == OMX_TRUE))
+            {
+                c->post_command(OMX_CommandPortEnable,
+                                Comp::OMX_CORE_INPUT_PORT_INDEX,
+                                Comp::OMX_COMPONENT_GENERATE_EVENT);
+            } else
+            {
+                // Skip the event notification
+                flag_set(c, Comp::OMX_COMPONENT_INPUT_ENABLE_PENDING);
+            }
+        }
+        if (param1 == Comp::OMX_CORE_OUTPUT_PORT_INDEX || param1 == OMX_ALL)
+        {
+            DEBUG_PRINT("SCP: Enabling Output port Indx\n");
+            c->m_out_bEnabled = OMX_TRUE;
+            if ((c->m_state == OMX_StateLoaded &&
+                 !flag_present(c, Comp::OMX_COMPONENT_IDLE_PENDING))
+                || (c->m_state == OMX_StateWaitForResources)
+                || (c->m_out_bPopulated == OMX_TRUE))
+            {
+                c->post_command(OMX_CommandPortEnable,
+                                Comp::OMX_CORE_OUTPUT_PORT_INDEX,
+                                Comp::OMX_COMPONENT_GENERATE_EVENT);
+            } else
+            {
+                // Skip the event notification
+                flag_set(c, Comp::OMX_COMPONENT_OUTPUT_ENABLE_PENDING);
+            }
+            wake_in_thread(c);
+            wake_out_thread(c);
+        } else
+        {
+            DEBUG_PRINT_ERROR("OMX_CommandPortEnable: enable wrong port ID");
+        }
+    } else
+    {
+        DEBUG_PRINT_ERROR("SCP-->ERROR: Invalid Command [%d]\n", cmd);
+        eRet = OMX_ErrorNotImplemented;
+    }
+    DEBUG_PRINT("posting sem_States\n");
+    sem_post(&c->sem_States);
+    if (eRet == OMX_ErrorNone && bFlag)
+    {
+        c->post_command(cmd, eState, Comp::OMX_COMPONENT_GENERATE_EVENT);
+    }
+    return eRet;
+}
+
+/**
+ @brief checks whether every enabled port has all of its buffers
+
+ Marks the ports populated as a side effect.
+
+ @param c component
+ @return true once the component can go to Idle
+ */
+template <typename Comp>
+bool aenc_core<Comp>::allocate_done(Comp *c)
+{
+    bool inp_done = c->m_inp_act_buf_count == c->m_inp_current_buf_count;
+    bool out_done = c->m_out_act_buf_count == c->m_out_current_buf_count;
+    bool bRet = false;
+
+    if (c->pcm_input == 1)
+    {
+        bRet = inp_done && out_done;
+        if (inp_done && c->m_inp_bEnabled)
+        {
+            c->m_inp_bPopulated = OMX_TRUE;
+        }
+        if (out_done && c->m_out_bEnabled)
+        {
+            c->m_out_bPopulated = OMX_TRUE;
+        }
+    } else if (c->pcm_input == 0)
+    {
+        bRet = out_done;
+        if (out_done && c->m_out_bEnabled)
+        {
+            c->m_out_bPopulated = OMX_TRUE;
+        }
+    }
+    return bRet;
+}
+
+/**
+ @brief checks whether a port (or both, OMX_ALL) gave all buffers back
+
+ @param c component
+ @param param1 port index or OMX_ALL
+ @return true if no buffer is left on the port(s)
+ */
+template <typename Comp>
+bool aenc_core<Comp>::release_done(Comp *c, OMX_U32 param1)
+{
+    bool bRet = false;
+
+    if (param1 == OMX_ALL)
+    {
+        bRet = c->m_inp_current_buf_count == 0 &&
+               c->m_out_current_buf_count == 0;
+    } else if (param1 == Comp::OMX_CORE_INPUT_PORT_INDEX)
+    {
+        bRet = c->m_inp_current_buf_count == 0;
+    } else if (param1 == Comp::OMX_CORE_OUTPUT_PORT_INDEX)
+    {
+        bRet = c->m_out_current_buf_count == 0;
+    }
+    return bRet;
+}
+
+/**
+ @brief member function that searches for caller buffer
+
+ @param c component
+ @param buffer pointer to buffer header
+ @return bool value indicating whether buffer is found
+ */
+template <typename Comp>
+bool aenc_core<Comp>::search_input_bufhdr(Comp *c,
+                                          OMX_BUFFERHEADERTYPE *buffer)
+{
+    //access only in IL client context
+    return buffer && c->m_input_buf_hdrs.find_ele(buffer);
+}
+
+template <typename Comp>
+bool aenc_core<Comp>::search_output_bufhdr(Comp *c,
+                                           OMX_BUFFERHEADERTYPE *buffer)
+{
+    //access only in IL client context
+    return buffer && c->m_output_buf_hdrs.find_ele(buffer);
+}
+
+/**
+ @brief runs the deferred transitions a new buffer on a port completes
+
+ @param c component
+ @param port port the buffer was added to
+ */
+template <typename Comp>
+void aenc_core<Comp>::complete_allocation(Comp *c, OMX_U32 port)
+{
+    if (allocate_done(c) &&
+        flag_present(c, Comp::OMX_COMPONENT_IDLE_PENDING))
+    {
+        flag_clear(c, Comp::OMX_COMPONENT_IDLE_PENDING);
+        c->post_command(OMX_CommandStateSet, OMX_StateIdle,
+                        Comp::OMX_COMPONENT_GENERATE_EVENT);
+        DEBUG_PRINT("post idle transition event\n");
+    }
+    if (port == Comp::OMX_CORE_INPUT_PORT_INDEX && c->m_inp_bPopulated &&
+        flag_present(c, Comp::OMX_COMPONENT_INPUT_ENABLE_PENDING))
+    {
+        flag_clear(c, Comp::OMX_COMPONENT_INPUT_ENABLE_PENDING);
+        c->post_command(OMX_CommandPortEnable,
+                        Comp::OMX_CORE_INPUT_PORT_INDEX,
+                        Comp::OMX_COMPONENT_GENERATE_EVENT);
+    }
+    if (port == Comp::OMX_CORE_OUTPUT_PORT_INDEX && c->m_out_bPopulated &&
+        flag_present(c, Comp::OMX_COMPONENT_OUTPUT_ENABLE_PENDING))
+    {
+        flag_clear(c, Comp::OMX_COMPONENT_OUTPUT_ENABLE_PENDING);
+        c->m_out_bEnabled = OMX_TRUE;
+        wake_out_thread(c);
+        wake_in_thread(c);
+        c->post_command(OMX_CommandPortEnable,
+                        Comp::OMX_CORE_OUTPUT_PORT_INDEX,
+                        Comp::OMX_COMPONENT_GENERATE_EVENT);
+    }
+}
+
+/**
+ @brief allocates an input buffer with META_IN head room
+
+ The head room lets empty_this_buffer_proxy write the meta data in
+ place in front of the client data.
+ */
+template <typename Comp>
+OMX_ERRORTYPE aenc_core<Comp>::allocate_input_buffer(Comp *c,
+                                                     OMX_HANDLETYPE hComp,
+                                                     OMX_BUFFERHEADERTYPE
+                                                     **bufferHdr,
+                                                     OMX_PTR appData,
+                                                     OMX_U32 bytes)
+{
+    const size_t meta = sizeof(typename Comp::META_IN);
+    unsigned nBufSize = bytes >= c->input_buffer_size ? bytes :
+                        c->input_buffer_size;
+    OMX_BUFFERHEADERTYPE *bufHdr;
+
+    if (hComp == NULL)
+    {
+        DEBUG_PRINT_ERROR("Returning OMX_ErrorBadParameter\n");
+        return OMX_ErrorBadParameter;
+    }
+    if (c->m_inp_current_buf_count >= c->m_inp_act_buf_count)
+    {
+        DEBUG_PRINT("Input buffer memory allocation failed 2\n");
+        return OMX_ErrorInsufficientResources;
+    }
+    bufHdr = (OMX_BUFFERHEADERTYPE *)
+             calloc(nBufSize + sizeof(OMX_BUFFERHEADERTYPE) + meta, 1);
+    if (bufHdr == NULL)
+    {
+        DEBUG_PRINT("Input buffer memory allocation failed 1 \n");
+        return OMX_ErrorInsufficientResources;
+    }
+    *bufferHdr = bufHdr;
+    bufHdr->pBuffer           = (OMX_U8 *)bufHdr +
+                                sizeof(OMX_BUFFERHEADERTYPE) + meta;
+    bufHdr->nSize             = sizeof(OMX_BUFFERHEADERTYPE);
+    bufHdr->nVersion.nVersion = AENC_CORE_SPEC_VERSION;
+    bufHdr->nAllocLen         = nBufSize;
+    bufHdr->pAppPrivate       = appData;
+    bufHdr->nInputPortIndex   = Comp::OMX_CORE_INPUT_PORT_INDEX;
+    bufHdr->pInputPortPrivate = bufHdr->pBuffer - meta;
+    c->m_input_buf_hdrs.insert(bufHdr, NULL);
+    c->m_inp_current_buf_count++;
+    DEBUG_PRINT("AIB:bufHdr %p bufHdr->pBuffer %p m_inp_buf_cnt=%u "
+                "bytes=%lu", bufHdr, bufHdr->pBuffer,
+                c->m_inp_current_buf_count, bytes);
+    return OMX_ErrorNone;
+}
+
+template <typename Comp>
+OMX_ERRORTYPE aenc_core<Comp>::allocate_output_buffer(Comp *c,
+                                                      OMX_HANDLETYPE hComp,
+                                                      OMX_BUFFERHEADERTYPE
+                                                      **bufferHdr,
+                                                      OMX_PTR appData,
+                                                      OMX_U32 bytes)
+{
+    unsigned nBufSize = bytes >= c->output_buffer_size ? bytes :
+                        c->output_buffer_size;
+    OMX_BUFFERHEADERTYPE *bufHdr;
+
+    if (hComp == NULL)
+    {
+        DEBUG_PRINT_ERROR("Returning OMX_ErrorBadParameter\n");
+        return OMX_ErrorBadParameter;
+    }
+    if (c->m_out_current_buf_count >= c->m_out_act_buf_count)
+    {
+        DEBUG_PRINT("Output buffer memory allocation failed\n");
+        return OMX_ErrorInsufficientResources;
+    }
+    bufHdr = (OMX_BUFFERHEADERTYPE *)
+             calloc(nBufSize + sizeof(OMX_BUFFERHEADERTYPE), 1);
+    if (bufHdr == NULL)
+    {
+        DEBUG_PRINT("Output buffer memory allocation failed 1 \n");
+        return OMX_ErrorInsufficientResources;
+    }
+    *bufferHdr = bufHdr;
+    bufHdr->pBuffer           = (OMX_U8 *)bufHdr +
+                                sizeof(OMX_BUFFERHEADERTYPE);
+    bufHdr->nSize             = sizeof(OMX_BUFFERHEADERTYPE);
+    bufHdr->nVersion.nVersion = AENC_CORE_SPEC_VERSION;
+    bufHdr->nAllocLen         = nBufSize;
+    bufHdr->pAppPrivate       = appData;
+    bufHdr->nOutputPortIndex  = Comp::OMX_CORE_OUTPUT_PORT_INDEX;
+    c->m_output_buf_hdrs.insert(bufHdr, NULL);
+    c->m_out_current_buf_count++;
+    DEBUG_PRINT("AOB::bufHdr %p bufHdr->pBuffer %p m_out_buf_cnt=%u "
+                "bytes=%lu", bufHdr, bufHdr->pBuffer,
+                c->m_out_current_buf_count, bytes);
+    return OMX_ErrorNone;
+}
+
+/**
+ @brief wraps a client buffer in a header on either port
+
+ The client buffer becomes the port buffer size, it must be at least
+ as large as what the port asks for. Input buffers in a shared region
+ carry their META_IN head room in front and go to the driver in place.
+ */
+template <typename Comp>
+OMX_ERRORTYPE aenc_core<Comp>::use_port_buffer(Comp *c, OMX_HANDLETYPE hComp,
+                                               OMX_BUFFERHEADERTYPE **bufferHdr,
+                                               OMX_U32 port, OMX_PTR appData,
+                                               OMX_U32 bytes, OMX_U8 *buffer)
+{
+    bool input = port == Comp::OMX_CORE_INPUT_PORT_INDEX;
+    unsigned int *buf_size = input ? &c->input_buffer_size :
+                             &c->output_buffer_size;
+    unsigned int *cur_count = input ? &c->m_inp_current_buf_count :
+                              &c->m_out_current_buf_count;
+    unsigned int act_count = input ? c->m_inp_act_buf_count :
+                             c->m_out_act_buf_count;
+    OMX_BUFFERHEADERTYPE *bufHdr;
+
+    if (hComp == NULL)
+    {
+        DEBUG_PRINT_ERROR("Returning OMX_ErrorBadParameter\n");
+        return OMX_ErrorBadParameter;
+    }
+    if (bytes < *buf_size)
+    {
+        /* return if the buffer size provided by client
+        is less than min buffer size supported by omx component*/
+        return OMX_ErrorInsufficientResources;
+    }
+    if (*cur_count >= act_count)
+    {
+        DEBUG_PRINT("use buffer: port %lu has all its buffers\n", port);
+        return OMX_ErrorInsufficientResources;
+    }
+    bufHdr = (OMX_BUFFERHEADERTYPE *) calloc(sizeof(OMX_BUFFERHEADERTYPE), 1);
+    if (bufHdr == NULL)
+    {
+        DEBUG_PRINT("use buffer: header allocation failed\n");
+        return OMX_ErrorInsufficientResources;
+    }
+    *bufferHdr = bufHdr;
+    bufHdr->pBuffer           = buffer;
+    bufHdr->nSize             = sizeof(OMX_BUFFERHEADERTYPE);
+    bufHdr->nVersion.nVersion = AENC_CORE_SPEC_VERSION;
+    bufHdr->nAllocLen         = bytes;
+    bufHdr->pAppPrivate       = appData;
+    bufHdr->nOffset           = 0;
+    *buf_size                 = bytes;
+    if (aenc_shm_pool_find(&c->m_shm, port, buffer,
+                           input ? sizeof(typename Comp::META_IN) : 0, bytes))
+    {
+        if (input)
+            bufHdr->pInputPortPrivate = buffer -
+                                        sizeof(typename Comp::META_IN);
+        c->m_shm.shared_bufs++;
+    }
+    if (input)
+    {
+        bufHdr->nInputPortIndex = Comp::OMX_CORE_INPUT_PORT_INDEX;
+        c->m_input_buf_hdrs.insert(bufHdr, NULL);
+    } else
+    {
+        bufHdr->nOutputPortIndex = Comp::OMX_CORE_OUTPUT_PORT_INDEX;
+        c->m_output_buf_hdrs.insert(bufHdr, NULL);
+    }
+    (*cur_count)++;
+    DEBUG_PRINT("use buffer: port %lu bufHdr %p pBuffer %p len=%lu\n",
+                port, bufHdr, bufHdr->pBuffer, bytes);
+    return OMX_ErrorNone;
+}
+
+/**
+ @brief registers a region of client memory with the driver
+
+ Later OMX_UseBuffer calls with buffers inside the region skip the
+ private input copy, see aenc_shm.h.
+ */
+template <typename Comp>
+OMX_ERRORTYPE aenc_core<Comp>::set_shared_buffer(Comp *c,
+                                                 const struct aenc_shm_param
+                                                 *param)
+{
+    int ret;
+
+    if (param->nPortIndex != Comp::OMX_CORE_INPUT_PORT_INDEX &&
+        param->nPortIndex != Comp::OMX_CORE_OUTPUT_PORT_INDEX)
+    {
+        return OMX_ErrorBadPortIndex;
+    }
+    if (param->nFd < 0 || param->pBase == NULL || param->nLen == 0)
+    {
+        return OMX_ErrorBadParameter;
+    }
+    ret = aenc_shm_pool_add(&c->m_shm, param);
+    if (ret == -ENOSPC)
+    {
+        return OMX_ErrorInsufficientResources;
+    } else if (ret)
+    {
+        DEBUG_PRINT_ERROR("shared buffer: port %lu fd %ld not mapped by the "
+                          "driver, err %d\n", param->nPortIndex,
+                          (long)param->nFd, ret);
+        return OMX_ErrorUnsupportedSetting;
+    }
+    DEBUG_PRINT("shared buffer: port %lu base %p len %lu\n",
+                param->nPortIndex, param->pBase, param->nLen);
+    return OMX_ErrorNone;
+}
+
+/**
+ @brief OMX AllocateBuffer, allocates a buffer and header on a port
+
+ @return error status
+ */
+template <typename Comp>
+OMX_ERRORTYPE aenc_core<Comp>::allocate_buffer(Comp *c, OMX_HANDLETYPE hComp,
+                                               OMX_BUFFERHEADERTYPE **bufferHdr,
+                                               OMX_U32 port, OMX_PTR appData,
+                                               OMX_U32 bytes)
+{
+    OMX_ERRORTYPE eRet;
+
+    if (c->m_state == OMX_StateInvalid)
+    {
+        DEBUG_PRINT_ERROR("Allocate Buf in Invalid State\n");
+        return OMX_ErrorInvalidState;
+    }
+    if (Comp::OMX_CORE_INPUT_PORT_INDEX == port)
+    {
+        eRet = allocate_input_buffer(c, hComp, bufferHdr, appData, bytes);
+    } else if (Comp::OMX_CORE_OUTPUT_PORT_INDEX == port)
+    {
+        eRet = allocate_output_buffer(c, hComp, bufferHdr, appData, bytes);
+    } else
+    {
+        DEBUG_PRINT_ERROR("Error: Invalid Port Index received %d\n",
+                          (int)port);
+        eRet = OMX_ErrorBadPortIndex;
+    }
+    if (eRet == OMX_ErrorNone)
+    {
+        complete_allocation(c, port);
+    }
+    DEBUG_PRINT("Allocate Buffer exit with ret Code %d\n", eRet);
+    return eRet;
+}
+
+/**
+ @brief OMX UseBuffer, wraps a client buffer on a port
+
+ @return error status
+ */
+template <typename Comp>
+OMX_ERRORTYPE aenc_core<Comp>::use_buffer(Comp *c, OMX_HANDLETYPE hComp,
+                                          OMX_BUFFERHEADERTYPE **bufferHdr,
+                                          OMX_U32 port, OMX_PTR appData,
+                                          OMX_U32 bytes, OMX_U8 *buffer)
+{
+    OMX_ERRORTYPE eRet;
+
+    if (Comp::OMX_CORE_INPUT_PORT_INDEX == port ||
+        Comp::OMX_CORE_OUTPUT_PORT_INDEX == port)
+    {
+        eRet = use_port_buffer(c, hComp, bufferHdr, port, appData, bytes,
+                               buffer);
+    } else
+    {
+        DEBUG_PRINT_ERROR("Error: Invalid Port Index received %d\n",
+                          (int)port);
+        eRet = OMX_ErrorBadPortIndex;
+    }
+    if (eRet == OMX_ErrorNone)
+    {
+        complete_allocation(c, port);
+    }
+    DEBUG_PRINT("Use Buffer for port[%lu] eRet[%d]\n", port, eRet);
+    return eRet;
+}
+
+/**
+  @brief OMX FreeBuffer, releases a buffer header and runs the deferred
+  port disable and Idle->Loaded transitions it completes
+
+  @param c component
+  @param hComp handle to component instance
+  @param port id of port which holds the buffer
+  @param buffer buffer header
+  @return Error status
+*/
+template <typename Comp>
+OMX_ERRORTYPE aenc_core<Comp>::free_buffer(Comp *c, OMX_HANDLETYPE hComp,
+                                           OMX_U32 port,
+                                           OMX_BUFFERHEADERTYPE *buffer)
+{
+    OMX_ERRORTYPE eRet = OMX_ErrorNone;
+
+    DEBUG_PRINT("Free_Buffer buf %p\n", buffer);
+    if (hComp == NULL)
+    {
+        DEBUG_PRINT_ERROR("Returning OMX_ErrorBadParameter\n");
+        return OMX_ErrorBadParameter;
+    }
+    if (c->m_state == OMX_StateIdle &&
+        flag_present(c, Comp::OMX_COMPONENT_LOADING_PENDING))
+    {
+        DEBUG_PRINT(" free buffer while Component in Loading pending\n");
+    } else if ((c->m_inp_bEnabled == OMX_FALSE &&
+                port == Comp::OMX_CORE_INPUT_PORT_INDEX) ||
+               (c->m_out_bEnabled == OMX_FALSE &&
+                port == Comp::OMX_CORE_OUTPUT_PORT_INDEX))
+    {
+        DEBUG_PRINT("Free Buffer while port %lu disabled\n", port);
+    } else
+    {
+        DEBUG_PRINT("free_buffer: Invalid state to free buffer, ports need "
+                    "to be disabled: OMX_ErrorPortUnpopulated\n");
+        c->post_command(OMX_EventError, OMX_ErrorPortUnpopulated,
+                        Comp::OMX_COMPONENT_GENERATE_EVENT);
+        if (c->m_state == OMX_StateExecuting || c->m_state == OMX_StatePause)
+        {
+            return eRet;
+        }
+    }
+    if (Comp::OMX_CORE_INPUT_PORT_INDEX == port)
+    {
+        if (c->m_inp_current_buf_count != 0)
+        {
+            c->m_inp_bPopulated = OMX_FALSE;
+            if (search_input_bufhdr(c, buffer))
+            {
+                DEBUG_PRINT("Free_Buf:in_buffer[%p]\n", buffer);
+                c->m_input_buf_hdrs.erase(buffer);
+                free(buffer);
+                c->m_inp_current_buf_count--;
+            } else
+            {
+                DEBUG_PRINT_ERROR("Free_Buf:Error-->free_buffer, "
+                                  "Invalid Input buffer header\n");
+                eRet = OMX_ErrorBadParameter;
+            }
+        } else
+        {
+            DEBUG_PRINT_ERROR("Error: free_buffer, Port Index calculation "
+                              "came out Invalid\n");
+            eRet = OMX_ErrorBadPortIndex;
+        }
+        if (flag_present(c, Comp::OMX_COMPONENT_INPUT_DISABLE_PENDING)
+            && release_done(c, 0))
+        {
+            DEBUG_PRINT("INPUT PORT MOVING TO DISABLED STATE \n");
+            flag_clear(c, Comp::OMX_COMPONENT_INPUT_DISABLE_PENDING);
+            c->post_command(OMX_CommandPortDisable,
+                            Comp::OMX_CORE_INPUT_PORT_INDEX,
+                            Comp::OMX_COMPONENT_GENERATE_EVENT);
+        }
+    } else if (Comp::OMX_CORE_OUTPUT_PORT_INDEX == port)
+    {
+        if (c->m_out_current_buf_count != 0)
+        {
+            c->m_out_bPopulated = OMX_FALSE;
+            if (search_output_bufhdr(c, buffer))
+            {
+                DEBUG_PRINT("Free_Buf:out_buffer[%p]\n", buffer);
+                c->m_output_buf_hdrs.erase(buffer);
+                free(buffer);
+                c->m_out_current_buf_count--;
+            } else
+            {
+                DEBUG_PRINT("Free_Buf:Error-->free_buffer, "
+                            "Invalid Output buffer header\n");
+                eRet = OMX_ErrorBadParameter;
+            }
+        } else
+        {
+            eRet = OMX_ErrorBadPortIndex;
+        }
+        if (flag_present(c, Comp::OMX_COMPONENT_OUTPUT_DISABLE_PENDING)
+            && release_done(c, 1))
+        {
+            DEBUG_PRINT("OUTPUT PORT MOVING TO DISABLED STATE \n");
+            flag_clear(c, Comp::OMX_COMPONENT_OUTPUT_DISABLE_PENDING);
+            c->post_command(OMX_CommandPortDisable,
+                            Comp::OMX_CORE_OUTPUT_PORT_INDEX,
+                            Comp::OMX_COMPONENT_GENERATE_EVENT);
+        }
+    } else
+    {
+        eRet = OMX_ErrorBadPortIndex;
+    }
+    if (OMX_ErrorNone == eRet &&
+        flag_present(c, Comp::OMX_COMPONENT_LOADING_PENDING) &&
+        release_done(c, -1))
+    {
+        stop_encoder(c);
+        // Send the callback now
+        flag_clear(c, Comp::OMX_COMPONENT_LOADING_PENDING);
+        c->post_command(OMX_CommandStateSet, OMX_StateLoaded,
+                        Comp::OMX_COMPONENT_GENERATE_EVENT);
+    }
+    return eRet;
+}
+
+#endif /* OMX_AENC_CORE_H */
@@ -0,0 +1,510 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2014, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+
+/*
+ * Stub for the /dev/msm_*_in encoder drivers, to run the QDSP6 encoder
+ * components and their test apps on a Linux box without a DSP:
+ *
+ *   LD_PRELOAD=libaenc-stubdrv.so mm-aenc-omxevrc-test ...
+ *
+ * open() of a known encoder node returns a descriptor on /dev/null and
+ * every later read(), write(), ioctl() and close() on it is served here.
+ * The stub follows the driver protocol the components rely on:
+ *   - non tunnel (O_RDWR): each write() carries META_IN and PCM. Every
+ *     full frame of PCM becomes one encoded frame of a fixed size for the
+ *     codec, and EOS in the META_IN flags is returned as an EOS frame
+ *   - tunnel (O_RDONLY): frames are produced in real time from
+ *     AUDIO_START
+ *   - read() returns the frame count, the meta data and the frames laid
+ *     out as in aenc_io.h, at most frames_per_buf frames per read
+ *   - AUDIO_STOP wakes a blocked read() with 0, AUDIO_FLUSH drops
+ *     pending frames
+ *   - AUDIO_REGISTER_ION maps memfd regions, the host stand-in for ION,
+ *     and refuses any other descriptor
+ * No encoding is done, so the numbers are the cost of the component, the
+ * OMX core and the client rather than the DSP.
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/msm_audio.h>
+#include "aenc_io.h"
+
+#define STUB_MAX_DEVS           16
+#define STUB_MAX_PENDING        64      /* frames before write() blocks */
+#define STUB_EOS_FLAG           0x1     /* OMX_BUFFERFLAG_EOS */
+
+#ifdef __BIONIC__
+typedef int stub_ioctl_req_t;
+#else
+typedef unsigned long stub_ioctl_req_t;
+#endif
+
+struct stub_codec
+{
+    const char *node;
+    unsigned int samples;       /* PCM samples per channel per frame */
+    unsigned int frame_bytes;   /* encoded frame size */
+    unsigned int rate;          /* default sample rate */
+};
+
+static const struct stub_codec stub_codecs[] = {
+    { "/dev/msm_aac_in",   1024, 384, 48000 },
+    { "/dev/msm_amrnb_in",  160,  32,  8000 },
+    { "/dev/msm_evrc_in",   160,  23,  8000 },
+    { "/dev/msm_qcelp_in",  160,  35,  8000 },
+};
+
+/* Layout of META_IN in the encoder components */
+struct stub_meta_in
+{
+    unsigned short offset;
+    unsigned long ts_low;
+    unsigned long ts_high;
+    unsigned int flags;
+} __attribute__ ((packed));
+
+struct stub_dev
+{
+    int fd;
+    const struct stub_codec *codec;
+    int pcm_input;
+    int started;
+    int eos;                    /* EOS written, not yet read */
+    unsigned int channels;
+    unsigned int rate;
+    unsigned int frames_per_buf;
+    uint64_t pcm_bytes;         /* PCM not yet making up a frame */
+    uint64_t frames_ready;
+    uint64_t frames_out;
+    struct timespec start;
+    pthread_cond_t cond;
+};
+
+static struct stub_dev stub_devs[STUB_MAX_DEVS];
+static pthread_mutex_t stub_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned short stub_session_id;
+
+static int (*real_open)(const char *, int, ...);
+static int (*real_close)(int);
+static ssize_t (*real_read)(int, void *, size_t);
+static ssize_t (*real_write)(int, const void *, size_t);
+static int (*real_ioctl)(int, stub_ioctl_req_t, ...);
+
+static void stub_init(void)
+{
+    if (real_open)
+        return;
+    real_close = (int (*)(int))dlsym(RTLD_NEXT, "close");
+    real_read = (ssize_t (*)(int, void *, size_t))dlsym(RTLD_NEXT, "read");
+    real_write = (ssize_t (*)(int, const void *, size_t))
+                 dlsym(RTLD_NEXT, "write");
+    real_ioctl = (int (*)(int, stub_ioctl_req_t, ...))
+                 dlsym(RTLD_NEXT, "ioctl");
+    real_open = (int (*)(const char *, int, ...))dlsym(RTLD_NEXT, "open");
+}
+
+/* Called with stub_lock held */
+static struct stub_dev *stub_find(int fd)
+{
+    int i;
+
+    if (fd < 0)
+        return NULL;
+    for (i = 0; i < STUB_MAX_DEVS; i++) {
+        if (stub_devs[i].codec && stub_devs[i].fd == fd)
+            return &stub_devs[i];
+    }
+    return NULL;
+}
+
+static uint64_t stub_frame_us(const struct stub_dev *dev)
+{
+    return (uint64_t)dev->codec->samples * 1000000 /
+           (dev->rate ? dev->rate : dev->codec->rate);
+}
+
+static uint64_t stub_frame_pcm_bytes(const struct stub_dev *dev)
+{
+    unsigned int channels = dev->channels ? dev->channels : 1;
+
+    return (uint64_t)dev->codec->samples * channels * 2;
+}
+
+/* Tunnel mode: frames the DSP would have encoded since AUDIO_START */
+static void stub_tunnel_frames(struct stub_dev *dev)
+{
+    struct timespec now;
+    uint64_t us, due;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    us = (uint64_t)(now.tv_sec - dev->start.tv_sec) * 1000000 +
+         (now.tv_nsec - dev->start.tv_nsec) / 1000;
+    due = us / stub_frame_us(dev);
+    if (due > dev->frames_out + dev->frames_ready)
+        dev->frames_ready = due - dev->frames_out;
+}
+
+static int stub_open(const char *path, int flags)
+{
+    struct stub_dev *dev = NULL;
+    unsigned int c;
+    int i, fd;
+
+    for (c = 0; c < sizeof(stub_codecs) / sizeof(stub_codecs[0]); c++) {
+        if (!strcmp(path, stub_codecs[c].node))
+            break;
+    }
+    if (c == sizeof(stub_codecs) / sizeof(stub_codecs[0]))
+        return -2;
+
+    fd = real_open("/dev/null", O_RDWR);
+    if (fd < 0)
+        return -1;
+
+    pthread_mutex_lock(&stub_lock);
+    for (i = 0; i < STUB_MAX_DEVS; i++) {
+        if (!stub_devs[i].codec) {
+            dev = &stub_devs[i];
+            break;
+        }
+    }
+    if (!dev) {
+        pthread_mutex_unlock(&stub_lock);
+        real_close(fd);
+        errno = EBUSY;
+        return -1;
+    }
+    memset(dev, 0, sizeof(*dev));
+    pthread_cond_init(&dev->cond, NULL);
+    dev->fd = fd;
+    dev->codec = &stub_codecs[c];
+    dev->pcm_input = (flags & O_ACCMODE) == O_RDWR;
+    dev->channels = 1;
+    dev->rate = stub_codecs[c].rate;
+    dev->frames_per_buf = 1;
+    pthread_mutex_unlock(&stub_lock);
+    return fd;
+}
+
+int open(const char *path, int flags, ...)
+{
+    mode_t mode = 0;
+    va_list ap;
+    int fd;
+
+    stub_init();
+    if (flags & O_CREAT) {
+        va_start(ap, flags);
+        mode = va_arg(ap, int);
+        va_end(ap);
+    }
+    if (!strncmp(path, "/dev/msm_", 9)) {
+        fd = stub_open(path, flags);
+        if (fd != -2)
+            return fd;
+    }
+    return real_open(path, flags, mode);
+}
+
+int open64(const char *path, int flags, ...)
+{
+    mode_t mode = 0;
+    va_list ap;
+
+    if (flags & O_CREAT) {
+        va_start(ap, flags);
+        mode = va_arg(ap, int);
+        va_end(ap);
+    }
+    return open(path, flags, mode);
+}
+
+int close(int fd)
+{
+    struct stub_dev *dev;
+
+    stub_init();
+    pthread_mutex_lock(&stub_lock);
+    dev = stub_find(fd);
+    if (dev) {
+        dev->started = 0;
+        dev->codec = NULL;
+        pthread_cond_broadcast(&dev->cond);
+    }
+    pthread_mutex_unlock(&stub_lock);
+    return real_close(fd);
+}
+
+static ssize_t stub_read(struct stub_dev *dev, uint8_t *buf, size_t len)
+{
+    struct aenc_meta_out *meta;
+    uint64_t ts;
+    unsigned int n, i;
+    size_t need;
+    struct timespec wait;
+
+    for (;;) {
+        if (!dev->codec || !dev->started)
+            return 0;
+        if (!dev->pcm_input)
+            stub_tunnel_frames(dev);
+        if (dev->frames_ready || dev->eos)
+            break;
+        if (dev->pcm_input) {
+            pthread_cond_wait(&dev->cond, &stub_lock);
+        } else {
+            clock_gettime(CLOCK_REALTIME, &wait);
+            wait.tv_nsec += stub_frame_us(dev) * 1000;
+            while (wait.tv_nsec >= 1000000000) {
+                wait.tv_nsec -= 1000000000;
+                wait.tv_sec++;
+            }
+            pthread_cond_timedwait(&dev->cond, &stub_lock, &wait);
+        }
+    }
+
+    if (!dev->frames_ready) {
+        /* EOS goes out as a frame of its own */
+        if (len < aenc_io_meta_size(1))
+            return -EINVAL;
+        buf[0] = 1;
+        meta = aenc_io_meta(buf, 0);
+        memset(meta, 0, sizeof(*meta));
+        meta->offset_to_frame = sizeof(*meta);
+        meta->nflags = STUB_EOS_FLAG;
+        dev->eos = 0;
+        return aenc_io_meta_size(1);
+    }
+
+    n = dev->frames_per_buf ? dev->frames_per_buf : 1;
+    if (n > dev->frames_ready)
+        n = (unsigned int)dev->frames_ready;
+    if (n > 255)
+        n = 255;
+    while (n > 1 && aenc_io_meta_size(n) +
+           (size_t)n * dev->codec->frame_bytes > len)
+        n--;
+    need = aenc_io_meta_size(n) + (size_t)n * dev->codec->frame_bytes;
+    if (need > len)
+        return -EINVAL;
+
+    buf[0] = (uint8_t)n;
+    for (i = 0; i < n; i++) {
+        meta = aenc_io_meta(buf, i);
+        ts = (dev->frames_out + i) * stub_frame_us(dev);
+        meta->offset_to_frame = n * sizeof(*meta) +
+                                i * dev->codec->frame_bytes;
+        meta->frame_size = dev->codec->frame_bytes;
+        meta->encoded_pcm_samples = dev->codec->samples;
+        meta->msw_ts = (uint32_t)(ts >> 32);
+        meta->lsw_ts = (uint32_t)ts;
+        meta->nflags = 0;
+    }
+    memset(buf + aenc_io_meta_size(n), 0,
+           (size_t)n * dev->codec->frame_bytes);
+    dev->frames_ready -= n;
+    dev->frames_out += n;
+    pthread_cond_broadcast(&dev->cond);
+    return need;
+}
+
+ssize_t read(int fd, void *buf, size_t len)
+{
+    struct stub_dev *dev;
+    ssize_t ret;
+
+    stub_init();
+    pthread_mutex_lock(&stub_lock);
+    dev = stub_find(fd);
+    if (!dev) {
+        pthread_mutex_unlock(&stub_lock);
+        return real_read(fd, buf, len);
+    }
+    ret = stub_read(dev, (uint8_t *)buf, len);
+    pthread_mutex_unlock(&stub_lock);
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+    return ret;
+}
+
+static ssize_t stub_write(struct stub_dev *dev, const uint8_t *buf,
+                          size_t len)
+{
+    const struct stub_meta_in *meta = (const struct stub_meta_in *)buf;
+    uint64_t frame_bytes = stub_frame_pcm_bytes(dev);
+
+    if (!dev->pcm_input || len < sizeof(*meta) || meta->offset > len)
+        return -EINVAL;
+
+    while (dev->codec && dev->started &&
+           dev->frames_ready >= STUB_MAX_PENDING)
+        pthread_cond_wait(&dev->cond, &stub_lock);
+    if (!dev->codec)
+        return -EBADF;
+
+    dev->pcm_bytes += len - meta->offset;
+    dev->frames_ready += dev->pcm_bytes / frame_bytes;
+    dev->pcm_bytes %= frame_bytes;
+    if (meta->flags & STUB_EOS_FLAG) {
+        if (dev->pcm_bytes)
+            dev->frames_ready++;
+        dev->pcm_bytes = 0;
+        dev->eos = 1;
+    }
+    pthread_cond_broadcast(&dev->cond);
+    return len;
+}
+
+ssize_t write(int fd, const void *buf, size_t len)
+{
+    struct stub_dev *dev;
+    ssize_t ret;
+
+    stub_init();
+    pthread_mutex_lock(&stub_lock);
+    dev = stub_find(fd);
+    if (!dev) {
+        pthread_mutex_unlock(&stub_lock);
+        return real_write(fd, buf, len);
+    }
+    ret = stub_write(dev, (const uint8_t *)buf, len);
+    pthread_mutex_unlock(&stub_lock);
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+    return ret;
+}
+
+#ifdef AUDIO_REGISTER_ION
+/* Only memfd regions can be "mapped", as only ION buffers can on target */
+static int stub_register(const struct msm_audio_ion_info *info)
+{
+    char path[32], target[64];
+    ssize_t n;
+
+    if (!info || info->fd < 0 || !info->vaddr)
+        return -EINVAL;
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", info->fd);
+    n = readlink(path, target, sizeof(target) - 1);
+    if (n < 0)
+        return -EBADF;
+    target[n] = '\0';
+    return strncmp(target, "/memfd:", 7) ? -EINVAL : 0;
+}
+#endif
+
+static int stub_ioctl(struct stub_dev *dev, stub_ioctl_req_t cmd,
+                      void *arg)
+{
+    switch (cmd) {
+    case AUDIO_START:
+        dev->started = 1;
+        dev->eos = 0;
+        dev->frames_out = 0;
+        dev->frames_ready = 0;
+        dev->pcm_bytes = 0;
+        clock_gettime(CLOCK_MONOTONIC, &dev->start);
+        return 0;
+    case AUDIO_STOP:
+        dev->started = 0;
+        pthread_cond_broadcast(&dev->cond);
+        return 0;
+    case AUDIO_FLUSH:
+        if (!dev->pcm_input && dev->started) {
+            stub_tunnel_frames(dev);
+            dev->frames_out += dev->frames_ready;
+        }
+        dev->frames_ready = 0;
+        dev->pcm_bytes = 0;
+        pthread_cond_broadcast(&dev->cond);
+        return 0;
+    case AUDIO_GET_SESSION_ID:
+        *(unsigned short *)arg = ++stub_session_id;
+        return 0;
+    case AUDIO_SET_BUF_CFG:
+        dev->frames_per_buf =
+            ((struct msm_audio_buf_cfg *)arg)->frames_per_buf;
+        return 0;
+    case AUDIO_SET_CONFIG:
+        dev->channels = ((struct msm_audio_config *)arg)->channel_count;
+        dev->rate = ((struct msm_audio_config *)arg)->sample_rate;
+        return 0;
+#ifdef AUDIO_REGISTER_ION
+    case AUDIO_REGISTER_ION:
+        return stub_register((struct msm_audio_ion_info *)arg);
+    case AUDIO_DEREGISTER_ION:
+        return 0;
+#endif
+    default:
+        break;
+    }
+    if ((_IOC_DIR(cmd) & _IOC_READ) && arg)
+        memset(arg, 0, _IOC_SIZE(cmd));
+    return 0;
+}
+
+int ioctl(int fd, stub_ioctl_req_t cmd, ...)
+{
+    struct stub_dev *dev;
+    void *arg;
+    va_list ap;
+    int ret;
+
+    va_start(ap, cmd);
+    arg = va_arg(ap, void *);
+    va_end(ap);
+
+    stub_init();
+    pthread_mutex_lock(&stub_lock);
+    dev = stub_find(fd);
+    if (!dev) {
+        pthread_mutex_unlock(&stub_lock);
+        return real_ioctl(fd, cmd, arg);
+    }
+    ret = stub_ioctl(dev, cmd, arg);
+    pthread_mutex_unlock(&stub_lock);
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+    return ret;
+}
@@ -0,0 +1,174 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2014, The Linux Foundation. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of The Linux Foundation nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+
+/*
+ * Buffer header lookup cost of Map<T,T2> against the linked list it
+ * replaced, for 4 to 64 buffers per port.
+ *
+ *   aenc-map-bench [LOOKUPS]
+ *
+ * Each buffer header is allocated together with its data, as
+ * allocate_buffer() does, and the lookups go round robin over the
+ * headers the way empty_this_buffer/fill_this_buffer see them. Prints
+ * one BENCH line per buffer count with the mean ns per lookup.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "Map.h"
+
+#define MAP_BENCH_HEADER_SIZE   96          // about sizeof(OMX_BUFFERHEADERTYPE)
+#define MAP_BENCH_BUFFER_SIZE   4096
+#define MAP_BENCH_LOOKUPS       4000000
+
+// The doubly linked list walk of the per-encoder Map.h before the hash map
+template <typename T,typename T2>
+class ListMap
+{
+    struct node
+    {
+        T    data;
+        T2   data2;
+        node* next;
+    };
+    node* head;
+    node* tail;
+public:
+    ListMap() : head(NULL), tail(NULL) {}
+    ~ListMap()
+    {
+        while (head)
+        {
+            node* temp = head;
+            head = head->next;
+            delete temp;
+        }
+    }
+    void insert(T data, T2 data2)
+    {
+        node* n = new node;
+        n->data = data;
+        n->data2 = data2;
+        n->next = NULL;
+        if (tail)
+            tail->next = n;
+        else
+            head = n;
+        tail = n;
+    }
+    T find_ele(T d1)
+    {
+        for (node* tmp = head; tmp; tmp = tmp->next)
+        {
+            if (tmp->data == d1)
+                return tmp->data;
+        }
+        return 0;
+    }
+};
+
+static uint64_t map_bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+template <typename M>
+static double map_bench_run(M &map, char **headers, unsigned count,
+                            unsigned lookups, unsigned *misses)
+{
+    uint64_t start;
+    unsigned i;
+
+    for (i = 0; i < count; i++)
+        map.insert(headers[i], headers[i]);
+
+    *misses = 0;
+    start = map_bench_now_ns();
+    for (i = 0; i < lookups; i++)
+    {
+        if (!map.find_ele(headers[i % count]))
+            (*misses)++;
+    }
+    return (double)(map_bench_now_ns() - start) / lookups;
+}
+
+int main(int argc, char **argv)
+{
+    static const unsigned counts[] = { 4, 8, 16, 32, 64 };
+    unsigned lookups = MAP_BENCH_LOOKUPS;
+    char *headers[64];
+    unsigned i, c, misses;
+    int ret = 0;
+
+    if (argc > 1)
+        lookups = strtoul(argv[1], NULL, 0);
+    if (!lookups)
+        lookups = MAP_BENCH_LOOKUPS;
+
+    for (c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    {
+        unsigned count = counts[c];
+        double list_ns, hash_ns;
+
+        for (i = 0; i < count; i++)
+        {
+            headers[i] = (char *)calloc(1, MAP_BENCH_HEADER_SIZE +
+                                           MAP_BENCH_BUFFER_SIZE);
+            if (!headers[i])
+            {
+                fprintf(stderr, "out of memory\n");
+                return 1;
+            }
+        }
+
+        {
+            ListMap<char *, char *> list;
+            list_ns = map_bench_run(list, headers, count, lookups, &misses);
+        }
+        if (misses)
+            ret = 2;
+        {
+            Map<char *, char *> hash;
+            hash_ns = map_bench_run(hash, headers, count, lookups, &misses);
+        }
+        if (misses)
+            ret = 2;
+
+        printf("BENCH: map buffers[%u] lookups[%u] list[%.1f ns] hash[%.1f ns]%s\n",
+               count, lookups, list_ns, hash_ns, misses ? " MISSES" : "");
+
+        for (i = 0; i < count; i++)
+            free(headers[i]);
+    }
+    return ret;
+}
@@ -16,6 +16,12 @@ libOmxEvrcEnc-def += -D_DEBUG
 ifeq ($(strip $(TARGET_USES_QCOM_MM_AUDIO)),true)
 libOmxEvrcEnc-def += -DAUDIOV2
 endif
+ifneq ($(strip $(AUDIO_FEATURE_AENC_FRAMES_PER_BUF)),)
+libOmxEvrcEnc-def += -DNUMOFFRAMES=$(AUDIO_FEATURE_AENC_FRAMES_PER_BUF)
+endif
+ifneq ($(strip $(AUDIO_FEATURE_AENC_PIPE_DEPTH)),)
+libOmxEvrcEnc-def += -DAENC_PIPE_DEPTH=$(AUDIO_FEATURE_AENC_PIPE_DEPTH)
+endif
 
 # ---------------------------------------------------------------------------------
 #             Make the Shared library (libOmxEvrcEnc)
@@ -24,6 +30,7 @@ endif
 include $(CLEAR_VARS)
 
 libOmxEvrcEnc-inc       := $(LOCAL_PATH)/inc
+libOmxEvrcEnc-inc       += $(LOCAL_PATH)/../../aenc-common/inc
 libOmxEvrcEnc-inc       += $(TARGET_OUT_HEADERS)/mm-core/omxcore
 
 LOCAL_MODULE            := libOmxEvrcEnc
@@ -49,6 +56,7 @@ include $(CLEAR_VARS)
 
 mm-evrc-enc-test-inc    := $(LOCAL_PATH)/inc
 mm-evrc-enc-test-inc    += $(LOCAL_PATH)/test
+mm-evrc-enc-test-inc    += $(LOCAL_PATH)/../../aenc-common/inc
 mm-evrc-enc-test-inc    += $(TARGET_OUT_HEADERS)/mm-core/omxcore
 ifeq ($(strip $(TARGET_USES_QCOM_MM_AUDIO)),true)
 mm-evrc-enc-test-inc     += $(TARGET_OUT_HEADERS)/mm-audio/audio-alsa 
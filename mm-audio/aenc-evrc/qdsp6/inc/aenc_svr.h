@@ -34,6 +34,7 @@ extern "C" {
 #include <pthread.h>
 #include <sched.h>
 #include <utils/Log.h>
+#include "aenc_msgq.h"
 
 #ifdef _ANDROID_
 #define LOG_TAG "QC_EVRCENC"
@@ -72,8 +73,7 @@ typedef void (*message_func)(void* client_data, unsigned char id);
 struct evrc_ipc_info
 {
     pthread_t thr;
-    int pipe_in;
-    int pipe_out;
+    struct aenc_msgq msgq;
     int dead;
     message_func process_msg_cb;
     void         *client_data;
@@ -47,25 +47,23 @@ void *omx_evrc_msg(void *info)
 {
     struct evrc_ipc_info *evrc_info = (struct evrc_ipc_info*)info;
     unsigned char id;
-    int n;
 
     DEBUG_DETAIL("\n%s: message thread start\n", __FUNCTION__);
-    while (!evrc_info->dead)
+    for (;;)
     {
-        n = read(evrc_info->pipe_in, &id, 1);
-        if (0 == n) break;
-        if (1 == n)
+        // Drain everything posted since the last wakeup in one go
+        while (aenc_msgq_pop(&evrc_info->msgq, &id))
         {
-          DEBUG_DETAIL("\n%s-->pipe_in=%d pipe_out=%d\n",
-                                               evrc_info->thread_name,
-                                               evrc_info->pipe_in,
-                                               evrc_info->pipe_out);
-
+            DEBUG_DETAIL("\n%s-->id=%d\n", evrc_info->thread_name, id);
             evrc_info->process_msg_cb(evrc_info->client_data, id);
         }
-        if ((n < 0) && (errno != EINTR)) break;
+        if (__atomic_load_n(&evrc_info->dead, __ATOMIC_ACQUIRE))
+            break;
+        aenc_msgq_wait(&evrc_info->msgq);
     }
-    DEBUG_DETAIL("%s: message thread stop\n", __FUNCTION__);
+    DEBUG_DETAIL("%s: message thread stop, %u msgs in %u wakeups\n",
+                 evrc_info->thread_name, evrc_info->msgq.posted,
+                 evrc_info->msgq.wakeups);
 
     return 0;
 }
@@ -95,7 +93,6 @@ struct evrc_ipc_info *omx_evrc_thread_create(
                                     char* th_name)
 {
     int r;
-    int fds[2];
     struct evrc_ipc_info *evrc_info;
 
     evrc_info = calloc(1, sizeof(struct evrc_ipc_info));
@@ -108,15 +105,12 @@ struct evrc_ipc_info *omx_evrc_thread_create(
     evrc_info->process_msg_cb = cb;
     strlcpy(evrc_info->thread_name, th_name, sizeof(evrc_info->thread_name));
 
-    if (pipe(fds))
+    if (aenc_msgq_init(&evrc_info->msgq))
     {
-        DEBUG_PRINT_ERROR("\n%s: pipe creation failed\n", __FUNCTION__);
-        goto fail_pipe;
+        DEBUG_PRINT_ERROR("\n%s: eventfd creation failed\n", __FUNCTION__);
+        goto fail_msgq;
     }
 
-    evrc_info->pipe_in = fds[0];
-    evrc_info->pipe_out = fds[1];
-
     r = pthread_create(&evrc_info->thr, 0, omx_evrc_msg, evrc_info);
     if (r < 0) goto fail_thread;
 
@@ -125,10 +119,9 @@ struct evrc_ipc_info *omx_evrc_thread_create(
 
 
 fail_thread:
-    close(evrc_info->pipe_in);
-    close(evrc_info->pipe_out);
+    aenc_msgq_deinit(&evrc_info->msgq);
 
-fail_pipe:
+fail_msgq:
     free(evrc_info);
 
     return 0;
@@ -148,7 +141,6 @@ struct evrc_ipc_info *omx_evrc_event_thread_create(
                                     char* th_name)
 {
     int r;
-    int fds[2];
     struct evrc_ipc_info *evrc_info;
 
     evrc_info = calloc(1, sizeof(struct evrc_ipc_info));
@@ -161,15 +153,12 @@ struct evrc_ipc_info *omx_evrc_event_thread_create(
     evrc_info->process_msg_cb = cb;
     strlcpy(evrc_info->thread_name, th_name, sizeof(evrc_info->thread_name));
 
-    if (pipe(fds))
+    if (aenc_msgq_init(&evrc_info->msgq))
     {
-        DEBUG_PRINT("\n%s: pipe creation failed\n", __FUNCTION__);
-        goto fail_pipe;
+        DEBUG_PRINT("\n%s: eventfd creation failed\n", __FUNCTION__);
+        goto fail_msgq;
     }
 
-    evrc_info->pipe_in = fds[0];
-    evrc_info->pipe_out = fds[1];
-
     r = pthread_create(&evrc_info->thr, 0, omx_evrc_events, evrc_info);
     if (r < 0) goto fail_thread;
 
@@ -178,10 +167,9 @@ struct evrc_ipc_info *omx_evrc_event_thread_create(
 
 
 fail_thread:
-    close(evrc_info->pipe_in);
-    close(evrc_info->pipe_out);
+    aenc_msgq_deinit(&evrc_info->msgq);
 
-fail_pipe:
+fail_msgq:
     free(evrc_info);
 
     return 0;
@@ -189,17 +177,15 @@ fail_pipe:
 
 void omx_evrc_thread_stop(struct evrc_ipc_info *evrc_info) {
     DEBUG_DETAIL("%s stop server\n", __FUNCTION__);
-    close(evrc_info->pipe_in);
-    close(evrc_info->pipe_out);
+    __atomic_store_n(&evrc_info->dead, 1, __ATOMIC_RELEASE);
+    aenc_msgq_wake(&evrc_info->msgq);
     pthread_join(evrc_info->thr,NULL);
-    evrc_info->pipe_out = -1;
-    evrc_info->pipe_in = -1;
-    DEBUG_DETAIL("%s: message thread close fds%d %d\n", evrc_info->thread_name,
-        evrc_info->pipe_in,evrc_info->pipe_out);
+    aenc_msgq_deinit(&evrc_info->msgq);
+    DEBUG_DETAIL("%s: message thread closed\n", evrc_info->thread_name);
     free(evrc_info);
 }
 
 void omx_evrc_post_msg(struct evrc_ipc_info *evrc_info, unsigned char id) {
     DEBUG_DETAIL("\n%s id=%d\n", __FUNCTION__,id);
-    write(evrc_info->pipe_out, &id, 1);
+    aenc_msgq_post(&evrc_info->msgq, id);
 }
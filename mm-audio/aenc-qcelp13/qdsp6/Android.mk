@@ -16,6 +16,12 @@ libOmxQcelp13Enc-def += -D_DEBUG
 ifeq ($(strip $(TARGET_USES_QCOM_MM_AUDIO)),true)
 libOmxQcelp13Enc-def += -DAUDIOV2
 endif
+ifneq ($(strip $(AUDIO_FEATURE_AENC_FRAMES_PER_BUF)),)
+libOmxQcelp13Enc-def += -DNUMOFFRAMES=$(AUDIO_FEATURE_AENC_FRAMES_PER_BUF)
+endif
+ifneq ($(strip $(AUDIO_FEATURE_AENC_PIPE_DEPTH)),)
+libOmxQcelp13Enc-def += -DAENC_PIPE_DEPTH=$(AUDIO_FEATURE_AENC_PIPE_DEPTH)
+endif
 
 # ---------------------------------------------------------------------------------
 #             Make the Shared library (libOmxQcelp13Enc)
@@ -24,6 +30,7 @@ endif
 include $(CLEAR_VARS)
 
 libOmxQcelp13Enc-inc       := $(LOCAL_PATH)/inc
+libOmxQcelp13Enc-inc       += $(LOCAL_PATH)/../../aenc-common/inc
 libOmxQcelp13Enc-inc       += $(TARGET_OUT_HEADERS)/mm-core/omxcore
 
 LOCAL_MODULE            := libOmxQcelp13Enc
@@ -51,6 +58,7 @@ include $(CLEAR_VARS)
 
 mm-qcelp13-enc-test-inc    := $(LOCAL_PATH)/inc
 mm-qcelp13-enc-test-inc    += $(LOCAL_PATH)/test
+mm-qcelp13-enc-test-inc    += $(LOCAL_PATH)/../../aenc-common/inc
 
 mm-qcelp13-enc-test-inc    += $(TARGET_OUT_HEADERS)/mm-core/omxcore
 ifeq ($(strip $(TARGET_USES_QCOM_MM_AUDIO)),true)
@@ -47,25 +47,23 @@ void *omx_qcelp13_msg(void *info)
 {
     struct qcelp13_ipc_info *qcelp13_info = (struct qcelp13_ipc_info*)info;
     unsigned char id;
-    int n;
 
     DEBUG_DETAIL("\n%s: message thread start\n", __FUNCTION__);
-    while (!qcelp13_info->dead)
+    for (;;)
     {
-        n = read(qcelp13_info->pipe_in, &id, 1);
-        if (0 == n) break;
-        if (1 == n)
+        // Drain everything posted since the last wakeup in one go
+        while (aenc_msgq_pop(&qcelp13_info->msgq, &id))
         {
-          DEBUG_DETAIL("\n%s-->pipe_in=%d pipe_out=%d\n",
-                                               qcelp13_info->thread_name,
-                                               qcelp13_info->pipe_in,
-                                               qcelp13_info->pipe_out);
-
+            DEBUG_DETAIL("\n%s-->id=%d\n", qcelp13_info->thread_name, id);
             qcelp13_info->process_msg_cb(qcelp13_info->client_data, id);
         }
-        if ((n < 0) && (errno != EINTR)) break;
+        if (__atomic_load_n(&qcelp13_info->dead, __ATOMIC_ACQUIRE))
+            break;
+        aenc_msgq_wait(&qcelp13_info->msgq);
     }
-    DEBUG_DETAIL("%s: message thread stop\n", __FUNCTION__);
+    DEBUG_DETAIL("%s: message thread stop, %u msgs in %u wakeups\n",
+                 qcelp13_info->thread_name, qcelp13_info->msgq.posted,
+                 qcelp13_info->msgq.wakeups);
 
     return 0;
 }
@@ -95,7 +93,6 @@ struct qcelp13_ipc_info *omx_qcelp13_thread_create(
                                     char* th_name)
 {
     int r;
-    int fds[2];
     struct qcelp13_ipc_info *qcelp13_info;
 
     qcelp13_info = calloc(1, sizeof(struct qcelp13_ipc_info));
@@ -109,15 +106,12 @@ struct qcelp13_ipc_info *omx_qcelp13_thread_create(
     strlcpy(qcelp13_info->thread_name, th_name,
 			sizeof(qcelp13_info->thread_name));
 
-    if (pipe(fds))
+    if (aenc_msgq_init(&qcelp13_info->msgq))
     {
-        DEBUG_PRINT_ERROR("\n%s: pipe creation failed\n", __FUNCTION__);
-        goto fail_pipe;
+        DEBUG_PRINT_ERROR("\n%s: eventfd creation failed\n", __FUNCTION__);
+        goto fail_msgq;
     }
 
-    qcelp13_info->pipe_in = fds[0];
-    qcelp13_info->pipe_out = fds[1];
-
     r = pthread_create(&qcelp13_info->thr, 0, omx_qcelp13_msg, qcelp13_info);
     if (r < 0) goto fail_thread;
 
@@ -126,10 +120,9 @@ struct qcelp13_ipc_info *omx_qcelp13_thread_create(
 
 
 fail_thread:
-    close(qcelp13_info->pipe_in);
-    close(qcelp13_info->pipe_out);
+    aenc_msgq_deinit(&qcelp13_info->msgq);
 
-fail_pipe:
+fail_msgq:
     free(qcelp13_info);
 
     return 0;
@@ -149,7 +142,6 @@ struct qcelp13_ipc_info *omx_qcelp13_event_thread_create(
                                     char* th_name)
 {
     int r;
-    int fds[2];
     struct qcelp13_ipc_info *qcelp13_info;
 
     qcelp13_info = calloc(1, sizeof(struct qcelp13_ipc_info));
@@ -163,15 +155,12 @@ struct qcelp13_ipc_info *omx_qcelp13_event_thread_create(
     strlcpy(qcelp13_info->thread_name, th_name,
 		sizeof(qcelp13_info->thread_name));
 
-    if (pipe(fds))
+    if (aenc_msgq_init(&qcelp13_info->msgq))
     {
-        DEBUG_PRINT("\n%s: pipe creation failed\n", __FUNCTION__);
-        goto fail_pipe;
+        DEBUG_PRINT("\n%s: eventfd creation failed\n", __FUNCTION__);
+        goto fail_msgq;
     }
 
-    qcelp13_info->pipe_in = fds[0];
-    qcelp13_info->pipe_out = fds[1];
-
     r = pthread_create(&qcelp13_info->thr, 0, omx_qcelp13_events, qcelp13_info);
     if (r < 0) goto fail_thread;
 
@@ -180,10 +169,9 @@ struct qcelp13_ipc_info *omx_qcelp13_event_thread_create(
 
 
 fail_thread:
-    close(qcelp13_info->pipe_in);
-    close(qcelp13_info->pipe_out);
+    aenc_msgq_deinit(&qcelp13_info->msgq);
 
-fail_pipe:
+fail_msgq:
     free(qcelp13_info);
 
     return 0;
@@ -191,18 +179,15 @@ fail_pipe:
 
 void omx_qcelp13_thread_stop(struct qcelp13_ipc_info *qcelp13_info) {
     DEBUG_DETAIL("%s stop server\n", __FUNCTION__);
-    close(qcelp13_info->pipe_in);
-    close(qcelp13_info->pipe_out);
+    __atomic_store_n(&qcelp13_info->dead, 1, __ATOMIC_RELEASE);
+    aenc_msgq_wake(&qcelp13_info->msgq);
     pthread_join(qcelp13_info->thr,NULL);
-    qcelp13_info->pipe_out = -1;
-    qcelp13_info->pipe_in = -1;
-    DEBUG_DETAIL("%s: message thread close fds%d %d\n", qcelp13_info->thread_name,
-        qcelp13_info->pipe_in,qcelp13_info->pipe_out);
+    aenc_msgq_deinit(&qcelp13_info->msgq);
+    DEBUG_DETAIL("%s: message thread closed\n", qcelp13_info->thread_name);
     free(qcelp13_info);
 }
 
 void omx_qcelp13_post_msg(struct qcelp13_ipc_info *qcelp13_info, unsigned char id) {
     DEBUG_DETAIL("\n%s id=%d\n", __FUNCTION__,id);
-    
-    write(qcelp13_info->pipe_out, &id, 1);
+    aenc_msgq_post(&qcelp13_info->msgq, id);
 }
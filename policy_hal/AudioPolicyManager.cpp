@@ -38,6 +38,8 @@
 #include <math.h>
 #include <hardware_legacy/audio_policy_conf.h>
 #include <cutils/properties.h>
+#define _REALLY_INCLUDE_SYS__SYSTEM_PROPERTIES_H_
+#include <sys/_system_properties.h>
 
 namespace android_audio_legacy {
 
@@ -47,9 +49,168 @@ namespace android_audio_legacy {
 const char* AudioPolicyManager::HDMI_SPKR_STR = "hdmi_spkr";
 int AudioPolicyManager::mvoice_call_state = 0;
 
+// ----------------------------------------------------------------------------
+// Traced entry points, see PolicyTrace.h
+// ----------------------------------------------------------------------------
+
+void AudioPolicyManager::initTrace()
+{
+    char path[PROPERTY_VALUE_MAX] = {0};
+
+    property_get(POLICY_TRACE_PROPERTY, path, "");
+    startTrace(path);
+}
+
+// The initial state record lets a replay bring a fresh policy to the state
+// the traced calls start from.
+void AudioPolicyManager::startTrace(const char *path)
+{
+    PolicyTraceState state;
+
+    mTrace.open(path);
+    if (!mTrace.enabled())
+        return;
+
+    memset(&state, 0, sizeof(state));
+    for (int i = 0; i < AudioSystem::NUM_FORCE_USE && i < POLICY_TRACE_MAX_FORCE_USE; i++)
+        state.forceUse[i] = mForceUse[i];
+    strncpy(state.a2dpAddress, mA2dpDeviceAddress.string(), POLICY_TRACE_ADDRESS_LEN - 1);
+    strncpy(state.scoAddress, mScoDeviceAddress.string(), POLICY_TRACE_ADDRESS_LEN - 1);
+    strncpy(state.usbAddress, mUsbCardAndDevice.string(), POLICY_TRACE_ADDRESS_LEN - 1);
+
+    int32_t args[] = { (int32_t)mAvailableOutputDevices,
+                       (int32_t)(mAvailableInputDevices | AUDIO_DEVICE_BIT_IN),
+                       mPhoneState };
+    mTrace.record(POLICY_TRACE_INITIAL_STATE, systemTime(), args, 3, 0,
+                  traceMusicDevice(), &state, sizeof(state));
+}
+
+uint32_t AudioPolicyManager::traceMusicDevice()
+{
+    return getDevicesForStream(AudioSystem::MUSIC);
+}
+
 status_t AudioPolicyManager::setDeviceConnectionState(audio_devices_t device,
                                                       AudioSystem::device_connection_state state,
                                                       const char *device_address)
+{
+    if (!mTrace.enabled())
+        return setDeviceConnectionStateInt(device, state, device_address);
+
+    nsecs_t start = systemTime();
+    status_t status = setDeviceConnectionStateInt(device, state, device_address);
+    int32_t args[] = { (int32_t)device, state };
+    mTrace.record(POLICY_TRACE_DEVICE_CONNECTION, start, args, 2, status,
+                  traceMusicDevice(), device_address,
+                  device_address != NULL ? strlen(device_address) : 0);
+    return status;
+}
+
+void AudioPolicyManager::setForceUse(AudioSystem::force_use usage,
+                                     AudioSystem::forced_config config)
+{
+    if (!mTrace.enabled()) {
+        setForceUseInt(usage, config);
+        return;
+    }
+
+    nsecs_t start = systemTime();
+    setForceUseInt(usage, config);
+    int32_t args[] = { usage, config };
+    mTrace.record(POLICY_TRACE_FORCE_USE, start, args, 2, 0, traceMusicDevice());
+}
+
+void AudioPolicyManager::setPhoneState(int state)
+{
+    if (!mTrace.enabled()) {
+        setPhoneStateInt(state);
+        return;
+    }
+
+    nsecs_t start = systemTime();
+    setPhoneStateInt(state);
+    int32_t args[] = { state };
+    mTrace.record(POLICY_TRACE_PHONE_STATE, start, args, 1, 0, traceMusicDevice());
+}
+
+audio_io_handle_t AudioPolicyManager::getOutput(AudioSystem::stream_type stream,
+                                                uint32_t samplingRate,
+                                                uint32_t format,
+                                                uint32_t channelMask,
+                                                AudioSystem::output_flags flags,
+                                                const audio_offload_info_t *offloadInfo)
+{
+    if (!mTrace.enabled())
+        return getOutputInt(stream, samplingRate, format, channelMask, flags, offloadInfo);
+
+    nsecs_t start = systemTime();
+    audio_io_handle_t output = getOutputInt(stream, samplingRate, format, channelMask,
+                                            flags, offloadInfo);
+    int32_t args[] = { stream, (int32_t)samplingRate, (int32_t)format,
+                       (int32_t)channelMask, flags };
+    PolicyTraceOffloadInfo info;
+    if (offloadInfo != NULL) {
+        memset(&info, 0, sizeof(info));
+        info.sampleRate = offloadInfo->sample_rate;
+        info.channelMask = offloadInfo->channel_mask;
+        info.format = offloadInfo->format;
+        info.streamType = offloadInfo->stream_type;
+        info.bitRate = offloadInfo->bit_rate;
+        info.durationMs = (int32_t)(offloadInfo->duration_us / 1000);
+        info.hasVideo = offloadInfo->has_video;
+        info.isStreaming = offloadInfo->is_streaming;
+    }
+    mTrace.record(POLICY_TRACE_GET_OUTPUT, start, args, 5, output, traceMusicDevice(),
+                  offloadInfo != NULL ? &info : NULL, sizeof(info));
+    return output;
+}
+
+status_t AudioPolicyManager::startOutput(audio_io_handle_t output,
+                                         AudioSystem::stream_type stream,
+                                         int session)
+{
+    if (!mTrace.enabled())
+        return startOutputInt(output, stream, session);
+
+    nsecs_t start = systemTime();
+    status_t status = startOutputInt(output, stream, session);
+    int32_t args[] = { output, stream, session };
+    mTrace.record(POLICY_TRACE_START_OUTPUT, start, args, 3, status, traceMusicDevice());
+    return status;
+}
+
+status_t AudioPolicyManager::stopOutput(audio_io_handle_t output,
+                                        AudioSystem::stream_type stream,
+                                        int session)
+{
+    if (!mTrace.enabled())
+        return stopOutputInt(output, stream, session);
+
+    nsecs_t start = systemTime();
+    status_t status = stopOutputInt(output, stream, session);
+    int32_t args[] = { output, stream, session };
+    mTrace.record(POLICY_TRACE_STOP_OUTPUT, start, args, 3, status, traceMusicDevice());
+    return status;
+}
+
+void AudioPolicyManager::releaseOutput(audio_io_handle_t output)
+{
+    if (!mTrace.enabled()) {
+        releaseOutputInt(output);
+        return;
+    }
+
+    nsecs_t start = systemTime();
+    releaseOutputInt(output);
+    int32_t args[] = { output };
+    mTrace.record(POLICY_TRACE_RELEASE_OUTPUT, start, args, 1, 0, traceMusicDevice());
+}
+
+// ----------------------------------------------------------------------------
+
+status_t AudioPolicyManager::setDeviceConnectionStateInt(audio_devices_t device,
+                                                      AudioSystem::device_connection_state state,
+                                                      const char *device_address)
 {
     SortedVector <audio_io_handle_t> outputs;
 
@@ -319,7 +480,7 @@ status_t AudioPolicyManager::setDeviceConnectionState(audio_devices_t device,
     return BAD_VALUE;
 }
 
-void AudioPolicyManager::setForceUse(AudioSystem::force_use usage, AudioSystem::forced_config config)
+void AudioPolicyManager::setForceUseInt(AudioSystem::force_use usage, AudioSystem::forced_config config)
 {
     ALOGD("setForceUse() usage %d, config %d, mPhoneState %d", usage, config, mPhoneState);
 
@@ -425,6 +586,8 @@ audio_io_handle_t AudioPolicyManager::getInput(int inputSource,
     ALOGD("getInput() inputSource %d, samplingRate %d, format %d, channelMask %x, acoustics %x",
           inputSource, samplingRate, format, channelMask, acoustics);
 
+    refreshConfig();
+
     if (device == AUDIO_DEVICE_NONE) {
         ALOGW("getInput() could not find device for inputSource %d", inputSource);
         return 0;
@@ -432,16 +595,8 @@ audio_io_handle_t AudioPolicyManager::getInput(int inputSource,
 
 #ifdef VOICE_CONCURRENCY
 
-    char propValue[PROPERTY_VALUE_MAX];
-    bool prop_rec_enabled=false, prop_voip_enabled = false;
-
-    if(property_get("voice.record.conc.disabled", propValue, NULL)) {
-        prop_rec_enabled = atoi(propValue) || !strncmp("true", propValue, 4);
-    }
-
-    if(property_get("voice.voip.conc.disabled", propValue, NULL)) {
-        prop_voip_enabled = atoi(propValue) || !strncmp("true", propValue, 4);
-    }
+    bool prop_rec_enabled = mConfig.voiceRecordConcDisabled;
+    bool prop_voip_enabled = mConfig.voipConcDisabled;
 
     if (prop_rec_enabled && mvoice_call_state) {
          //check if voice call is active  / running in background
@@ -569,10 +724,31 @@ AudioPolicyManager::routing_strategy AudioPolicyManager::getStrategy(AudioSystem
 
 }
 
+void AudioPolicyManager::checkDeviceMemo()
+{
+    DeviceMemoKey key;
+
+    memset(&key, 0, sizeof(key));
+    key.phoneState = mPhoneState;
+    key.prevPhoneState = mPrevPhoneState;
+    for (int i = 0; i < AudioSystem::NUM_FORCE_USE; i++) {
+        key.forceUse[i] = mForceUse[i];
+    }
+    key.availableOutputDevices = mAvailableOutputDevices;
+    key.a2dpOutput = mHasA2dp && (getA2dpOutput() != 0);
+    key.a2dpSuspended = mA2dpSuspended;
+
+    if (memcmp(&key, &mDeviceMemoKey, sizeof(key)) != 0) {
+        ALOGVV("checkDeviceMemo() routing inputs changed, dropping memo");
+        mDeviceMemoKey = key;
+        mDeviceMemoValid = 0;
+    }
+}
+
 audio_devices_t AudioPolicyManager::getDeviceForStrategy(routing_strategy strategy,
                                                              bool fromCache)
 {
-    uint32_t device = AUDIO_DEVICE_NONE;
+    audio_devices_t device;
 
     if (fromCache) {
         ALOGVV("getDeviceForStrategy() from cache strategy %d, device %x",
@@ -580,6 +756,28 @@ audio_devices_t AudioPolicyManager::getDeviceForStrategy(routing_strategy strate
         return mDeviceForStrategy[strategy];
     }
 
+    if (strategy < 0 || strategy >= NUM_STRATEGIES ||
+            strategy == STRATEGY_SONIFICATION_RESPECTFUL) {
+        return computeDeviceForStrategy(strategy);
+    }
+
+    checkDeviceMemo();
+    if (mDeviceMemoValid & (1 << strategy)) {
+        mDeviceMemoHits++;
+        return mDeviceMemo[strategy];
+    }
+
+    mDeviceMemoMisses++;
+    device = computeDeviceForStrategy(strategy);
+    mDeviceMemo[strategy] = device;
+    mDeviceMemoValid |= 1 << strategy;
+    return device;
+}
+
+audio_devices_t AudioPolicyManager::computeDeviceForStrategy(routing_strategy strategy)
+{
+    uint32_t device = AUDIO_DEVICE_NONE;
+
     switch (strategy) {
 
     case STRATEGY_SONIFICATION_RESPECTFUL:
@@ -1169,7 +1367,7 @@ float AudioPolicyManager::computeVolume(int stream,
 }
 
 
-audio_io_handle_t AudioPolicyManager::getOutput(AudioSystem::stream_type stream,
+audio_io_handle_t AudioPolicyManager::getOutputInt(AudioSystem::stream_type stream,
                                     uint32_t samplingRate,
                                     uint32_t format,
                                     uint32_t channelMask,
@@ -1182,17 +1380,11 @@ audio_io_handle_t AudioPolicyManager::getOutput(AudioSystem::stream_type stream,
     audio_devices_t device = getDeviceForStrategy(strategy, false /*fromCache*/);
     IOProfile *profile = NULL;
 
-#ifdef VOICE_CONCURRENCY
-    char propValue[PROPERTY_VALUE_MAX];
-    bool prop_play_enabled=false, prop_voip_enabled = false;
-
-    if(property_get("voice.playback.conc.disabled", propValue, NULL)) {
-       prop_play_enabled = atoi(propValue) || !strncmp("true", propValue, 4);
-    }
+    refreshConfig();
 
-    if(property_get("voice.voip.conc.disabled", propValue, NULL)) {
-       prop_voip_enabled = atoi(propValue) || !strncmp("true", propValue, 4);
-    }
+#ifdef VOICE_CONCURRENCY
+    bool prop_play_enabled = mConfig.voicePlaybackConcDisabled;
+    bool prop_voip_enabled = mConfig.voipConcDisabled;
 
     if (prop_play_enabled && mvoice_call_state) {
         //check if voice call is active  / running in background
@@ -1210,6 +1402,7 @@ audio_io_handle_t AudioPolicyManager::getOutput(AudioSystem::stream_type stream,
             else {
                 ALOGD(" IN call mode adding ULL flags .. flags: %x ", flags );
                 flags = (AudioSystem::output_flags)AUDIO_OUTPUT_FLAG_FAST;
+                mCallFastStreams |= 1 << stream;
             }
         }
     } else if (prop_voip_enabled && mvoice_call_state) {
@@ -1349,11 +1542,7 @@ audio_io_handle_t AudioPolicyManager::getOutput(AudioSystem::stream_type stream,
         AudioOutputDescriptor *outputDesc = NULL;
 
 #ifdef MULTIPLE_OFFLOAD_ENABLED
-        bool multiOffloadEnabled = false;
-        char value[PROPERTY_VALUE_MAX] = {0};
-        property_get("audio.offload.multiple.enabled", value, NULL);
-        if (atoi(value) || !strncmp("true", value, 4))
-            multiOffloadEnabled = true;
+        bool multiOffloadEnabled = mConfig.multipleOffloadEnabled;
         // if multiple concurrent offload decode is supported
         // do no check for reuse and also don't close previous output if its offload
         // previous output will be closed during track destruction
@@ -1457,17 +1646,12 @@ bool AudioPolicyManager::isOffloadSupported(const audio_offload_info_t& offloadI
      offloadInfo.stream_type, offloadInfo.bit_rate, offloadInfo.duration_us,
      offloadInfo.has_video);
 
+    refreshConfig();
+
 #ifdef VOICE_CONCURRENCY
-    char concpropValue[PROPERTY_VALUE_MAX];
-    if(property_get("voice.playback.conc.disabled", concpropValue, NULL)) {
-         bool propenabled = atoi(concpropValue) || !strncmp("true", concpropValue, 4);
-         if (propenabled) {
-            if(isInCall())
-            {
-                ALOGD("\n copl: blocking  compress offload on call mode\n");
-                return false;
-            }
-         }
+    if (mConfig.voicePlaybackConcDisabled && isInCall()) {
+        ALOGD("\n copl: blocking  compress offload on call mode\n");
+        return false;
     }
 
 #endif
@@ -1478,15 +1662,11 @@ bool AudioPolicyManager::isOffloadSupported(const audio_offload_info_t& offloadI
         return false;
     }
 
-    char propValue[PROPERTY_VALUE_MAX];
     bool pcmOffload = false;
     if (audio_is_offload_pcm(offloadInfo.format)) {
-        if(property_get("audio.offload.pcm.enable", propValue, NULL)) {
-            bool prop_enabled = atoi(propValue) || !strncmp("true", propValue, 4);
-            if (prop_enabled) {
-                ALOGW("PCM offload property is enabled");
-                pcmOffload = true;
-            }
+        if (mConfig.pcmOffloadEnabled) {
+            ALOGW("PCM offload property is enabled");
+            pcmOffload = true;
         }
         if (!pcmOffload) {
             ALOGD("copl: PCM offload disabled by property audio.offload.pcm.enable");
@@ -1496,11 +1676,9 @@ bool AudioPolicyManager::isOffloadSupported(const audio_offload_info_t& offloadI
 
     if (!pcmOffload) {
         // Check if offload has been disabled
-        if (property_get("audio.offload.disable", propValue, "0")) {
-            if (atoi(propValue) != 0) {
-                ALOGD("copl: offload disabled by audio.offload.disable=%s", propValue );
-                return false;
-            }
+        if (mConfig.offloadDisabled) {
+            ALOGD("copl: offload disabled by audio.offload.disable");
+            return false;
         }
 
         //check if it's multi-channel AAC format
@@ -1512,27 +1690,15 @@ bool AudioPolicyManager::isOffloadSupported(const audio_offload_info_t& offloadI
 
         if (offloadInfo.has_video)
         {
-            if(property_get("av.offload.enable", propValue, NULL)) {
-                bool prop_enabled = atoi(propValue) || !strncmp("true", propValue, 4);
-                if (!prop_enabled) {
-                    ALOGW("offload disabled by av.offload.enable = %s ", propValue );
-                    return false;
-                }
-            } else {
+            if (!mConfig.avOffloadEnabled) {
+                ALOGW("offload disabled by av.offload.enable");
                 return false;
             }
 
-            if(offloadInfo.is_streaming) {
-                if (property_get("av.streaming.offload.enable", propValue, NULL)) {
-                    bool prop_enabled = atoi(propValue) || !strncmp("true", propValue, 4);
-                    if (!prop_enabled) {
-                       ALOGW("offload disabled by av.streaming.offload.enable = %s ", propValue );
-                       return false;
-                    }
-                } else {
-                    //Do not offload AV streamnig if the property is not defined
-                    return false;
-                }
+            //Do not offload AV streamnig if the property is not defined
+            if (offloadInfo.is_streaming && !mConfig.avStreamingOffloadEnabled) {
+                ALOGW("offload disabled by av.streaming.offload.enable");
+                return false;
             }
             ALOGD("copl: isOffloadSupported: has_video == true, property\
                     set to enable offload");
@@ -1540,9 +1706,10 @@ bool AudioPolicyManager::isOffloadSupported(const audio_offload_info_t& offloadI
     }
 
     //If duration is less than minimum value defined in property, return false
-    if (property_get("audio.offload.min.duration.secs", propValue, NULL)) {
-        if (offloadInfo.duration_us < (atoi(propValue) * 1000000 )) {
-            ALOGD("copl: Offload denied by duration < audio.offload.min.duration.secs(=%s)", propValue);
+    if (mConfig.minOffloadDurationSecs >= 0) {
+        if (offloadInfo.duration_us < (mConfig.minOffloadDurationSecs * 1000000LL)) {
+            ALOGD("copl: Offload denied by duration < audio.offload.min.duration.secs(=%d)",
+                  mConfig.minOffloadDurationSecs);
             return false;
         }
     } else if (offloadInfo.duration_us < OFFLOAD_DEFAULT_MIN_DURATION_SECS * 1000000) {
@@ -1574,7 +1741,7 @@ bool AudioPolicyManager::isOffloadSupported(const audio_offload_info_t& offloadI
     return (profile != NULL);
 }
 
-void AudioPolicyManager::setPhoneState(int state)
+void AudioPolicyManager::setPhoneStateInt(int state)
 
 {
     ALOGD("setPhoneState() state %d", state);
@@ -1589,6 +1756,9 @@ void AudioPolicyManager::setPhoneState(int state)
         return;
     }
 
+    // call setup is where the concurrency properties are acted on
+    refreshConfig();
+
     // if leaving call state, handle special case of active streams
     // pertaining to sonification strategy see handleIncallSonification()
     if (isInCall()) {
@@ -1644,20 +1814,9 @@ void AudioPolicyManager::setPhoneState(int state)
         newDevice = hwOutputDesc->device();
     }
 #ifdef VOICE_CONCURRENCY
-    char propValue[PROPERTY_VALUE_MAX];
-    bool prop_playback_enabled = false, prop_rec_enabled=false, prop_voip_enabled = false;
-
-    if(property_get("voice.playback.conc.disabled", propValue, NULL)) {
-        prop_playback_enabled = atoi(propValue) || !strncmp("true", propValue, 4);
-    }
-
-    if(property_get("voice.record.conc.disabled", propValue, NULL)) {
-        prop_rec_enabled = atoi(propValue) || !strncmp("true", propValue, 4);
-    }
-
-    if(property_get("voice.voip.conc.disabled", propValue, NULL)) {
-        prop_voip_enabled = atoi(propValue) || !strncmp("true", propValue, 4);
-    }
+    bool prop_playback_enabled = mConfig.voicePlaybackConcDisabled;
+    bool prop_rec_enabled = mConfig.voiceRecordConcDisabled;
+    bool prop_voip_enabled = mConfig.voipConcDisabled;
 
     bool mode_in_call = (AudioSystem::MODE_IN_CALL != oldState) && (AudioSystem::MODE_IN_CALL == state);
     //query if it is a actual voice call initiated by telephony
@@ -1722,6 +1881,8 @@ void AudioPolicyManager::setPhoneState(int state)
         }
 
         //suspend  PCM (deep-buffer) output & close  compress & direct tracks
+        SortedVector<audio_io_handle_t> closing;
+        mCallFastStreams = 0;
         for (size_t i = 0; i < mOutputs.size(); i++) {
             AudioOutputDescriptor *outputDesc = mOutputs.valueAt(i);
             if (!outputDesc || !outputDesc->mProfile) {
@@ -1731,44 +1892,52 @@ void AudioPolicyManager::setPhoneState(int state)
             if (((!outputDesc->isDuplicated() &&outputDesc->mProfile->mFlags & AUDIO_OUTPUT_FLAG_PRIMARY))
                         && prop_playback_enabled) {
                 ALOGD(" calling suspendOutput on call mode for primary output");
-                mpClientInterface->suspendOutput(mOutputs.keyAt(i));
+                if (suspendOutputFor(mOutputs.keyAt(i), SUSPEND_FOR_CALL)) {
+                    mCallTransitions.suspended++;
+                }
             } //Close compress all sessions
             else if ((outputDesc->mProfile->mFlags & AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD)
                             &&  prop_playback_enabled) {
                 ALOGD(" calling closeOutput on call mode for COMPRESS output");
-                closeOutput(mOutputs.keyAt(i));
+                closing.add(mOutputs.keyAt(i));
             }
             else if ((outputDesc->mProfile->mFlags & AUDIO_OUTPUT_FLAG_VOIP_RX)
                             && prop_voip_enabled) {
                 ALOGD(" calling closeOutput on call mode for DIRECT  output");
-                closeOutput(mOutputs.keyAt(i));
+                closing.add(mOutputs.keyAt(i));
             }
         }
+        // closeOutput() edits mOutputs, so close once the scan is done
+        for (size_t i = 0; i < closing.size(); i++) {
+            closeOutput(closing[i]);
+        }
+        mCallTransitions.closed += closing.size();
+        mCallTransitions.transitions++;
+        if (prop_playback_enabled) {
+            mCallTransitions.invalidations += AudioSystem::NUM_STREAM_TYPES - AudioSystem::SYSTEM;
+        }
    }
 
    if ((AudioSystem::MODE_IN_CALL == oldState) && (AudioSystem::MODE_IN_CALL != state)
         && prop_playback_enabled && mvoice_call_state) {
         ALOGD("EXITING from call mode oldState :: %d state::%d \n",oldState, state);
         mvoice_call_state = 0;
-        //restore PCM (deep-buffer) output after call termination
-        for (size_t i = 0; i < mOutputs.size(); i++) {
-            AudioOutputDescriptor *outputDesc = mOutputs.valueAt(i);
-            if (!outputDesc || !outputDesc->mProfile) {
-               ALOGD("ouput desc / profile is NULL");
-               continue;
-            }
-            if (!outputDesc->isDuplicated() &&outputDesc->mProfile->mFlags & AUDIO_OUTPUT_FLAG_PRIMARY) {
-                ALOGD("calling restoreOutput after call mode for primary output");
-                mpClientInterface->restoreOutput(mOutputs.keyAt(i));
-            }
-       }
+        //restore PCM (deep-buffer) outputs suspended for the call
+        mCallTransitions.restored += restoreOutputsFor(SUSPEND_FOR_CALL);
+        mCallTransitions.transitions++;
        //call invalidate tracks so that any open streams can fall back to deep buffer/compress path from ULL
+       //Only streams given an ULL output during the call have tracks to move back; tracks
+       //that stayed idle through the call pick their output again when they restart.
        for (int i = AudioSystem::SYSTEM; i < (int)AudioSystem::NUM_STREAM_TYPES; i++) {
+           if (!(mCallFastStreams & (1 << i)))
+               continue;
            ALOGD("Invalidate on call mode for stream :: %d ", i);
            //FIXME see fixme on name change
            mpClientInterface->setStreamOutput((AudioSystem::stream_type)i,
                                                   0 /* ignored */);
+           mCallTransitions.invalidations++;
        }
+       mCallFastStreams = 0;
     }
 #endif
     mPrevPhoneState = oldState;
@@ -1861,7 +2030,7 @@ void AudioPolicyManager::handleNotificationRoutingForStream(AudioSystem::stream_
     }
 }
 
-status_t AudioPolicyManager::startOutput(audio_io_handle_t output,
+status_t AudioPolicyManager::startOutputInt(audio_io_handle_t output,
                                              AudioSystem::stream_type stream,
                                              int session)
 {
@@ -1952,7 +2121,7 @@ status_t AudioPolicyManager::startOutput(audio_io_handle_t output,
 }
 
 
-status_t AudioPolicyManager::stopOutput(audio_io_handle_t output,
+status_t AudioPolicyManager::stopOutputInt(audio_io_handle_t output,
                                             AudioSystem::stream_type stream,
                                             int session)
 {
@@ -2027,7 +2196,7 @@ status_t AudioPolicyManager::stopOutput(audio_io_handle_t output,
     }
 }
 
-void AudioPolicyManager::releaseOutput(audio_io_handle_t output)
+void AudioPolicyManager::releaseOutputInt(audio_io_handle_t output)
 {
     ALOGV("releaseOutput() %d", output);
     ssize_t index = mOutputs.indexOfKey(output);
@@ -2093,6 +2262,7 @@ void AudioPolicyManager::closeOutput(audio_io_handle_t output)
         ALOGW("closeOutput() unknown output %d", output);
         return;
     }
+    mSuspendedOutputs.removeItem(output);
 
     // look for duplicated outputs connected to the output being removed.
     for (size_t i = 0; i < mOutputs.size(); i++) {
@@ -2141,9 +2311,25 @@ void AudioPolicyManager::closeOutput(audio_io_handle_t output)
 
 #ifdef HDMI_PASSTHROUGH_ENABLED
 
+// Fast, deep buffer, primary and multichannel PCM outputs on HDMI cannot
+// play while a passthrough session owns it.
+bool AudioPolicyManager::isPassthroughSuspendable(const AudioOutputDescriptor *desc)
+{
+    if (!(desc->mDevice & AUDIO_DEVICE_OUT_AUX_DIGITAL) &&
+            desc->mDevice != AUDIO_DEVICE_NONE)
+        return false;
+
+    return (desc->mFlags & AUDIO_OUTPUT_FLAG_FAST) ||
+           (desc->mFlags & AUDIO_OUTPUT_FLAG_DEEP_BUFFER) ||
+           (desc->mFlags & AUDIO_OUTPUT_FLAG_PRIMARY) ||
+           ((desc->mFlags & AUDIO_OUTPUT_FLAG_DIRECT) &&
+            !(desc->mFlags & AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD));
+}
+
 void AudioPolicyManager::checkAndSuspendOutputs() {
 
     AudioOutputDescriptor *desc;
+    uint32_t suspended = 0;
 
     if (!isHDMIPassthroughEnabled()) {
         ALOGV("checkAndSuspendOutputs: passthrough not enabled");
@@ -2154,111 +2340,32 @@ void AudioPolicyManager::checkAndSuspendOutputs() {
         desc = mOutputs.valueAt(i);
         ALOGV("checkAndSuspendOutputs:device 0x%x, flag %x, music refcount %d",
              desc->mDevice, desc->mFlags, desc->mRefCount[AudioSystem::MUSIC]);
-        if (desc->mDevice & AUDIO_DEVICE_OUT_AUX_DIGITAL ||
-            desc->mDevice == AUDIO_DEVICE_NONE) {
-            // check if  fast/deep buffer/multichannel outputs are already
-            // suspended before suspending the output
-            if (((desc->mFlags &
-                        (AudioSystem::output_flags)AUDIO_OUTPUT_FLAG_FAST) &&
-                        !mFastSuspended) ||
-                ((desc->mFlags &
-                        (AudioSystem::output_flags)AUDIO_OUTPUT_FLAG_DEEP_BUFFER) &&
-                        !mPrimarySuspended) ||
-                ((desc->mFlags &
-                        (AudioSystem::output_flags)AUDIO_OUTPUT_FLAG_PRIMARY) &&
-                        !mPrimarySuspended) ||
-                ((desc->mFlags &   (AudioSystem::output_flags)
-                        AUDIO_OUTPUT_FLAG_DIRECT) &&
-                        !(desc->mFlags &  (AudioSystem::output_flags)
-                        AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD) &&
-                        !mMultiChannelSuspended)) {
-                /*TODO : is other streams needed here. */
-                ALOGD("suspend Ouput");
-                mpClientInterface->suspendOutput(mOutputs.keyAt(i));
-                // Update the reference count of fast/deep buffer/multichannel
-                // after suspend.
-                if (desc->mFlags &
-                    (AudioSystem::output_flags)AUDIO_OUTPUT_FLAG_DEEP_BUFFER ||
-                    desc->mFlags &
-                    (AudioSystem::output_flags)AUDIO_OUTPUT_FLAG_PRIMARY) {
-                    mPrimarySuspended++;
-                } else if (desc->mFlags &
-                    (AudioSystem::output_flags)AUDIO_OUTPUT_FLAG_FAST) {
-                    mFastSuspended++;
-                } else if ((desc->mFlags & (AudioSystem::output_flags)
-                    AUDIO_OUTPUT_FLAG_DIRECT) &&
-                    !(desc->mFlags &  (AudioSystem::output_flags)
-                    AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD)) {
-                    mMultiChannelSuspended++;
-                }
-            } else {
-                continue;
-                ALOGD("Ignore  suspend");
-            }
+        // outputs already suspended are left alone
+        if (isPassthroughSuspendable(desc) &&
+                suspendOutputFor(mOutputs.keyAt(i), SUSPEND_FOR_PASSTHROUGH)) {
+            suspended++;
         }
     }
-    ALOGV("Suspend count: primary %d, fast %d, multichannel %d",
-           mPrimarySuspended, mFastSuspended, mMultiChannelSuspended);
+    mPassthroughTransitions.transitions++;
+    mPassthroughTransitions.suspended += suspended;
+    ALOGV("checkAndSuspendOutputs: %u suspended, %zu held",
+          suspended, mSuspendedOutputs.size());
 }
 
 void AudioPolicyManager::checkAndRestoreOutputs() {
 
-    AudioOutputDescriptor *desc;
+    uint32_t restored;
 
     if (!isHDMIPassthroughEnabled()) {
         ALOGV("checkAndRestoreOutputs: passthrough not enabled");
         return;
     }
 
-    for (size_t i = 0; i < mOutputs.size(); i++) {
-        desc = mOutputs.valueAt(i);
-        ALOGV("checkAndRestoreOutputs: device 0x%x, flag %x, music refcount %d",
-             desc->mDevice, desc->mFlags, desc->mRefCount[AudioSystem::MUSIC]);
-        if (desc->mDevice & AUDIO_DEVICE_OUT_AUX_DIGITAL ||
-            desc->mDevice == AUDIO_DEVICE_NONE) {
-            // check if the deep buffer/fast/multichannel outputs were
-            // suspended before restore.
-            if (((desc->mFlags &
-                    (AudioSystem::output_flags)AUDIO_OUTPUT_FLAG_FAST) &&
-                    mFastSuspended) ||
-                ((desc->mFlags &
-                    (AudioSystem::output_flags)AUDIO_OUTPUT_FLAG_DEEP_BUFFER) &&
-                    mPrimarySuspended) ||
-                ((desc->mFlags &
-                    (AudioSystem::output_flags)AUDIO_OUTPUT_FLAG_PRIMARY) &&
-                    mPrimarySuspended) ||
-                ((desc->mFlags &  (AudioSystem::output_flags)
-                    AUDIO_OUTPUT_FLAG_DIRECT) &&
-                    !(desc->mFlags & (AudioSystem::output_flags)
-                    AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD) &&
-                    mMultiChannelSuspended)) {
-
-                ALOGD("restore Output");
-                mpClientInterface->restoreOutput(mOutputs.keyAt(i));
-                // update the reference count for fast/deep buffer/multichannel
-                // after restore.
-                if (desc->mFlags &
-                    (AudioSystem::output_flags)AUDIO_OUTPUT_FLAG_DEEP_BUFFER ||
-                    desc->mFlags &
-                    (AudioSystem::output_flags)AUDIO_OUTPUT_FLAG_PRIMARY) {
-                    mPrimarySuspended--;
-                } else if (desc->mFlags &
-                    (AudioSystem::output_flags)AUDIO_OUTPUT_FLAG_FAST) {
-                    mFastSuspended--;
-                } else if ((desc->mFlags & (AudioSystem::output_flags)
-                    AUDIO_OUTPUT_FLAG_DIRECT) &&
-                    !(desc->mFlags &  (AudioSystem::output_flags)
-                    AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD)) {
-                    mMultiChannelSuspended--;
-                }
-            } else {
-                continue;
-                ALOGD("Ignore  restore");
-            }
-        }
-    }
-    ALOGV("Restore count: primary %d, fast %d, multichannel %d",
-          mPrimarySuspended, mFastSuspended, mMultiChannelSuspended);
+    restored = restoreOutputsFor(SUSPEND_FOR_PASSTHROUGH);
+    mPassthroughTransitions.transitions++;
+    mPassthroughTransitions.restored += restored;
+    ALOGV("checkAndRestoreOutputs: %u restored, %zu held",
+          restored, mSuspendedOutputs.size());
 }
 
 audio_devices_t AudioPolicyManager::handleHDMIPassthrough(audio_devices_t device,
@@ -2538,7 +2645,7 @@ void AudioPolicyManager::updateAndCloseOutputs() {
 
 void AudioPolicyManager::closeOffloadOutputs() {
 
-    bool passthroughActive = false;
+    SortedVector<audio_io_handle_t> idle;
     AudioOutputDescriptor *desc;
 
     if (!isHDMIPassthroughEnabled())
@@ -2558,17 +2665,23 @@ void AudioPolicyManager::closeOffloadOutputs() {
             (!(desc->mFlags &
             (AudioSystem::output_flags)AUDIO_OUTPUT_FLAG_COMPRESS_PASSTHROUGH))
             ) && desc->mRefCount[AudioSystem::MUSIC] == 0) {
-            mpClientInterface->setStreamOutput(AudioSystem::MUSIC, 0);
-            closeOutput(desc->mId);
+            idle.add(mOutputs.keyAt(i));
         }
     }
+    if (idle.isEmpty())
+        return;
+
+    // one invalidation moves the music tracks off every output closed below
+    mpClientInterface->setStreamOutput(AudioSystem::MUSIC, 0);
+    mPassthroughTransitions.invalidations++;
+    for (size_t i = 0; i < idle.size(); i++) {
+        closeOutput(idle[i]);
+    }
+    mPassthroughTransitions.closed += idle.size();
 }
 bool AudioPolicyManager::isHDMIPassthroughEnabled() {
 
-    char value[PROPERTY_VALUE_MAX] = {0};
-
-    property_get("audio.offload.passthrough", value, NULL);
-    if (atoi(value) || !strncmp("true", value, 4)) {
+    if (mConfig.hdmiPassthroughEnabled) {
         ALOGD("HDMI Passthrough is enabled");
         return true;
     }
@@ -2577,15 +2690,164 @@ bool AudioPolicyManager::isHDMIPassthroughEnabled() {
 }
 #endif
 
+bool AudioPolicyManager::suspendOutputFor(audio_io_handle_t output, uint32_t reason)
+{
+    ssize_t index = mSuspendedOutputs.indexOfKey(output);
+
+    if (index >= 0) {
+        mSuspendedOutputs.editValueAt(index) |= reason;
+        return false;
+    }
+    ALOGD("suspendOutputFor() output %d, reason %x", output, reason);
+    mpClientInterface->suspendOutput(output);
+    mSuspendedOutputs.add(output, reason);
+    return true;
+}
+
+bool AudioPolicyManager::restoreOutputFor(audio_io_handle_t output, uint32_t reason)
+{
+    ssize_t index = mSuspendedOutputs.indexOfKey(output);
+
+    if (index < 0 || !(mSuspendedOutputs.valueAt(index) & reason))
+        return false;
+    mSuspendedOutputs.editValueAt(index) &= ~reason;
+    if (mSuspendedOutputs.valueAt(index) != 0)
+        return false;
+
+    ALOGD("restoreOutputFor() output %d, reason %x", output, reason);
+    mSuspendedOutputs.removeItemsAt(index);
+    mpClientInterface->restoreOutput(output);
+    return true;
+}
+
+uint32_t AudioPolicyManager::restoreOutputsFor(uint32_t reason)
+{
+    uint32_t restored = 0;
+
+    // restoreOutputFor() removes entries, walk backwards
+    for (ssize_t i = mSuspendedOutputs.size() - 1; i >= 0; i--) {
+        if (restoreOutputFor(mSuspendedOutputs.keyAt(i), reason))
+            restored++;
+    }
+    return restored;
+}
+
+status_t AudioPolicyManager::dump(int fd)
+{
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+
+    AudioPolicyManagerBase::dump(fd);
+    snprintf(buffer, SIZE, " Device for strategy memo: %u hits, %u misses\n",
+             mDeviceMemoHits, mDeviceMemoMisses);
+    write(fd, buffer, strlen(buffer));
+    snprintf(buffer, SIZE, " Call transitions: %u, outputs suspended %u, restored %u, "
+             "closed %u, stream invalidations %u\n",
+             mCallTransitions.transitions, mCallTransitions.suspended,
+             mCallTransitions.restored, mCallTransitions.closed,
+             mCallTransitions.invalidations);
+    write(fd, buffer, strlen(buffer));
+    snprintf(buffer, SIZE, " Passthrough transitions: %u, outputs suspended %u, restored %u, "
+             "closed %u, stream invalidations %u\n",
+             mPassthroughTransitions.transitions, mPassthroughTransitions.suspended,
+             mPassthroughTransitions.restored, mPassthroughTransitions.closed,
+             mPassthroughTransitions.invalidations);
+    write(fd, buffer, strlen(buffer));
+    return NO_ERROR;
+}
+
 bool AudioPolicyManager::isExternalModem()
 {
-    char platform[128], baseband[128];
-    property_get("ro.board.platform", platform, "");
-    property_get("ro.baseband", baseband, "");
-    if (!strcmp("apq8084", platform) && !strncmp("mdm", baseband, 3))
-        return true;
+    return mConfig.externalModem;
+}
+
+static bool propertyEnabled(const char *key)
+{
+    char value[PROPERTY_VALUE_MAX] = {0};
+
+    property_get(key, value, NULL);
+    return atoi(value) || !strncmp("true", value, 4);
+}
+
+void AudioPolicyManager::loadConfig()
+{
+    char value[PROPERTY_VALUE_MAX] = {0};
+    char baseband[PROPERTY_VALUE_MAX] = {0};
+
+    mConfig.voicePlaybackConcDisabled = propertyEnabled("voice.playback.conc.disabled");
+    mConfig.voiceRecordConcDisabled = propertyEnabled("voice.record.conc.disabled");
+    mConfig.voipConcDisabled = propertyEnabled("voice.voip.conc.disabled");
+    mConfig.pcmOffloadEnabled = propertyEnabled("audio.offload.pcm.enable");
+    property_get("audio.offload.disable", value, "0");
+    mConfig.offloadDisabled = atoi(value) != 0;
+    mConfig.avOffloadEnabled = propertyEnabled("av.offload.enable");
+    mConfig.avStreamingOffloadEnabled = propertyEnabled("av.streaming.offload.enable");
+    if (property_get("audio.offload.min.duration.secs", value, NULL))
+        mConfig.minOffloadDurationSecs = atoi(value);
     else
-        return false;
+        mConfig.minOffloadDurationSecs = -1;
+    mConfig.multipleOffloadEnabled = propertyEnabled("audio.offload.multiple.enabled");
+    mConfig.hdmiPassthroughEnabled = propertyEnabled("audio.offload.passthrough");
+
+    property_get("ro.board.platform", value, "");
+    property_get("ro.baseband", baseband, "");
+    mConfig.externalModem = !strcmp("apq8084", value) && !strncmp("mdm", baseband, 3);
+}
+
+// Properties behind mConfig and the HAL's audio_config snapshot. The HAL
+// ones are watched here too so that a runtime setprop reaches both sides.
+const char * const AudioPolicyManager::kConfigProperties[kNumConfigProperties] = {
+    "voice.playback.conc.disabled",
+    "voice.record.conc.disabled",
+    "voice.voip.conc.disabled",
+    "audio.offload.pcm.enable",
+    "audio.offload.disable",
+    "av.offload.enable",
+    "av.streaming.offload.enable",
+    "audio.offload.min.duration.secs",
+    "audio.offload.multiple.enabled",
+    "audio.offload.passthrough",
+    "audio.offload.gapless.enabled",
+    "audio.use.hdmi.sink.cap",
+    "audio.offload.track.enabled",
+    "audio.offload.buffer.size.kb",
+    "audio.offload.pcm.buffer.size",
+    "audio.offload.track.buffer.size",
+};
+
+void AudioPolicyManager::refreshConfig()
+{
+    bool changed = false;
+
+    for (size_t i = 0; i < kNumConfigProperties; i++) {
+        // a property only gets a prop_info once it is first set
+        if (mConfigPropInfo[i] == NULL)
+            mConfigPropInfo[i] = __system_property_find(kConfigProperties[i]);
+        unsigned int serial = mConfigPropInfo[i] ?
+                __system_property_serial(mConfigPropInfo[i]) : 0;
+        if (serial != mConfigPropSerial[i]) {
+            mConfigPropSerial[i] = serial;
+            changed = true;
+        }
+    }
+    if (!changed)
+        return;
+
+    ALOGV("refreshConfig() properties changed, reloading");
+    loadConfig();
+    // AUDIO_PARAMETER_KEY_CONFIG_RELOAD in the HAL's audio_config.h
+    AudioParameter param;
+    param.addInt(String8("audio_config_reload"), 1);
+    mpClientInterface->setParameters(0, param.toString());
+}
+
+void AudioPolicyManager::setSystemProperty(const char* property, const char* value)
+{
+    AudioPolicyManagerBase::setSystemProperty(property, value);
+    refreshConfig();
+    if (!strcmp(property, POLICY_TRACE_PROPERTY)) {
+        startTrace(value);
+    }
 }
 
 extern "C" AudioPolicyInterface* createAudioPolicyManager(AudioPolicyClientInterface *clientInterface)
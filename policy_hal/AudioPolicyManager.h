@@ -19,11 +19,14 @@
 
 
 #include <stdint.h>
+#include <string.h>
 #include <sys/types.h>
+#include <sys/system_properties.h>
 #include <utils/Timers.h>
 #include <utils/Errors.h>
 #include <utils/KeyedVector.h>
 #include <hardware_legacy/AudioPolicyManagerBase.h>
+#include "PolicyTrace.h"
 
 
 namespace android_audio_legacy {
@@ -38,8 +41,16 @@ public:
                 : AudioPolicyManagerBase(clientInterface) {
                     mHdmiAudioDisabled = false;
                     mHdmiAudioEvent = false; 
-                    mPrimarySuspended = 0; mFastSuspended = 0;
-                    mMultiChannelSuspended = 0;}
+                    memset(&mCallTransitions, 0, sizeof(mCallTransitions));
+                    memset(&mPassthroughTransitions, 0,
+                           sizeof(mPassthroughTransitions));
+                    mCallFastStreams = 0;
+                    mDeviceMemoValid = 0;
+                    mDeviceMemoHits = 0; mDeviceMemoMisses = 0;
+                    memset(mConfigPropInfo, 0, sizeof(mConfigPropInfo));
+                    memset(mConfigPropSerial, 0, sizeof(mConfigPropSerial));
+                    refreshConfig();
+                    initTrace();}
 
         virtual ~AudioPolicyManager() {}
 
@@ -69,9 +80,12 @@ public:
         virtual bool isOffloadSupported(const audio_offload_info_t& offloadInfo);
 
         virtual void setPhoneState(int state);
+        virtual void setSystemProperty(const char* property, const char* value);
 
         // true if given state represents a device in a telephony or VoIP call
         virtual bool isStateInCall(int state);
+
+        virtual status_t dump(int fd);
 protected:
         // return the strategy corresponding to a given stream type
         static routing_strategy getStrategy(AudioSystem::stream_type stream);
@@ -89,6 +103,8 @@ protected:
         //  before updateDevicesAndOutputs() is called.
         virtual audio_devices_t getDeviceForStrategy(routing_strategy strategy,
                                                      bool fromCache = true);
+        // routing decision behind getDeviceForStrategy(strategy, false)
+        audio_devices_t computeDeviceForStrategy(routing_strategy strategy);
         // select input device corresponding to requested audio source
         virtual audio_devices_t getDeviceForInputSource(int inputSource);
 
@@ -140,14 +156,109 @@ protected:
         void closeOffloadOutputs();
         void updateAndCloseOutputs();
         bool isHDMIPassthroughEnabled();
+        bool isPassthroughSuspendable(const AudioOutputDescriptor *desc);
 #endif
-        uint32_t mPrimarySuspended;
-        uint32_t mFastSuspended;
-        uint32_t mMultiChannelSuspended;
+
+        // Outputs suspended by this policy and the reasons they are held,
+        // so that a transition only suspends or restores the outputs whose
+        // state actually changes.
+        enum {
+            SUSPEND_FOR_CALL = 0x1,
+            SUSPEND_FOR_PASSTHROUGH = 0x2,
+        };
+        KeyedVector<audio_io_handle_t, uint32_t> mSuspendedOutputs;
+        bool suspendOutputFor(audio_io_handle_t output, uint32_t reason);
+        bool restoreOutputFor(audio_io_handle_t output, uint32_t reason);
+        uint32_t restoreOutputsFor(uint32_t reason);
+
+        struct OutputTransitionStats {
+            uint32_t transitions;
+            uint32_t suspended;
+            uint32_t restored;
+            uint32_t closed;
+            uint32_t invalidations;     // setStreamOutput() calls
+        };
+        OutputTransitionStats mCallTransitions;
+        OutputTransitionStats mPassthroughTransitions;
+        // stream types given an ULL output during the current call
+        uint32_t mCallFastStreams;
 
         int mOldPhoneState;
         bool isExternalModem();
 
+        // Snapshot of the system properties consulted when tracks are created.
+        // refreshConfig() reloads it whenever one of kConfigProperties has a
+        // new serial, and is called from getOutput(), getInput(),
+        // isOffloadSupported(), setPhoneState() and setSystemProperty(). A
+        // reload also asks the HAL to reload its own snapshot. Policy entry
+        // points are serialized by the policy service, so it is read without
+        // locking.
+        struct PolicyConfig {
+            bool voicePlaybackConcDisabled;  // voice.playback.conc.disabled
+            bool voiceRecordConcDisabled;    // voice.record.conc.disabled
+            bool voipConcDisabled;           // voice.voip.conc.disabled
+            bool pcmOffloadEnabled;          // audio.offload.pcm.enable
+            bool offloadDisabled;            // audio.offload.disable
+            bool avOffloadEnabled;           // av.offload.enable
+            bool avStreamingOffloadEnabled;  // av.streaming.offload.enable
+            int minOffloadDurationSecs;      // audio.offload.min.duration.secs, -1 if unset
+            bool multipleOffloadEnabled;     // audio.offload.multiple.enabled
+            bool hdmiPassthroughEnabled;     // audio.offload.passthrough
+            bool externalModem;              // ro.board.platform, ro.baseband
+        };
+        PolicyConfig mConfig;
+        void loadConfig();
+
+        static const size_t kNumConfigProperties = 16;
+        static const char * const kConfigProperties[kNumConfigProperties];
+        const prop_info *mConfigPropInfo[kNumConfigProperties];
+        unsigned int mConfigPropSerial[kNumConfigProperties];
+        void refreshConfig();
+
+        // Memoized getDeviceForStrategy(strategy, false) results. Apart from
+        // STRATEGY_SONIFICATION_RESPECTFUL, which also depends on recent music
+        // activity and is never memoized, the decision is a function of the
+        // inputs below, so the entries stay valid while they do not change.
+        struct DeviceMemoKey {
+            int phoneState;
+            int prevPhoneState;
+            AudioSystem::forced_config forceUse[AudioSystem::NUM_FORCE_USE];
+            audio_devices_t availableOutputDevices;
+            bool a2dpOutput;
+            bool a2dpSuspended;
+        };
+        DeviceMemoKey mDeviceMemoKey;
+        audio_devices_t mDeviceMemo[NUM_STRATEGIES];
+        uint32_t mDeviceMemoValid;      // one bit per strategy
+        uint32_t mDeviceMemoHits;
+        uint32_t mDeviceMemoMisses;
+        void checkDeviceMemo();
+
+        // Entry points behind the traced public ones
+        status_t setDeviceConnectionStateInt(audio_devices_t device,
+                                             AudioSystem::device_connection_state state,
+                                             const char *device_address);
+        void setForceUseInt(AudioSystem::force_use usage, AudioSystem::forced_config config);
+        void setPhoneStateInt(int state);
+        audio_io_handle_t getOutputInt(AudioSystem::stream_type stream,
+                                       uint32_t samplingRate,
+                                       uint32_t format,
+                                       uint32_t channels,
+                                       AudioSystem::output_flags flags,
+                                       const audio_offload_info_t *offloadInfo);
+        status_t startOutputInt(audio_io_handle_t output,
+                                AudioSystem::stream_type stream,
+                                int session);
+        status_t stopOutputInt(audio_io_handle_t output,
+                               AudioSystem::stream_type stream,
+                               int session);
+        void releaseOutputInt(audio_io_handle_t output);
+
+        PolicyTrace mTrace;
+        void initTrace();
+        void startTrace(const char *path);
+        uint32_t traceMusicDevice();
+
         static const char* HDMI_SPKR_STR;
 
         //parameter indicates of HDMI speakers disabled from the Qualcomm settings
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "PolicyTrace"
+//#define LOG_NDEBUG 0
+
+#include <string.h>
+#include <utils/Log.h>
+#include "PolicyTrace.h"
+
+namespace android_audio_legacy {
+
+static const char * const kEventNames[POLICY_TRACE_NUM_EVENTS] = {
+    "invalid",
+    "setDeviceConnectionState",
+    "setPhoneState",
+    "setForceUse",
+    "getOutput",
+    "startOutput",
+    "stopOutput",
+    "releaseOutput",
+    "initialState",
+};
+
+const char *policyTraceEventName(int event)
+{
+    if (event <= 0 || event >= POLICY_TRACE_NUM_EVENTS)
+        return kEventNames[0];
+    return kEventNames[event];
+}
+
+PolicyTrace::PolicyTrace()
+    : mFile(NULL), mRecords(0)
+{
+}
+
+PolicyTrace::~PolicyTrace()
+{
+    close();
+}
+
+void PolicyTrace::open(const char *path)
+{
+    PolicyTraceHeader header;
+
+    close();
+    if (path == NULL || path[0] == '\0')
+        return;
+
+    mFile = fopen(path, "w");
+    if (mFile == NULL) {
+        ALOGE("open() cannot create policy trace %s", path);
+        return;
+    }
+
+    header.magic = POLICY_TRACE_MAGIC;
+    header.version = POLICY_TRACE_VERSION;
+    header.recordSize = sizeof(PolicyTraceRecord);
+    if (fwrite(&header, sizeof(header), 1, mFile) != 1) {
+        ALOGE("open() cannot write policy trace %s", path);
+        close();
+        return;
+    }
+    ALOGD("open() recording policy trace to %s", path);
+}
+
+void PolicyTrace::close()
+{
+    if (mFile == NULL)
+        return;
+    fclose(mFile);
+    mFile = NULL;
+    ALOGD("close() %u records", mRecords);
+    mRecords = 0;
+}
+
+void PolicyTrace::record(PolicyTraceEvent event, nsecs_t startNs,
+                         const int32_t *args, int numArgs, int32_t result,
+                         uint32_t musicDevice,
+                         const void *payload, size_t payloadSize)
+{
+    PolicyTraceRecord record;
+    nsecs_t duration = systemTime() - startNs;
+
+    if (mFile == NULL)
+        return;
+
+    if (payloadSize > POLICY_TRACE_MAX_PAYLOAD)
+        payloadSize = POLICY_TRACE_MAX_PAYLOAD;
+    if (numArgs > POLICY_TRACE_MAX_ARGS)
+        numArgs = POLICY_TRACE_MAX_ARGS;
+
+    memset(&record, 0, sizeof(record));
+    record.event = event;
+    record.payloadSize = payload != NULL ? payloadSize : 0;
+    record.durationNs = duration > 0xffffffffLL ? 0xffffffffU : (uint32_t)duration;
+    memcpy(record.args, args, numArgs * sizeof(int32_t));
+    record.result = result;
+    record.musicDevice = musicDevice;
+
+    if (fwrite(&record, sizeof(record), 1, mFile) != 1 ||
+            (record.payloadSize &&
+             fwrite(payload, record.payloadSize, 1, mFile) != 1) ||
+            fflush(mFile) != 0) {
+        ALOGE("record() write failed, stopping policy trace");
+        close();
+        return;
+    }
+    mRecords++;
+}
+
+bool PolicyTrace::readHeader(FILE *file)
+{
+    PolicyTraceHeader header;
+
+    if (fread(&header, sizeof(header), 1, file) != 1)
+        return false;
+    return header.magic == POLICY_TRACE_MAGIC &&
+           header.version == POLICY_TRACE_VERSION &&
+           header.recordSize == sizeof(PolicyTraceRecord);
+}
+
+bool PolicyTrace::readRecord(FILE *file, PolicyTraceRecord *record,
+                             uint8_t payload[POLICY_TRACE_MAX_PAYLOAD])
+{
+    if (fread(record, sizeof(*record), 1, file) != 1)
+        return false;
+    if (record->event == 0 || record->event >= POLICY_TRACE_NUM_EVENTS)
+        return false;
+    if (record->payloadSize &&
+            fread(payload, record->payloadSize, 1, file) != 1)
+        return false;
+    return true;
+}
+
+}; // namespace android_audio_legacy
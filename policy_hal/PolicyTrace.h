@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_POLICY_TRACE_H
+#define ANDROID_POLICY_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <utils/Timers.h>
+
+namespace android_audio_legacy {
+
+// Binary trace of the policy entry points that drive routing and output
+// selection, written when audio.policy.trace.file names a writable file and
+// read back by the policy_replay test app.
+//
+// The file starts with a PolicyTraceHeader and a POLICY_TRACE_INITIAL_STATE
+// record describing the policy when tracing started, followed by
+// PolicyTraceRecords in call order. A record may be followed by payloadSize
+// bytes of payload: a PolicyTraceState for POLICY_TRACE_INITIAL_STATE, the
+// device address for POLICY_TRACE_DEVICE_CONNECTION and a
+// PolicyTraceOffloadInfo for POLICY_TRACE_GET_OUTPUT with offload info.
+// Output handles are the ones seen on the recording device. Every record is
+// flushed as it is written so a crash only loses the call in progress.
+
+#define POLICY_TRACE_PROPERTY   "audio.policy.trace.file"
+#define POLICY_TRACE_MAGIC      0x54504150  // "PAPT"
+#define POLICY_TRACE_VERSION    2
+#define POLICY_TRACE_MAX_ARGS   5
+#define POLICY_TRACE_MAX_PAYLOAD 255
+#define POLICY_TRACE_MAX_FORCE_USE 8
+#define POLICY_TRACE_ADDRESS_LEN 20
+
+enum PolicyTraceEvent {
+    POLICY_TRACE_DEVICE_CONNECTION = 1, // device, state; result status
+    POLICY_TRACE_PHONE_STATE,           // state
+    POLICY_TRACE_FORCE_USE,             // usage, config
+    POLICY_TRACE_GET_OUTPUT,            // stream, rate, format, channels, flags; result output
+    POLICY_TRACE_START_OUTPUT,          // output, stream, session; result status
+    POLICY_TRACE_STOP_OUTPUT,           // output, stream, session; result status
+    POLICY_TRACE_RELEASE_OUTPUT,        // output
+    POLICY_TRACE_INITIAL_STATE,         // output devices, input devices, phone state
+    POLICY_TRACE_NUM_EVENTS
+};
+
+struct PolicyTraceHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+};
+
+struct PolicyTraceRecord {
+    uint8_t event;
+    uint8_t payloadSize;
+    uint16_t reserved;
+    uint32_t durationNs;            // time spent in the call, saturated
+    int32_t args[POLICY_TRACE_MAX_ARGS];
+    int32_t result;
+    uint32_t musicDevice;           // getDevicesForStream(MUSIC) after the call
+};
+
+struct PolicyTraceOffloadInfo {
+    uint32_t sampleRate;
+    uint32_t channelMask;
+    uint32_t format;
+    uint32_t streamType;
+    uint32_t bitRate;
+    int32_t durationMs;
+    uint8_t hasVideo;
+    uint8_t isStreaming;
+    uint16_t reserved;
+};
+
+struct PolicyTraceState {
+    int32_t forceUse[POLICY_TRACE_MAX_FORCE_USE];
+    char a2dpAddress[POLICY_TRACE_ADDRESS_LEN];
+    char scoAddress[POLICY_TRACE_ADDRESS_LEN];
+    char usbAddress[POLICY_TRACE_ADDRESS_LEN];
+};
+
+const char *policyTraceEventName(int event);
+
+class PolicyTrace {
+public:
+    PolicyTrace();
+    ~PolicyTrace();
+
+    // Starts a new trace in path, or stops tracing if path is empty
+    void open(const char *path);
+    void close();
+    bool enabled() const { return mFile != NULL; }
+
+    void record(PolicyTraceEvent event, nsecs_t startNs,
+                const int32_t *args, int numArgs, int32_t result,
+                uint32_t musicDevice,
+                const void *payload = NULL, size_t payloadSize = 0);
+
+    // Reads the next record and its payload from a trace opened for reading.
+    // Returns false at the end of the trace or on a malformed record.
+    static bool readHeader(FILE *file);
+    static bool readRecord(FILE *file, PolicyTraceRecord *record,
+                           uint8_t payload[POLICY_TRACE_MAX_PAYLOAD]);
+
+private:
+    FILE *mFile;
+    uint32_t mRecords;
+};
+
+}; // namespace android_audio_legacy
+
+#endif // ANDROID_POLICY_TRACE_H
@@ -0,0 +1,382 @@
+/*
+ * Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Replays a policy trace recorded with audio.policy.trace.file against a
+ * fresh AudioPolicyManager whose client interface only hands out handles,
+ * checks that every call makes the same decision as on the device and
+ * prints the time spent per call type.
+ *
+ *   policy_replay TRACEFILE [ITERATIONS]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cutils/properties.h>
+#include <utils/KeyedVector.h>
+#include <utils/Vector.h>
+#include "AudioPolicyManager.h"
+#include "PolicyTrace.h"
+
+using namespace android;
+using namespace android_audio_legacy;
+
+#define MAX_REPORTED_MISMATCHES 20
+
+class ReplayClient : public AudioPolicyClientInterface
+{
+public:
+    ReplayClient() : mNextHandle(1) {}
+    virtual ~ReplayClient() {}
+
+    virtual audio_module_handle_t loadHwModule(const char *name __unused)
+    {
+        return mNextHandle++;
+    }
+    virtual audio_io_handle_t openOutput(audio_module_handle_t module __unused,
+                                         audio_devices_t *pDevices __unused,
+                                         uint32_t *pSamplingRate,
+                                         audio_format_t *pFormat,
+                                         audio_channel_mask_t *pChannelMask,
+                                         uint32_t *pLatencyMs,
+                                         audio_output_flags_t flags __unused,
+                                         const audio_offload_info_t *offloadInfo __unused)
+    {
+        if (*pSamplingRate == 0)
+            *pSamplingRate = 48000;
+        if (*pFormat == AUDIO_FORMAT_DEFAULT)
+            *pFormat = AUDIO_FORMAT_PCM_16_BIT;
+        if (*pChannelMask == 0)
+            *pChannelMask = AUDIO_CHANNEL_OUT_STEREO;
+        *pLatencyMs = 20;
+        return mNextHandle++;
+    }
+    virtual audio_io_handle_t openDuplicateOutput(audio_io_handle_t output1 __unused,
+                                                  audio_io_handle_t output2 __unused)
+    {
+        return mNextHandle++;
+    }
+    virtual status_t closeOutput(audio_io_handle_t output __unused) { return NO_ERROR; }
+    virtual status_t suspendOutput(audio_io_handle_t output __unused) { return NO_ERROR; }
+    virtual status_t restoreOutput(audio_io_handle_t output __unused) { return NO_ERROR; }
+    virtual audio_io_handle_t openInput(audio_module_handle_t module __unused,
+                                        audio_devices_t *pDevices __unused,
+                                        uint32_t *pSamplingRate __unused,
+                                        audio_format_t *pFormat __unused,
+                                        audio_channel_mask_t *pChannelMask __unused)
+    {
+        return mNextHandle++;
+    }
+    virtual status_t closeInput(audio_io_handle_t input __unused) { return NO_ERROR; }
+    virtual status_t setStreamVolume(AudioSystem::stream_type stream __unused,
+                                     float volume __unused,
+                                     audio_io_handle_t output __unused,
+                                     int delayMs __unused)
+    {
+        return NO_ERROR;
+    }
+    virtual status_t setStreamOutput(AudioSystem::stream_type stream __unused,
+                                     audio_io_handle_t output __unused)
+    {
+        return NO_ERROR;
+    }
+    virtual void setParameters(audio_io_handle_t ioHandle __unused,
+                               const String8& keyValuePairs __unused,
+                               int delayMs __unused) {}
+    virtual String8 getParameters(audio_io_handle_t ioHandle __unused,
+                                  const String8& keys __unused)
+    {
+        return String8("");
+    }
+    virtual status_t startTone(ToneGenerator::tone_type tone __unused,
+                               AudioSystem::stream_type stream __unused)
+    {
+        return NO_ERROR;
+    }
+    virtual status_t stopTone() { return NO_ERROR; }
+    virtual status_t setVoiceVolume(float volume __unused, int delayMs __unused)
+    {
+        return NO_ERROR;
+    }
+    virtual status_t moveEffects(int session __unused,
+                                 audio_io_handle_t srcOutput __unused,
+                                 audio_io_handle_t dstOutput __unused)
+    {
+        return NO_ERROR;
+    }
+
+private:
+    int mNextHandle;
+};
+
+struct EventStats {
+    uint32_t calls;
+    uint32_t mismatches;
+    uint64_t recordedNs;
+    Vector<nsecs_t> replayNs;
+};
+
+static EventStats gStats[POLICY_TRACE_NUM_EVENTS];
+static uint32_t gReported;
+
+static int compareNs(const void *a, const void *b)
+{
+    nsecs_t x = *(const nsecs_t *)a, y = *(const nsecs_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Output handles differ between the device and the replay; map them the
+// first time a recorded handle is returned by getOutput().
+static audio_io_handle_t mapOutput(KeyedVector<int32_t, audio_io_handle_t> &outputs,
+                                   int32_t recorded)
+{
+    ssize_t index = outputs.indexOfKey(recorded);
+    return index < 0 ? 0 : outputs.valueAt(index);
+}
+
+static void reportMismatch(uint32_t index, const PolicyTraceRecord &record,
+                           int32_t result, uint32_t musicDevice)
+{
+    if (gReported++ >= MAX_REPORTED_MISMATCHES)
+        return;
+    printf("MISMATCH: record[%u] %s args[%d %d %d %d %d] result[%d/%d] "
+           "music-device[0x%x/0x%x]\n", index,
+           policyTraceEventName(record.event), record.args[0], record.args[1],
+           record.args[2], record.args[3], record.args[4],
+           record.result, result, record.musicDevice, musicDevice);
+}
+
+static const char *stateAddress(const PolicyTraceState &state, audio_devices_t device)
+{
+    if (audio_is_a2dp_device(device))
+        return state.a2dpAddress;
+    if (audio_is_bluetooth_sco_device(device))
+        return state.scoAddress;
+    if (audio_is_usb_device(device))
+        return state.usbAddress;
+    return "";
+}
+
+// Makes the availability of every device in mask match the recorded one
+static void applyDevices(AudioPolicyManager *apm, const PolicyTraceState &state,
+                         uint32_t recorded, uint32_t mask, uint32_t inBit)
+{
+    for (uint32_t bit = 1; bit != 0 && bit <= mask; bit <<= 1) {
+        if (!(mask & bit))
+            continue;
+        audio_devices_t device = (audio_devices_t)(bit | inBit);
+        const char *address = stateAddress(state, device);
+        AudioSystem::device_connection_state want = (recorded & bit) ?
+                AudioSystem::DEVICE_STATE_AVAILABLE :
+                AudioSystem::DEVICE_STATE_UNAVAILABLE;
+        if (apm->getDeviceConnectionState(device, address) != want)
+            apm->setDeviceConnectionState(device, want, address);
+    }
+}
+
+static void applyInitialState(AudioPolicyManager *apm, const PolicyTraceRecord &record,
+                              const uint8_t *payload)
+{
+    PolicyTraceState state;
+
+    if (record.payloadSize != sizeof(state))
+        return;
+    memcpy(&state, payload, sizeof(state));
+
+    applyDevices(apm, state, record.args[0], AUDIO_DEVICE_OUT_ALL, 0);
+    applyDevices(apm, state, record.args[1] & ~AUDIO_DEVICE_BIT_IN,
+                 AUDIO_DEVICE_IN_ALL & ~AUDIO_DEVICE_BIT_IN, AUDIO_DEVICE_BIT_IN);
+    for (int i = 0; i < AudioSystem::NUM_FORCE_USE && i < POLICY_TRACE_MAX_FORCE_USE; i++)
+        apm->setForceUse((AudioSystem::force_use)i,
+                         (AudioSystem::forced_config)state.forceUse[i]);
+    apm->setPhoneState(record.args[2]);
+}
+
+static bool replayOnce(FILE *file)
+{
+    ReplayClient client;
+    AudioPolicyManager *apm = new AudioPolicyManager(&client);
+    KeyedVector<int32_t, audio_io_handle_t> outputs;
+    PolicyTraceRecord record;
+    uint8_t payload[POLICY_TRACE_MAX_PAYLOAD + 1];
+    uint32_t index = 0;
+
+    rewind(file);
+    if (!PolicyTrace::readHeader(file)) {
+        fprintf(stderr, "not a policy trace or unsupported version\n");
+        delete apm;
+        return false;
+    }
+
+    while (PolicyTrace::readRecord(file, &record, payload)) {
+        EventStats &stats = gStats[record.event];
+        int32_t result = 0;
+        bool match = true;
+        nsecs_t start = systemTime();
+
+        switch (record.event) {
+        case POLICY_TRACE_DEVICE_CONNECTION:
+            payload[record.payloadSize] = '\0';
+            result = apm->setDeviceConnectionState((audio_devices_t)record.args[0],
+                    (AudioSystem::device_connection_state)record.args[1],
+                    (const char *)payload);
+            match = result == record.result;
+            break;
+        case POLICY_TRACE_PHONE_STATE:
+            apm->setPhoneState(record.args[0]);
+            break;
+        case POLICY_TRACE_FORCE_USE:
+            apm->setForceUse((AudioSystem::force_use)record.args[0],
+                             (AudioSystem::forced_config)record.args[1]);
+            break;
+        case POLICY_TRACE_GET_OUTPUT: {
+            audio_offload_info_t info;
+            const audio_offload_info_t *offloadInfo = NULL;
+
+            if (record.payloadSize == sizeof(PolicyTraceOffloadInfo)) {
+                PolicyTraceOffloadInfo traced;
+                memcpy(&traced, payload, sizeof(traced));
+                memset(&info, 0, sizeof(info));
+                info.version = AUDIO_OFFLOAD_INFO_VERSION_CURRENT;
+                info.size = sizeof(info);
+                info.sample_rate = traced.sampleRate;
+                info.channel_mask = traced.channelMask;
+                info.format = (audio_format_t)traced.format;
+                info.stream_type = (audio_stream_type_t)traced.streamType;
+                info.bit_rate = traced.bitRate;
+                info.duration_us = (int64_t)traced.durationMs * 1000;
+                info.has_video = traced.hasVideo;
+                info.is_streaming = traced.isStreaming;
+                offloadInfo = &info;
+            }
+            result = apm->getOutput((AudioSystem::stream_type)record.args[0],
+                                    record.args[1], record.args[2], record.args[3],
+                                    (AudioSystem::output_flags)record.args[4],
+                                    offloadInfo);
+            if (record.result == 0 || result == 0) {
+                match = record.result == result;
+            } else if (outputs.indexOfKey(record.result) < 0) {
+                outputs.add(record.result, result);
+            } else {
+                match = mapOutput(outputs, record.result) == result;
+            }
+        } break;
+        case POLICY_TRACE_START_OUTPUT:
+            result = apm->startOutput(mapOutput(outputs, record.args[0]),
+                                      (AudioSystem::stream_type)record.args[1],
+                                      record.args[2]);
+            match = result == record.result;
+            break;
+        case POLICY_TRACE_STOP_OUTPUT:
+            result = apm->stopOutput(mapOutput(outputs, record.args[0]),
+                                     (AudioSystem::stream_type)record.args[1],
+                                     record.args[2]);
+            match = result == record.result;
+            break;
+        case POLICY_TRACE_RELEASE_OUTPUT:
+            apm->releaseOutput(mapOutput(outputs, record.args[0]));
+            break;
+        case POLICY_TRACE_INITIAL_STATE:
+            applyInitialState(apm, record, payload);
+            break;
+        }
+        stats.replayNs.add(systemTime() - start);
+
+        uint32_t musicDevice = apm->getDevicesForStream(AudioSystem::MUSIC);
+        if (musicDevice != record.musicDevice)
+            match = false;
+
+        stats.calls++;
+        stats.recordedNs += record.durationNs;
+        if (!match) {
+            stats.mismatches++;
+            reportMismatch(index, record, result, musicDevice);
+        }
+        index++;
+    }
+
+    delete apm;
+    return true;
+}
+
+static void printStats()
+{
+    uint32_t calls = 0, mismatches = 0;
+
+    for (int event = 1; event < POLICY_TRACE_NUM_EVENTS; event++) {
+        EventStats &stats = gStats[event];
+        size_t n = stats.replayNs.size();
+        nsecs_t total = 0;
+
+        if (n == 0)
+            continue;
+        qsort(stats.replayNs.editArray(), n, sizeof(nsecs_t), compareNs);
+        for (size_t i = 0; i < n; i++)
+            total += stats.replayNs[i];
+
+        printf("BENCH: %s calls[%u] mismatches[%u] device-mean-us[%.1f] "
+               "replay-mean-us[%.1f] p50-us[%.1f] p99-us[%.1f] max-us[%.1f]\n",
+               policyTraceEventName(event), stats.calls, stats.mismatches,
+               stats.recordedNs / 1000.0 / stats.calls, total / 1000.0 / n,
+               stats.replayNs[n / 2] / 1000.0,
+               stats.replayNs[(n * 99) / 100] / 1000.0,
+               stats.replayNs[n - 1] / 1000.0);
+        calls += stats.calls;
+        mismatches += stats.mismatches;
+    }
+    printf("BENCH: total calls[%u] mismatches[%u]\n", calls, mismatches);
+}
+
+int main(int argc, char **argv)
+{
+    char value[PROPERTY_VALUE_MAX] = {0};
+    int iterations = 1;
+    FILE *file;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s TRACEFILE [ITERATIONS]\n", argv[0]);
+        return 1;
+    }
+    if (argc > 2)
+        iterations = atoi(argv[2]);
+    if (iterations < 1)
+        iterations = 1;
+
+    // The policy under test would otherwise start a trace of its own
+    property_get(POLICY_TRACE_PROPERTY, value, "");
+    if (value[0] != '\0') {
+        fprintf(stderr, "unset %s before replaying\n", POLICY_TRACE_PROPERTY);
+        return 1;
+    }
+
+    file = fopen(argv[1], "r");
+    if (file == NULL) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    for (int i = 0; i < iterations; i++) {
+        if (!replayOnce(file)) {
+            fclose(file);
+            return 1;
+        }
+    }
+    fclose(file);
+
+    printStats();
+    return gReported ? 2 : 0;
+}